@@ -0,0 +1,71 @@
+/*
+ * bit_order.h
+ *
+ * entropy-driven RID bit reordering.
+ *
+ * the PT branches on RID bits in raw order (see bit() in pt.c), but Bloom
+ * filter bits aren't equally informative: some positions are set in a lot
+ * more FIB entries than others. a bit which is '1' in about half of the
+ * entries splits the trie evenly, while a bit which is (almost) always '0'
+ * barely discriminates anything.
+ *
+ * the bit order is a permutation of the RID bits, computed from the per-bit
+ * set frequency over all FIB entries: bits are sorted by decreasing entropy,
+ * so that the most discriminating bits end up at the top of the tries. the
+ * same permutation must be applied to all stored RIDs and all requests:
+ * since it's a bijection, (R & F) == F still holds iff it held before.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _BIT_ORDER_H_
+#define _BIT_ORDER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "pt.h"
+
+#define BIT_ORDER_BITS      (8 * CLICK_XIA_XID_ID_LEN)
+
+/*
+ * \brief a permutation of RID bits, in the bit order of bit() in pt.c.
+ */
+struct rid_perm {
+
+    // bit i of a permuted RID is bit map[i] of the original RID
+    uint8_t map[BIT_ORDER_BITS];
+
+    // fraction of FIB entries w/ original bit i set
+    double freq[BIT_ORDER_BITS];
+};
+
+extern void rid_perm_init(struct rid_perm * perm, struct pt_ht * fib);
+extern void rid_perm_apply(struct rid_perm * perm, struct click_xia_xid * rid);
+
+extern void bit_order_apply(
+        struct pt_ht * fib,
+        struct rid_perm * perm,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _BIT_ORDER_H_ */
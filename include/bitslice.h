@@ -0,0 +1,105 @@
+/*
+ * bitslice.h
+ *
+ * bit-sliced signature RID FIB engine (a la BitFunnel).
+ *
+ * the entries of a FIB partition are stored 'sideways': one bitmap (or
+ * 'slice') per RID bit position, w/ 1 bit per entry. an entry F matches a
+ * request R iff (R & F) == F, i.e. iff F has no '1' where R has a '0'. the
+ * match set of R is then the AND-NOT of all slices for which R has a '0' bit:
+ *
+ *      matches(R) = ~slice[b_0] & ~slice[b_1] & ... , for all b_i : R[b_i] = 0
+ *
+ * slices are cut into blocks of BS_BLOCK_ENTRIES entries (row groups), so
+ * that all 160 slices of a block fit in L2 cache while being AND-NOT'd
+ * together. there's no pointer chasing at all: prefix strings are only
+ * consulted for matches, in order to tell TPs from FPs.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _BITSLICE_H_
+#define _BITSLICE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+#include "pt.h"
+
+// nr. of RID bits, i.e. nr. of slices
+#define BS_SLICES               (8 * CLICK_XIA_XID_ID_LEN)
+
+// max. 64 bit words per slice, per block. 64 words -> 4096 entries per 
+// block, i.e. 160 slices x 512 byte = 80 KB per block, which fits in L2. 
+// smaller partitions use smaller blocks, in multiples of 4 words (1 AVX2 
+// register).
+#define BS_BLOCK_WORDS          64
+#define BS_BLOCK_ENTRIES        (BS_BLOCK_WORDS * 64)
+
+// check if a block ran out of candidates every BS_CHECK_INTERVAL slices
+#define BS_CHECK_INTERVAL       8
+
+/*
+ * \brief bit-sliced fwd table for a single FIB partition (prefix size).
+ */
+struct bs_fwd {
+
+    // FIB partition the entries were collected from
+    struct pt_ht * fib_root;
+
+    // prefix size (in number of encoded elements)
+    int prefix_size;
+
+    // nr. of forwarding entries and blocks
+    uint32_t num_entries;
+    uint32_t num_blocks;
+
+    // 64 bit words per slice, per block (<= BS_BLOCK_WORDS)
+    uint32_t block_words;
+
+    // slices, block by block: the slice for bit b of block k starts at
+    // slices[((k * BS_SLICES) + b) * block_words]
+    uint64_t * slices;
+
+    // RID bit positions, from the most to the least dense slice. the
+    // densest slices knock out the most candidates, so these go 1st.
+    uint8_t slice_order[BS_SLICES];
+
+    // prefix info of each entry (NOT a copy: these belong to the pt_fwd
+    // nodes the entries were collected from)
+    struct prefix_info ** prefix_i;
+
+    // next hop of each entry (see pt_fwd.port)
+    uint16_t * ports;
+};
+
+extern struct bs_fwd * bs_fwd_init(struct pt_ht * partition);
+extern void bs_fwd_erase(struct bs_fwd * bs);
+
+extern int bs_fwd_lookup(
+        struct bs_fwd * bs,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats);
+
+#endif /* _BITSLICE_H_ */
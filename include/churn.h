@@ -0,0 +1,84 @@
+/*
+ * churn.h
+ *
+ * FIB churn benchmark: a stream of online updates (adds and removes of
+ * URLs, see pt_ht_add_url() and pt_ht_remove_url()) applied to a FIB.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _CHURN_H_
+#define _CHURN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "rid_utils.h"
+#include "pt.h"
+#include "bit_order.h"
+
+#define CHURN_OP_ADD        0x00
+#define CHURN_OP_REMOVE     0x01
+
+// nr. of windows the update stream is split into, for reporting
+#define CHURN_WINDOWS       10
+
+// max. nr. of random URLs tried as the base of an add
+#define CHURN_ADD_TRIES     64
+
+// mixed read/write benchmark: passes over the requests by each reader, and
+// nr. of concurrent readers
+#define CHURN_RCU_ROUNDS    20
+#define CHURN_RCU_READERS   4
+
+/*
+ * \brief an online update
+ */
+struct churn_update {
+    int op;
+    std::string url;
+};
+
+extern void churn_generate(
+        std::vector<std::string> & urls,
+        int num_updates,
+        std::vector<struct churn_update> & updates);
+
+extern int churn_apply(
+        struct pt_ht ** fib,
+        struct churn_update * update,
+        struct rid_perm * perm);
+
+extern void churn_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        int num_updates,
+        std::string output_dir);
+
+extern void churn_rcu_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        struct rid_request * requests,
+        int requests_num,
+        double update_rate,
+        std::string output_dir);
+
+#endif /* _CHURN_H_ */
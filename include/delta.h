@@ -0,0 +1,139 @@
+/*
+ * delta.h
+ *
+ * FIB deltas: lists of entries to add to and remove from a FIB, keyed by
+ * (RID, prefix), which can be saved to / loaded from a binary delta file.
+ *
+ * applying a delta to a FIB costs 1 insert or remove per record, i.e. it's
+ * proportional to the delta size, not to the FIB size (but see below). a
+ * delta can also be merged into a base snapshot offline (see snapshot.h):
+ * the snapshot is loaded, the delta applied and a new snapshot written.
+ *
+ * XXX: partitions of a FIB loaded from a snapshot only live in the
+ * read-only mapping. the 1st update of such a partition re-builds its
+ * trie (see pt_ht_thaw()), which is a one-off cost proportional to the
+ * partition size.
+ *
+ * file layout:
+ *
+ *  -# header (struct delta_header)
+ *  -# records (header.num_records x struct delta_record), applied in order
+ *  -# string blob ('\0' terminated prefix strings)
+ *
+ * delta files can be created from text files w/ 1 URL per line, prefixed
+ * by '+' (add) or '-' (remove). added URLs may be followed by their next
+ * hop (port), as in URL files.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _DELTA_H_
+#define _DELTA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "pt.h"
+#include "bit_order.h"
+
+#define DELTA_MAGIC         "RIDDELTA"
+#define DELTA_MAGIC_LEN     8
+#define DELTA_VERSION       2
+
+#define DELTA_OP_ADD        0x00
+#define DELTA_OP_REMOVE     0x01
+
+// delta sizes run by delta_bench()
+#define DELTA_BENCH_SIZES   {1000, 10000, 100000}
+
+struct delta_header {
+
+    char magic[DELTA_MAGIC_LEN];
+    uint32_t version;
+    uint32_t header_size;
+
+    uint64_t file_size;
+    uint64_t num_records;
+    uint64_t strings_size;
+
+    // FNV-1a over records and strings
+    uint64_t checksum;
+};
+
+struct delta_record {
+
+    // DELTA_OP_*
+    uint8_t op;
+    uint8_t prefix_size;
+    // next hop of added entries (PT_PORT_NONE if none)
+    uint16_t port;
+
+    // RID, in identity bit order
+    struct click_xia_xid rid;
+
+    // offset of the prefix string (in the string blob)
+    uint32_t prefix;
+};
+
+struct fib_delta {
+
+    struct delta_record * records;
+    uint32_t num_records;
+    uint32_t max_records;
+
+    char * strings;
+    size_t strings_size;
+    size_t max_strings;
+};
+
+extern struct fib_delta * delta_init();
+extern void delta_erase(struct fib_delta * delta);
+
+extern void delta_add(
+        struct fib_delta * delta,
+        uint8_t op,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port);
+
+extern struct fib_delta * delta_from_urls(const char * filename);
+
+extern int delta_save(struct fib_delta * delta, const char * filename);
+extern struct fib_delta * delta_load(const char * filename);
+
+extern int delta_apply(
+        struct fib_delta * delta,
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        uint32_t * skipped);
+
+extern int delta_merge_snapshot(
+        const char * base_file,
+        struct fib_delta * delta,
+        const char * out_file);
+
+extern void delta_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        std::string output_dir);
+
+#endif /* _DELTA_H_ */
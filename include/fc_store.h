@@ -0,0 +1,62 @@
+/*
+ * fc_store.h
+ *
+ * front-coded string store: a read-only set of strings, sorted and split in
+ * blocks of FC_BLOCK_SIZE strings. the 1st string of a block is kept as
+ * is, the others as the length of the prefix they share w/ the previous
+ * string plus their remaining suffix. URL prefixes share long host and path
+ * prefixes, so most of each string goes away.
+ *
+ * strings are referenced by ID, i.e. their rank in sorted order. getting a
+ * string back decodes (at most) FC_BLOCK_SIZE strings of its block.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _FC_STORE_H_
+#define _FC_STORE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#define FC_BLOCK_SIZE   16
+
+struct fc_store {
+
+    uint32_t num_strings;
+
+    // byte offset of each block in data
+    uint32_t * blocks;
+    uint32_t num_blocks;
+
+    uint8_t * data;
+    size_t data_size;
+};
+
+extern struct fc_store * fc_store_init(std::vector<std::string> & strings);
+extern void fc_store_erase(struct fc_store * store);
+
+extern int fc_store_get(struct fc_store * store, uint32_t id, char * str, size_t max_size);
+extern int64_t fc_store_find(struct fc_store * store, const char * str);
+
+extern size_t fc_store_memory(struct fc_store * store);
+
+#endif /* _FC_STORE_H_ */
@@ -0,0 +1,59 @@
+/*
+ * fib_compress.h
+ *
+ * FIB compression: removal of entries which are redundant for forwarding.
+ * an entry F is redundant if it has the same next hop as the longest entry
+ * G whose prefix is a (component-wise) prefix of F's, e.g. F = 'a/b/c' and
+ * G = 'a/b'. RIDs encode all sub-prefixes of a name (see name_to_rid()), so
+ * G's RID is a subset of F's and every request which matches F also
+ * matches G: dropping F changes neither the union of the ports of the
+ * matches, nor the next hop of the longest confirmed match (G, or an
+ * entry w/ the same next hop, takes F's place).
+ *
+ * the pass removes entries w/ pt_ht_partition_remove(), so it can run
+ * offline (right after building the FIB) or online, on a FIB which is
+ * being looked up and updated. the number of removed entries per partition
+ * goes to pt_ht.fea_n and their share of the partition to pt_ht.fea.
+ *
+ * XXX: entries w/o next hop (PT_PORT_NONE) are never removed. a removed
+ * entry isn't brought back if its covering entry is removed or changes
+ * its next hop afterwards: re-run the pass on the full FIB instead.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _FIB_COMPRESS_H_
+#define _FIB_COMPRESS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "pt.h"
+
+extern int fib_compress(struct pt_ht * fib);
+
+extern void fib_compress_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _FIB_COMPRESS_H_ */
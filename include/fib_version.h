@@ -0,0 +1,112 @@
+/*
+ * fib_version.h
+ *
+ * copy-on-write FIB versions: a FIB handle holds the current (published)
+ * version of a FIB, which lookups use, and lets a writer build the next
+ * version in the background and publish it w/ a single atomic pointer
+ * exchange.
+ *
+ * a version is an array of FIB partitions, indexed by prefix size.
+ * partitions are shared between versions until they're updated: the 1st
+ * update of a partition in the next version works on a private copy of it
+ * (see pt_ht_clone_partition()). a version replaced by a newer one is
+ * retired through the handle's epoch-based reclamation domain (see rcu.h),
+ * and partitions no version refers to anymore are freed once no reader can
+ * still be looking them up.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _FIB_VERSION_H_
+#define _FIB_VERSION_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "rid_utils.h"
+#include "pt.h"
+#include "rcu.h"
+#include "bit_order.h"
+
+// lookups before/after the swap reported separately by fib_handle_bench()
+#define FIB_VERSION_SWAP_WINDOW     1000
+
+struct fib_version {
+
+    uint64_t id;
+
+    // partitions, indexed by prefix size (NULL if there's none)
+    struct pt_ht * parts[MAX_PREFIX_SIZE + 1];
+
+    // 1 if the partition is private to this version (not published yet)
+    int priv[MAX_PREFIX_SIZE + 1];
+};
+
+struct fib_handle {
+
+    // published version, read w/ rcu_dereference()
+    struct fib_version * current;
+
+    // version being built, NULL if none (writer only)
+    struct fib_version * next;
+
+    // nr. of versions (current, next or retired) referring to a partition
+    std::unordered_map<struct pt_ht *, int> * refs;
+
+    struct rcu_domain * rcu;
+    uint64_t num_versions;
+};
+
+extern struct fib_handle * fib_handle_init(struct pt_ht ** fib);
+extern struct pt_ht * fib_handle_detach(struct fib_handle * handle);
+
+extern void fib_handle_begin(struct fib_handle * handle);
+extern int fib_handle_add(
+        struct fib_handle * handle,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size);
+extern int fib_handle_remove(
+        struct fib_handle * handle,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size);
+extern double fib_handle_commit(struct fib_handle * handle);
+extern void fib_handle_abort(struct fib_handle * handle);
+
+extern void fib_handle_lookup(
+        struct fib_handle * handle,
+        int reader,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes);
+
+extern void fib_handle_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        struct rid_request * requests,
+        int requests_num,
+        int num_updates,
+        std::string output_dir);
+
+#endif /* _FIB_VERSION_H_ */
@@ -0,0 +1,97 @@
+/*
+ * hp_arena.h
+ *
+ * huge page backed memory arena for the FIB's trie nodes and RIDs. nodes
+ * malloc()'d one by one end up scattered over the heap, so a lookup in a
+ * large FIB touches ~1 (4 KB) page per visited node, i.e. pays a TLB miss
+ * on top of a cache miss. the arena packs nodes into 2 MB pages instead,
+ * either explicit (hugetlbfs, MAP_HUGETLB) or transparent (THP,
+ * madvise(MADV_HUGEPAGE)).
+ *
+ * allocation is a bump pointer, w/ a free list per size class, so that
+ * nodes removed by updates are re-used. both are under a lock, since tries
+ * are built by several threads at once (see pt_bulk.h). explicit huge pages must be
+ * reserved beforehand (/proc/sys/vm/nr_hugepages): the arena is sized to
+ * the free huge pages (capped to the requested size) and falls back to THP
+ * if there are none. callers fall back to malloc() when the arena is full.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _HP_ARENA_H_
+#define _HP_ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define HP_PAGE_SIZE        (2UL << 20)
+#define HP_ALIGN            8
+// size classes (multiples of HP_ALIGN) w/ a free list
+#define HP_SIZE_CLASSES     64
+
+#define HP_MODE_NONE        0x00
+#define HP_MODE_THP         0x01
+#define HP_MODE_EXPLICIT    0x02
+
+// default arena size. w/ THP, only the pages actually used are backed.
+#define HP_DEFAULT_SIZE     (4UL << 30)
+
+struct hp_free {
+    struct hp_free * next;
+};
+
+struct hp_arena {
+
+    // HP_MODE_*
+    int mode;
+
+    char * base;
+    size_t size;
+    size_t used;
+
+    struct hp_free * free_lists[HP_SIZE_CLASSES];
+    pthread_mutex_t lock;
+
+    uint64_t num_allocs;
+    uint64_t num_reused;
+    uint64_t num_fallbacks;
+};
+
+extern int hp_mode(const char * mode);
+extern const char * hp_mode_name(int mode);
+
+extern struct hp_arena * hp_arena_init(size_t size, int mode);
+extern void hp_arena_erase(struct hp_arena * arena);
+
+extern void * hp_arena_alloc(struct hp_arena * arena, size_t size);
+extern void hp_arena_free(struct hp_arena * arena, void * ptr, size_t size);
+
+extern size_t hp_arena_huge_bytes(struct hp_arena * arena);
+extern void hp_arena_print(struct hp_arena * arena);
+
+/*
+ * \brief 1 if ptr was allocated from the arena
+ */
+static __inline int hp_arena_owns(struct hp_arena * arena, void * ptr) {
+
+    return (arena != NULL
+        && (char *) ptr >= arena->base && (char *) ptr < (arena->base + arena->size));
+}
+
+#endif /* _HP_ARENA_H_ */
@@ -32,10 +32,13 @@
 
 struct prefix_info {
 
-    // pointer to a copy of the respective prefix URL, in its non-encoded form
-    char * prefix;
     // FIXME: this may be useless, but i'll keep it...
     uint8_t prefix_size;
+
+    // the respective prefix URL, in its non-encoded form, as the IDs of its
+    // components in the default prefix dictionary (see prefix_dict.h)
+    uint16_t num_comps;
+    uint32_t comps[];
 };
 
 struct lookup_stats {
@@ -79,6 +82,10 @@ extern void lookup_stats_update(
         uint32_t tns,
         uint32_t total_matches);
 
+extern void lookup_stats_add_tns(struct lookup_stats * stats, uint32_t tns);
+
+extern void lookup_stats_reset(struct lookup_stats * stats);
+
 extern struct lookup_stats * lookup_stats_add(
         struct lookup_stats ** ht,
         struct lookup_stats * node);
@@ -0,0 +1,110 @@
+/*
+ * louds.h
+ *
+ * succinct (read-only) RID FIB engine: the trie of a FIB partition encoded
+ * w/ LOUDS (level-order unary degree sequence), for bytes per entry rather
+ * than lookup speed.
+ *
+ * lookups only ever follow the downward links of a patricia trie: an upward
+ * link ends the walk (see pt_fwd_lookup()). so the topology is just a binary
+ * tree, encoded level by level (breadth-first) w/ 2 bits per node, 1 per
+ * child slot (left, right), set if the child exists. nodes are numbered in
+ * the same order, root first, so the child at slot position p is node:
+ *
+ *      rank1(p) + 1
+ *
+ * where rank1(p) is the nr. of 1s before p, answered in O(1) out of a
+ * directory of cumulative counts every LOUDS_RANK_BITS bits plus a
+ * popcount. a top-down walk needs no select (which would be for parents).
+ *
+ * the other per node fields are packed arrays in the same order: key bits
+ * (1 byte), RIDs (CLICK_XIA_XID_ID_LEN byte, w/o the XID type) and prefix
+ * string IDs (ceil(log2(# strings)) bits) into a front-coded store (see
+ * fc_store.h).
+ *
+ * lookups behave (and update stats) exactly as pt_fwd_lookup().
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _LOUDS_H_
+#define _LOUDS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+#include "pt.h"
+#include "fc_store.h"
+
+// bits per rank directory entry
+#define LOUDS_RANK_BITS     512
+#define LOUDS_RANK_WORDS    (LOUDS_RANK_BITS / 64)
+
+struct louds_fwd {
+
+    // FIB partition the trie was encoded from
+    struct pt_ht * fib_root;
+
+    // prefix size (in number of encoded elements)
+    int prefix_size;
+
+    // nr. of nodes, root included
+    uint32_t num_nodes;
+
+    // topology: bits 2i and 2i + 1 for the left and right children of node
+    // i, and the nr. of 1s before each LOUDS_RANK_BITS bits
+    uint64_t * bits;
+    uint32_t * ranks;
+    uint32_t num_words;
+
+    uint8_t * key_bits;
+    uint8_t * rids;
+
+    // next hop of each node (see pt_fwd.port)
+    uint16_t * ports;
+
+    // prefix string IDs, id_width bits each
+    uint64_t * prefix_ids;
+    uint32_t id_width;
+    struct fc_store * prefixes;
+};
+
+extern struct louds_fwd * louds_fwd_init(struct pt_ht * partition);
+extern void louds_fwd_erase(struct louds_fwd * louds);
+extern size_t louds_fwd_memory(struct louds_fwd * louds);
+
+extern int louds_fwd_lookup(
+        struct louds_fwd * louds,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports);
+
+extern void louds_ht_print_stats(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _LOUDS_H_ */
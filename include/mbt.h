@@ -0,0 +1,128 @@
+/*
+ * mbt.h
+ *
+ * multi-bit stride trie RID FIB engine (Tree Bitmap style).
+ *
+ * instead of testing 1 bit per node as the PT does, each node of a multi-bit
+ * trie (MBT) consumes MBT_STRIDE RID bits at once (in the same bit order as
+ * the PT, see bit() in pt.c). a node keeps a bitmap of its non-empty children,
+ * and the children themselves are stored contiguously in a node array, so
+ * that child c is found at:
+ *
+ *      child_base + popcount(child_bitmap & ((1 << c) - 1))
+ *
+ * subtrees w/ at most MBT_LEAF_SIZE entries are stored as leaf buckets, which
+ * are tested linearly.
+ *
+ * subset semantics: a request R can only match entries F s.t. (R & F) == F,
+ * so at a node where R has stride bits r, only the children whose index is a
+ * submask of r are explored.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _MBT_H_
+#define _MBT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+#include "pt.h"
+
+// nr. of RID bits consumed per node, and resulting nr. of children per node
+#define MBT_STRIDE          4
+#define MBT_FANOUT          (1 << MBT_STRIDE)
+#define MBT_MAX_DEPTH       ((8 * CLICK_XIA_XID_ID_LEN) / MBT_STRIDE)
+
+// max. nr. of entries in a leaf bucket
+#define MBT_LEAF_SIZE       8
+
+/*
+ * \brief multi-bit trie node. internal nodes have a non-zero child bitmap,
+ * leaf buckets have entries_num > 0 (or neither, for an empty trie).
+ */
+struct mbt_node {
+
+    // bit c is set iff child c exists
+    uint16_t child_bitmap;
+
+    // nr. of entries in the leaf bucket
+    uint16_t entries_num;
+
+    // index of the 1st child (in mbt_fwd.nodes) or the 1st entry of the
+    // leaf bucket (in mbt_fwd.rids)
+    uint32_t base;
+};
+
+/*
+ * \brief multi-bit trie fwd table for a single FIB partition (prefix size).
+ */
+struct mbt_fwd {
+
+    // FIB partition the entries were collected from
+    struct pt_ht * fib_root;
+
+    // prefix size (in number of encoded elements)
+    int prefix_size;
+
+    // nr. of forwarding entries
+    uint32_t num_entries;
+
+    // node array (root is nodes[0])
+    struct mbt_node * nodes;
+    uint32_t num_nodes;
+    uint32_t max_nodes;
+
+    // max. depth of the trie (in nodes, root at depth 0)
+    int depth;
+
+    // entries' RIDs, bucket by bucket
+    struct click_xia_xid * rids;
+
+    // prefix info of each entry (NOT a copy: these belong to the pt_fwd
+    // nodes the entries were collected from)
+    struct prefix_info ** prefix_i;
+
+    // next hop of each entry, bucket by bucket
+    uint16_t * ports;
+};
+
+extern struct mbt_fwd * mbt_fwd_init(struct pt_ht * partition);
+extern void mbt_fwd_erase(struct mbt_fwd * mbt);
+extern size_t mbt_fwd_memory(struct mbt_fwd * mbt);
+
+extern int mbt_fwd_lookup(
+        struct mbt_fwd * mbt,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats);
+
+extern void mbt_ht_print_stats(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _MBT_H_ */
@@ -0,0 +1,86 @@
+/*
+ * name_lpm.h
+ *
+ * exact name-based FIB: longest prefix match (LPM) on URL components, w/ 1
+ * hash table per prefix size (nr. of components), as a name-based router
+ * would do it. keys are the same sub-prefixes name_to_rid() encodes in RIDs
+ * (i.e. the 1st k components of a URL), so that for a request of |R|
+ * components, a lookup probes (at most) the tables for |R|, |R| - 1, ..., 1
+ * w/ the request's own sub-prefixes and stops at the 1st hit.
+ *
+ * the point is to have (a) a baseline for memory and lookup time of RID FIBs
+ * and (b) ground truth for the FP analysis: the true LPM answer of a request
+ * vs. the largest entry a RID FIB matches.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _NAME_LPM_H_
+#define _NAME_LPM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "uthash.h"
+
+#include "rid_utils.h"
+#include "pt.h"
+
+struct name_lpm_entry {
+
+    // prefix size (in number of URL components)
+    uint8_t prefix_size;
+    uint16_t prefix_len;
+
+    UT_hash_handle hh;
+
+    // the key, '\0' terminated
+    char prefix[];
+};
+
+struct name_lpm {
+
+    // 1 table per prefix size, keyed by prefix string
+    struct name_lpm_entry * tables[MAX_PREFIX_SIZE + 1];
+    uint32_t num_entries[MAX_PREFIX_SIZE + 1];
+
+    // prefixes which were already in the FIB
+    uint32_t num_dups;
+};
+
+extern struct name_lpm * name_lpm_init();
+extern void name_lpm_erase(struct name_lpm * lpm);
+
+extern int name_lpm_add(struct name_lpm * lpm, char * prefix, int prefix_size);
+
+extern struct name_lpm_entry * name_lpm_lookup(
+        struct name_lpm * lpm,
+        const char * request);
+
+extern size_t name_lpm_memory(struct name_lpm * lpm);
+
+extern void name_lpm_bench(
+        struct name_lpm * lpm,
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _NAME_LPM_H_ */
@@ -0,0 +1,72 @@
+/*
+ * perf_counters.h
+ *
+ * hardware / software event counters (via perf_event_open()) around a
+ * section of code, e.g. the lookup phase. counters are inherited by threads
+ * created after perf_counters_start(), which covers the per-lookup thread
+ * pools of pt_ht_lookup().
+ *
+ * events the kernel (or the VM) doesn't support, or which the process
+ * isn't allowed to count (see /proc/sys/kernel/perf_event_paranoid), are
+ * reported as n/a, instead of failing.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#define PERF_EVENT_PAGE_FAULTS      0x00
+#define PERF_EVENT_MINOR_FAULTS     0x01
+#define PERF_EVENT_MAJOR_FAULTS     0x02
+#define PERF_EVENT_DTLB_MISSES      0x03
+#define PERF_EVENT_L1D_MISSES       0x04
+#define PERF_EVENT_LLC_MISSES       0x05
+#define PERF_EVENT_CACHE_MISSES     0x06
+#define PERF_EVENT_INSTRUCTIONS     0x07
+#define PERF_EVENTS                 0x08
+
+struct perf_counters {
+
+    // -1 if the event isn't available
+    int fds[PERF_EVENTS];
+    uint64_t values[PERF_EVENTS];
+};
+
+extern const char * perf_event_name(int event);
+
+extern void perf_counters_init(struct perf_counters * pc);
+extern void perf_counters_erase(struct perf_counters * pc);
+
+extern void perf_counters_start(struct perf_counters * pc);
+extern void perf_counters_stop(struct perf_counters * pc);
+
+extern int perf_counters_available(struct perf_counters * pc, int event);
+
+extern void perf_counters_print(
+        struct perf_counters * pc,
+        const char * label,
+        uint64_t num_lookups,
+        std::string output_dir);
+
+#endif /* _PERF_COUNTERS_H_ */
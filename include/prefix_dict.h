@@ -0,0 +1,210 @@
+/*
+ * prefix_dict.h
+ *
+ * component dictionary for prefix strings (URLs) of FIB entries.
+ *
+ * URLs in a FIB share most of their components (hosts, top-level paths),
+ * so instead of a full copy of its URL, each entry keeps the IDs of its
+ * components (see struct prefix_info), split at every PREFIX_DELIM_CHAR
+ * (empty components included, so that the URL can be put back together
+ * exactly). each distinct component is stored once, in a dictionary shared
+ * by all FIBs.
+ *
+ * a component's ID is its offset in the dictionary's string storage, which
+ * is append-only and split in chunks which never move: lookups can read
+ * components w/o locks, concurrently w/ inserts. components are never
+ * removed.
+ *
+ * TP checks (strstr(request, prefix) != NULL) and |F\R| counts (see
+ * req_entry_diff()) run on the IDs: the request is split into components
+ * once per lookup (struct prefix_req, shared by all partitions), inner
+ * components are compared by ID and only the 1st and last components of a
+ * prefix need string compares, as they may be a suffix (prefix) of a
+ * request component.
+ * results are the same as w/ the plain strings.
+ *
+ * w/ PREFIX_CLASSIFY_MASKS, the request also keeps, for each
+ * prefix component (ID) it meets, the bit masks of the request components
+ * it ends, starts or equals. IDs are collision-free fingerprints of the
+ * components, so the string compares are done once per distinct component
+ * and request. the starting positions at which a prefix lines up w/ the
+ * request are then just the AND of its components' masks, each shifted by
+ * the component's position: a TP check is k AND + shift ops for a prefix
+ * of k components, |F\R| a count of the steps w/ positions left. most
+ * entries fail within 2 steps, which only need the entry's fingerprint
+ * (see prefix_info_fp()), kept in the trie node. on misc/url.txt, the
+ * memo costs more than it saves (see pt_ht_classify_bench()), so
+ * PREFIX_CLASSIFY_SCAN is the default.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _PREFIX_DICT_H_
+#define _PREFIX_DICT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+
+#define PREFIX_DICT_CHUNK_SIZE  (1 << 20)
+#define PREFIX_DICT_MAX_CHUNKS  4095
+#define PREFIX_DICT_MIN_SLOTS   1024
+// ID of components which aren't in the dictionary
+#define PREFIX_DICT_NONE        0xFFFFFFFF
+
+// max. nr. of components of a request kept in a struct prefix_req (w/ bit
+// masks, 1 bit per component). longer requests are classified on their
+// strings (i.e. w/ strstr() and req_entry_diff()).
+#define PREFIX_REQ_MASK_COMPS   64
+#define PREFIX_REQ_MEMO_SLOTS   128
+
+// how prefix_info_match() and prefix_info_diff() work (see below). 'none'
+// skips classification altogether in pt_fwd_lookup(), for timing only.
+#define PREFIX_CLASSIFY_NONE    0x00
+#define PREFIX_CLASSIFY_SCAN    0x01
+#define PREFIX_CLASSIFY_MASKS   0x02
+#define PREFIX_CLASSIFY_MODES   3
+
+extern const char * PREFIX_CLASSIFY_STRS[];
+extern int prefix_classify;
+
+/*
+ * \brief open addressing hash table of component IDs
+ */
+struct prefix_dict_table {
+
+    uint32_t num_slots;
+    uint32_t slots[];
+};
+
+struct prefix_dict {
+
+    // string storage: each component is a 2 byte length, followed by its
+    // chars (w/o '\0'). a component's ID is chunk * chunk size + offset.
+    char * chunks[PREFIX_DICT_MAX_CHUNKS];
+    uint32_t num_chunks;
+    uint32_t chunk_used;
+
+    struct prefix_dict_table * table;
+
+    // replaced tables, kept until prefix_dict_erase() since lookups may
+    // still be reading them (they add up to less than the current table)
+    struct prefix_dict_table ** old_tables;
+    uint32_t num_old_tables;
+
+    uint32_t num_strings;
+    size_t strings_size;
+
+    // serializes inserts
+    pthread_mutex_t lock;
+};
+
+/*
+ * \brief positions of the request components a prefix component ends,
+ *        starts and is equal to (bit i for component i)
+ */
+struct prefix_req_masks {
+
+    uint64_t suffix;
+    uint64_t prefix;
+    uint64_t equal;
+};
+
+/*
+ * \brief a request, split in components
+ */
+struct prefix_req {
+
+    // the dictionary the request was looked up in
+    struct prefix_dict * dict;
+
+    // the request string, for requests w/ more than PREFIX_REQ_MASK_COMPS
+    // components (num_comps is then PREFIX_REQ_MASK_COMPS + 1)
+    const char * request;
+    uint32_t num_comps;
+
+    // component IDs (PREFIX_DICT_NONE if not in the dictionary), chars and
+    // lengths
+    uint32_t ids[PREFIX_REQ_MASK_COMPS];
+    const char * strs[PREFIX_REQ_MASK_COMPS];
+    uint16_t lens[PREFIX_REQ_MASK_COMPS];
+
+    // masks of the prefix components seen so far, by component ID. the IDs
+    // are only cleared on 1st use.
+    int memo_ready;
+    uint32_t memo_ids[PREFIX_REQ_MEMO_SLOTS];
+    struct prefix_req_masks memo[PREFIX_REQ_MEMO_SLOTS];
+};
+
+extern struct prefix_dict * prefix_dict_init();
+extern void prefix_dict_erase(struct prefix_dict * dict);
+
+// dictionary used by prefix_info_init(), created on 1st use
+extern struct prefix_dict * prefix_dict_default();
+extern void prefix_dict_default_erase();
+
+extern uint32_t prefix_dict_insert(struct prefix_dict * dict, const char * str, size_t len);
+extern uint32_t prefix_dict_find(struct prefix_dict * dict, const char * str, size_t len);
+extern size_t prefix_dict_memory(struct prefix_dict * dict);
+
+static __inline const char * prefix_dict_get(
+        struct prefix_dict * dict,
+        uint32_t id,
+        uint16_t * len) {
+
+    const char * p = dict->chunks[id / PREFIX_DICT_CHUNK_SIZE] + (id % PREFIX_DICT_CHUNK_SIZE);
+
+    memcpy(len, p, sizeof(uint16_t));
+
+    return p + sizeof(uint16_t);
+}
+
+/*
+ * \brief   fingerprint of a prefix, for |F\R| counts w/o a trip to its
+ *          prefix_info: the IDs of its 1st and 2nd components, if followed
+ *          by a PREFIX_DELIM_CHAR (PREFIX_DICT_NONE otherwise).
+ */
+static __inline uint64_t prefix_info_fp(struct prefix_info * prefix_info) {
+
+    uint64_t lo = (prefix_info->num_comps > 1 ? prefix_info->comps[0] : PREFIX_DICT_NONE);
+    uint64_t hi = (prefix_info->num_comps > 2 ? prefix_info->comps[1] : PREFIX_DICT_NONE);
+
+    return (hi << 32) | lo;
+}
+
+extern void prefix_req_init(struct prefix_req * req, const char * request);
+extern void prefix_req_copy(struct prefix_req * dst, struct prefix_req * src);
+
+extern int prefix_info_str(struct prefix_info * prefix_info, char * str, size_t max_size);
+extern size_t prefix_info_size(struct prefix_info * prefix_info);
+extern size_t prefix_info_str_size(struct prefix_info * prefix_info);
+
+extern int prefix_info_match(
+        struct prefix_info * prefix_info,
+        struct prefix_req * req);
+
+extern unsigned int prefix_info_diff(
+        struct prefix_info * prefix_info,
+        uint64_t fp,
+        struct prefix_req * req,
+        unsigned int entry_size);
+
+#endif /* _PREFIX_DICT_H_ */
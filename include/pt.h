@@ -36,6 +36,8 @@
 #include <pthread.h>
 
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 #include "uthash.h"
 // playing with fire... i mean threads now...
@@ -51,6 +53,69 @@
 // 1 thread per core (at least in my machine)?
 #define NUM_THREADS 4
 
+// lookup engines a FIB partition can use (see pt_ht_calibrate())
+#define PT_ENGINE_PT        0x00
+#define PT_ENGINE_SCAN      0x01
+#define PT_ENGINE_BITSLICE  0x02
+#define PT_ENGINE_DIR       0x03
+#define PT_ENGINE_MBT       0x04
+#define PT_ENGINE_FLAT      0x05
+#define PT_ENGINE_LOUDS     0x06
+#define PT_ENGINE_AUTO      0xFF
+
+// depth histograms of partition tries are capped at PT_MAX_DEPTH - 1
+#define PT_MAX_DEPTH                (8 * CLICK_XIA_XID_ID_LEN + 1)
+
+// rounds of pt_ht_classify_bench() (the 1st isn't counted)
+#define PT_CLASSIFY_BENCH_ROUNDS    4
+
+// nr. of requests used to time each engine during calibration
+#define PT_CALIBRATION_REQUESTS     64
+// partitions larger than this always keep the PT (SCAN and BITSLICE lookups
+// go over all entries)
+#define PT_CALIBRATION_MAX_ENTRIES  4096
+
+// next hops (output ports) of FIB entries. entries w/o one hold 
+// PT_PORT_NONE.
+#define PT_PORT_NONE                0xFFFF
+#define PT_MAX_PORTS                256
+#define PT_PORT_WORDS               (PT_MAX_PORTS / 64)
+
+extern const char * PT_ENGINE_STRS[];
+
+// epoch-based reclamation domain for lookups concurrent w/ FIB updates (see
+// rcu.h), NULL if there are none. readers pass their id (see rcu_register())
+// to pt_ht_lookup() and pt_ht_next_hop(). only the trie (PT engine) supports
+// concurrent lookups, and the partitions must exist beforehand.
+extern struct rcu_domain * pt_rcu;
+
+// reader id of lookups which don't run concurrently w/ FIB updates (see
+// pt_ht_lookup())
+#define PT_READER_NONE              -1
+
+// huge page arena for trie nodes and RIDs (see hp_arena.h), NULL to use
+// malloc(). must be set before the FIB is built, and outlive it.
+extern struct hp_arena * pt_arena;
+
+// lookup result cache (see rid_cache.h), NULL if there's none. if set,
+// pt_ht_lookup() and pt_ht_next_hop() (w/ name checks) go through it, and
+// FIB updates invalidate it. it holds the results of a single FIB.
+struct rid_cache;
+extern struct rid_cache * pt_cache;
+
+struct pt_fwd;
+
+// per-node visit counts of a partition's trie (see pt_ht_profile())
+typedef std::unordered_map<struct pt_fwd *, uint32_t> PtProfile;
+
+struct scan_fwd;
+struct bs_fwd;
+struct pt_dir;
+struct mbt_fwd;
+struct rid_perm;
+struct pt_flat;
+struct rcu_domain;
+
 struct pt_ht {
 
     // prefix size (in number of encoded elements)
@@ -59,11 +124,35 @@ struct pt_ht {
     // nr. of forwarding entries
     uint32_t num_entries;
 
+    // nr. of duplicate RIDs rejected by pt_ht_add()
+    uint32_t num_dups;
+
     // pointer to the fwd entry list
     struct pt_fwd * trie;
 
-    // FIXME: just a aux parameter for keeping track of 'forwarding entry
-    // avoidance' percentage per RID size
+    // engine used for lookups in this partition (PT_ENGINE_*). the trie is 
+    // always kept up-to-date, other engines are built out of it.
+    int engine;
+    struct scan_fwd * scan;
+    struct bs_fwd * bs;
+    struct pt_dir * dir;
+    struct mbt_fwd * mbt;
+    struct pt_flat * flat;
+    struct louds_fwd * louds;
+
+    // 1 if the partition's entries only live in its flat trie (e.g. if 
+    // loaded from a snapshot), and the trie is just the root. the trie is 
+    // re-built out of the flat trie (thawed) when needed.
+    int frozen;
+
+    // visit counts of the trie's nodes, for profile-guided flat trie
+    // layouts (see pt_flat.h). pt_fwd_lookup() only counts while profiling
+    // is set.
+    PtProfile * profile;
+    int profiling;
+
+    // 'forwarding entry avoidance': % and nr. of the partition's entries
+    // removed as redundant for forwarding (see fib_compress.h)
     double fea;
     unsigned long fea_n;
 
@@ -97,12 +186,87 @@ struct pt_fwd {
     struct pt_fwd * p_right;
 
     struct prefix_info * prefix_i;
+
+    // fingerprint of prefix_i (see prefix_info_fp()), so that most |F\R|
+    // counts don't have to follow prefix_i
+    uint64_t prefix_fp;
+
+    // next hop (output port), PT_PORT_NONE if none
+    uint16_t port;
+};
+
+/*
+ * \brief a set of ports, as a bitmap: the union of the next hops of all
+ * entries matched by a request (i.e. multicast-like delivery) is a 
+ * word-wide OR of such sets.
+ */
+struct pt_port_set {
+    uint64_t words[PT_PORT_WORDS];
 };
 
+static __inline void pt_port_set_clear(struct pt_port_set * set) {
+
+    memset(set->words, 0, sizeof(set->words));
+}
+
+static __inline void pt_port_set_add(struct pt_port_set * set, uint16_t port) {
+
+    if (port < PT_MAX_PORTS)
+        set->words[port >> 6] |= (1ULL << (port & 63));
+}
+
+static __inline void pt_port_set_union(struct pt_port_set * dst, struct pt_port_set * src) {
+
+    for (int i = 0; i < PT_PORT_WORDS; i++)
+        dst->words[i] |= src->words[i];
+}
+
+static __inline int pt_port_set_count(struct pt_port_set * set) {
+
+    int count = 0;
+
+    for (int i = 0; i < PT_PORT_WORDS; i++)
+        count += __builtin_popcountll(set->words[i]);
+
+    return count;
+}
+
+// max. nr. of entries kept in a match set
+#define PT_MATCH_SET_MAX    64
+
+/*
+ * \brief the entries matched by a request (i.e. (R & F) == F), w/o TP / FP
+ * classification, as returned by the stats-free lookup (see 
+ * pt_fwd_lookup_fast()).
+ */
+struct pt_match_set {
+
+    // nr. of matches per prefix size |F|
+    uint32_t sizes[BF_MAX_ELEMENTS];
+
+    // the 1st PT_MATCH_SET_MAX matches, in visiting order. num_entries 
+    // counts all of them.
+    struct pt_fwd * entries[PT_MATCH_SET_MAX];
+    uint32_t num_entries;
+
+    // next hops of all matches
+    struct pt_port_set ports;
+};
+
+static __inline void pt_match_set_init(struct pt_match_set * matches) {
+
+    memset(matches->sizes, 0, sizeof(matches->sizes));
+    matches->num_entries = 0;
+    pt_port_set_clear(&(matches->ports));
+}
+
 struct pt_fwd_lookup_tdata {
 
     int thread_id;
-    int condition_var;
+
+    // nr. of partition lookups of the request still running (shared by all
+    // jobs of the request)
+    int * pending;
 
     struct pt_fwd * node;
 
@@ -111,28 +275,182 @@ struct pt_fwd_lookup_tdata {
     
     struct click_xia_xid * request_rid;
 
+    // the request, split in components (NULL w/ PREFIX_CLASSIFY_NONE)
+    struct prefix_req * req;
+
     int prev_key_bit;
     
     uint32_t * fp_sizes;
     uint32_t * tp_sizes;
+
+    // next hops of the partition's matches, if collect_ports is set
+    int collect_ports;
+    struct pt_port_set ports;
 };
 
+extern void * pt_fwd_malloc(size_t size);
+extern void pt_fwd_mfree(void * ptr, size_t size);
+
 extern void pt_ht_erase(struct pt_ht * fib);
+extern int pt_ht_sort(struct pt_ht * a, struct pt_ht * b);
+extern int pt_ht_erase_partition(struct pt_ht * s);
+extern struct pt_ht * pt_ht_partition_init(char * prefix, int prefix_size);
+extern struct pt_ht * pt_ht_clone_partition(struct pt_ht * s);
 extern void pt_ht_print_stats(struct pt_ht * fib, std::string output_dir);
+extern size_t pt_ht_partition_memory(struct pt_ht * s);
+extern size_t pt_ht_memory(struct pt_ht * fib);
+extern void pt_ht_print_memory(struct pt_ht * fib);
 extern struct pt_ht * pt_ht_search(struct pt_ht * ht, int prefix_size);
+extern struct pt_ht * pt_ht_get_partition(
+        struct pt_ht ** ht,
+        char * prefix,
+        int prefix_size);
 extern int pt_ht_add(
         struct pt_ht ** ht,
         struct click_xia_xid * rid,
         char * prefix,
+        int prefix_size,
+        uint16_t port);
+
+extern int pt_ht_remove(
+        struct pt_ht * ht,
+        struct click_xia_xid * rid,
+        char * prefix,
         int prefix_size);
 
+extern int pt_ht_partition_add(
+        struct pt_ht * s,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port);
+
+extern int pt_ht_partition_remove(
+        struct pt_ht * s,
+        struct click_xia_xid * rid,
+        char * prefix);
+
+extern int pt_ht_url_to_rid(
+        char * url,
+        char * prefix,
+        struct click_xia_xid * rid,
+        struct rid_perm * perm);
+
+extern int pt_ht_add_url(struct pt_ht ** ht, char * url, struct rid_perm * perm);
+extern int pt_ht_remove_url(struct pt_ht * ht, char * url, struct rid_perm * perm);
+extern void pt_ht_get_prefixes(struct pt_ht * fib, std::vector<std::string> & prefixes);
+extern int pt_ht_check(struct pt_ht * fib);
+
+extern void pt_ht_permute(struct pt_ht * fib, struct rid_perm * perm);
+extern void pt_ht_thaw(struct pt_ht * fib);
+extern void pt_ht_set_engine(struct pt_ht * fib, int engine);
+extern void pt_ht_calibrate(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num);
+extern void pt_ht_profile(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num);
+extern void pt_ht_profile_clear(struct pt_ht * fib);
+
+extern void pt_ht_classify_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+extern void pt_ht_lpm_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+extern void pt_ht_stats_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+extern void pt_ht_lookup_partition(
+        struct pt_ht * partition,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct prefix_req * req);
+
+extern int pt_ht_lookup_lpm(
+        struct pt_ht * fib,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int verify,
+        uint16_t * next_hop,
+        int * partitions);
+
+extern uint16_t pt_ht_next_hop(
+        struct pt_ht * fib,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int verify,
+        int reader);
+
 extern void pt_ht_lookup(
         struct pt_ht * pt_fib,
         char * request,
         int request_size,
         struct click_xia_xid * request_rid,
         uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        int reader);
+
+extern struct pt_fwd * pt_fwd_init(struct pt_ht * ht);
+extern struct pt_fwd * pt_fwd_insert(struct pt_fwd * n, struct pt_fwd * head);
+extern int pt_fwd_remove(struct click_xia_xid * rid, char * prefix, struct pt_fwd * head);
+extern struct pt_fwd * pt_fwd_search(struct click_xia_xid * rid, struct pt_fwd * head);
+extern int pt_fwd_count(struct pt_fwd * t);
+extern int pt_fwd_depth_hist(struct pt_fwd * t, uint32_t * hist, int hist_size);
+extern int pt_fwd_lookup(
+        struct pt_fwd * node,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        uint32_t * fp_sizes,
         uint32_t * tp_sizes);
+extern int pt_fwd_lookup_ports(
+        struct pt_fwd * node,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports);
+extern int pt_fwd_lookup_req(
+        struct pt_fwd * node,
+        struct prefix_req * req,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports);
+
+extern int pt_fwd_lookup_fast(
+        struct pt_fwd * node,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        struct pt_match_set * matches);
+
+extern struct pt_fwd * pt_fwd_lookup_first(
+        struct pt_fwd * node,
+        struct click_xia_xid * request_rid,
+        struct prefix_req * req,
+        int prev_key_bit,
+        int * visits);
 
 extern void pt_fwd_print(struct pt_fwd * node, uint8_t mode);
 
@@ -0,0 +1,90 @@
+/*
+ * pt_bulk.h
+ *
+ * bulk (bottom-up) construction of the FIB partition tries.
+ *
+ * instead of inserting entries one at a time w/ pt_ht_add(), (RID, prefix)
+ * pairs are collected per partition first. each partition is then radix
+ * sorted by RID (in the bit order of bit() in pt.c) and its trie is built
+ * in a single linear pass: the branching bit between 2 adjacent sorted keys
+ * is their 1st differing bit, and the trie is the Cartesian tree of these
+ * bits (the smallest bit at the top), built w/ a stack. partitions are built
+ * in parallel, 1 thread pool job per partition.
+ *
+ * the result is a valid patricia trie for the same set of entries as w/
+ * pt_ht_add(), so lookups return the same matches. the key held by each node
+ * may differ from the one an incremental build would put there, so the nr.
+ * of nodes visited per lookup may differ slightly.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _PT_BULK_H_
+#define _PT_BULK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rid_utils.h"
+#include "pt.h"
+
+/*
+ * \brief (RID, prefix) pairs collected for a single FIB partition.
+ */
+struct pt_bulk_part {
+
+    // FIB partition the entries go to (set by pt_bulk_build())
+    struct pt_ht * partition;
+
+    // nr. of collected pairs, and capacity of the arrays
+    uint32_t num;
+    uint32_t max;
+
+    struct click_xia_xid * rids;
+    char ** prefixes;
+    uint16_t * ports;
+
+    // nr. of duplicate RIDs and build time (in seconds)
+    uint32_t dups;
+    double build_time;
+};
+
+/*
+ * \brief bulk loader: collected pairs, per prefix size.
+ */
+struct pt_bulk {
+
+    struct pt_bulk_part parts[MAX_PREFIX_SIZE + 1];
+
+    // nr. of collected pairs
+    uint32_t num;
+};
+
+extern struct pt_bulk * pt_bulk_init();
+extern void pt_bulk_erase(struct pt_bulk * bulk);
+
+extern void pt_bulk_add(
+        struct pt_bulk * bulk,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port);
+
+extern int pt_bulk_build(struct pt_bulk * bulk, struct pt_ht ** fib);
+
+#endif /* _PT_BULK_H_ */
@@ -0,0 +1,100 @@
+/*
+ * pt_dir.h
+ *
+ * jump table (directory) over the top k bits of RIDs, w/ one patricia
+ * sub-trie per slot (think DIR-24-8 for IP addresses).
+ *
+ * the entries of a FIB partition are split over 2^k slots, indexed by the
+ * top k bits of their RIDs (in the same bit order as the PT, see bit() in
+ * pt.c). a request RID R can only match entries F s.t. (R & F) == F, so the
+ * top k bits of F must be a submask of the top k bits of R: the lookup visits
+ * only those slots, enumerated w/ the s = (s - 1) & r trick. this skips the
+ * upper k levels of the partition trie.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _PT_DIR_H_
+#define _PT_DIR_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+#include "pt.h"
+#include "prefix_dict.h"
+
+// default and max. nr. of RID bits used to index the directory. 2^20 slots
+// is already 8 MB worth of pointers per partition.
+#define PT_DIR_DEFAULT_BITS     8
+#define PT_DIR_MAX_BITS         20
+
+// nr. of directory bits used by PT_ENGINE_DIR partitions
+extern int pt_dir_bits;
+
+/*
+ * \brief directory of patricia sub-tries for a single FIB partition.
+ */
+struct pt_dir {
+
+    // FIB partition the entries were collected from
+    struct pt_ht * fib_root;
+
+    // prefix size (in number of encoded elements)
+    int prefix_size;
+
+    // nr. of RID bits used to index the directory (k)
+    int bits;
+
+    // nr. of forwarding entries and non-empty slots
+    uint32_t num_entries;
+    uint32_t num_slots;
+
+    // 2^k slots, each w/ a sub-trie (NULL if empty). the sub-trie nodes
+    // share the RIDs and prefix info of the partition trie nodes.
+    struct pt_fwd ** slots;
+
+    // FIXME: just a aux parameter for keeping track of the nr. of (non-empty)
+    // slots visited by lookups
+    unsigned long slot_visits;
+};
+
+extern struct pt_dir * pt_dir_init(struct pt_ht * partition, int bits);
+extern void pt_dir_erase(struct pt_dir * dir);
+extern size_t pt_dir_memory(struct pt_dir * dir);
+
+extern int pt_dir_lookup(
+        struct pt_dir * dir,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct prefix_req * req);
+
+extern void pt_dir_print_tradeoff(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _PT_DIR_H_ */
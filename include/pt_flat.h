@@ -0,0 +1,167 @@
+/*
+ * pt_flat.h
+ *
+ * flat (frozen) patricia trie: the trie of a FIB partition, w/ nodes stored
+ * in a single array and linked by index instead of by pointer.
+ *
+ * a flat trie has exactly the same structure (and lookups the same behavior
+ * and stats) as the pt_fwd trie it was frozen from. since it has no
+ * pointers, it can be written to disk and mmap()'d back as is (see
+ * snapshot.h). prefix strings are kept in a single string blob, referenced
+ * by offset.
+ *
+ * nodes are numbered in pre-order when frozen (i.e. in the order a lookup
+ * visits them, but w/ right children far from their parents). a layout
+ * pass can then re-order them (see pt_flat_layout), so that root-to-leaf
+ * walks touch fewer cache lines and pages:
+ *
+ *  - PT_FLAT_LAYOUT_BFS: page sized blocks (PT_FLAT_BLOCK_SIZE), each
+ *    filled w/ the top of a sub-trie, breadth-first. the sub-tries hanging
+ *    from a block start blocks of their own.
+ *  - PT_FLAT_LAYOUT_VEB: van Emde Boas order. the top half of a trie's
+ *    levels is laid out (recursively) first, then each sub-trie below it,
+ *    so that a walk stays w/in blocks of any size (cache line or page),
+ *    w/o knowing it.
+ *  - PT_FLAT_LAYOUT_PROFILE: profile-guided, out of the visit counts of a
+ *    training run (see pt_ht_profile()). the hot set, i.e. the most
+ *    visited nodes which together get PT_FLAT_HOT_SHARE of all visits, goes
+ *    first, in pre-order, followed by the cold nodes, in pre-order too.
+ *    w/o a profile, it's the same as PT_FLAT_LAYOUT_PREORDER. updates made
+ *    after the training run aren't reflected in the profile.
+ *
+ * the root is node 0 in every layout, and the layout is kept in snapshots.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _PT_FLAT_H_
+#define _PT_FLAT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+#include "pt.h"
+
+#define PT_FLAT_LAYOUT_PREORDER     0x00
+#define PT_FLAT_LAYOUT_BFS          0x01
+#define PT_FLAT_LAYOUT_VEB          0x02
+// nr. of layouts which don't need a profile
+#define PT_FLAT_LAYOUTS             0x03
+#define PT_FLAT_LAYOUT_PROFILE      0x03
+
+// share of the visits of a training run the hot set gets
+#define PT_FLAT_HOT_SHARE           0.95
+
+#define PT_FLAT_BLOCK_SIZE          4096
+#define PT_FLAT_LINE_SIZE           64
+
+extern const char * PT_FLAT_LAYOUT_STRS[];
+
+// layout of the flat tries made by pt_flat_init(), PT_FLAT_LAYOUT_PREORDER
+// by default
+extern int pt_flat_layout;
+
+/*
+ * \brief flat trie node. node 0 is the root (default route).
+ */
+struct pt_flat_node {
+
+    // node's RID
+    struct click_xia_xid rid;
+
+    // bit to check (aka `key bit')
+    int16_t key_bit;
+
+    // next hop (see pt_fwd.port)
+    uint16_t port;
+
+    // indexes of the left and right nodes (in the same flat trie)
+    uint32_t p_left;
+    uint32_t p_right;
+
+    // offset of the prefix string (in pt_flat.strings)
+    uint32_t prefix;
+};
+
+/*
+ * \brief flat trie of a single FIB partition (prefix size).
+ */
+struct pt_flat {
+
+    // FIB partition the trie belongs to
+    struct pt_ht * fib_root;
+
+    // prefix size (in number of encoded elements)
+    int prefix_size;
+
+    // node array
+    struct pt_flat_node * nodes;
+    uint32_t num_nodes;
+
+    // prefix strings, '\0' terminated, back to back
+    char * strings;
+    size_t strings_size;
+
+    // nr. of hot nodes (nodes [0, num_hot) w/ PT_FLAT_LAYOUT_PROFILE), 0
+    // for other layouts
+    uint32_t num_hot;
+
+    // 1 if nodes and strings belong to someone else (e.g. a mmap()'d
+    // snapshot), 0 if they were allocated by pt_flat_init()
+    int mapped;
+};
+
+extern struct pt_flat * pt_flat_init(struct pt_ht * partition);
+extern struct pt_flat * pt_flat_init_layout(struct pt_ht * partition, int layout);
+extern struct pt_flat * pt_flat_copy(struct pt_flat * flat);
+extern void pt_flat_relayout(struct pt_flat * flat, int layout);
+extern void pt_flat_erase(struct pt_flat * flat);
+extern size_t pt_flat_memory(struct pt_flat * flat);
+
+extern void pt_flat_thaw(struct pt_flat * flat, struct pt_ht * partition);
+
+extern int pt_flat_lookup(
+        struct pt_flat * flat,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports);
+
+extern struct pt_flat_node * pt_flat_lookup_first(
+        struct pt_flat * flat,
+        char * request,
+        struct click_xia_xid * request_rid,
+        int * visits);
+
+extern void pt_flat_profile_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+extern void pt_flat_layout_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _PT_FLAT_H_ */
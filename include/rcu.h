@@ -0,0 +1,102 @@
+/*
+ * rcu.h
+ *
+ * epoch-based reclamation (EBR) for FIB tries w/ concurrent readers, in the
+ * style of RCU: readers never lock or write shared state other than their
+ * own epoch slot, writers (serialized among themselves) publish new nodes
+ * w/ release stores and retire unlinked nodes, which are only freed once
+ * every reader which could still hold a reference to them is done.
+ *
+ * a reader announces the global epoch it started in. the global epoch can
+ * only advance when all active readers have announced the current one, so
+ * nodes retired in epoch e are unreachable to every reader by the time the
+ * global epoch reaches e + 2 (i.e. when all active readers started after
+ * epoch e was over).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _RCU_H_
+#define _RCU_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define RCU_MAX_READERS     64
+#define RCU_EPOCHS          3
+#define RCU_CACHE_LINE      64
+
+// pointer publication (writers) and dereference (readers)
+#define rcu_assign_pointer(p, v)    __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define rcu_dereference(p)          __atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+/*
+ * \brief a reader's epoch slot: (epoch << 1) | 1 while in a read-side
+ * critical section, 0 otherwise. 1 slot per cache line.
+ */
+struct rcu_reader {
+    uint64_t state;
+    char pad[RCU_CACHE_LINE - sizeof(uint64_t)];
+} __attribute__((aligned(RCU_CACHE_LINE)));
+
+struct rcu_retired {
+    void * ptr;
+    void (*free_fn)(void *);
+    struct rcu_retired * next;
+};
+
+struct rcu_domain {
+
+    struct rcu_reader readers[RCU_MAX_READERS];
+    uint32_t num_readers;
+
+    uint64_t epoch;
+
+    // nodes retired in epoch e, in list e % RCU_EPOCHS (writer side only)
+    struct rcu_retired * retired[RCU_EPOCHS];
+    uint64_t num_retired;
+    uint64_t num_reclaimed;
+};
+
+extern struct rcu_domain * rcu_init();
+extern void rcu_erase(struct rcu_domain * rcu);
+
+extern int rcu_register(struct rcu_domain * rcu);
+
+extern void rcu_retire(struct rcu_domain * rcu, void * ptr, void (*free_fn)(void *));
+extern int rcu_reclaim(struct rcu_domain * rcu);
+
+/*
+ * \brief   enters a read-side critical section: nodes reachable from now on
+ *          won't be freed until rcu_read_unlock().
+ */
+static __inline void rcu_read_lock(struct rcu_domain * rcu, int reader) {
+
+    uint64_t epoch = __atomic_load_n(&(rcu->epoch), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(rcu->readers[reader].state), (epoch << 1) | 1, __ATOMIC_SEQ_CST);
+
+    // the slot must be visible before any node is read
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static __inline void rcu_read_unlock(struct rcu_domain * rcu, int reader) {
+
+    __atomic_store_n(&(rcu->readers[reader].state), 0, __ATOMIC_RELEASE);
+}
+
+#endif /* _RCU_H_ */
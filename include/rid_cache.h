@@ -0,0 +1,175 @@
+/*
+ * rid_cache.h
+ *
+ * lookup result cache in front of a RID FIB, keyed by the request RID (20
+ * byte), size |R| and a hash of its name. request streams are skewed, so a
+ * few requests make up
+ * most lookups: a hit returns the result of a full multi-partition lookup
+ * w/o walking any trie. if pt_cache (see pt.h) is set, it's filled and used
+ * by the FIB lookups themselves, w/ the partitions' engines:
+ *
+ *  - pt_ht_next_hop() w/ name checks: the longest confirmed match's size
+ *    and next hop (RID_CACHE_LPM)
+ *  - pt_ht_lookup(): the FPs and TPs per prefix size and the union of the
+ *    ports of all matches (RID_CACHE_MATCHES)
+ *
+ * an entry holds the parts its request was looked up for so far. requests
+ * w/ the same RID and size may still differ in name (the RID is a Bloom
+ * filter), and TPs / FPs and confirmed matches depend on the name: the
+ * FNV-1a hash of the name is part of the key. hits don't update the
+ * partition stats.
+ *
+ * the cache is split in RID_CACHE_SHARDS shards, picked by a hash of the
+ * key, each w/ its own lock and an LRU list over a uthash table (as in
+ * lib/uthash/tests/lru_cache): hits move an entry to the tail, inserts into
+ * a full shard evict (and re-use) the head.
+ *
+ * FIB updates invalidate the whole cache in O(1), by bumping a generation
+ * number (see rid_cache_invalidate()): entries of older generations are
+ * misses. partition adds and removes, COW version commits, bulk builds and
+ * RID permutations invalidate pt_cache (see pt.h) if set.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _RID_CACHE_H_
+#define _RID_CACHE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <string>
+
+#include "uthash.h"
+
+#include "rid_utils.h"
+#include "pt.h"
+
+// nr. of shards (a power of 2)
+#define RID_CACHE_SHARDS            16
+#define RID_CACHE_LINE              64
+
+// Zipf exponents and stream length (in lookups) run by rid_cache_bench()
+#define RID_CACHE_BENCH_ZIPF        {0.6, 0.8, 1.0, 1.2}
+#define RID_CACHE_BENCH_LOOKUPS     20000
+// the invalidation check adds an entry every RID_CACHE_BENCH_UPDATES
+// lookups, and removes it RID_CACHE_BENCH_UPDATES / 2 lookups later
+#define RID_CACHE_BENCH_UPDATES     1000
+
+// parts of a cached result (see rid_cache_result.parts)
+#define RID_CACHE_LPM               0x01
+#define RID_CACHE_MATCHES           0x02
+
+/*
+ * \brief result of a lookup, as cached.
+ */
+struct rid_cache_result {
+
+    // parts which are filled, RID_CACHE_LPM and / or RID_CACHE_MATCHES
+    uint8_t parts;
+
+    // RID_CACHE_LPM: size of the longest confirmed match (0 if none) and
+    // its next hop (see pt_ht_next_hop())
+    uint8_t lpm_size;
+    uint16_t next_hop;
+
+    // RID_CACHE_MATCHES: FPs and TPs per prefix size, and union of the next
+    // hops of all matches (see pt_ht_lookup())
+    uint32_t fp_sizes[BF_MAX_ELEMENTS];
+    uint32_t tp_sizes[BF_MAX_ELEMENTS];
+    struct pt_port_set ports;
+};
+
+struct rid_cache_key {
+
+    uint8_t rid[CLICK_XIA_XID_ID_LEN];
+    uint32_t request_size;
+    // FNV-1a of the request name
+    uint64_t name_hash;
+};
+
+struct rid_cache_entry {
+
+    // the key
+    struct rid_cache_key key;
+
+    // generation the result was computed in
+    uint64_t generation;
+
+    struct rid_cache_result result;
+
+    UT_hash_handle hh;
+};
+
+/*
+ * \brief a shard: LRU list (uthash order, oldest 1st) of at most capacity
+ * entries. 1 shard per cache line (at least).
+ */
+struct rid_cache_shard {
+
+    pthread_mutex_t lock;
+    struct rid_cache_entry * entries;
+
+    uint32_t capacity;
+    uint64_t hits;
+    uint64_t misses;
+} __attribute__((aligned(RID_CACHE_LINE)));
+
+struct rid_cache {
+
+    struct rid_cache_shard shards[RID_CACHE_SHARDS];
+
+    // bumped by rid_cache_invalidate()
+    uint64_t generation;
+    uint64_t invalidations;
+};
+
+extern struct rid_cache * rid_cache_init(uint32_t capacity);
+extern void rid_cache_erase(struct rid_cache * cache);
+
+extern int rid_cache_lookup(
+        struct rid_cache * cache,
+        const char * request,
+        struct click_xia_xid * rid,
+        int request_size,
+        uint8_t parts,
+        struct rid_cache_result * result);
+
+extern void rid_cache_insert(
+        struct rid_cache * cache,
+        const char * request,
+        struct click_xia_xid * rid,
+        int request_size,
+        struct rid_cache_result * result,
+        uint64_t generation);
+
+extern uint64_t rid_cache_generation(struct rid_cache * cache);
+extern void rid_cache_invalidate(struct rid_cache * cache);
+
+extern double rid_cache_hit_rate(struct rid_cache * cache);
+extern size_t rid_cache_memory(struct rid_cache * cache);
+
+extern void rid_cache_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        uint32_t capacity,
+        std::string output_dir);
+
+#endif /* _RID_CACHE_H_ */
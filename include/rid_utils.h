@@ -47,14 +47,47 @@
 #define DEFAULT_GEN_STATS_FILE          "gen-stats.tsv"
 #define DEFAULT_REQ_ENTRY_DIFF_FILE     "req-entry-diff.tsv"
 #define DEFAULT_TP_SIZE_FILE            "tp-size.tsv"
+#define DEFAULT_SCAN_CROSSOVER_FILE     "scan-crossover.tsv"
+#define DEFAULT_DIR_TRADEOFF_FILE       "dir-tradeoff.tsv"
+#define DEFAULT_MBT_STATS_FILE          "mbt-stats.tsv"
+#define DEFAULT_BIT_ORDER_FILE          "bit-order.tsv"
+#define DEFAULT_BIT_ORDER_DEPTH_FILE    "bit-order-depth.tsv"
+#define DEFAULT_DELTA_BENCH_FILE        "delta-bench.tsv"
+#define DEFAULT_CHURN_BENCH_FILE        "churn-bench.tsv"
+#define DEFAULT_RCU_BENCH_FILE          "rcu-bench.tsv"
+#define DEFAULT_COW_BENCH_FILE          "cow-bench.tsv"
+#define DEFAULT_PERF_COUNTERS_FILE      "perf-counters.tsv"
+#define DEFAULT_LAYOUT_BENCH_FILE       "layout-bench.tsv"
+#define DEFAULT_PROFILE_BENCH_FILE      "profile-bench.tsv"
+#define DEFAULT_LOUDS_BENCH_FILE        "louds-bench.tsv"
+#define DEFAULT_CLASSIFY_BENCH_FILE     "classify-bench.tsv"
+#define DEFAULT_NAME_LPM_BENCH_FILE     "name-lpm-bench.tsv"
+#define DEFAULT_STATS_BENCH_FILE        "stats-bench.tsv"
+#define DEFAULT_LPM_BENCH_FILE          "lpm-bench.tsv"
+#define DEFAULT_FIB_COMPRESS_FILE       "fib-compress.tsv"
+#define DEFAULT_CACHE_BENCH_FILE        "cache-bench.tsv"
 
 #define MAX_PREFIX_SIZE             10
 
+// 64 bit FNV-1a (see fnv1a())
+#define FNV_OFFSET_BASIS            0xcbf29ce484222325ULL
+#define FNV_PRIME                   0x100000001b3ULL
+
 struct click_xia_xid {
     uint32_t type;
     uint8_t id[CLICK_XIA_XID_ID_LEN];
 };
 
+/*
+ * \brief a request name and its RID, as generated for a lookup run. kept 
+ * around so that the same requests can be replayed against other FIB engines.
+ */
+struct rid_request {
+    char * name;
+    int size;
+    struct click_xia_xid * rid;
+};
+
 extern char * extract_prefix_bytes(char ** to, struct click_xia_xid * rid, int trailing_bit);
 
 extern unsigned int req_entry_diff(
@@ -73,4 +106,7 @@ extern int rid_match_mask(
 
 extern int rid_hamming_weight(struct click_xia_xid * rid);
 
+extern double get_time_now();
+extern uint64_t fnv1a(uint64_t hash, const void * data, size_t size);
+
 #endif /* _RID_UTILS_H_ */
@@ -0,0 +1,94 @@
+/*
+ * scan.h
+ *
+ * brute-force linear scan RID FIB engine.
+ *
+ * the entries of a FIB partition (i.e. all entries w/ the same prefix size
+ * |F|) are kept in a contiguous structure-of-arrays (SoA) layout: each 160 bit
+ * RID is split into 64 + 64 + 32 bit columns, which are scanned w/ a branch-free
+ * (R & F) == F test, several entries per instruction (AVX2, if the CPU
+ * supports it). prefix strings are only consulted for matches, in order to
+ * tell TPs from FPs.
+ *
+ * the point is to have a baseline for the PT engine, and find the partition
+ * size at which pointer-chasing a trie starts to pay off.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rid_utils.h"
+#include "lookup_stats.h"
+#include "pt.h"
+
+// nr. of entries tested per iteration of the scan loop
+#define SCAN_BLOCK_SIZE     4
+
+/*
+ * \brief linear scan fwd table for a single FIB partition (prefix size).
+ */
+struct scan_fwd {
+
+    // FIB partition the entries were collected from
+    struct pt_ht * fib_root;
+
+    // prefix size (in number of encoded elements)
+    int prefix_size;
+
+    // nr. of forwarding entries
+    uint32_t num_entries;
+
+    // RID columns: bytes [0, 8), [8, 16) and [16, 20) of each entry's RID
+    uint64_t * rid_hi;
+    uint64_t * rid_mid;
+    uint32_t * rid_lo;
+
+    // prefix info of each entry (NOT a copy: these belong to the pt_fwd
+    // nodes the entries were collected from)
+    struct prefix_info ** prefix_i;
+
+    // next hop of each entry (see pt_fwd.port)
+    uint16_t * ports;
+};
+
+extern struct scan_fwd * scan_fwd_init(struct pt_ht * partition);
+extern void scan_fwd_erase(struct scan_fwd * s);
+
+extern int scan_fwd_lookup(
+        struct scan_fwd * s,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats);
+
+extern void scan_ht_print_crossover(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir);
+
+#endif /* _SCAN_H_ */
@@ -0,0 +1,123 @@
+/*
+ * snapshot.h
+ *
+ * binary FIB snapshots: the flat tries of all FIB partitions (see
+ * pt_flat.h), written to a single file which can be mmap()'d back
+ * read-only, w/o re-building the FIB.
+ *
+ * file layout (all offsets in byte, from the start of the file):
+ *
+ *  -# header (struct snapshot_header)
+ *  -# partition table (header.num_parts x struct snapshot_part)
+ *  -# node array (struct pt_flat_node, all partitions back to back, 64 byte
+ *     aligned). node links are indexes w/in the node's partition.
+ *  -# string blob ('\0' terminated prefix strings). node prefix offsets are
+ *     relative to the start of the blob.
+ *
+ * there are no pointers in the file, so the mapping address doesn't matter.
+ * the header and partition table are checked (magic, version, sizes,
+ * checksum and no duplicate prefix sizes) on every load, and so are the
+ * node links, key bits and prefix offsets (which reads the node array, but
+ * not the strings). the rest of the file (the payload) has its own
+ * checksum, which is only verified on demand, since that means reading
+ * the whole file instead of faulting pages in lazily, as lookups touch
+ * them.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rid_utils.h"
+#include "pt.h"
+#include "pt_flat.h"
+#include "bit_order.h"
+
+#define SNAPSHOT_MAGIC          "RIDFIB\0\0"
+#define SNAPSHOT_MAGIC_LEN      8
+#define SNAPSHOT_VERSION        2
+#define SNAPSHOT_ALIGN          64
+
+struct snapshot_header {
+
+    char magic[SNAPSHOT_MAGIC_LEN];
+    uint32_t version;
+    uint32_t header_size;
+
+    // size of the whole file
+    uint64_t file_size;
+
+    uint32_t num_parts;
+
+    // 1 if the RIDs were permuted w/ perm (see bit_order.h): requests must
+    // be permuted as well
+    uint32_t has_perm;
+    uint8_t perm[BIT_ORDER_BITS];
+
+    uint64_t parts_off;
+    uint64_t nodes_off;
+    uint64_t num_nodes;
+    uint64_t strings_off;
+    uint64_t strings_size;
+
+    // FNV-1a over the payload (nodes and strings)
+    uint64_t payload_checksum;
+
+    // FNV-1a over the header (w/ this field set to 0) and partition table
+    uint64_t header_checksum;
+};
+
+struct snapshot_part {
+
+    int32_t prefix_size;
+    uint32_t num_entries;
+    uint32_t num_dups;
+    uint32_t num_nodes;
+
+    // index of the partition's 1st node in the node array
+    uint64_t first_node;
+};
+
+/*
+ * \brief a mmap()'d snapshot. must outlive the FIB loaded from it.
+ */
+struct snapshot {
+
+    void * addr;
+    size_t size;
+};
+
+extern int snapshot_save(
+        struct pt_ht * fib,
+        struct rid_perm * perm,
+        const char * filename);
+
+extern struct snapshot * snapshot_load(
+        const char * filename,
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        int * has_perm,
+        int verify);
+
+extern void snapshot_unmap(struct snapshot * snap);
+
+#endif /* _SNAPSHOT_H_ */
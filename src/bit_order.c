@@ -0,0 +1,289 @@
+/*
+ * bit_order.c
+ *
+ * entropy-driven RID bit reordering.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "bit_order.h"
+
+// same bit order as bit() in pt.c
+static __inline int bit_get(int i, struct click_xia_xid * rid) {
+
+    return (rid->id[CLICK_XIA_XID_ID_LEN - (i / 8) - 1] >> (8 - (i % 8) - 1)) & 0x01;
+}
+
+static __inline void bit_set(int i, struct click_xia_xid * rid) {
+
+    rid->id[CLICK_XIA_XID_ID_LEN - (i / 8) - 1] |= (uint8_t) (1 << (8 - (i % 8) - 1));
+}
+
+static int rid_perm_count_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        uint32_t * counts) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    int entries = 0, i = 0;
+
+    // the root node (default route) isn't an actual entry
+    if (t->prefix_size > 0) {
+
+        for (i = 0; i < BIT_ORDER_BITS; i++)
+            counts[i] += bit_get(i, t->prefix_rid);
+
+        entries++;
+    }
+
+    entries += rid_perm_count_rec(t->p_left, t->key_bit, counts);
+    entries += rid_perm_count_rec(t->p_right, t->key_bit, counts);
+
+    return entries;
+}
+
+static double bit_entropy(double p) {
+
+    if (p <= 0.0 || p >= 1.0)
+        return 0.0;
+
+    return -((p * log2(p)) + ((1.0 - p) * log2(1.0 - p)));
+}
+
+/*
+ * \brief   computes a bit order for a FIB, out of the per-bit set frequency
+ *          over all its entries: bits are sorted by decreasing entropy
+ *          (ties keep the original order).
+ *
+ * \param   perm    the permutation to fill
+ * \param   fib     the FIB
+ */
+void rid_perm_init(struct rid_perm * perm, struct pt_ht * fib) {
+
+    uint32_t counts[BIT_ORDER_BITS] = {0};
+    int entries = 0, i = 0;
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        entries += rid_perm_count_rec(itr->trie, -1, counts);
+
+    for (i = 0; i < BIT_ORDER_BITS; i++) {
+
+        perm->map[i] = (uint8_t) i;
+        perm->freq[i] = (entries > 0 ? (double) counts[i] / (double) entries : 0.0);
+    }
+
+    std::stable_sort(perm->map, perm->map + BIT_ORDER_BITS,
+        [perm](uint8_t x, uint8_t y) { return bit_entropy(perm->freq[x]) > bit_entropy(perm->freq[y]); });
+}
+
+/*
+ * \brief   applies a bit permutation to an RID, in place.
+ */
+void rid_perm_apply(struct rid_perm * perm, struct click_xia_xid * rid) {
+
+    struct click_xia_xid orig;
+    int i = 0;
+
+    memcpy(&orig, rid, sizeof(struct click_xia_xid));
+    memset(rid->id, 0, CLICK_XIA_XID_ID_LEN);
+
+    for (i = 0; i < BIT_ORDER_BITS; i++) {
+
+        if (bit_get(perm->map[i], &orig))
+            bit_set(i, rid);
+    }
+}
+
+/*
+ * \brief   trie depth histogram and nodes visited by lookups, for all
+ *          partitions of a FIB.
+ *
+ * XXX: pt_fwd_lookup() updates the partition stats, these must be reset
+ * by the caller.
+ */
+static void bit_order_measure(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        uint32_t depth_hist[][PT_MAX_DEPTH],
+        int * max_depth,
+        unsigned long * visits,
+        int * lookups) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+    int i = 0;
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        int p = itr->prefix_size;
+
+        memset(depth_hist[p], 0, PT_MAX_DEPTH * sizeof(uint32_t));
+        max_depth[p] = pt_fwd_depth_hist(itr->trie, depth_hist[p], PT_MAX_DEPTH);
+
+        visits[p] = 0;
+        lookups[p] = 0;
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < p)
+                continue;
+
+            visits[p] += pt_fwd_lookup(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+            lookups[p]++;
+        }
+    }
+}
+
+static double bit_order_avg_depth(uint32_t * depth_hist) {
+
+    double depth = 0.0, nodes = 0.0;
+    int k = 0;
+
+    for (k = 0; k < PT_MAX_DEPTH; k++) {
+        depth += (double) k * (double) depth_hist[k];
+        nodes += (double) depth_hist[k];
+    }
+
+    return (nodes > 0.0 ? depth / nodes : 0.0);
+}
+
+/*
+ * \brief   re-orders the RID bits of a FIB and of a set of requests w/ an
+ *          entropy-driven permutation, reporting the trie depth and nodes
+ *          visited per lookup before (identity order) and after.
+ *
+ * the FIB tries are rebuilt w/ pt_ht_permute(), requests are permuted in
+ * place. the partition stats are reset at the end.
+ *
+ * \param   fib             the FIB, in identity order
+ * \param   perm            set to the permutation applied to the FIB
+ * \param   requests        array of requests, in identity order
+ * \param   requests_num    size of the requests array
+ * \param   output_dir      dir on which to dump the .tsv files
+ */
+void bit_order_apply(
+        struct pt_ht * fib,
+        struct rid_perm * perm,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    static uint32_t id_hist[MAX_PREFIX_SIZE + 1][PT_MAX_DEPTH];
+    static uint32_t perm_hist[MAX_PREFIX_SIZE + 1][PT_MAX_DEPTH];
+
+    int id_max_depth[MAX_PREFIX_SIZE + 1] = {0}, perm_max_depth[MAX_PREFIX_SIZE + 1] = {0};
+    unsigned long id_visits[MAX_PREFIX_SIZE + 1] = {0}, perm_visits[MAX_PREFIX_SIZE + 1] = {0};
+    int lookups[MAX_PREFIX_SIZE + 1] = {0};
+    int i = 0, k = 0;
+
+    rid_perm_init(perm, fib);
+
+    bit_order_measure(fib, requests, requests_num, id_hist, id_max_depth, id_visits, lookups);
+
+    pt_ht_permute(fib, perm);
+
+    for (i = 0; i < requests_num; i++)
+        rid_perm_apply(perm, requests[i].rid);
+
+    bit_order_measure(fib, requests, requests_num, perm_hist, perm_max_depth, perm_visits, lookups);
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_BIT_ORDER_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tID_AVG_DEPTH\tPERM_AVG_DEPTH\tID_MAX_DEPTH\tPERM_MAX_DEPTH"\
+        "\tID_AVG_VISITS\tPERM_AVG_VISITS\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-4s\t| %-8s\t| %-14s\t| %-14s\t| %-14s\n"\
+            "%-4s\t| %-8s\t| %-14s\t| %-14s\t| %-14s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "AVG DEPTH", "MAX DEPTH", "VISITS/REQ",
+            "", "", "(ID/PERM)", "(ID/PERM)", "(ID/PERM)");
+
+    uint32_t id_total[PT_MAX_DEPTH] = {0}, perm_total[PT_MAX_DEPTH] = {0};
+    unsigned long id_visits_total = 0, perm_visits_total = 0;
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        int p = itr->prefix_size;
+
+        for (k = 0; k < PT_MAX_DEPTH; k++) {
+            id_total[k] += id_hist[p][k];
+            perm_total[k] += perm_hist[p][k];
+        }
+
+        id_visits_total += id_visits[p];
+        perm_visits_total += perm_visits[p];
+
+        double id_avg = (lookups[p] > 0 ? (double) id_visits[p] / (double) lookups[p] : 0.0);
+        double perm_avg = (lookups[p] > 0 ? (double) perm_visits[p] / (double) lookups[p] : 0.0);
+
+        printf(
+            "%-4d\t| %-8d\t| %-6.1f/%-6.1f\t| %-6d/%-6d\t| %-6.1f/%-6.1f\n",
+            p, itr->num_entries,
+            bit_order_avg_depth(id_hist[p]), bit_order_avg_depth(perm_hist[p]),
+            id_max_depth[p], perm_max_depth[p],
+            id_avg, perm_avg);
+
+        fprintf(output_file, "%d\t%d\t%-.6f\t%-.6f\t%d\t%d\t%-.6f\t%-.6f\n",
+            p, itr->num_entries,
+            bit_order_avg_depth(id_hist[p]), bit_order_avg_depth(perm_hist[p]),
+            id_max_depth[p], perm_max_depth[p],
+            id_avg, perm_avg);
+
+        lookup_stats_reset(itr->general_stats);
+    }
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-4s\t| %-8s\t| %-6.1f/%-6.1f\t| %-14s\t| %-6.1f/%-6.1f\n",
+            "ALL", "",
+            bit_order_avg_depth(id_total), bit_order_avg_depth(perm_total),
+            "",
+            (requests_num > 0 ? (double) id_visits_total / (double) requests_num : 0.0),
+            (requests_num > 0 ? (double) perm_visits_total / (double) requests_num : 0.0));
+
+    printf("\n");
+
+    fclose(output_file);
+
+    // depth distribution, over all partitions
+    filename = output_dir + std::string("/") + std::string(DEFAULT_BIT_ORDER_DEPTH_FILE);
+    output_file = fopen(filename.c_str(), "wb");
+    fprintf(output_file, "DEPTH\tID_NODES\tPERM_NODES\n");
+
+    for (k = 0; k < PT_MAX_DEPTH; k++) {
+
+        if (id_total[k] == 0 && perm_total[k] == 0)
+            continue;
+
+        fprintf(output_file, "%d\t%d\t%d\n", k, id_total[k], perm_total[k]);
+    }
+
+    fclose(output_file);
+}
@@ -0,0 +1,323 @@
+/*
+ * bitslice.c
+ *
+ * bit-sliced signature RID FIB engine (a la BitFunnel).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+#include "bitslice.h"
+#include "prefix_dict.h"
+
+/*
+ * \brief   returns whether or not bit b is set in an RID. unlike bit() in
+ *          pt.c, the order of the bits doesn't matter here.
+ */
+static __inline int bs_rid_bit(struct click_xia_xid * rid, int b) {
+
+    return (rid->id[b / 8] >> (b % 8)) & 0x01;
+}
+
+static __inline uint64_t * bs_slice(struct bs_fwd * bs, uint32_t block, int b) {
+
+    return &(bs->slices[(((size_t) block * BS_SLICES) + b) * bs->block_words]);
+}
+
+static int bs_fwd_collect_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct bs_fwd * bs,
+        uint32_t * density) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    // the root node (default route) isn't an actual entry
+    if (t->prefix_size > 0) {
+
+        uint32_t block_entries = bs->block_words * 64;
+        uint32_t e = bs->num_entries, block = e / block_entries;
+        uint32_t word = (e % block_entries) / 64, shift = e % 64;
+        int b = 0;
+
+        for (b = 0; b < BS_SLICES; b++) {
+
+            if (bs_rid_bit(t->prefix_rid, b)) {
+
+                bs_slice(bs, block, b)[word] |= (1ULL << shift);
+                density[b]++;
+            }
+        }
+
+        bs->prefix_i[e] = t->prefix_i;
+        bs->ports[e] = t->port;
+        bs->num_entries++;
+    }
+
+    bs_fwd_collect_rec(t->p_left, t->key_bit, bs, density);
+    bs_fwd_collect_rec(t->p_right, t->key_bit, bs, density);
+
+    return bs->num_entries;
+}
+
+/*
+ * \brief   builds a bit-sliced fwd table out of the entries of a FIB
+ *          partition (i.e. a PT subtree for some prefix size)
+ *
+ * \param   partition   the FIB partition to collect the entries from
+ *
+ * \return  the bit-sliced fwd table, NULL if memory couldn't be allocated
+ */
+struct bs_fwd * bs_fwd_init(struct pt_ht * partition) {
+
+    struct bs_fwd * bs = (struct bs_fwd * ) calloc(1, sizeof(struct bs_fwd));
+
+    bs->fib_root = partition;
+    bs->prefix_size = partition->prefix_size;
+    bs->num_blocks = (partition->num_entries + BS_BLOCK_ENTRIES - 1) / BS_BLOCK_ENTRIES;
+
+    // no point in scanning 4096 entry blocks for partitions w/ a handful of 
+    // entries: round the nr. of words up to a multiple of 4
+    bs->block_words = BS_BLOCK_WORDS;
+
+    if (bs->num_blocks < 2)
+        bs->block_words = std::max((uint32_t) 4, (((partition->num_entries + 63) / 64) + 3) & ~((uint32_t) 3));
+
+    // FIXME: the max() avoids 0 size allocations for empty partitions
+    size_t slices_size = std::max(bs->num_blocks, (uint32_t) 1)
+        * BS_SLICES * bs->block_words * sizeof(uint64_t);
+
+    if (posix_memalign((void **) &(bs->slices), 64, slices_size)) {
+
+        fprintf(stderr, "bs_fwd_init() : ERROR posix_memalign() failed\n");
+        free(bs);
+
+        return NULL;
+    }
+
+    memset(bs->slices, 0, slices_size);
+    bs->prefix_i = (struct prefix_info **) calloc(partition->num_entries + 1, sizeof(struct prefix_info *));
+    bs->ports = (uint16_t *) calloc(partition->num_entries + 1, sizeof(uint16_t));
+
+    uint32_t density[BS_SLICES] = {0};
+
+    bs->num_entries = 0;
+    bs_fwd_collect_rec(partition->trie, -1, bs, density);
+
+    // sort the bit positions by slice density (descending)
+    int b = 0;
+    for (b = 0; b < BS_SLICES; b++)
+        bs->slice_order[b] = (uint8_t) b;
+
+    std::stable_sort(bs->slice_order, bs->slice_order + BS_SLICES,
+        [&density](uint8_t x, uint8_t y) { return density[x] > density[y]; });
+
+    return bs;
+}
+
+void bs_fwd_erase(struct bs_fwd * bs) {
+
+    if (!bs)
+        return;
+
+    free(bs->slices);
+    free(bs->prefix_i);
+    free(bs->ports);
+    free(bs);
+}
+
+/*
+ * \brief   AND-NOTs the slices of the request's '0' bits into the candidate
+ *          bitmap of a block.
+ *
+ * \return  0 if the block ran out of candidates, 1 otherwise
+ */
+static int bs_block_filter_scalar(
+        struct bs_fwd * bs,
+        uint32_t block,
+        uint8_t * zero_bits,
+        int zero_bits_num,
+        uint64_t * cand) {
+
+    int j = 0, w = 0;
+    uint64_t any = 0;
+
+    for (j = 0; j < zero_bits_num; j++) {
+
+        uint64_t * slice = bs_slice(bs, block, zero_bits[j]);
+
+        for (w = 0; w < (int) bs->block_words; w++)
+            cand[w] &= ~slice[w];
+
+        if ((j % BS_CHECK_INTERVAL) == (BS_CHECK_INTERVAL - 1)) {
+
+            for (any = 0, w = 0; w < (int) bs->block_words; w++)
+                any |= cand[w];
+
+            if (!any)
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+__attribute__((target("avx2")))
+static int bs_block_filter_avx2(
+        struct bs_fwd * bs,
+        uint32_t block,
+        uint8_t * zero_bits,
+        int zero_bits_num,
+        uint64_t * cand) {
+
+    int j = 0, w = 0;
+
+    for (j = 0; j < zero_bits_num; j++) {
+
+        uint64_t * slice = bs_slice(bs, block, zero_bits[j]);
+
+        for (w = 0; w < (int) bs->block_words; w += 4) {
+
+            __m256i c = _mm256_load_si256((const __m256i *) &(cand[w]));
+            __m256i s = _mm256_load_si256((const __m256i *) &(slice[w]));
+
+            // ~s & c
+            _mm256_store_si256((__m256i *) &(cand[w]), _mm256_andnot_si256(s, c));
+        }
+
+        if ((j % BS_CHECK_INTERVAL) == (BS_CHECK_INTERVAL - 1)) {
+
+            __m256i any = _mm256_setzero_si256();
+
+            for (w = 0; w < (int) bs->block_words; w += 4)
+                any = _mm256_or_si256(any, _mm256_load_si256((const __m256i *) &(cand[w])));
+
+            if (_mm256_testz_si256(any, any))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * \brief   looks up a request RID in a bit-sliced fwd table.
+ *
+ * TPs and FPs are added to the tp_sizes and fp_sizes arrays, in the same way
+ * as pt_fwd_lookup() does it, and the next hops of the matches to ports (if
+ * not NULL). if stats isn't NULL, |F\R| is worked out for matches and all
+ * non-matching entries are counted as TNs.
+ *
+ * \return  nr. of matching entries (TPs + FPs)
+ */
+int bs_fwd_lookup(
+        struct bs_fwd * bs,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats) {
+
+    // checking for AVX2 support only once
+    static int has_avx2 = -1;
+
+    if (has_avx2 < 0)
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    // the slices to AND-NOT are those of the request's '0' bits, densest 1st
+    uint8_t zero_bits[BS_SLICES];
+    int zero_bits_num = 0, b = 0;
+
+    for (b = 0; b < BS_SLICES; b++) {
+
+        if (!bs_rid_bit(request_rid, bs->slice_order[b]))
+            zero_bits[zero_bits_num++] = bs->slice_order[b];
+    }
+
+    uint64_t cand[BS_BLOCK_WORDS] __attribute__((aligned(32)));
+    uint32_t block = 0, entries = 0, w = 0, block_entries = bs->block_words * 64;
+    int matches = 0, tps = 0, fps = 0, filtered = 0;
+
+    for (block = 0; block < bs->num_blocks; block++) {
+
+        // all entries of the block are candidates to begin with (the last
+        // block may be partially filled)
+        entries = std::min(block_entries, bs->num_entries - (block * block_entries));
+
+        for (w = 0; w < bs->block_words; w++) {
+
+            if (entries >= ((w + 1) * 64))
+                cand[w] = ~0ULL;
+            else if (entries > (w * 64))
+                cand[w] = (1ULL << (entries - (w * 64))) - 1;
+            else
+                cand[w] = 0ULL;
+        }
+
+        if (has_avx2)
+            filtered = bs_block_filter_avx2(bs, block, zero_bits, zero_bits_num, cand);
+        else
+            filtered = bs_block_filter_scalar(bs, block, zero_bits, zero_bits_num, cand);
+
+        if (!filtered)
+            continue;
+
+        // whatever's left are matches
+        for (w = 0; w < bs->block_words; w++) {
+
+            while (cand[w]) {
+
+                uint32_t e = (block * block_entries) + (w * 64) + __builtin_ctzll(cand[w]);
+                char prefix[PREFIX_MAX_LENGTH];
+                cand[w] &= (cand[w] - 1);
+
+                // TP or FP check
+                tps = 0; fps = 0;
+                prefix_info_str(bs->prefix_i[e], prefix, PREFIX_MAX_LENGTH);
+
+                if (strstr(request, prefix) != NULL)
+                    tps = 1;
+                else
+                    fps = 1;
+
+                tp_sizes[bs->prefix_size - 1] += tps;
+                fp_sizes[bs->prefix_size - 1] += fps;
+
+                if (ports != NULL)
+                    pt_port_set_add(ports, bs->ports[e]);
+
+                if (stats != NULL) {
+
+                    lookup_stats_update(
+                        &stats,
+                        req_entry_diff(request, prefix, bs->prefix_size),
+                        tps, fps, 0, 1);
+                }
+
+                matches++;
+            }
+        }
+    }
+
+    if (stats != NULL)
+        lookup_stats_add_tns(stats, bs->num_entries - matches);
+
+    return matches;
+}
@@ -0,0 +1,510 @@
+/*
+ * churn.c
+ *
+ * FIB churn benchmark.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <pthread.h>
+#include <time.h>
+
+#include "churn.h"
+#include "rcu.h"
+
+/*
+ * \brief   generates a stream of updates out of a list of URLs in a FIB.
+ *          adds and removes are equally likely: removes pick a random URL
+ *          in the FIB at that point of the stream (including URLs added by
+ *          earlier updates), adds extend a random URL in the FIB by 1
+ *          element.
+ *
+ * \param   urls        the URLs in the FIB. left w/ the URLs in the FIB
+ *                      after the whole stream.
+ */
+void churn_generate(
+        std::vector<std::string> & urls,
+        int num_updates,
+        std::vector<struct churn_update> & updates) {
+
+    char name[PREFIX_MAX_LENGTH];
+
+    for (int i = 0; i < num_updates && !urls.empty(); i++) {
+
+        int j = rand() % urls.size();
+        struct churn_update u;
+
+        if (rand() % 2) {
+
+            u.op = CHURN_OP_REMOVE;
+            u.url = urls[j];
+
+            urls[j] = urls.back();
+            urls.pop_back();
+
+        } else {
+
+            // URLs which can't be extended any further are skipped
+            for (int k = 0; k < CHURN_ADD_TRIES
+                && (std::count(urls[j].begin(), urls[j].end(), '/') + 1 >= MAX_PREFIX_SIZE
+                    || urls[j].length() + 16 > ((size_t) PREFIX_MAX_LENGTH * 0.75)); k++)
+                j = rand() % urls.size();
+
+            snprintf(name, PREFIX_MAX_LENGTH, "%s/c%d", urls[j].c_str(), i);
+
+            u.op = CHURN_OP_ADD;
+            u.url = std::string(name);
+
+            urls.push_back(u.url);
+        }
+
+        updates.push_back(u);
+    }
+}
+
+/*
+ * \brief   applies an update to a FIB
+ *
+ * \return  0 if the FIB changed, 1 if the update was a no-op (see
+ *          pt_ht_add_url() and pt_ht_remove_url()), -1 on error
+ */
+int churn_apply(
+        struct pt_ht ** fib,
+        struct churn_update * update,
+        struct rid_perm * perm) {
+
+    if (update->op == CHURN_OP_ADD)
+        return pt_ht_add_url(fib, (char *) update->url.c_str(), perm);
+    else
+        return pt_ht_remove_url(*fib, (char *) update->url.c_str(), perm);
+}
+
+static uint32_t churn_fib_size(struct pt_ht * fib) {
+
+    struct pt_ht * itr;
+    uint32_t size = 0;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        size += itr->num_entries;
+
+    return size;
+}
+
+/*
+ * \brief   applies a stream of num_updates updates (see churn_generate()) to
+ *          a FIB and reports the update rate, per window of
+ *          num_updates / CHURN_WINDOWS updates. the FIB's entry counts are
+ *          checked against its tries at the end. results go to
+ *          <output_dir>/churn-bench.tsv.
+ */
+void churn_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        int num_updates,
+        std::string output_dir) {
+
+    std::vector<std::string> urls;
+    std::vector<struct churn_update> updates;
+
+    // frozen partitions are thawed upfront (see delta.h)
+    pt_ht_thaw(*fib);
+    pt_ht_get_prefixes(*fib, urls);
+
+    uint32_t fib_size = churn_fib_size(*fib), init_size = fib_size;
+    churn_generate(urls, num_updates, updates);
+
+    std::string report_file = output_dir + std::string("/") + std::string(DEFAULT_CHURN_BENCH_FILE);
+    FILE * report = fopen(report_file.c_str(), "wb");
+
+    if (!report) {
+
+        fprintf(stderr, "churn_bench() : [ERROR] couldn't open %s\n", report_file.c_str());
+        return;
+    }
+
+    fprintf(report, "WINDOW\tUPDATES\tADDS\tREMOVES\tNOOPS\tTIME\tUPDATES_PER_SEC\tFIB_SIZE\n");
+
+    printf("\n[FIB_SIZE]: %d"\
+        "\n[UPDATES]: %d"\
+        "\n\n%-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\n",
+        fib_size, (int) updates.size(),
+        "WINDOW", "ADDS", "REMOVES", "NO-OPS", "UPDATES/s", "FIB SIZE");
+
+    int window_size = std::max(1, (int) updates.size() / CHURN_WINDOWS);
+    int adds = 0, removes = 0, noops = 0, window = 0;
+    int tot_adds = 0, tot_removes = 0, tot_noops = 0;
+    double tot_time = 0.0, window_begin = get_time_now();
+
+    for (int i = 0; i < (int) updates.size(); i++) {
+
+        int ret = churn_apply(fib, &updates[i], perm);
+
+        if (ret != 0)
+            noops++;
+        else if (updates[i].op == CHURN_OP_ADD)
+            adds++;
+        else
+            removes++;
+
+        if ((i + 1) % window_size == 0 || (i + 1) == (int) updates.size()) {
+
+            double window_time = get_time_now() - window_begin;
+            int window_updates = adds + removes + noops;
+
+            fib_size = churn_fib_size(*fib);
+
+            printf("%-10d\t| %-10d\t| %-10d\t| %-10d\t| %-10.1f\t| %-10d\n",
+                window, adds, removes, noops, (double) window_updates / window_time, fib_size);
+
+            fprintf(report, "%d\t%d\t%d\t%d\t%d\t%-.8f\t%-.1f\t%d\n",
+                window, window_updates, adds, removes, noops,
+                window_time, (double) window_updates / window_time, fib_size);
+
+            tot_time += window_time;
+            tot_adds += adds;
+            tot_removes += removes;
+            tot_noops += noops;
+
+            adds = removes = noops = 0;
+            window++;
+
+            // reporting isn't accounted for
+            window_begin = get_time_now();
+        }
+    }
+
+    printf("\n[UPDATES_PER_SEC]: %-.1f"\
+        "\n[ADDS]: %d"\
+        "\n[REMOVES]: %d"\
+        "\n[NO-OPS]: %d"\
+        "\n[CONSISTENT]: %s\n",
+        (double) updates.size() / tot_time,
+        tot_adds, tot_removes, tot_noops,
+        (pt_ht_check(*fib) && fib_size == init_size + tot_adds - tot_removes ? "yes" : "no"));
+
+    fclose(report);
+}
+
+/*
+ * \brief state shared by the readers and the writer of churn_rcu_bench()
+ */
+struct churn_rcu_writer {
+
+    struct pt_ht ** fib;
+    struct rid_perm * perm;
+    // URLs in the FIB
+    std::vector<std::string> * urls;
+
+    // updates per second
+    double update_rate;
+
+    // set when the readers are done
+    int stop;
+
+    uint32_t num_updates;
+    double time;
+};
+
+/*
+ * \brief   applies updates at a fixed rate until told to stop. the writer
+ *          adds URLs (1 element longer than random URLs in the FIB) and
+ *          removes the URLs it added, w/ equal probability, so that the
+ *          entries looked up by the reader stay the same.
+ */
+static void * churn_rcu_writer_run(void * arg) {
+
+    struct churn_rcu_writer * w = (struct churn_rcu_writer *) arg;
+    std::vector<std::string> added;
+    std::vector<std::string> & urls = *(w->urls);
+
+    char name[PREFIX_MAX_LENGTH];
+    struct churn_update u;
+
+    struct timespec nap = {0, 50000};
+    double begin = get_time_now(), now = begin, slot = begin;
+
+    while (!__atomic_load_n(&(w->stop), __ATOMIC_ACQUIRE) && !urls.empty()) {
+
+        // keep up w/ the rate: wait for the next update's slot
+        slot = begin + ((double) w->num_updates / w->update_rate);
+
+        if ((now = get_time_now()) < slot) {
+
+            if (slot - now > 0.0001)
+                nanosleep(&nap, NULL);
+
+            continue;
+        }
+
+        if (added.empty() || rand() % 2) {
+
+            int j = rand() % urls.size();
+
+            if (std::count(urls[j].begin(), urls[j].end(), '/') + 1 >= MAX_PREFIX_SIZE
+                || urls[j].length() + 16 > ((size_t) PREFIX_MAX_LENGTH * 0.75))
+                continue;
+
+            snprintf(name, PREFIX_MAX_LENGTH, "%s/c%d", urls[j].c_str(), w->num_updates);
+
+            u.op = CHURN_OP_ADD;
+            u.url = std::string(name);
+
+            added.push_back(u.url);
+
+        } else {
+
+            int j = rand() % added.size();
+
+            u.op = CHURN_OP_REMOVE;
+            u.url = added[j];
+
+            added[j] = added.back();
+            added.pop_back();
+        }
+
+        churn_apply(w->fib, &u, w->perm);
+        w->num_updates++;
+    }
+
+    w->time = get_time_now() - begin;
+
+    // leave the FIB as it was
+    for (size_t i = 0; i < added.size(); i++) {
+
+        u.op = CHURN_OP_REMOVE;
+        u.url = added[i];
+
+        churn_apply(w->fib, &u, w->perm);
+    }
+
+    return NULL;
+}
+
+static double churn_percentile(std::vector<double> & latencies, double p) {
+
+    return latencies[std::min(latencies.size() - 1, (size_t) (p * latencies.size()))];
+}
+
+/*
+ * \brief   runs CHURN_RCU_ROUNDS passes over the requests, timing each
+ *          lookup.
+ *
+ * \return  total nr. of TPs. a reader which misses no entry in the FIB
+ *          gets the same TPs w/ and w/o concurrent updates.
+ */
+static uint32_t churn_rcu_read(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        int reader,
+        std::vector<double> & latencies) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tps = 0;
+
+    for (int r = 0; r < CHURN_RCU_ROUNDS; r++) {
+
+        // readers start at different requests
+        for (int j = 0; j < requests_num; j++) {
+
+            int i = (j + (reader * (requests_num / CHURN_RCU_READERS))) % requests_num;
+            double begin = get_time_now();
+
+            // same partitions as pt_ht_lookup(), but w/o the thread pool
+            rcu_read_lock(pt_rcu, reader);
+
+            struct pt_ht * s = NULL;
+            int prefix_size = requests[i].size;
+
+            while ((s == NULL) && prefix_size > 0)
+                s = pt_ht_search(fib, prefix_size--);
+
+            for ( ; s != NULL; s = (struct pt_ht *) s->hh.prev)
+                pt_fwd_lookup(s->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+
+            rcu_read_unlock(pt_rcu, reader);
+
+            latencies.push_back(get_time_now() - begin);
+        }
+    }
+
+    for (int i = 0; i < BF_MAX_ELEMENTS; i++)
+        tps += tp_sizes[i];
+
+    return tps;
+}
+
+/*
+ * \brief a reader of churn_rcu_bench()
+ */
+struct churn_rcu_reader {
+
+    struct pt_ht * fib;
+    struct rid_request * requests;
+    int requests_num;
+    int reader;
+
+    std::vector<double> latencies;
+    uint32_t tps;
+};
+
+static void * churn_rcu_reader_run(void * arg) {
+
+    struct churn_rcu_reader * r = (struct churn_rcu_reader *) arg;
+
+    r->latencies.clear();
+    r->tps = churn_rcu_read(r->fib, r->requests, r->requests_num, r->reader, r->latencies);
+
+    return NULL;
+}
+
+/*
+ * \brief   mixed read/write benchmark: CHURN_RCU_READERS readers look up the
+ *          requests in the FIB while a writer applies online updates at
+ *          update_rate updates per second. the lookup latency distribution
+ *          (of all readers) is reported w/o and w/ the writer running.
+ *          results go to <output_dir>/rcu-bench.tsv.
+ *
+ * lookups don't take any locks: the writer publishes new nodes w/ release
+ * semantics and retires removed nodes through pt_rcu (see rcu.h), and the
+ * partition stats are updated atomically.
+ */
+void churn_rcu_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        struct rid_request * requests,
+        int requests_num,
+        double update_rate,
+        std::string output_dir) {
+
+    std::vector<std::string> urls;
+
+    // concurrent lookups only work on the tries, and the partitions can't
+    // be created while readers are running
+    pt_ht_set_engine(*fib, PT_ENGINE_PT);
+    pt_ht_thaw(*fib);
+
+    for (int i = 1; i <= MAX_PREFIX_SIZE; i++)
+        pt_ht_get_partition(fib, (char *) "", i);
+
+    pt_ht_get_prefixes(*fib, urls);
+
+    std::string report_file = output_dir + std::string("/") + std::string(DEFAULT_RCU_BENCH_FILE);
+    FILE * report = fopen(report_file.c_str(), "wb");
+
+    if (!report) {
+
+        fprintf(stderr, "churn_rcu_bench() : [ERROR] couldn't open %s\n", report_file.c_str());
+        return;
+    }
+
+    pt_rcu = rcu_init();
+
+    struct churn_rcu_reader readers[CHURN_RCU_READERS];
+    pthread_t reader_threads[CHURN_RCU_READERS];
+    int r = 0;
+
+    for (r = 0; r < CHURN_RCU_READERS; r++) {
+
+        readers[r].fib = *fib;
+        readers[r].requests = requests;
+        readers[r].requests_num = requests_num;
+        readers[r].reader = rcu_register(pt_rcu);
+    }
+
+    fprintf(report, "UPDATE_RATE\tUPDATES\tACTUAL_RATE\tLOOKUPS\tTPS\tP50\tP90\tP99\tP999\tMAX\tRETIRED\tRECLAIMED\n");
+
+    printf("\n%-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\n",
+        "UPDATES/s", "ACTUAL/s", "TPs", "P50 (us)", "P90 (us)", "P99 (us)", "P999 (us)", "MAX (us)");
+
+    // reads only, then reads + writes
+    double rates[] = {0.0, update_rate};
+
+    for (int k = 0; k < 2; k++) {
+
+        struct churn_rcu_writer w;
+        pthread_t writer;
+
+        memset(&w, 0, sizeof(struct churn_rcu_writer));
+        w.fib = fib;
+        w.perm = perm;
+        w.urls = &urls;
+        w.update_rate = rates[k];
+
+        if (rates[k] > 0.0)
+            pthread_create(&writer, NULL, churn_rcu_writer_run, &w);
+
+        for (r = 0; r < CHURN_RCU_READERS; r++)
+            pthread_create(&reader_threads[r], NULL, churn_rcu_reader_run, &readers[r]);
+
+        std::vector<double> latencies;
+
+        for (r = 0; r < CHURN_RCU_READERS; r++) {
+
+            pthread_join(reader_threads[r], NULL);
+            latencies.insert(latencies.end(), readers[r].latencies.begin(), readers[r].latencies.end());
+
+            // a reader which misses no entry gets the same TPs as the others
+            if (readers[r].tps != readers[0].tps)
+                fprintf(stderr, "churn_rcu_bench() : [ERROR] reader %d got %d TPs vs. %d\n",
+                    r, readers[r].tps, readers[0].tps);
+        }
+
+        uint32_t tps = readers[0].tps;
+
+        if (rates[k] > 0.0) {
+
+            __atomic_store_n(&(w.stop), 1, __ATOMIC_RELEASE);
+            pthread_join(writer, NULL);
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        double actual_rate = (w.time > 0.0 ? (double) w.num_updates / w.time : 0.0);
+
+        printf("%-10.1f\t| %-10.1f\t| %-10d\t| %-10.3f\t| %-10.3f\t| %-10.3f\t| %-10.3f\t| %-10.3f\n",
+            rates[k], actual_rate, tps,
+            churn_percentile(latencies, 0.50) * 1000000.0,
+            churn_percentile(latencies, 0.90) * 1000000.0,
+            churn_percentile(latencies, 0.99) * 1000000.0,
+            churn_percentile(latencies, 0.999) * 1000000.0,
+            latencies.back() * 1000000.0);
+
+        fprintf(report, "%-.1f\t%d\t%-.1f\t%d\t%d\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%ld\t%ld\n",
+            rates[k], w.num_updates, actual_rate, (int) latencies.size(), tps,
+            churn_percentile(latencies, 0.50),
+            churn_percentile(latencies, 0.90),
+            churn_percentile(latencies, 0.99),
+            churn_percentile(latencies, 0.999),
+            latencies.back(),
+            pt_rcu->num_retired, pt_rcu->num_reclaimed);
+    }
+
+    printf("\n[RETIRED]: %ld"\
+        "\n[RECLAIMED]: %ld"\
+        "\n[CONSISTENT]: %s\n",
+        pt_rcu->num_retired, pt_rcu->num_reclaimed,
+        (pt_ht_check(*fib) ? "yes" : "no"));
+
+    // no readers left: the remaining retired nodes can go
+    rcu_erase(pt_rcu);
+    pt_rcu = NULL;
+
+    fclose(report);
+}
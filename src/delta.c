@@ -0,0 +1,558 @@
+/*
+ * delta.c
+ *
+ * FIB deltas (incremental FIB updates).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "delta.h"
+#include "pt_flat.h"
+#include "snapshot.h"
+
+
+struct fib_delta * delta_init() {
+
+    return (struct fib_delta *) calloc(1, sizeof(struct fib_delta));
+}
+
+void delta_erase(struct fib_delta * delta) {
+
+    if (!delta)
+        return;
+
+    free(delta->records);
+    free(delta->strings);
+    free(delta);
+}
+
+/*
+ * \brief   appends a record to a delta. records are applied in the order
+ *          they're added.
+ *
+ * \param   op          DELTA_OP_ADD or DELTA_OP_REMOVE
+ * \param   rid         the entry's RID (identity bit order)
+ * \param   prefix      the entry's prefix
+ * \param   prefix_size the entry's prefix size
+ * \param   port        the entry's next hop, for adds (PT_PORT_NONE if none)
+ */
+void delta_add(
+        struct fib_delta * delta,
+        uint8_t op,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port) {
+
+    if (delta->num_records == delta->max_records) {
+
+        delta->max_records = (delta->max_records ? 2 * delta->max_records : 1024);
+        delta->records = (struct delta_record *) realloc(delta->records, delta->max_records * sizeof(struct delta_record));
+    }
+
+    size_t len = strlen(prefix) + 1;
+
+    while (delta->strings_size + len > delta->max_strings) {
+
+        delta->max_strings = (delta->max_strings ? 2 * delta->max_strings : 16384);
+        delta->strings = (char *) realloc(delta->strings, delta->max_strings);
+    }
+
+    struct delta_record * r = &(delta->records[delta->num_records++]);
+
+    memset(r, 0, sizeof(struct delta_record));
+    r->op = op;
+    r->prefix_size = (uint8_t) prefix_size;
+    r->port = (op == DELTA_OP_ADD ? port : PT_PORT_NONE);
+    memcpy(&(r->rid), rid, sizeof(struct click_xia_xid));
+    r->prefix = (uint32_t) delta->strings_size;
+
+    memcpy(delta->strings + delta->strings_size, prefix, len);
+    delta->strings_size += len;
+}
+
+/*
+ * \brief   creates a delta out of a text file, w/ 1 URL per line, prefixed
+ *          by '+' (add) or '-' (remove). URLs are normalized and checked
+ *          w/ pt_ht_url_to_rid(), as in online updates (see 
+ *          pt_ht_add_url()): URLs which can't be FIB entries are skipped.
+ *          as in URL files, an added URL may be followed by its next hop 
+ *          (port), separated by a space or tab ('+<url> <port>'). invalid 
+ *          or out-of-range ports are ignored. empty lines and lines 
+ *          starting w/ '#' are ignored.
+ *
+ * \return  the delta, NULL on error
+ */
+struct fib_delta * delta_from_urls(const char * filename) {
+
+    FILE * fr = fopen(filename, "rt");
+
+    if (!fr) {
+
+        fprintf(stderr, "delta_from_urls() : [ERROR] couldn't open %s\n", filename);
+        return NULL;
+    }
+
+    struct fib_delta * delta = delta_init();
+    struct click_xia_xid rid;
+
+    char * line = (char *) calloc(PREFIX_MAX_LENGTH, sizeof(char));
+    char prefix[PREFIX_MAX_LENGTH];
+    char * newline_pos, * port_pos;
+    uint16_t port = PT_PORT_NONE;
+    int line_nr = 0;
+
+    while (fgets(line, PREFIX_MAX_LENGTH, fr) != NULL) {
+
+        line_nr++;
+
+        if ((newline_pos = strchr(line, '\n')) != NULL)
+            *(newline_pos) = '\0';
+
+        int len = strlen(line);
+
+        if (len == 0 || line[0] == '#')
+            continue;
+
+        if ((line[0] != '+' && line[0] != '-') || len < 2) {
+
+            fprintf(stderr, "delta_from_urls() : [ERROR] %s:%d : expected '+<url> [port]' or '-<url>'\n", filename, line_nr);
+
+            delta_erase(delta);
+            delta = NULL;
+            break;
+        }
+
+        port = PT_PORT_NONE;
+
+        if ((port_pos = strpbrk(line, " \t")) != NULL) {
+
+            *(port_pos++) = '\0';
+
+            char * port_end = NULL;
+            long port_val = strtol(port_pos, &port_end, 10);
+
+            if (port_end != port_pos && port_val >= 0 && port_val < PT_MAX_PORTS)
+                port = (uint16_t) port_val;
+
+            if (strlen(line) < 2)
+                continue;
+        }
+
+        // same normalization and limits as pt_ht_add_url(), so that 
+        // records match the FIB entries of the same URLs
+        int prefix_size = pt_ht_url_to_rid(line + 1, prefix, &rid, NULL);
+
+        if (prefix_size < 0)
+            continue;
+
+        delta_add(delta, (line[0] == '+' ? DELTA_OP_ADD : DELTA_OP_REMOVE), &rid, prefix, prefix_size, port);
+    }
+
+    free(line);
+    fclose(fr);
+
+    return delta;
+}
+
+/*
+ * \brief   writes a delta to a file
+ *
+ * \return  0 on success, -1 otherwise
+ */
+int delta_save(struct fib_delta * delta, const char * filename) {
+
+    struct delta_header header;
+
+    memset(&header, 0, sizeof(struct delta_header));
+    memcpy(header.magic, DELTA_MAGIC, DELTA_MAGIC_LEN);
+    header.version = DELTA_VERSION;
+    header.header_size = sizeof(struct delta_header);
+    header.num_records = delta->num_records;
+    header.strings_size = delta->strings_size;
+    header.file_size = sizeof(struct delta_header)
+        + (delta->num_records * sizeof(struct delta_record))
+        + delta->strings_size;
+
+    header.checksum = fnv1a(
+        fnv1a(FNV_OFFSET_BASIS, delta->records, delta->num_records * sizeof(struct delta_record)),
+        delta->strings, delta->strings_size);
+
+    FILE * f = fopen(filename, "wb");
+
+    if (!f) {
+
+        fprintf(stderr, "delta_save() : [ERROR] couldn't open %s\n", filename);
+        return -1;
+    }
+
+    fwrite(&header, sizeof(struct delta_header), 1, f);
+    fwrite(delta->records, sizeof(struct delta_record), delta->num_records, f);
+    fwrite(delta->strings, 1, delta->strings_size, f);
+
+    int ret = (ferror(f) ? -1 : 0);
+    fclose(f);
+
+    return ret;
+}
+
+static struct fib_delta * delta_fail(struct fib_delta * delta, FILE * f, const char * filename, const char * reason) {
+
+    fprintf(stderr, "delta_load() : [ERROR] %s : %s\n", filename, reason);
+
+    if (f) fclose(f);
+    delta_erase(delta);
+
+    return NULL;
+}
+
+/*
+ * \brief   reads a delta from a file, checking its header and checksum
+ *
+ * \return  the delta, NULL on error
+ */
+struct fib_delta * delta_load(const char * filename) {
+
+    struct delta_header header;
+    struct stat st;
+
+    FILE * f = fopen(filename, "rb");
+
+    if (!f || fstat(fileno(f), &st) < 0)
+        return delta_fail(NULL, f, filename, "couldn't open file");
+
+    if (fread(&header, sizeof(struct delta_header), 1, f) != 1)
+        return delta_fail(NULL, f, filename, "file too small");
+
+    if (memcmp(header.magic, DELTA_MAGIC, DELTA_MAGIC_LEN) != 0)
+        return delta_fail(NULL, f, filename, "not a FIB delta");
+
+    if (header.version != DELTA_VERSION || header.header_size != sizeof(struct delta_header))
+        return delta_fail(NULL, f, filename, "unsupported version");
+
+    if (header.file_size != (uint64_t) st.st_size
+        || header.file_size != sizeof(struct delta_header)
+            + (header.num_records * sizeof(struct delta_record))
+            + header.strings_size)
+        return delta_fail(NULL, f, filename, "truncated or corrupt file");
+
+    struct fib_delta * delta = delta_init();
+
+    delta->num_records = delta->max_records = header.num_records;
+    delta->strings_size = delta->max_strings = header.strings_size;
+    delta->records = (struct delta_record *) malloc(delta->max_records * sizeof(struct delta_record));
+    delta->strings = (char *) malloc(delta->max_strings);
+
+    if (fread(delta->records, sizeof(struct delta_record), delta->num_records, f) != delta->num_records
+        || fread(delta->strings, 1, delta->strings_size, f) != delta->strings_size)
+        return delta_fail(delta, f, filename, "truncated file");
+
+    fclose(f);
+
+    uint64_t checksum = fnv1a(
+        fnv1a(FNV_OFFSET_BASIS, delta->records, delta->num_records * sizeof(struct delta_record)),
+        delta->strings, delta->strings_size);
+
+    if (checksum != header.checksum)
+        return delta_fail(delta, NULL, filename, "checksum mismatch");
+
+    uint32_t i = 0;
+
+    for (i = 0; i < delta->num_records; i++) {
+
+        struct delta_record * r = &(delta->records[i]);
+
+        if (r->op > DELTA_OP_REMOVE
+            || r->prefix_size < 1 || r->prefix_size > MAX_PREFIX_SIZE
+            || r->prefix >= delta->strings_size
+            || memchr(delta->strings + r->prefix, '\0', delta->strings_size - r->prefix) == NULL)
+            return delta_fail(delta, NULL, filename, "corrupt record");
+    }
+
+    return delta;
+}
+
+/*
+ * \brief   applies a delta to a FIB, record by record.
+ *
+ * \param   fib         the FIB
+ * \param   perm        the bit permutation applied to the FIB's RIDs (see
+ *                      bit_order.h), NULL if none. the delta's RIDs are
+ *                      permuted the same way.
+ * \param   skipped     set to the nr. of records which were no-ops (adds of
+ *                      entries already in the FIB, removes of entries not in
+ *                      the FIB)
+ *
+ * \return  nr. of applied records
+ */
+int delta_apply(
+        struct fib_delta * delta,
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        uint32_t * skipped) {
+
+    struct click_xia_xid rid;
+    uint32_t i = 0;
+    int applied = 0;
+
+    *skipped = 0;
+
+    for (i = 0; i < delta->num_records; i++) {
+
+        struct delta_record * r = &(delta->records[i]);
+
+        memcpy(&rid, &(r->rid), sizeof(struct click_xia_xid));
+
+        if (perm != NULL)
+            rid_perm_apply(perm, &rid);
+
+        int ret = 0;
+
+        if (r->op == DELTA_OP_ADD)
+            ret = pt_ht_add(fib, &rid, delta->strings + r->prefix, r->prefix_size, r->port);
+        else
+            ret = pt_ht_remove(*fib, &rid, delta->strings + r->prefix, r->prefix_size);
+
+        if (ret == 0)
+            applied++;
+        else
+            (*skipped)++;
+    }
+
+    return applied;
+}
+
+/*
+ * \brief   merges a delta into a snapshot, offline: the base snapshot is
+ *          loaded, the delta applied to it and the result written to a new
+ *          snapshot (w/ the same bit permutation as the base).
+ *
+ * \return  0 on success, -1 otherwise
+ */
+int delta_merge_snapshot(
+        const char * base_file,
+        struct fib_delta * delta,
+        const char * out_file) {
+
+    struct pt_ht * fib = NULL;
+    struct rid_perm perm;
+    int has_perm = 0;
+    uint32_t skipped = 0;
+
+    struct snapshot * snap = snapshot_load(base_file, &fib, &perm, &has_perm, 1);
+
+    if (!snap)
+        return -1;
+
+    int applied = delta_apply(delta, &fib, (has_perm ? &perm : NULL), &skipped);
+    int ret = snapshot_save(fib, (has_perm ? &perm : NULL), out_file);
+
+    printf("[delta merge]: %s + delta (%d applied, %d skipped) -> %s\n",
+        base_file, applied, skipped, out_file);
+
+    pt_ht_erase(fib);
+    snapshot_unmap(snap);
+
+    return ret;
+}
+
+/*
+ * \brief   next hop of a FIB entry, PT_PORT_NONE if it's not in the FIB.
+ *
+ * \param   rid     the entry's RID (identity bit order)
+ * \param   perm    the bit permutation applied to the FIB's RIDs, NULL if 
+ *                  none
+ */
+static uint16_t delta_entry_port(
+        struct pt_ht * fib,
+        struct click_xia_xid * rid,
+        int prefix_size,
+        struct rid_perm * perm) {
+
+    struct pt_ht * s = pt_ht_search(fib, prefix_size);
+    struct click_xia_xid _rid;
+
+    if (s == NULL || s->trie == NULL)
+        return PT_PORT_NONE;
+
+    memcpy(&_rid, rid, sizeof(struct click_xia_xid));
+
+    if (perm != NULL)
+        rid_perm_apply(perm, &_rid);
+
+    struct pt_fwd * f = pt_fwd_search(&_rid, s->trie);
+
+    return (f != NULL ? f->port : PT_PORT_NONE);
+}
+
+static uint64_t delta_file_size(const char * filename) {
+
+    struct stat st;
+
+    return (stat(filename, &st) < 0 ? 0 : st.st_size);
+}
+
+/*
+ * \brief   measures the cost of applying deltas of 1k, 10k and 100k updates
+ *          (half removes of random FIB entries, half adds of new entries, 1
+ *          element longer than random FIB entries) to a FIB. each delta is
+ *          saved, loaded, applied and then reverted (the FIB is left as it
+ *          was, next hops included). results go to 
+ *          <output_dir>/delta-bench.tsv.
+ */
+void delta_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        std::string output_dir) {
+
+    std::vector<std::string> entries;
+
+    // frozen partitions are thawed upfront (1 time cost, see delta.h), so
+    // that only the cost of the updates themselves is measured
+    double thaw_begin = get_time_now();
+    pt_ht_thaw(*fib);
+    double thaw_time = get_time_now() - thaw_begin;
+
+    pt_ht_get_prefixes(*fib, entries);
+    uint32_t num_entries = entries.size();
+
+    std::string delta_file = output_dir + std::string("/delta-bench.bin");
+    std::string report_file = output_dir + std::string("/") + std::string(DEFAULT_DELTA_BENCH_FILE);
+    FILE * report = fopen(report_file.c_str(), "wb");
+
+    if (!report) {
+
+        fprintf(stderr, "delta_bench() : [ERROR] couldn't open %s\n", report_file.c_str());
+        return;
+    }
+
+    fprintf(report, "DELTA_SIZE\tREMOVES\tADDS\tSKIPPED\tFILE_SIZE\tSAVE_TIME\tLOAD_TIME\tAPPLY_TIME\tUPDATE_TIME\tREVERT_TIME\tFIB_SIZE\n");
+
+    printf("\n[FIB_SIZE]: %d"\
+        "\n[THAW_TIME]: %-.8f"\
+        "\n\n%-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\n",
+        num_entries, thaw_time,
+        "DELTA", "FILE (byte)", "LOAD (s)", "APPLY (s)", "us/UPDATE", "REVERT (s)");
+
+    int sizes[] = DELTA_BENCH_SIZES;
+    int num_sizes = sizeof(sizes) / sizeof(int);
+    struct click_xia_xid * rid = (struct click_xia_xid *) malloc(sizeof(struct click_xia_xid));
+    char * name = (char *) calloc(PREFIX_MAX_LENGTH, sizeof(char));
+    uint32_t skipped = 0, revert_skipped = 0;
+
+    for (int s = 0; s < num_sizes; s++) {
+
+        // half removes, half adds, both out of distinct FIB entries
+        int size = std::min(sizes[s], (int) entries.size());
+
+        if (size < 2)
+            break;
+
+        for (int i = entries.size() - 1; i > 0; i--)
+            std::swap(entries[i], entries[rand() % (i + 1)]);
+
+        struct fib_delta * delta = delta_init();
+        int removes = 0, adds = 0;
+
+        for (int i = 0; i < size / 2; i++) {
+
+            memset(rid, 0, sizeof(struct click_xia_xid));
+            int prefix_size = name_to_rid(&rid, (char *) entries[i].c_str());
+            delta_add(delta, DELTA_OP_REMOVE, rid, (char *) entries[i].c_str(), prefix_size, PT_PORT_NONE);
+            removes++;
+        }
+
+        for (int i = size / 2; i < (int) entries.size() && adds < (size - removes); i++) {
+
+            if (std::count(entries[i].begin(), entries[i].end(), '/') + 1 >= MAX_PREFIX_SIZE
+                || entries[i].length() + 16 > ((size_t) PREFIX_MAX_LENGTH * 0.75))
+                continue;
+
+            snprintf(name, PREFIX_MAX_LENGTH, "%s/d%d", entries[i].c_str(), i);
+
+            memset(rid, 0, sizeof(struct click_xia_xid));
+            int prefix_size = name_to_rid(&rid, name);
+            delta_add(delta, DELTA_OP_ADD, rid, name, prefix_size, (uint16_t) (i % PT_MAX_PORTS));
+            adds++;
+        }
+
+        double save_begin = get_time_now();
+        delta_save(delta, delta_file.c_str());
+        double save_time = get_time_now() - save_begin;
+
+        delta_erase(delta);
+
+        double load_begin = get_time_now();
+        delta = delta_load(delta_file.c_str());
+        double load_time = get_time_now() - load_begin;
+
+        if (!delta)
+            break;
+
+        // revert: same records, opposite ops, in reverse order. removed 
+        // entries are added back w/ their next hops, taken from the FIB 
+        // before the delta is applied.
+        struct fib_delta * inverse = delta_init();
+
+        for (int i = (int) delta->num_records - 1; i >= 0; i--) {
+
+            struct delta_record * r = &(delta->records[i]);
+
+            delta_add(
+                inverse,
+                (r->op == DELTA_OP_ADD ? DELTA_OP_REMOVE : DELTA_OP_ADD),
+                &(r->rid), delta->strings + r->prefix, r->prefix_size,
+                (r->op == DELTA_OP_REMOVE ? delta_entry_port(*fib, &(r->rid), r->prefix_size, perm) : PT_PORT_NONE));
+        }
+
+        double apply_begin = get_time_now();
+        delta_apply(delta, fib, perm, &skipped);
+        double apply_time = get_time_now() - apply_begin;
+
+        uint32_t fib_size = 0;
+        for (struct pt_ht * itr = *fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+            fib_size += itr->num_entries;
+
+        double revert_begin = get_time_now();
+        delta_apply(inverse, fib, perm, &revert_skipped);
+        double revert_time = get_time_now() - revert_begin;
+
+        printf("%-10d\t| %-10ld\t| %-.8f\t| %-.8f\t| %-.8f\t| %-.8f\n",
+            delta->num_records, delta_file_size(delta_file.c_str()),
+            load_time, apply_time, (apply_time * 1000000.0) / (double) delta->num_records, revert_time);
+
+        fprintf(report, "%d\t%d\t%d\t%d\t%ld\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%d\n",
+            delta->num_records, removes, adds, skipped,
+            delta_file_size(delta_file.c_str()),
+            save_time, load_time, apply_time,
+            (apply_time * 1000000.0) / (double) delta->num_records,
+            revert_time, fib_size);
+
+        delta_erase(inverse);
+        delta_erase(delta);
+    }
+
+    remove(delta_file.c_str());
+
+    free(name);
+    free(rid);
+    fclose(report);
+}
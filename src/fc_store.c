@@ -0,0 +1,207 @@
+/*
+ * fc_store.c
+ *
+ * front-coded string store.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "fc_store.h"
+
+static void fc_put_varint(std::vector<uint8_t> & data, uint32_t value) {
+
+    while (value >= 0x80) {
+        data.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+
+    data.push_back((uint8_t) value);
+}
+
+static uint32_t fc_get_varint(const uint8_t ** p) {
+
+    uint32_t value = 0;
+    int shift = 0;
+
+    while (**p & 0x80) {
+        value |= (uint32_t) (*((*p)++) & 0x7F) << shift;
+        shift += 7;
+    }
+
+    value |= (uint32_t) (*((*p)++)) << shift;
+
+    return value;
+}
+
+/*
+ * \brief   builds a store out of a list of strings (duplicates are stored
+ *          once). IDs follow the sorted order of the strings.
+ */
+struct fc_store * fc_store_init(std::vector<std::string> & strings) {
+
+    std::vector<std::string> sorted(strings);
+
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    struct fc_store * store = (struct fc_store *) calloc(1, sizeof(struct fc_store));
+
+    store->num_strings = sorted.size();
+    store->num_blocks = (store->num_strings + FC_BLOCK_SIZE - 1) / FC_BLOCK_SIZE;
+    store->blocks = (uint32_t *) calloc(store->num_blocks + 1, sizeof(uint32_t));
+
+    std::vector<uint8_t> data;
+
+    for (uint32_t i = 0; i < store->num_strings; i++) {
+
+        const std::string & s = sorted[i];
+
+        if (i % FC_BLOCK_SIZE == 0) {
+
+            store->blocks[i / FC_BLOCK_SIZE] = data.size();
+
+            fc_put_varint(data, s.size());
+            data.insert(data.end(), s.begin(), s.end());
+
+            continue;
+        }
+
+        const std::string & prev = sorted[i - 1];
+        uint32_t lcp = 0;
+
+        while (lcp < prev.size() && lcp < s.size() && prev[lcp] == s[lcp])
+            lcp++;
+
+        fc_put_varint(data, lcp);
+        fc_put_varint(data, s.size() - lcp);
+        data.insert(data.end(), s.begin() + lcp, s.end());
+    }
+
+    store->blocks[store->num_blocks] = data.size();
+
+    store->data_size = data.size();
+    store->data = (uint8_t *) malloc(store->data_size + 1);
+    memcpy(store->data, data.data(), store->data_size);
+
+    return store;
+}
+
+void fc_store_erase(struct fc_store * store) {
+
+    if (!store)
+        return;
+
+    free(store->blocks);
+    free(store->data);
+    free(store);
+}
+
+/*
+ * \brief   decodes string id into str ('\0' terminated)
+ *
+ * \return  the string's length, -1 if there's no such string or it doesn't
+ *          fit in max_size byte
+ */
+int fc_store_get(struct fc_store * store, uint32_t id, char * str, size_t max_size) {
+
+    if (id >= store->num_strings)
+        return -1;
+
+    const uint8_t * p = store->data + store->blocks[id / FC_BLOCK_SIZE];
+    uint32_t len = fc_get_varint(&p);
+
+    if (len >= max_size)
+        return -1;
+
+    memcpy(str, p, len);
+    p += len;
+
+    for (uint32_t i = 0; i < id % FC_BLOCK_SIZE; i++) {
+
+        uint32_t lcp = fc_get_varint(&p);
+        uint32_t suffix = fc_get_varint(&p);
+
+        if (lcp + suffix >= max_size)
+            return -1;
+
+        memcpy(str + lcp, p, suffix);
+        p += suffix;
+        len = lcp + suffix;
+    }
+
+    str[len] = '\0';
+
+    return (int) len;
+}
+
+static int fc_block_cmp(struct fc_store * store, uint32_t block, const char * str) {
+
+    const uint8_t * p = store->data + store->blocks[block];
+    uint32_t len = fc_get_varint(&p);
+    size_t str_len = strlen(str);
+
+    int res = memcmp(p, str, std::min((size_t) len, str_len));
+
+    if (res != 0)
+        return res;
+
+    return (len < str_len ? -1 : (len > str_len ? 1 : 0));
+}
+
+/*
+ * \return  the ID of a string, -1 if it's not in the store
+ */
+int64_t fc_store_find(struct fc_store * store, const char * str) {
+
+    if (store->num_blocks == 0)
+        return -1;
+
+    // last block whose 1st string is <= str
+    int64_t lo = 0, hi = store->num_blocks - 1;
+
+    while (lo < hi) {
+
+        int64_t mid = (lo + hi + 1) / 2;
+
+        if (fc_block_cmp(store, mid, str) <= 0)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    char buf[4096];
+    uint32_t first = lo * FC_BLOCK_SIZE;
+
+    for (uint32_t id = first; id < store->num_strings && id < first + FC_BLOCK_SIZE; id++) {
+
+        if (fc_store_get(store, id, buf, sizeof(buf)) >= 0 && strcmp(buf, str) == 0)
+            return id;
+    }
+
+    return -1;
+}
+
+size_t fc_store_memory(struct fc_store * store) {
+
+    if (!store)
+        return 0;
+
+    return sizeof(struct fc_store)
+        + ((store->num_blocks + 1) * sizeof(uint32_t))
+        + store->data_size;
+}
@@ -0,0 +1,345 @@
+/*
+ * fib_compress.c
+ *
+ * FIB compression: removal of entries which are redundant for forwarding
+ * (see fib_compress.h).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <unordered_map>
+#include <vector>
+
+#include "fib_compress.h"
+#include "prefix_dict.h"
+#include "lookup_stats.h"
+
+// next hop of each FIB entry, by prefix string
+typedef std::unordered_map<std::string, uint16_t> FibCompressPorts;
+
+struct fib_compress_entry {
+
+    struct pt_ht * partition;
+    struct click_xia_xid rid;
+    std::string prefix;
+};
+
+static void fib_compress_collect_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct pt_ht * s,
+        FibCompressPorts & ports,
+        std::vector<struct fib_compress_entry> & entries) {
+
+    if (t->key_bit <= key_bit)
+        return;
+
+    // the root (default route) isn't an actual entry
+    if (t != s->trie) {
+
+        char prefix[PREFIX_MAX_LENGTH];
+        prefix_info_str(t->prefix_i, prefix, PREFIX_MAX_LENGTH);
+
+        struct fib_compress_entry e;
+        e.partition = s;
+        memcpy(&(e.rid), t->prefix_rid, sizeof(struct click_xia_xid));
+        e.prefix = std::string(prefix);
+
+        ports[e.prefix] = t->port;
+        entries.push_back(e);
+    }
+
+    fib_compress_collect_rec(t->p_left, t->key_bit, s, ports, entries);
+    fib_compress_collect_rec(t->p_right, t->key_bit, s, ports, entries);
+}
+
+/*
+ * \brief   next hop of the longest entry covering a prefix, i.e. whose
+ *          prefix is made of the 1st k components of prefix, for the
+ *          largest k possible.
+ *
+ * \return  the next hop, PT_PORT_NONE if no entry covers the prefix
+ */
+static uint16_t fib_compress_cover(FibCompressPorts & ports, std::string prefix) {
+
+    size_t pos = prefix.rfind('/');
+
+    while (pos != std::string::npos && pos > 0) {
+
+        prefix.resize(pos);
+
+        FibCompressPorts::iterator itr = ports.find(prefix);
+
+        if (itr != ports.end())
+            return itr->second;
+
+        pos = prefix.rfind('/');
+    }
+
+    return PT_PORT_NONE;
+}
+
+/*
+ * \brief   removes the entries of a FIB which are redundant for forwarding,
+ *          i.e. w/ the same next hop as the longest entry covering them.
+ *          redundancy is decided on the FIB as it is before the pass, so
+ *          chains of redundant entries (e.g. 'a', 'a/b', 'a/b/c', all w/ the
+ *          same next hop) are removed in one go. fills pt_ht.fea (% of the
+ *          partition's entries removed) and pt_ht.fea_n (nr. of entries
+ *          removed) of each partition.
+ *
+ * \return  nr. of removed entries
+ */
+int fib_compress(struct pt_ht * fib) {
+
+    FibCompressPorts ports;
+    std::vector<struct fib_compress_entry> entries;
+    struct pt_ht * itr;
+    int removed = 0;
+
+    // the pass works on the tries
+    pt_ht_thaw(fib);
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        fib_compress_collect_rec(itr->trie, -1, itr, ports, entries);
+
+    std::vector<struct fib_compress_entry> redundant;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+
+        uint16_t port = ports[entries[i].prefix];
+
+        if (port != PT_PORT_NONE && fib_compress_cover(ports, entries[i].prefix) == port)
+            redundant.push_back(entries[i]);
+    }
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+        itr->fea = (double) itr->num_entries;
+        itr->fea_n = 0;
+    }
+
+    for (size_t i = 0; i < redundant.size(); i++) {
+
+        char prefix[PREFIX_MAX_LENGTH];
+        strncpy(prefix, redundant[i].prefix.c_str(), PREFIX_MAX_LENGTH - 1);
+        prefix[PREFIX_MAX_LENGTH - 1] = '\0';
+
+        if (pt_ht_partition_remove(redundant[i].partition, &(redundant[i].rid), prefix) != 0) {
+
+            fprintf(stderr, "fib_compress() : [ERROR] couldn't remove %s\n", prefix);
+            continue;
+        }
+
+        redundant[i].partition->fea_n++;
+        removed++;
+    }
+
+    // fea held the nr. of entries before the pass
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        itr->fea = (itr->fea > 0.0 ? ((double) itr->fea_n / itr->fea) * 100.0 : 0.0);
+
+    return removed;
+}
+
+/*
+ * \brief   avg. lookup time (in us) of a partition's trie, w/o stats (see
+ *          pt_fwd_lookup_fast()).
+ */
+static double fib_compress_time(
+        struct pt_ht * s,
+        struct rid_request * requests,
+        int requests_num) {
+
+    struct pt_match_set matches;
+    double begin = 0.0, time = 0.0;
+    int i = 0, round = 0, lookups = 0;
+
+    // 1st round warms up the caches and isn't counted
+    for (round = 0; round < 2; round++) {
+
+        lookups = 0;
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < s->prefix_size)
+                continue;
+
+            pt_match_set_init(&matches);
+            pt_fwd_lookup_fast(s->trie, requests[i].rid, -1, &matches);
+            lookups++;
+        }
+
+        time = get_time_now() - begin;
+    }
+
+    return (lookups > 0 ? (time / (double) lookups) * 1000000.0 : 0.0);
+}
+
+/*
+ * \brief   forwarding decisions for a set of requests: the next hop of the
+ *          longest confirmed match and the union of the ports of all
+ *          matches.
+ */
+static void fib_compress_decisions(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::vector<uint16_t> & next_hops,
+        std::vector<struct pt_port_set> & port_sets) {
+
+    struct pt_match_set matches;
+    struct pt_ht * itr;
+    int i = 0;
+
+    next_hops.resize(requests_num);
+    port_sets.resize(requests_num);
+
+    for (i = 0; i < requests_num; i++) {
+
+        next_hops[i] = pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE);
+
+        pt_port_set_clear(&(port_sets[i]));
+
+        for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            pt_match_set_init(&matches);
+            pt_fwd_lookup_fast(itr->trie, requests[i].rid, -1, &matches);
+            pt_port_set_union(&(port_sets[i]), &(matches.ports));
+        }
+    }
+}
+
+/*
+ * \brief   compresses a FIB (see fib_compress()) and reports, per prefix
+ *          size |F|, the removed entries, memory saved and lookup time
+ *          before vs. after. the forwarding decisions (LPM next hop and port
+ *          set) of all requests are checked to be the same before and after.
+ *          results go to <output_dir>/fib-compress.tsv.
+ *
+ * XXX: the FIB is left compressed, and the partition stats are reset.
+ */
+void fib_compress_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t num_entries[MAX_PREFIX_SIZE + 1] = {0};
+    size_t memory_before[MAX_PREFIX_SIZE + 1] = {0};
+    double time_before[MAX_PREFIX_SIZE + 1] = {0.0};
+
+    std::vector<uint16_t> next_hops_before, next_hops_after;
+    std::vector<struct pt_port_set> ports_before, ports_after;
+
+    struct pt_ht * itr;
+    int i = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_FIB_COMPRESS_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "fib_compress_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    pt_ht_thaw(fib);
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        num_entries[itr->prefix_size] = itr->num_entries;
+        memory_before[itr->prefix_size] = pt_ht_partition_memory(itr);
+        time_before[itr->prefix_size] = fib_compress_time(itr, requests, requests_num);
+    }
+
+    fib_compress_decisions(fib, requests, requests_num, next_hops_before, ports_before);
+
+    double begin = get_time_now();
+    int removed = fib_compress(fib);
+    double compress_time = get_time_now() - begin;
+
+    fib_compress_decisions(fib, requests, requests_num, next_hops_after, ports_after);
+
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tREMOVED\tFEA\tMEMORY_BEFORE\tMEMORY_AFTER\tAVG_TIME_BEFORE\tAVG_TIME_AFTER\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-4s\t| %-10s\t| %-10s\t| %-8s\t| %-10s\t| %-10s\t| %-10s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "# REMOVED", "FEA (%)", "SAVED (KB)", "BEFORE (us)", "AFTER (us)");
+
+    uint32_t total_entries = 0;
+    size_t total_memory_before = 0, total_memory_after = 0;
+    double total_time_before = 0.0, total_time_after = 0.0;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        int k = itr->prefix_size;
+        size_t memory_after = pt_ht_partition_memory(itr);
+        double time_after = fib_compress_time(itr, requests, requests_num);
+
+        total_entries += num_entries[k];
+        total_memory_before += memory_before[k];
+        total_memory_after += memory_after;
+        total_time_before += time_before[k];
+        total_time_after += time_after;
+
+        printf("%-4d\t| %-10d\t| %-10lu\t| %-8.3f\t| %-10.1f\t| %-10.3f\t| %-10.3f\n",
+            k, num_entries[k], itr->fea_n, itr->fea,
+            (double) (memory_before[k] - memory_after) / 1024.0,
+            time_before[k], time_after);
+
+        fprintf(output_file, "%d\t%d\t%lu\t%-.6f\t%lu\t%lu\t%-.6f\t%-.6f\n",
+            k, num_entries[k], itr->fea_n, itr->fea,
+            (unsigned long) memory_before[k], (unsigned long) memory_after,
+            time_before[k], time_after);
+    }
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        lookup_stats_reset(itr->general_stats);
+
+    // compression must not change any forwarding decision
+    uint32_t next_hop_diffs = 0, port_set_diffs = 0;
+
+    for (i = 0; i < requests_num; i++) {
+
+        next_hop_diffs += (next_hops_before[i] != next_hops_after[i]);
+        port_set_diffs += (memcmp(&(ports_before[i]), &(ports_after[i]), sizeof(struct pt_port_set)) != 0);
+    }
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-10s\t| %-10s\t| %-12s\t| %-12s\t| %-10s\t| %-10s\n"\
+            "-------------------------------------------------------------------------------\n"\
+            "%-10d\t| %-10d\t| %-12lu\t| %-12lu\t| %-10.3f\t| %-10.3f\n",
+            "# ENTRIES", "# REMOVED", "MEM. BEFORE", "MEM. AFTER", "SPEEDUP", "TIME (s)",
+            total_entries, removed,
+            (unsigned long) total_memory_before, (unsigned long) total_memory_after,
+            (total_time_after > 0.0 ? total_time_before / total_time_after : 0.0),
+            compress_time);
+
+    printf("\n");
+
+    if (next_hop_diffs > 0 || port_set_diffs > 0)
+        fprintf(stderr, "fib_compress_bench() : [ERROR] %d next hops and %d port sets changed\n",
+            next_hop_diffs, port_set_diffs);
+
+    fclose(output_file);
+}
@@ -0,0 +1,491 @@
+/*
+ * fib_version.c
+ *
+ * copy-on-write FIB versions.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include <pthread.h>
+
+#include "fib_version.h"
+#include "churn.h"
+#include "rid_cache.h"
+#include "prefix_dict.h"
+
+/*
+ * \brief a version retired by fib_handle_commit()
+ */
+struct fib_version_retired {
+    struct fib_handle * handle;
+    struct fib_version * version;
+};
+
+static void fib_version_release(struct fib_handle * handle, struct fib_version * version) {
+
+    for (int i = 1; i <= MAX_PREFIX_SIZE; i++) {
+
+        struct pt_ht * s = version->parts[i];
+
+        if (s != NULL && --(*(handle->refs))[s] == 0) {
+
+            handle->refs->erase(s);
+            pt_ht_erase_partition(s);
+        }
+    }
+
+    free(version);
+}
+
+static void fib_version_reclaim(void * arg) {
+
+    struct fib_version_retired * r = (struct fib_version_retired *) arg;
+
+    fib_version_release(r->handle, r->version);
+    free(r);
+}
+
+/*
+ * \brief   wraps a FIB in a handle, as its 1st version. the handle takes the
+ *          FIB's partitions over: *fib is left empty.
+ */
+struct fib_handle * fib_handle_init(struct pt_ht ** fib) {
+
+    struct fib_handle * handle = (struct fib_handle *) calloc(1, sizeof(struct fib_handle));
+    struct pt_ht * itr;
+
+    handle->refs = new std::unordered_map<struct pt_ht *, int>();
+    handle->rcu = rcu_init();
+    handle->current = (struct fib_version *) calloc(1, sizeof(struct fib_version));
+
+    for (itr = *fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        handle->current->parts[itr->prefix_size] = itr;
+        (*(handle->refs))[itr] = 1;
+    }
+
+    // the partitions now belong to the versions
+    HASH_CLEAR(hh, *fib);
+
+    return handle;
+}
+
+/*
+ * \brief   frees a handle and all versions but the current one, which is
+ *          turned back into a FIB. there must be no readers left.
+ */
+struct pt_ht * fib_handle_detach(struct fib_handle * handle) {
+
+    struct pt_ht * fib = NULL;
+
+    fib_handle_abort(handle);
+
+    // frees the retired versions
+    rcu_erase(handle->rcu);
+
+    for (int i = 1; i <= MAX_PREFIX_SIZE; i++) {
+
+        struct pt_ht * s = handle->current->parts[i];
+
+        if (s != NULL)
+            HASH_ADD_INT(fib, prefix_size, s);
+    }
+
+    HASH_SORT(fib, pt_ht_sort);
+
+    free(handle->current);
+    delete handle->refs;
+    free(handle);
+
+    return fib;
+}
+
+/*
+ * \brief   starts building the next version, out of the current one (if it
+ *          isn't being built already). writer only.
+ */
+void fib_handle_begin(struct fib_handle * handle) {
+
+    if (handle->next != NULL)
+        return;
+
+    struct fib_version * next = (struct fib_version *) calloc(1, sizeof(struct fib_version));
+
+    memcpy(next->parts, handle->current->parts, sizeof(next->parts));
+    next->id = ++(handle->num_versions);
+
+    for (int i = 1; i <= MAX_PREFIX_SIZE; i++)
+        if (next->parts[i] != NULL)
+            (*(handle->refs))[next->parts[i]]++;
+
+    handle->next = next;
+}
+
+/*
+ * \brief   returns the partition of the next version for a prefix size,
+ *          copying it 1st if it's still shared w/ the current version.
+ */
+static struct pt_ht * fib_handle_partition(struct fib_handle * handle, int prefix_size) {
+
+    struct fib_version * next = handle->next;
+
+    if (next->priv[prefix_size])
+        return next->parts[prefix_size];
+
+    struct pt_ht * s = next->parts[prefix_size];
+    struct pt_ht * c = NULL;
+
+    if (s != NULL) {
+
+        c = pt_ht_clone_partition(s);
+
+        // still referred to by the current version
+        (*(handle->refs))[s]--;
+
+    } else {
+
+        c = pt_ht_partition_init((char *) "", prefix_size);
+    }
+
+    (*(handle->refs))[c] = 1;
+
+    next->parts[prefix_size] = c;
+    next->priv[prefix_size] = 1;
+
+    return c;
+}
+
+/*
+ * \brief   adds an RID to the next version (see pt_ht_add()).
+ */
+int fib_handle_add(
+        struct fib_handle * handle,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size) {
+
+    if (prefix_size < 1 || prefix_size > MAX_PREFIX_SIZE)
+        return -1;
+
+    fib_handle_begin(handle);
+
+    return pt_ht_partition_add(fib_handle_partition(handle, prefix_size), rid, prefix, prefix_size, PT_PORT_NONE);
+}
+
+/*
+ * \brief   removes an RID from the next version (see pt_ht_remove()).
+ */
+int fib_handle_remove(
+        struct fib_handle * handle,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size) {
+
+    if (prefix_size < 1 || prefix_size > MAX_PREFIX_SIZE)
+        return -1;
+
+    fib_handle_begin(handle);
+
+    if (handle->next->parts[prefix_size] == NULL)
+        return 1;
+
+    return pt_ht_partition_remove(fib_handle_partition(handle, prefix_size), rid, prefix);
+}
+
+/*
+ * \brief   publishes the next version, w/ a single atomic pointer exchange.
+ *          the previous version is retired, and freed (along w/ the
+ *          partitions only it referred to) once readers are done w/ it.
+ *
+ * \return  time taken by the exchange itself
+ */
+double fib_handle_commit(struct fib_handle * handle) {
+
+    if (handle->next == NULL)
+        return 0.0;
+
+    struct fib_version * next = handle->next;
+    memset(next->priv, 0, sizeof(next->priv));
+
+    double swap_begin = get_time_now();
+    struct fib_version * prev = __atomic_exchange_n(&(handle->current), next, __ATOMIC_ACQ_REL);
+    double swap_time = get_time_now() - swap_begin;
+
+    handle->next = NULL;
+
+    // results cached from the previous version are outdated
+    if (pt_cache != NULL)
+        rid_cache_invalidate(pt_cache);
+
+    struct fib_version_retired * r = (struct fib_version_retired *) malloc(sizeof(struct fib_version_retired));
+    r->handle = handle;
+    r->version = prev;
+
+    rcu_retire(handle->rcu, r, fib_version_reclaim);
+    rcu_reclaim(handle->rcu);
+
+    return swap_time;
+}
+
+/*
+ * \brief   drops the next version, if any. writer only.
+ */
+void fib_handle_abort(struct fib_handle * handle) {
+
+    if (handle->next == NULL)
+        return;
+
+    fib_version_release(handle, handle->next);
+    handle->next = NULL;
+}
+
+/*
+ * \brief   looks up a request in the current version (see pt_ht_lookup()).
+ *          never blocks, even if a new version is published meanwhile.
+ *
+ * \param   reader  reader id, from rcu_register(handle->rcu)
+ */
+void fib_handle_lookup(
+        struct fib_handle * handle,
+        int reader,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes) {
+
+    // the request is split in components once, for all partitions
+    struct prefix_req req;
+
+    if (prefix_classify != PREFIX_CLASSIFY_NONE)
+        prefix_req_init(&req, request);
+
+    rcu_read_lock(handle->rcu, reader);
+
+    struct fib_version * v = rcu_dereference(handle->current);
+
+    for (int i = std::min(request_size, MAX_PREFIX_SIZE); i > 0; i--)
+        if (v->parts[i] != NULL)
+            pt_ht_lookup_partition(
+                v->parts[i], request, request_size, request_rid, fp_sizes, tp_sizes, NULL,
+                (prefix_classify != PREFIX_CLASSIFY_NONE ? &req : NULL));
+
+    rcu_read_unlock(handle->rcu, reader);
+}
+
+/*
+ * \brief state shared by the reader and the writer of fib_handle_bench()
+ */
+struct fib_version_writer {
+
+    struct fib_handle * handle;
+    struct rid_perm * perm;
+    std::vector<struct churn_update> * updates;
+
+    // set by the reader when the writer can start, by the writer when done
+    int start;
+    int done;
+
+    double build_begin;
+    double build_time;
+    double swap_at;
+    double swap_time;
+    int cloned;
+};
+
+static void * fib_version_writer_run(void * arg) {
+
+    struct fib_version_writer * w = (struct fib_version_writer *) arg;
+    struct timespec nap = {0, 1000000};
+
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+
+    while (!__atomic_load_n(&(w->start), __ATOMIC_ACQUIRE))
+        nanosleep(&nap, NULL);
+
+    w->build_begin = get_time_now();
+
+    fib_handle_begin(w->handle);
+
+    for (size_t i = 0; i < w->updates->size(); i++) {
+
+        struct churn_update * u = &((*(w->updates))[i]);
+        int prefix_size = pt_ht_url_to_rid((char *) u->url.c_str(), prefix, &rid, w->perm);
+
+        if (prefix_size < 0)
+            continue;
+
+        if (u->op == CHURN_OP_ADD)
+            fib_handle_add(w->handle, &rid, prefix, prefix_size);
+        else
+            fib_handle_remove(w->handle, &rid, prefix, prefix_size);
+    }
+
+    for (int i = 1; i <= MAX_PREFIX_SIZE; i++)
+        w->cloned += w->handle->next->priv[i];
+
+    w->build_time = get_time_now() - w->build_begin;
+
+    w->swap_at = get_time_now();
+    w->swap_time = fib_handle_commit(w->handle);
+
+    __atomic_store_n(&(w->done), 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static void fib_version_report(
+        FILE * report,
+        const char * window,
+        std::vector<double> & latencies) {
+
+    if (latencies.empty())
+        return;
+
+    std::sort(latencies.begin(), latencies.end());
+
+    double p50 = latencies[latencies.size() / 2];
+    double p99 = latencies[std::min(latencies.size() - 1, (size_t) (0.99 * latencies.size()))];
+
+    printf("%-10s\t| %-10d\t| %-10.3f\t| %-10.3f\t| %-10.3f\n",
+        window, (int) latencies.size(), p50 * 1000000.0, p99 * 1000000.0, latencies.back() * 1000000.0);
+
+    fprintf(report, "%s\t%d\t%-.8f\t%-.8f\t%-.8f\n",
+        window, (int) latencies.size(), p50, p99, latencies.back());
+}
+
+/*
+ * \brief   builds a new FIB version w/ num_updates updates (see
+ *          churn_generate()) in a writer thread, while a reader keeps
+ *          looking up the requests in the current version, then swaps it
+ *          in. the lookup latency is reported before the new version is
+ *          built, while it's built, right after the swap
+ *          (FIB_VERSION_SWAP_WINDOW lookups) and after that. results go to
+ *          <output_dir>/cow-bench.tsv.
+ */
+void fib_handle_bench(
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        struct rid_request * requests,
+        int requests_num,
+        int num_updates,
+        std::string output_dir) {
+
+    std::vector<std::string> urls;
+    std::vector<struct churn_update> updates;
+
+    pt_ht_get_prefixes(*fib, urls);
+    churn_generate(urls, num_updates, updates);
+
+    std::string report_file = output_dir + std::string("/") + std::string(DEFAULT_COW_BENCH_FILE);
+    FILE * report = fopen(report_file.c_str(), "wb");
+
+    if (!report) {
+
+        fprintf(stderr, "fib_handle_bench() : [ERROR] couldn't open %s\n", report_file.c_str());
+        return;
+    }
+
+    struct fib_handle * handle = fib_handle_init(fib);
+    int reader = rcu_register(handle->rcu);
+
+    struct fib_version_writer w;
+    pthread_t writer;
+
+    memset(&w, 0, sizeof(struct fib_version_writer));
+    w.handle = handle;
+    w.perm = perm;
+    w.updates = &updates;
+
+    pthread_create(&writer, NULL, fib_version_writer_run, &w);
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    std::vector<double> begins, latencies;
+    int after_swap = -1;
+
+    // 1 pass w/o the writer, then keep going until a full pass after the
+    // swap is done
+    for (int r = 0; after_swap < 0 || (int) latencies.size() - after_swap < requests_num; r++) {
+
+        if (r == 1)
+            __atomic_store_n(&(w.start), 1, __ATOMIC_RELEASE);
+
+        for (int i = 0; i < requests_num; i++) {
+
+            double begin = get_time_now();
+            fib_handle_lookup(handle, reader, requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes);
+
+            begins.push_back(begin);
+            latencies.push_back(get_time_now() - begin);
+        }
+
+        if (after_swap < 0 && __atomic_load_n(&(w.done), __ATOMIC_ACQUIRE))
+            after_swap = latencies.size();
+    }
+
+    pthread_join(writer, NULL);
+
+    // the reader is done: the old version can go
+    rcu_reclaim(handle->rcu);
+    rcu_reclaim(handle->rcu);
+
+    std::vector<double> windows[4];
+    int num_swap = 0;
+
+    for (size_t i = 0; i < latencies.size(); i++) {
+
+        if (begins[i] < w.build_begin || w.build_begin == 0.0)
+            windows[0].push_back(latencies[i]);
+        else if (begins[i] + latencies[i] < w.swap_at)
+            windows[1].push_back(latencies[i]);
+        else if (num_swap++ < FIB_VERSION_SWAP_WINDOW)
+            windows[2].push_back(latencies[i]);
+        else
+            windows[3].push_back(latencies[i]);
+    }
+
+    int shared = 0;
+    for (int i = 1; i <= MAX_PREFIX_SIZE; i++)
+        shared += (handle->current->parts[i] != NULL);
+
+    printf("\n[UPDATES]: %d"\
+        "\n[CLONED_PARTITIONS]: %d (of %d)"\
+        "\n[BUILD_TIME]: %-.8f"\
+        "\n[SWAP_TIME]: %-.9f"\
+        "\n[RECLAIMED_VERSIONS]: %ld\n",
+        (int) updates.size(), w.cloned, shared, w.build_time, w.swap_time,
+        handle->rcu->num_reclaimed);
+
+    fprintf(report, "WINDOW\tLOOKUPS\tP50\tP99\tMAX\n");
+
+    printf("\n%-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\n",
+        "WINDOW", "LOOKUPS", "P50 (us)", "P99 (us)", "MAX (us)");
+
+    fib_version_report(report, "BEFORE", windows[0]);
+    fib_version_report(report, "BUILD", windows[1]);
+    fib_version_report(report, "SWAP", windows[2]);
+    fib_version_report(report, "AFTER", windows[3]);
+
+    fclose(report);
+
+    *fib = fib_handle_detach(handle);
+}
@@ -0,0 +1,285 @@
+/*
+ * hp_arena.c
+ *
+ * huge page backed memory arena.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+
+#include "hp_arena.h"
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+
+/*
+ * \brief   parses a huge page mode name ("thp", "explicit" or "none")
+ *
+ * \return  HP_MODE_*, -1 if unknown
+ */
+int hp_mode(const char * mode) {
+
+    if (strcmp(mode, "thp") == 0)
+        return HP_MODE_THP;
+    else if (strcmp(mode, "explicit") == 0)
+        return HP_MODE_EXPLICIT;
+    else if (strcmp(mode, "none") == 0)
+        return HP_MODE_NONE;
+
+    return -1;
+}
+
+const char * hp_mode_name(int mode) {
+
+    switch (mode) {
+
+        case HP_MODE_THP:       return "thp";
+        case HP_MODE_EXPLICIT:  return "explicit";
+        default:                return "none";
+    }
+}
+
+/*
+ * \brief   reads a field (in kB, or pages) from /proc/meminfo
+ */
+static size_t hp_meminfo(const char * field) {
+
+    FILE * f = fopen("/proc/meminfo", "r");
+    char line[256];
+    size_t value = 0, len = strlen(field);
+
+    if (!f)
+        return 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+
+        if (strncmp(line, field, len) == 0 && line[len] == ':') {
+            value = strtoul(line + len + 1, NULL, 10);
+            break;
+        }
+    }
+
+    fclose(f);
+
+    return value;
+}
+
+/*
+ * \brief   maps an arena of (at most) size bytes, backed by huge pages
+ *
+ * \param   size    arena size, rounded up to HP_PAGE_SIZE
+ * \param   mode    HP_MODE_THP or HP_MODE_EXPLICIT. w/ HP_MODE_EXPLICIT,
+ *                  the arena is capped to the free huge pages, and falls
+ *                  back to HP_MODE_THP if there are none.
+ *
+ * \return  the arena, NULL on error
+ */
+struct hp_arena * hp_arena_init(size_t size, int mode) {
+
+    struct hp_arena * arena = (struct hp_arena *) calloc(1, sizeof(struct hp_arena));
+    pthread_mutex_init(&(arena->lock), NULL);
+
+    size = (size + HP_PAGE_SIZE - 1) & ~(HP_PAGE_SIZE - 1);
+
+    if (mode == HP_MODE_EXPLICIT) {
+
+        size_t free_size = hp_meminfo("HugePages_Free") * HP_PAGE_SIZE;
+
+        if (free_size < size)
+            size = free_size;
+
+        if (size > 0) {
+
+            void * addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+            if (addr != MAP_FAILED) {
+
+                arena->mode = HP_MODE_EXPLICIT;
+                arena->base = (char *) addr;
+                arena->size = size;
+
+                return arena;
+            }
+        }
+
+        fprintf(stderr, "hp_arena_init() : [WARNING] no explicit huge pages "\
+            "available (see /proc/sys/vm/nr_hugepages), using THP\n");
+
+        size = HP_DEFAULT_SIZE;
+    }
+
+    // THP: over-map by 1 huge page, so that the arena can start at a huge
+    // page boundary. only the pages which are touched get backed.
+    char * addr = (char *) mmap(NULL, size + HP_PAGE_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (addr == MAP_FAILED) {
+
+        fprintf(stderr, "hp_arena_init() : [ERROR] mmap() of %lu byte failed\n", size);
+        pthread_mutex_destroy(&(arena->lock));
+        free(arena);
+
+        return NULL;
+    }
+
+    char * base = (char *) (((uintptr_t) addr + HP_PAGE_SIZE - 1) & ~(HP_PAGE_SIZE - 1));
+
+    if (base > addr)
+        munmap(addr, base - addr);
+
+    munmap(base + size, (addr + size + HP_PAGE_SIZE) - (base + size));
+
+    if (madvise(base, size, MADV_HUGEPAGE) != 0)
+        fprintf(stderr, "hp_arena_init() : [WARNING] madvise(MADV_HUGEPAGE) failed "\
+            "(see /sys/kernel/mm/transparent_hugepage/enabled)\n");
+
+    arena->mode = HP_MODE_THP;
+    arena->base = base;
+    arena->size = size;
+
+    return arena;
+}
+
+/*
+ * \brief   unmaps an arena. nothing allocated from it may be used afterwards.
+ */
+void hp_arena_erase(struct hp_arena * arena) {
+
+    if (!arena)
+        return;
+
+    if (arena->base != NULL)
+        munmap(arena->base, arena->size);
+
+    pthread_mutex_destroy(&(arena->lock));
+    free(arena);
+}
+
+/*
+ * \return  a block of size byte (HP_ALIGN aligned), NULL if the arena is
+ *          full (callers should fall back to malloc())
+ */
+void * hp_arena_alloc(struct hp_arena * arena, size_t size) {
+
+    size = (size + HP_ALIGN - 1) & ~((size_t) HP_ALIGN - 1);
+
+    size_t c = size / HP_ALIGN;
+    void * b = NULL;
+
+    pthread_mutex_lock(&(arena->lock));
+
+    if (c < HP_SIZE_CLASSES && arena->free_lists[c] != NULL) {
+
+        b = arena->free_lists[c];
+        arena->free_lists[c] = arena->free_lists[c]->next;
+
+        arena->num_allocs++;
+        arena->num_reused++;
+
+    } else if (arena->used + size > arena->size) {
+
+        arena->num_fallbacks++;
+
+    } else {
+
+        b = arena->base + arena->used;
+        arena->used += size;
+        arena->num_allocs++;
+    }
+
+    pthread_mutex_unlock(&(arena->lock));
+
+    return b;
+}
+
+/*
+ * \brief   returns a block to the arena. size must be the one it was
+ *          allocated w/.
+ */
+void hp_arena_free(struct hp_arena * arena, void * ptr, size_t size) {
+
+    size = (size + HP_ALIGN - 1) & ~((size_t) HP_ALIGN - 1);
+
+    size_t c = size / HP_ALIGN;
+
+    // blocks of other sizes are only reclaimed w/ the arena
+    if (c >= HP_SIZE_CLASSES)
+        return;
+
+    struct hp_free * b = (struct hp_free *) ptr;
+
+    pthread_mutex_lock(&(arena->lock));
+
+    b->next = arena->free_lists[c];
+    arena->free_lists[c] = b;
+
+    pthread_mutex_unlock(&(arena->lock));
+}
+
+/*
+ * \return  bytes of the arena actually backed by huge pages (from
+ *          /proc/self/smaps)
+ */
+size_t hp_arena_huge_bytes(struct hp_arena * arena) {
+
+    if (arena->mode == HP_MODE_EXPLICIT)
+        return (arena->used + HP_PAGE_SIZE - 1) & ~(HP_PAGE_SIZE - 1);
+
+    FILE * f = fopen("/proc/self/smaps", "r");
+    char line[256];
+    size_t huge = 0;
+    int in_arena = 0;
+
+    if (!f)
+        return 0;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+
+        unsigned long begin, end;
+
+        // mapping headers look like "<begin>-<end> <perms> ..."
+        if (sscanf(line, "%lx-%lx ", &begin, &end) == 2 && strchr(line, '-') < strchr(line, ' ')) {
+
+            in_arena = (begin < (uintptr_t) (arena->base + arena->size) && end > (uintptr_t) arena->base);
+
+        } else if (in_arena && strncmp(line, "AnonHugePages:", 14) == 0) {
+
+            huge += strtoul(line + 14, NULL, 10) * 1024;
+        }
+    }
+
+    fclose(f);
+
+    return huge;
+}
+
+void hp_arena_print(struct hp_arena * arena) {
+
+    printf("\n[HUGE_PAGES]: %s"\
+        "\n[ARENA_USED]: %lu byte"\
+        "\n[ARENA_HUGE]: %lu byte"\
+        "\n[ARENA_ALLOCS]: %lu (%lu re-used, %lu fallbacks to malloc())\n",
+        hp_mode_name(arena->mode),
+        arena->used, hp_arena_huge_bytes(arena),
+        arena->num_allocs, arena->num_reused, arena->num_fallbacks);
+}
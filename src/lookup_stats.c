@@ -23,6 +23,7 @@
  */
 
 #include "lookup_stats.h"
+#include "prefix_dict.h"
 
 void lookup_stats_print(struct lookup_stats * stats) {
 
@@ -41,19 +42,49 @@ void lookup_stats_print(struct lookup_stats * stats) {
     printf("\n");
 }
 
+/*
+ * \brief   allocates a prefix_info for a prefix string, w/ its components
+ *          added to the default prefix dictionary.
+ */
 void prefix_info_init(
         struct prefix_info ** prefix_info,
         char * prefix,
         uint8_t prefix_size) {
 
-    (*prefix_info)->prefix = (char *) calloc(strlen(prefix) + 1, sizeof(char));
-    strncpy((*prefix_info)->prefix, prefix, strlen(prefix) + 1);
+    struct prefix_dict * dict = prefix_dict_default();
+    uint16_t num_comps = 1;
+    char * c = prefix;
+
+    for (c = strchr(prefix, PREFIX_DELIM_CHAR); c != NULL; c = strchr(c + 1, PREFIX_DELIM_CHAR))
+        num_comps++;
+
+    // the empty string has no components at all
+    if (prefix[0] == '\0')
+        num_comps = 0;
+
+    (*prefix_info) = (struct prefix_info *) malloc(sizeof(struct prefix_info) + (num_comps * sizeof(uint32_t)));
     (*prefix_info)->prefix_size = prefix_size;
+    (*prefix_info)->num_comps = num_comps;
+
+    char * start = prefix;
+    uint16_t i = 0;
+
+    for (i = 0; i < num_comps; i++) {
+
+        char * end = strchr(start, PREFIX_DELIM_CHAR);
+        size_t len = (end != NULL ? (size_t) (end - start) : strlen(start));
+
+        (*prefix_info)->comps[i] = prefix_dict_insert(dict, start, len);
+
+        if (end != NULL)
+            start = end + 1;
+    }
 }
 
 void prefix_info_erase(struct prefix_info ** prefix_info) {
 
-    free((*prefix_info)->prefix);
+    free(*prefix_info);
+    (*prefix_info) = NULL;
 }
 
 void lookup_stats_init(
@@ -63,7 +94,6 @@ void lookup_stats_init(
 
     // the prefix info will allow to distinguish true positives from false 
     // positives. this is good for stats gathering...
-    (*stats)->prefix_info = (struct prefix_info *) malloc(sizeof(struct prefix_info));
     prefix_info_init(&(*stats)->prefix_info, prefix, prefix_size);
 
     (*stats)->req_entry_diffs_fps = (uint32_t *) calloc(prefix_size + 1, sizeof(uint32_t));
@@ -80,7 +110,6 @@ void lookup_stats_erase(struct lookup_stats ** stats) {
 
     // erase the prefix string and |F\R| array
     prefix_info_erase(&(*stats)->prefix_info);
-    free((*stats)->prefix_info);
     free((*stats)->req_entry_diffs_fps);
     free((*stats)->req_entry_diffs);
 
@@ -96,6 +125,11 @@ void lookup_stats_erase(struct lookup_stats ** stats) {
     // printf("\n");   
 }
 
+/*
+ * \brief   updates the stats of a prefix (or FIB partition) w/ a lookup
+ *          result. counters are updated atomically, so that concurrent
+ *          lookups (e.g. several EBR readers, see rcu.h) can share them.
+ */
 void lookup_stats_update(
         struct lookup_stats ** stats,
         uint8_t req_entry_diff,
@@ -107,7 +141,7 @@ void lookup_stats_update(
     // only update when a false positive triggers lookup_stats_update()
     if (fps > 0) {
 
-        (*stats)->req_entry_diffs_fps[req_entry_diff] += fps; 
+        __atomic_fetch_add(&((*stats)->req_entry_diffs_fps[req_entry_diff]), fps, __ATOMIC_RELAXED);
 
         // if (req_entry_diff == 0) {
         //     printf("lookup_stats_update():"\ 
@@ -119,12 +153,47 @@ void lookup_stats_update(
     }
 
     if ((*stats)->req_entry_diffs != NULL)
-        (*stats)->req_entry_diffs[req_entry_diff] += 1;
+        __atomic_fetch_add(&((*stats)->req_entry_diffs[req_entry_diff]), 1, __ATOMIC_RELAXED);
+
+    // a lookup result is either a TP, a FP or a TN
+    if (tps)
+        __atomic_fetch_add(&((*stats)->tps), tps, __ATOMIC_RELAXED);
+
+    if (fps)
+        __atomic_fetch_add(&((*stats)->fps), fps, __ATOMIC_RELAXED);
 
-    (*stats)->tps += tps;
-    (*stats)->fps += fps;
-    (*stats)->tns += tns;
-    (*stats)->total_matches += total_matches;
+    if (tns)
+        __atomic_fetch_add(&((*stats)->tns), tns, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&((*stats)->total_matches), total_matches, __ATOMIC_RELAXED);
+}
+
+/*
+ * \brief   counts TNs w/o a |F\R| value, e.g. entries which a scan rejects 
+ *          w/o looking at their prefixes (atomically, as
+ *          lookup_stats_update()).
+ */
+void lookup_stats_add_tns(struct lookup_stats * stats, uint32_t tns) {
+
+    __atomic_fetch_add(&(stats->tns), tns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&(stats->total_matches), tns, __ATOMIC_RELAXED);
+}
+
+/*
+ * \brief   zeroes all counters in a lookup_stats struct, e.g. after lookups 
+ *          which shouldn't count towards the simulation results.
+ */
+void lookup_stats_reset(struct lookup_stats * stats) {
+
+    uint8_t prefix_size = stats->prefix_info->prefix_size;
+
+    memset(stats->req_entry_diffs_fps, 0, (prefix_size + 1) * sizeof(uint32_t));
+    memset(stats->req_entry_diffs, 0, (prefix_size + 1) * sizeof(uint32_t));
+
+    stats->tps = 0;
+    stats->fps = 0;
+    stats->tns = 0;
+    stats->total_matches = 0;
 }
 
 struct lookup_stats * lookup_stats_add(
@@ -133,10 +202,13 @@ struct lookup_stats * lookup_stats_add(
 
     struct lookup_stats * s;
 
-    HASH_FIND_STR(*ht, node->prefix_info->prefix, s);
+    // equal prefixes have equal component IDs
+    size_t key_size = node->prefix_info->num_comps * sizeof(uint32_t);
+
+    HASH_FIND(hh, *ht, node->prefix_info->comps, key_size, s);
 
     if (s == NULL) {
-        HASH_ADD_KEYPTR(hh, *ht, node->prefix_info->prefix, strlen(node->prefix_info->prefix), node);
+        HASH_ADD_KEYPTR(hh, *ht, node->prefix_info->comps, key_size, node);
     }
 
     return (*ht);
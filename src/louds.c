@@ -0,0 +1,415 @@
+/*
+ * louds.c
+ *
+ * succinct (LOUDS) RID FIB engine.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include "louds.h"
+#include "prefix_dict.h"
+
+static inline uint32_t louds_rank1(struct louds_fwd * louds, uint32_t pos) {
+
+    uint32_t word = pos / 64;
+    uint32_t rank = louds->ranks[word / LOUDS_RANK_WORDS];
+
+    for (uint32_t w = (word / LOUDS_RANK_WORDS) * LOUDS_RANK_WORDS; w < word; w++)
+        rank += __builtin_popcountll(louds->bits[w]);
+
+    if (pos % 64)
+        rank += __builtin_popcountll(louds->bits[word] & ((1ULL << (pos % 64)) - 1));
+
+    return rank;
+}
+
+static inline int louds_bit(struct louds_fwd * louds, uint32_t pos) {
+
+    return (louds->bits[pos / 64] >> (pos % 64)) & 1;
+}
+
+static inline uint32_t louds_prefix_id(struct louds_fwd * louds, uint32_t node) {
+
+    if (louds->id_width == 0)
+        return 0;
+
+    uint64_t pos = (uint64_t) node * louds->id_width;
+    uint64_t value = louds->prefix_ids[pos / 64] >> (pos % 64);
+
+    if ((pos % 64) + louds->id_width > 64)
+        value |= louds->prefix_ids[(pos / 64) + 1] << (64 - (pos % 64));
+
+    return (uint32_t) (value & ((1ULL << louds->id_width) - 1));
+}
+
+/*
+ * \brief   encodes the trie of a FIB partition
+ *
+ * \return  the succinct trie
+ */
+struct louds_fwd * louds_fwd_init(struct pt_ht * partition) {
+
+    struct louds_fwd * louds = (struct louds_fwd *) calloc(1, sizeof(struct louds_fwd));
+
+    louds->fib_root = partition;
+    louds->prefix_size = partition->prefix_size;
+
+    // level order: children of node i are appended left, then right
+    std::vector<struct pt_fwd *> order(1, partition->trie);
+
+    for (size_t i = 0; i < order.size(); i++) {
+
+        struct pt_fwd * t = order[i];
+
+        if (t->p_left->key_bit > t->key_bit)
+            order.push_back(t->p_left);
+
+        if (t->p_right->key_bit > t->key_bit)
+            order.push_back(t->p_right);
+    }
+
+    louds->num_nodes = order.size();
+    louds->num_words = ((2 * louds->num_nodes) + 63) / 64;
+
+    louds->bits = (uint64_t *) calloc(louds->num_words + 1, sizeof(uint64_t));
+    louds->ranks = (uint32_t *) calloc((louds->num_words / LOUDS_RANK_WORDS) + 1, sizeof(uint32_t));
+    louds->key_bits = (uint8_t *) malloc(louds->num_nodes);
+    louds->rids = (uint8_t *) malloc((size_t) louds->num_nodes * CLICK_XIA_XID_ID_LEN);
+    louds->ports = (uint16_t *) malloc((size_t) louds->num_nodes * sizeof(uint16_t));
+
+    std::vector<std::string> strings;
+    strings.reserve(louds->num_nodes);
+
+    char prefix[PREFIX_MAX_LENGTH];
+
+    for (uint32_t i = 0; i < louds->num_nodes; i++) {
+
+        struct pt_fwd * t = order[i];
+
+        if (t->p_left->key_bit > t->key_bit)
+            louds->bits[(2 * i) / 64] |= (1ULL << ((2 * i) % 64));
+
+        if (t->p_right->key_bit > t->key_bit)
+            louds->bits[(2 * i + 1) / 64] |= (1ULL << ((2 * i + 1) % 64));
+
+        louds->key_bits[i] = (uint8_t) t->key_bit;
+        memcpy(louds->rids + ((size_t) i * CLICK_XIA_XID_ID_LEN), t->prefix_rid->id, CLICK_XIA_XID_ID_LEN);
+        louds->ports[i] = t->port;
+
+        prefix_info_str(t->prefix_i, prefix, PREFIX_MAX_LENGTH);
+        strings.push_back(std::string(prefix));
+    }
+
+    uint32_t rank = 0;
+
+    for (uint32_t w = 0; w < louds->num_words; w++) {
+
+        if (w % LOUDS_RANK_WORDS == 0)
+            louds->ranks[w / LOUDS_RANK_WORDS] = rank;
+
+        rank += __builtin_popcountll(louds->bits[w]);
+    }
+
+    louds->prefixes = fc_store_init(strings);
+
+    while ((1ULL << louds->id_width) < louds->prefixes->num_strings)
+        louds->id_width++;
+
+    louds->prefix_ids = (uint64_t *) calloc((((uint64_t) louds->num_nodes * louds->id_width) / 64) + 2, sizeof(uint64_t));
+
+    for (uint32_t i = 0; i < louds->num_nodes && louds->id_width > 0; i++) {
+
+        uint64_t id = (uint64_t) fc_store_find(louds->prefixes, strings[i].c_str());
+        uint64_t pos = (uint64_t) i * louds->id_width;
+
+        louds->prefix_ids[pos / 64] |= (id << (pos % 64));
+
+        if ((pos % 64) + louds->id_width > 64)
+            louds->prefix_ids[(pos / 64) + 1] |= (id >> (64 - (pos % 64)));
+    }
+
+    return louds;
+}
+
+void louds_fwd_erase(struct louds_fwd * louds) {
+
+    if (!louds)
+        return;
+
+    free(louds->bits);
+    free(louds->ranks);
+    free(louds->key_bits);
+    free(louds->rids);
+    free(louds->ports);
+    free(louds->prefix_ids);
+    fc_store_erase(louds->prefixes);
+    free(louds);
+}
+
+/*
+ * \brief   memory held by a succinct trie, in byte
+ */
+size_t louds_fwd_memory(struct louds_fwd * louds) {
+
+    if (!louds)
+        return 0;
+
+    return sizeof(struct louds_fwd)
+        + ((louds->num_words + 1) * sizeof(uint64_t))
+        + (((louds->num_words / LOUDS_RANK_WORDS) + 1) * sizeof(uint32_t))
+        + louds->num_nodes
+        + ((size_t) louds->num_nodes * CLICK_XIA_XID_ID_LEN)
+        + ((size_t) louds->num_nodes * sizeof(uint16_t))
+        + (((((uint64_t) louds->num_nodes * louds->id_width) / 64) + 2) * sizeof(uint64_t))
+        + fc_store_memory(louds->prefixes);
+}
+
+static int louds_fwd_lookup_rec(
+        struct louds_fwd * louds,
+        uint32_t node,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports) {
+
+    struct click_xia_xid rid;
+    char prefix[PREFIX_MAX_LENGTH];
+
+    int key_bit = louds->key_bits[node];
+
+    // the root (default route) has prefix size 0
+    int prefix_size = (node > 0 ? louds->prefix_size : 0);
+
+    memcpy(rid.id, louds->rids + ((size_t) node * CLICK_XIA_XID_ID_LEN), CLICK_XIA_XID_ID_LEN);
+
+    if (fc_store_get(louds->prefixes, louds_prefix_id(louds, node), prefix, PREFIX_MAX_LENGTH) < 0)
+        prefix[0] = '\0';
+
+    uint32_t _req_entry_diff = req_entry_diff(request, prefix, prefix_size);
+
+    int tps = 0, fps = 0, tns = 0;
+    int matches = 0;
+
+    // same as pt_fwd_lookup(): always follow the left branch, follow the
+    // right branch only if the request matches the node up to the key bit
+    if (rid_match_mask(request_rid, &rid, key_bit)) {
+
+        if (rid_match(request_rid, &rid) && (prefix_size > 0)) {
+
+            if (strstr(request, prefix) != NULL)
+                tps = 1;
+            else
+                fps = 1;
+
+        } else {
+
+            tns = 1;
+        }
+
+        matches += (tps + fps + tns);
+
+        lookup_stats_update(
+            &(louds->fib_root->general_stats),
+            _req_entry_diff,
+            tps, fps, tns, 1);
+
+        if (prefix_size > 0) {
+            fp_sizes[prefix_size - 1] += fps;
+            tp_sizes[prefix_size - 1] += tps;
+        }
+
+        if ((tps + fps) > 0 && ports != NULL)
+            pt_port_set_add(ports, louds->ports[node]);
+
+        // upward links aren't in the topology: a 0 bit ends the walk
+        if (louds_bit(louds, 2 * node + 1))
+            matches += louds_fwd_lookup_rec(louds, louds_rank1(louds, 2 * node + 1) + 1,
+                request, request_size, request_rid, fp_sizes, tp_sizes, ports);
+
+    } else {
+
+        tns = 1;
+        matches += tns;
+
+        lookup_stats_update(
+            &(louds->fib_root->general_stats),
+            _req_entry_diff,
+            tps, fps, tns, 1);
+    }
+
+    if (louds_bit(louds, 2 * node))
+        matches += louds_fwd_lookup_rec(louds, louds_rank1(louds, 2 * node) + 1,
+            request, request_size, request_rid, fp_sizes, tp_sizes, ports);
+
+    return matches;
+}
+
+/*
+ * \brief   looks up a request RID in a succinct trie, w/ the same behavior
+ *          and stats as pt_fwd_lookup_ports() on the trie it was encoded
+ *          from.
+ *
+ * \param   ports   port set for the next hops of the matches, NULL if not
+ *                  needed
+ *
+ * \return  nr. of visited nodes
+ */
+int louds_fwd_lookup(
+        struct louds_fwd * louds,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports) {
+
+    return louds_fwd_lookup_rec(louds, 0, request, request_size, request_rid, fp_sizes, tp_sizes, ports);
+}
+
+/*
+ * \brief   memory vs. lookup time, pointer trie vs. succinct trie, per
+ *          prefix size. the pointer trie's memory is what its nodes, RIDs
+ *          and prefix info actually take on the heap (see
+ *          pt_ht_partition_memory()). results go to
+ *          <output_dir>/louds-bench.tsv.
+ *
+ * XXX: the PT partition stats are updated by this function, so call it
+ * AFTER pt_ht_print_stats().
+ */
+void louds_ht_print_stats(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    uint32_t pt_matches = 0, louds_matches = 0;
+    size_t pt_total = 0, louds_total = 0;
+    uint64_t total_entries = 0;
+    double begin = 0.0, pt_time = 0.0, louds_time = 0.0;
+    int i = 0, k = 0, lookups = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_LOUDS_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "louds_ht_print_stats() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tPT_MEMORY\tLOUDS_MEMORY\tPT_AVG_TIME\tLOUDS_AVG_TIME\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-4s\t| %-10s\t| %-12s\t| %-12s\t| %-10s\t| %-10s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "PT (B/ENTRY)", "LOUDS (B/E)", "PT (us)", "LOUDS (us)");
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        struct louds_fwd * louds = louds_fwd_init(itr);
+
+        pt_time = 0.0; louds_time = 0.0; lookups = 0;
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            pt_fwd_lookup(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+            lookups++;
+        }
+
+        pt_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            pt_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            louds_fwd_lookup(louds, requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes, NULL);
+        }
+
+        louds_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            louds_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        if (lookups > 0) {
+            pt_time = (pt_time / (double) lookups) * 1000000.0;
+            louds_time = (louds_time / (double) lookups) * 1000000.0;
+        }
+
+        size_t pt_memory = pt_ht_partition_memory(itr);
+        size_t louds_memory = louds_fwd_memory(louds);
+        uint32_t entries = (itr->num_entries ? itr->num_entries : 1);
+
+        pt_total += pt_memory;
+        louds_total += louds_memory;
+        total_entries += itr->num_entries;
+
+        printf("%-4d\t| %-10d\t| %-12.1f\t| %-12.1f\t| %-10.3f\t| %-10.3f\n",
+            itr->prefix_size, itr->num_entries,
+            (double) pt_memory / entries, (double) louds_memory / entries,
+            pt_time, louds_time);
+
+        fprintf(output_file, "%d\t%d\t%lu\t%lu\t%-.6f\t%-.6f\n",
+            itr->prefix_size, itr->num_entries,
+            (unsigned long) pt_memory, (unsigned long) louds_memory,
+            pt_time, louds_time);
+
+        louds_fwd_erase(louds);
+    }
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n"\
+            "%-12.1f\t| %-12.1f\t| %-12d\t| %-12d\n",
+            "PT (B/ENTRY)", "LOUDS (B/E)", "# PT MATCHES", "# LOUDS MATCHES",
+            (double) pt_total / (total_entries ? total_entries : 1),
+            (double) louds_total / (total_entries ? total_entries : 1),
+            pt_matches, louds_matches);
+
+    printf("\n");
+
+    // both engines must agree on the match set
+    if (pt_matches != louds_matches)
+        fprintf(stderr, "louds_ht_print_stats() : [ERROR] %d PT vs. %d LOUDS matches\n",
+            pt_matches, louds_matches);
+
+    fclose(output_file);
+}
@@ -0,0 +1,518 @@
+/*
+ * mbt.c
+ *
+ * multi-bit stride trie RID FIB engine (Tree Bitmap style).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "mbt.h"
+#include "prefix_dict.h"
+
+// MBT_SUBMASKS[r] has bit c set iff c is a submask of r
+static uint16_t MBT_SUBMASKS[MBT_FANOUT];
+static int mbt_submasks_ready = 0;
+
+static void mbt_submasks_init() {
+
+    int r = 0, c = 0;
+
+    for (r = 0; r < MBT_FANOUT; r++) {
+
+        MBT_SUBMASKS[r] = 0;
+
+        for (c = 0; c < MBT_FANOUT; c++) {
+
+            if ((c & ~r) == 0)
+                MBT_SUBMASKS[r] |= (uint16_t) (1 << c);
+        }
+    }
+
+    mbt_submasks_ready = 1;
+}
+
+/*
+ * \brief   returns the MBT_STRIDE bits of an RID consumed at a given depth,
+ *          in the same bit order as bit() in pt.c (bit 0 is the msb of the
+ *          last byte).
+ */
+static __inline uint32_t mbt_chunk(struct click_xia_xid * rid, int depth) {
+
+    uint8_t byte = rid->id[CLICK_XIA_XID_ID_LEN - (depth / 2) - 1];
+
+    return ((depth % 2) == 0 ? (byte >> 4) : byte) & (MBT_FANOUT - 1);
+}
+
+static __inline int mbt_rid_match(struct click_xia_xid * req, struct click_xia_xid * fwd) {
+
+    uint64_t r[3] = {0, 0, 0}, f[3] = {0, 0, 0};
+
+    memcpy(r, req->id, CLICK_XIA_XID_ID_LEN);
+    memcpy(f, fwd->id, CLICK_XIA_XID_ID_LEN);
+
+    return (((f[0] & ~r[0]) | (f[1] & ~r[1]) | (f[2] & ~r[2])) == 0);
+}
+
+static uint32_t mbt_node_alloc(struct mbt_fwd * mbt, uint32_t n) {
+
+    if (mbt->num_nodes + n > mbt->max_nodes) {
+
+        mbt->max_nodes = std::max(mbt->max_nodes * 2, mbt->num_nodes + n);
+        mbt->nodes = (struct mbt_node *) realloc(mbt->nodes, mbt->max_nodes * sizeof(struct mbt_node));
+    }
+
+    uint32_t base = mbt->num_nodes;
+
+    memset(&(mbt->nodes[base]), 0, n * sizeof(struct mbt_node));
+    mbt->num_nodes += n;
+
+    return base;
+}
+
+static int mbt_fwd_collect_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct mbt_fwd * mbt) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    // the root node (default route) isn't an actual entry
+    if (t->prefix_size > 0) {
+
+        memcpy(&(mbt->rids[mbt->num_entries]), t->prefix_rid, sizeof(struct click_xia_xid));
+        mbt->prefix_i[mbt->num_entries] = t->prefix_i;
+        mbt->ports[mbt->num_entries] = t->port;
+        mbt->num_entries++;
+    }
+
+    mbt_fwd_collect_rec(t->p_left, t->key_bit, mbt);
+    mbt_fwd_collect_rec(t->p_right, t->key_bit, mbt);
+
+    return mbt->num_entries;
+}
+
+/*
+ * \brief   builds the subtree rooted at node, out of entries [lo, hi).
+ *          entries are re-arranged in place, so that each leaf bucket ends
+ *          up w/ a contiguous range of entries.
+ */
+static void mbt_fwd_build_rec(
+        struct mbt_fwd * mbt,
+        uint32_t node,
+        uint32_t lo,
+        uint32_t hi,
+        int depth,
+        struct click_xia_xid * tmp_rids,
+        struct prefix_info ** tmp_prefix_i,
+        uint16_t * tmp_ports) {
+
+    uint32_t n = hi - lo, i = 0;
+
+    if (depth > mbt->depth)
+        mbt->depth = depth;
+
+    if (n <= MBT_LEAF_SIZE || depth == MBT_MAX_DEPTH) {
+
+        mbt->nodes[node].child_bitmap = 0;
+        mbt->nodes[node].entries_num = (uint16_t) n;
+        mbt->nodes[node].base = lo;
+
+        return;
+    }
+
+    // counting sort of the entries by their chunk at this depth
+    uint32_t counts[MBT_FANOUT] = {0};
+    uint32_t starts[MBT_FANOUT + 1] = {0};
+    uint16_t bitmap = 0;
+    int c = 0;
+
+    for (i = lo; i < hi; i++)
+        counts[mbt_chunk(&(mbt->rids[i]), depth)]++;
+
+    for (c = 0; c < MBT_FANOUT; c++) {
+
+        starts[c + 1] = starts[c] + counts[c];
+
+        if (counts[c] > 0)
+            bitmap |= (uint16_t) (1 << c);
+    }
+
+    uint32_t pos[MBT_FANOUT];
+    memcpy(pos, starts, sizeof(pos));
+
+    for (i = lo; i < hi; i++) {
+
+        c = mbt_chunk(&(mbt->rids[i]), depth);
+
+        tmp_rids[pos[c]] = mbt->rids[i];
+        tmp_prefix_i[pos[c]] = mbt->prefix_i[i];
+        tmp_ports[pos[c]] = mbt->ports[i];
+        pos[c]++;
+    }
+
+    memcpy(&(mbt->rids[lo]), tmp_rids, n * sizeof(struct click_xia_xid));
+    memcpy(&(mbt->prefix_i[lo]), tmp_prefix_i, n * sizeof(struct prefix_info *));
+    memcpy(&(mbt->ports[lo]), tmp_ports, n * sizeof(uint16_t));
+
+    // children are allocated contiguously, in chunk order. note that
+    // mbt->nodes may be moved around by realloc(), so we stick to indexes.
+    uint32_t base = mbt_node_alloc(mbt, __builtin_popcount(bitmap));
+
+    mbt->nodes[node].child_bitmap = bitmap;
+    mbt->nodes[node].entries_num = 0;
+    mbt->nodes[node].base = base;
+
+    uint32_t child = base;
+
+    for (c = 0; c < MBT_FANOUT; c++) {
+
+        if (counts[c] == 0)
+            continue;
+
+        mbt_fwd_build_rec(mbt, child++, lo + starts[c], lo + starts[c + 1], depth + 1, tmp_rids, tmp_prefix_i, tmp_ports);
+    }
+}
+
+/*
+ * \brief   builds a multi-bit trie out of the entries of a FIB partition
+ *          (i.e. a PT subtree for some prefix size)
+ *
+ * \param   partition   the FIB partition to collect the entries from
+ *
+ * \return  the multi-bit trie
+ */
+struct mbt_fwd * mbt_fwd_init(struct pt_ht * partition) {
+
+    if (!mbt_submasks_ready)
+        mbt_submasks_init();
+
+    struct mbt_fwd * mbt = (struct mbt_fwd *) calloc(1, sizeof(struct mbt_fwd));
+
+    mbt->fib_root = partition;
+    mbt->prefix_size = partition->prefix_size;
+
+    // FIXME: the + 1 avoids 0 size allocations for empty partitions
+    size_t capacity = partition->num_entries + 1;
+
+    mbt->rids = (struct click_xia_xid *) calloc(capacity, sizeof(struct click_xia_xid));
+    mbt->prefix_i = (struct prefix_info **) calloc(capacity, sizeof(struct prefix_info *));
+    mbt->ports = (uint16_t *) calloc(capacity, sizeof(uint16_t));
+
+    mbt->num_entries = 0;
+    mbt_fwd_collect_rec(partition->trie, -1, mbt);
+
+    // roughly 1 node per MBT_LEAF_SIZE / 2 entries
+    mbt->max_nodes = std::max((uint32_t) 16, (2 * mbt->num_entries) / MBT_LEAF_SIZE);
+    mbt->nodes = (struct mbt_node *) malloc(mbt->max_nodes * sizeof(struct mbt_node));
+    mbt->num_nodes = 0;
+
+    struct click_xia_xid * tmp_rids = (struct click_xia_xid *) calloc(capacity, sizeof(struct click_xia_xid));
+    struct prefix_info ** tmp_prefix_i = (struct prefix_info **) calloc(capacity, sizeof(struct prefix_info *));
+    uint16_t * tmp_ports = (uint16_t *) calloc(capacity, sizeof(uint16_t));
+
+    mbt_fwd_build_rec(mbt, mbt_node_alloc(mbt, 1), 0, mbt->num_entries, 0, tmp_rids, tmp_prefix_i, tmp_ports);
+
+    free(tmp_rids);
+    free(tmp_prefix_i);
+    free(tmp_ports);
+
+    return mbt;
+}
+
+void mbt_fwd_erase(struct mbt_fwd * mbt) {
+
+    if (!mbt)
+        return;
+
+    free(mbt->nodes);
+    free(mbt->rids);
+    free(mbt->prefix_i);
+    free(mbt->ports);
+    free(mbt);
+}
+
+/*
+ * \brief   memory held by a multi-bit trie, in byte. the prefix info shared
+ *          w/ the partition trie isn't accounted for.
+ */
+size_t mbt_fwd_memory(struct mbt_fwd * mbt) {
+
+    if (!mbt)
+        return 0;
+
+    return (sizeof(struct mbt_fwd)
+        + (mbt->num_nodes * sizeof(struct mbt_node))
+        + (mbt->num_entries * (sizeof(struct click_xia_xid) + sizeof(struct prefix_info *) + sizeof(uint16_t))));
+}
+
+static int mbt_fwd_lookup_rec(
+        struct mbt_fwd * mbt,
+        uint32_t node,
+        int depth,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats,
+        int * matches) {
+
+    struct mbt_node * n = &(mbt->nodes[node]);
+    int visited = 1;
+
+    if (n->child_bitmap == 0) {
+
+        // leaf bucket: test all entries
+        uint32_t e = n->base, end = n->base + n->entries_num;
+        int tps = 0, fps = 0, leaf_matches = 0;
+        char prefix[PREFIX_MAX_LENGTH];
+
+        for ( ; e < end; e++) {
+
+            if (!mbt_rid_match(request_rid, &(mbt->rids[e])))
+                continue;
+
+            // TP or FP check
+            tps = 0; fps = 0;
+            prefix_info_str(mbt->prefix_i[e], prefix, PREFIX_MAX_LENGTH);
+
+            if (strstr(request, prefix) != NULL)
+                tps = 1;
+            else
+                fps = 1;
+
+            tp_sizes[mbt->prefix_size - 1] += tps;
+            fp_sizes[mbt->prefix_size - 1] += fps;
+
+            if (ports != NULL)
+                pt_port_set_add(ports, mbt->ports[e]);
+
+            if (stats != NULL) {
+
+                lookup_stats_update(
+                    &stats,
+                    req_entry_diff(request, prefix, mbt->prefix_size),
+                    tps, fps, 0, 1);
+            }
+
+            (*matches)++;
+            leaf_matches++;
+        }
+
+        // all other entries of the bucket were tested too
+        if (stats != NULL)
+            lookup_stats_add_tns(stats, n->entries_num - leaf_matches);
+
+        return visited;
+    }
+
+    // only children w/ an index which is a submask of the request's chunk
+    // can hold matching entries
+    uint32_t bitmap = n->child_bitmap;
+    uint32_t explore = bitmap & MBT_SUBMASKS[mbt_chunk(request_rid, depth)];
+    uint32_t base = n->base;
+
+    while (explore) {
+
+        int c = __builtin_ctz(explore);
+        explore &= (explore - 1);
+
+        visited += mbt_fwd_lookup_rec(
+            mbt,
+            base + __builtin_popcount(bitmap & ((1U << c) - 1)),
+            depth + 1,
+            request, request_rid,
+            fp_sizes, tp_sizes, ports, stats, matches);
+    }
+
+    return visited;
+}
+
+/*
+ * \brief   looks up a request RID in a multi-bit trie.
+ *
+ * TPs and FPs are added to the tp_sizes and fp_sizes arrays, in the same way
+ * as pt_fwd_lookup() does it, and the next hops of the matches to ports (if
+ * not NULL). if stats isn't NULL, |F\R| is worked out for matches and all
+ * non-matching entries in visited leaf buckets are counted as TNs.
+ *
+ * \return  nr. of visited nodes (internal nodes + leaf buckets)
+ */
+int mbt_fwd_lookup(
+        struct mbt_fwd * mbt,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats) {
+
+    int matches = 0;
+
+    return mbt_fwd_lookup_rec(mbt, 0, 0, request, request_rid, fp_sizes, tp_sizes, ports, stats, &matches);
+}
+
+/*
+ * \brief   PT vs. multi-bit trie, partition by partition: trie size and
+ *          depth, nodes visited per lookup and avg. lookup time.
+ *
+ * partitions are tested in isolation, single threaded. PT node visits are
+ * the ones counted by pt_fwd_lookup() (i.e. the # LOOKUPS in the stats).
+ *
+ * XXX: the PT partition stats are updated by this function, so call it
+ * AFTER pt_ht_print_stats().
+ *
+ * \param   fib             the (PT) FIB to test
+ * \param   requests        array of requests to run through the partitions
+ * \param   requests_num    size of the requests array
+ * \param   output_dir      dir on which to dump the .tsv file
+ */
+void mbt_ht_print_stats(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t depth_hist[PT_MAX_DEPTH] = {0};
+
+    uint32_t pt_matches = 0, mbt_matches = 0;
+    unsigned long pt_visits = 0, mbt_visits = 0;
+    double begin = 0.0, pt_time = 0.0, mbt_time = 0.0, pt_depth = 0.0;
+    int i = 0, k = 0, lookups = 0, pt_max_depth = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_MBT_STATS_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tPT_NODES\tMBT_NODES\tPT_AVG_DEPTH\tPT_MAX_DEPTH\tMBT_MAX_DEPTH"\
+        "\tPT_AVG_VISITS\tMBT_AVG_VISITS\tPT_MEMORY\tMBT_MEMORY\tPT_AVG_TIME\tMBT_AVG_TIME\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-4s\t| %-8s\t| %-8s\t| %-8s\t| %-14s\t| %-14s\t| %-14s\n"\
+            "%-4s\t| %-8s\t| %-8s\t| %-8s\t| %-14s\t| %-14s\t| %-14s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "PT NODES", "MBT NODES", "DEPTH", "VISITS/REQ", "TIME (us)",
+            "", "", "", "", "(PT/PT MAX/MBT)", "(PT/MBT)", "(PT/MBT)");
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        if (itr->prefix_size < 1)
+            continue;
+
+        struct mbt_fwd * mbt = mbt_fwd_init(itr);
+
+        memset(depth_hist, 0, sizeof(depth_hist));
+        pt_max_depth = pt_fwd_depth_hist(itr->trie, depth_hist, PT_MAX_DEPTH);
+        pt_depth = 0.0;
+
+        for (k = 0; k < PT_MAX_DEPTH; k++)
+            pt_depth += (double) k * (double) depth_hist[k];
+
+        pt_depth /= (double) (itr->num_entries + 1);
+
+        pt_visits = 0; mbt_visits = 0; lookups = 0;
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            pt_visits += pt_fwd_lookup(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+            lookups++;
+        }
+
+        pt_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            pt_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            mbt_visits += mbt_fwd_lookup(mbt, requests[i].name, requests[i].rid, fp_sizes, tp_sizes, NULL, NULL);
+        }
+
+        mbt_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            mbt_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        if (lookups > 0) {
+            pt_time = (pt_time / (double) lookups) * 1000000.0;
+            mbt_time = (mbt_time / (double) lookups) * 1000000.0;
+        }
+
+        // PT node: the pt_fwd struct + its own RID (prefix info is shared)
+        size_t pt_memory = (itr->num_entries + 1) * (sizeof(struct pt_fwd) + sizeof(struct click_xia_xid));
+
+        printf(
+            "%-4d\t| %-8d\t| %-8d\t| %-8d\t| %-4.1f/%-4d/%-4d\t| %-6.1f/%-6.1f\t| %-6.2f/%-6.2f\n",
+            itr->prefix_size,
+            itr->num_entries,
+            itr->num_entries + 1,
+            mbt->num_nodes,
+            pt_depth, pt_max_depth, mbt->depth,
+            (lookups > 0 ? (double) pt_visits / (double) lookups : 0.0),
+            (lookups > 0 ? (double) mbt_visits / (double) lookups : 0.0),
+            pt_time, mbt_time);
+
+        fprintf(output_file,
+            "%d\t%d\t%d\t%d\t%-.6f\t%d\t%d\t%-.6f\t%-.6f\t%lu\t%lu\t%-.6f\t%-.6f\n",
+            itr->prefix_size,
+            itr->num_entries,
+            itr->num_entries + 1,
+            mbt->num_nodes,
+            pt_depth, pt_max_depth, mbt->depth,
+            (lookups > 0 ? (double) pt_visits / (double) lookups : 0.0),
+            (lookups > 0 ? (double) mbt_visits / (double) lookups : 0.0),
+            (unsigned long) pt_memory, (unsigned long) mbt_fwd_memory(mbt),
+            pt_time, mbt_time);
+
+        mbt_fwd_erase(mbt);
+    }
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n"\
+            "%-12d\t| %-12d\n",
+            "# PT MATCHES", "# MBT MATCHES",
+            pt_matches, mbt_matches);
+
+    printf("\n");
+
+    // both engines must agree on the match set
+    if (pt_matches != mbt_matches)
+        fprintf(stderr, "mbt_ht_print_stats() : [ERROR] %d PT vs. %d MBT matches\n",
+            pt_matches, mbt_matches);
+
+    fclose(output_file);
+}
@@ -0,0 +1,359 @@
+/*
+ * name_lpm.c
+ *
+ * exact name-based FIB (LPM on URL components, 1 hash table per prefix
+ * size).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <malloc.h>
+
+#include "name_lpm.h"
+#include "prefix_dict.h"
+#include "lookup_stats.h"
+
+// request outcomes, RID FIB vs. true LPM (see name_lpm_bench())
+#define NAME_LPM_CORRECT        0x00
+#define NAME_LPM_FP_TIE         0x01
+#define NAME_LPM_FP_LONGER      0x02
+#define NAME_LPM_OUTCOMES       3
+
+// heap bytes held by a block, incl. malloc() overhead
+static __inline size_t name_lpm_block_size(void * ptr) {
+
+    return (ptr != NULL ? malloc_usable_size(ptr) + sizeof(size_t) : 0);
+}
+
+struct name_lpm * name_lpm_init() {
+
+    return (struct name_lpm *) calloc(1, sizeof(struct name_lpm));
+}
+
+void name_lpm_erase(struct name_lpm * lpm) {
+
+    struct name_lpm_entry * itr, * tmp;
+    int k = 0;
+
+    if (!lpm)
+        return;
+
+    for (k = 0; k <= MAX_PREFIX_SIZE; k++) {
+
+        HASH_ITER(hh, lpm->tables[k], itr, tmp) {
+
+            HASH_DEL(lpm->tables[k], itr);
+            free(itr);
+        }
+    }
+
+    free(lpm);
+}
+
+/*
+ * \brief   adds a prefix to a name-based FIB.
+ *
+ * \param   prefix          URL-like prefix, w/o a trailing '/'
+ * \param   prefix_size     nr. of components in prefix, as returned by
+ *                          name_to_rid()
+ *
+ * \return  0 if the prefix was added, 1 if it was already in the FIB, -1 on
+ *          error
+ */
+int name_lpm_add(struct name_lpm * lpm, char * prefix, int prefix_size) {
+
+    struct name_lpm_entry * e = NULL;
+    size_t prefix_len = strlen(prefix);
+
+    if (prefix_size < 1 || prefix_size > MAX_PREFIX_SIZE || prefix_len >= PREFIX_MAX_LENGTH) {
+
+        fprintf(stderr, "name_lpm_add() : [ERROR] invalid prefix %s (size %d)\n", prefix, prefix_size);
+        return -1;
+    }
+
+    HASH_FIND(hh, lpm->tables[prefix_size], prefix, prefix_len, e);
+
+    if (e != NULL) {
+
+        lpm->num_dups++;
+        return 1;
+    }
+
+    e = (struct name_lpm_entry *) malloc(sizeof(struct name_lpm_entry) + prefix_len + 1);
+
+    e->prefix_size = prefix_size;
+    e->prefix_len = prefix_len;
+    memcpy(e->prefix, prefix, prefix_len + 1);
+
+    HASH_ADD(hh, lpm->tables[prefix_size], prefix, prefix_len, e);
+    lpm->num_entries[prefix_size]++;
+
+    return 0;
+}
+
+/*
+ * \brief   longest prefix match of a request name. the request is split
+ *          into components the same way as name_to_rid() does it (i.e. empty
+ *          components are skipped), and its sub-prefixes are looked up from
+ *          the largest to the smallest.
+ *
+ * \return  the longest matching entry, NULL if none
+ */
+struct name_lpm_entry * name_lpm_lookup(
+        struct name_lpm * lpm,
+        const char * request) {
+
+    struct name_lpm_entry * e = NULL;
+
+    // ends[k] : length of the 1st k components of the request
+    uint16_t ends[MAX_PREFIX_SIZE + 1];
+    int k = 0, i = 0;
+
+    while (request[i] != '\0' && k < MAX_PREFIX_SIZE) {
+
+        while (request[i] == PREFIX_DELIM_CHAR)
+            i++;
+
+        if (request[i] == '\0')
+            break;
+
+        while (request[i] != '\0' && request[i] != PREFIX_DELIM_CHAR)
+            i++;
+
+        ends[++k] = i;
+    }
+
+    for ( ; k > 0; k--) {
+
+        if (lpm->tables[k] == NULL)
+            continue;
+
+        HASH_FIND(hh, lpm->tables[k], request, ends[k], e);
+
+        if (e != NULL)
+            return e;
+    }
+
+    return NULL;
+}
+
+static size_t name_lpm_table_memory(struct name_lpm * lpm, int prefix_size) {
+
+    struct name_lpm_entry * itr;
+    size_t memory = 0;
+
+    if (lpm->tables[prefix_size] == NULL)
+        return 0;
+
+    UT_hash_table * tbl = lpm->tables[prefix_size]->hh.tbl;
+    memory += name_lpm_block_size(tbl) + name_lpm_block_size(tbl->buckets);
+
+    for (itr = lpm->tables[prefix_size]; itr != NULL; itr = (struct name_lpm_entry *) itr->hh.next)
+        memory += name_lpm_block_size(itr);
+
+    return memory;
+}
+
+/*
+ * \brief   memory held by a name-based FIB (entries, incl. prefix strings,
+ *          and hash table buckets), in byte.
+ */
+size_t name_lpm_memory(struct name_lpm * lpm) {
+
+    size_t memory = name_lpm_block_size(lpm);
+    int k = 0;
+
+    for (k = 0; k <= MAX_PREFIX_SIZE; k++)
+        memory += name_lpm_table_memory(lpm, k);
+
+    return memory;
+}
+
+/*
+ * \brief   name-based LPM vs. the RID FIB, on the same requests:
+ *
+ *  -# memory of both FIBs (the RID FIB's tries plus the prefix dictionary)
+ *  -# avg. lookup time, per size of the true LPM of the request. the RID
+ *     FIB looks up all partitions of size |F| <= |R|, w/ their engines.
+ *  -# ground truth for the FP analysis: the RID FIB's answer is its largest
+ *     match. it's correct if that's the true LPM, a tie if there are FPs of
+ *     the same size as the true LPM and wrong if an FP is larger.
+ *
+ * results go to <output_dir>/name-lpm-bench.tsv.
+ *
+ * XXX: the FIB partition stats are reset by this function, so call it
+ * AFTER pt_ht_print_stats().
+ */
+void name_lpm_bench(
+        struct name_lpm * lpm,
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    // per true LPM size (0 for no match)
+    uint32_t num_requests[MAX_PREFIX_SIZE + 1] = {0};
+    uint32_t outcomes[MAX_PREFIX_SIZE + 1][NAME_LPM_OUTCOMES] = {{0}};
+    double name_times[MAX_PREFIX_SIZE + 1] = {0.0};
+    double pt_times[MAX_PREFIX_SIZE + 1] = {0.0};
+
+    // requests for which the largest RID FIB TP isn't the true LPM
+    uint32_t mismatches = 0;
+    uint32_t num_entries = 0;
+    double begin = 0.0, name_time = 0.0, pt_time = 0.0;
+    int i = 0, k = 0, round = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_NAME_LPM_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "name_lpm_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    struct pt_ht * itr;
+
+    // 1st round warms up the caches and isn't counted
+    for (round = 0; round < 2; round++) {
+
+        for (i = 0; i < requests_num; i++) {
+
+            begin = get_time_now();
+            struct name_lpm_entry * e = name_lpm_lookup(lpm, requests[i].name);
+            name_time = get_time_now() - begin;
+
+            begin = get_time_now();
+
+            for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+                if (requests[i].size < itr->prefix_size)
+                    continue;
+
+                pt_ht_lookup_partition(itr, requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes, NULL, NULL);
+            }
+
+            pt_time = get_time_now() - begin;
+
+            int lpm_size = (e != NULL ? e->prefix_size : 0), tp_max = 0, fp_max = 0;
+
+            for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+
+                if (tp_sizes[k] > 0) tp_max = k + 1;
+                if (fp_sizes[k] > 0) fp_max = k + 1;
+
+                fp_sizes[k] = 0; tp_sizes[k] = 0;
+            }
+
+            if (round == 0)
+                continue;
+
+            num_requests[lpm_size]++;
+            name_times[lpm_size] += name_time;
+            pt_times[lpm_size] += pt_time;
+
+            if (tp_max != lpm_size)
+                mismatches++;
+
+            if (fp_max > lpm_size)
+                outcomes[lpm_size][NAME_LPM_FP_LONGER]++;
+            else if (fp_max == lpm_size && fp_max > 0)
+                outcomes[lpm_size][NAME_LPM_FP_TIE]++;
+            else
+                outcomes[lpm_size][NAME_LPM_CORRECT]++;
+        }
+    }
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        lookup_stats_reset(itr->general_stats);
+
+    fprintf(output_file, "SIZE\tNUM_ENTRIES\tNAME_MEMORY\tPT_MEMORY\tNUM_REQUESTS\tNAME_AVG_TIME\tPT_AVG_TIME\tCORRECT\tFP_TIE\tFP_LONGER\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-8s\t| %-10s\t| %-10s\t| %-10s\t| %-8s\t| %-8s\t| %-8s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|LPM|", "# REQUESTS", "NAME (us)", "PT (us)", "CORRECT", "FP TIE", "FP LONGER");
+
+    uint32_t totals[NAME_LPM_OUTCOMES] = {0};
+    double name_total = 0.0, pt_total = 0.0;
+
+    // 1 row per size, both as the true LPM size of requests and as the
+    // prefix size of entries
+    for (k = 0; k <= MAX_PREFIX_SIZE; k++) {
+
+        struct pt_ht * s = pt_ht_search(fib, k);
+
+        num_entries += lpm->num_entries[k];
+
+        if (num_requests[k] == 0 && lpm->num_entries[k] == 0 && s == NULL)
+            continue;
+
+        double name_avg = (num_requests[k] > 0 ? (name_times[k] / (double) num_requests[k]) * 1000000.0 : 0.0);
+        double pt_avg = (num_requests[k] > 0 ? (pt_times[k] / (double) num_requests[k]) * 1000000.0 : 0.0);
+
+        if (num_requests[k] > 0)
+            printf("%-8d\t| %-10d\t| %-10.3f\t| %-10.3f\t| %-8d\t| %-8d\t| %-8d\n",
+                k, num_requests[k], name_avg, pt_avg,
+                outcomes[k][NAME_LPM_CORRECT], outcomes[k][NAME_LPM_FP_TIE], outcomes[k][NAME_LPM_FP_LONGER]);
+
+        fprintf(output_file, "%d\t%d\t%lu\t%lu\t%d\t%-.6f\t%-.6f\t%d\t%d\t%d\n",
+            k, lpm->num_entries[k],
+            (unsigned long) name_lpm_table_memory(lpm, k),
+            (unsigned long) (s != NULL ? pt_ht_partition_memory(s) : 0),
+            num_requests[k], name_avg, pt_avg,
+            outcomes[k][NAME_LPM_CORRECT], outcomes[k][NAME_LPM_FP_TIE], outcomes[k][NAME_LPM_FP_LONGER]);
+
+        for (i = 0; i < NAME_LPM_OUTCOMES; i++)
+            totals[i] += outcomes[k][i];
+
+        name_total += name_times[k];
+        pt_total += pt_times[k];
+    }
+
+    // the prefix dictionary is shared by all partitions
+    size_t name_memory = name_lpm_memory(lpm);
+    size_t pt_memory = pt_ht_memory(fib) + prefix_dict_memory(prefix_dict_default());
+    uint32_t entries = (num_entries ? num_entries : 1);
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-8s\t| %-10d\t| %-10.3f\t| %-10.3f\t| %-8d\t| %-8d\t| %-8d\n"\
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n"\
+            "%-12d\t| %-12.1f\t| %-12.1f\t| %-12d\n",
+            "TOTAL", requests_num,
+            (requests_num > 0 ? (name_total / requests_num) * 1000000.0 : 0.0),
+            (requests_num > 0 ? (pt_total / requests_num) * 1000000.0 : 0.0),
+            totals[NAME_LPM_CORRECT], totals[NAME_LPM_FP_TIE], totals[NAME_LPM_FP_LONGER],
+            "# ENTRIES", "NAME (B/E)", "PT (B/E)", "# MISMATCHES",
+            num_entries,
+            (double) name_memory / entries, (double) pt_memory / entries,
+            mismatches);
+
+    printf("\n");
+
+    // the largest TP of a RID FIB lookup should be the true LPM (up to
+    // entries w/ duplicate RIDs, which the RID FIB drops)
+    if (mismatches > 0)
+        fprintf(stderr, "name_lpm_bench() : [WARNING] largest TP isn't the true LPM for %d requests\n", mismatches);
+
+    fclose(output_file);
+}
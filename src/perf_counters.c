@@ -0,0 +1,171 @@
+/*
+ * perf_counters.c
+ *
+ * event counters via perf_event_open().
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counters.h"
+#include "rid_utils.h"
+
+#define PERF_CACHE_EVENT(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+static const struct {
+
+    const char * name;
+    uint32_t type;
+    uint64_t config;
+
+} perf_events[PERF_EVENTS] = {
+
+    { "PAGE_FAULTS",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "MINOR_FAULTS",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN },
+    { "MAJOR_FAULTS",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ },
+    { "DTLB_MISSES",    PERF_TYPE_HW_CACHE,
+        PERF_CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "L1D_MISSES",     PERF_TYPE_HW_CACHE,
+        PERF_CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "LLC_MISSES",     PERF_TYPE_HW_CACHE,
+        PERF_CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "CACHE_MISSES",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "INSTRUCTIONS",   PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+};
+
+const char * perf_event_name(int event) {
+
+    return perf_events[event].name;
+}
+
+/*
+ * \brief   opens (disabled) counters for all PERF_EVENTS, for the calling
+ *          process and the threads it creates from then on
+ */
+void perf_counters_init(struct perf_counters * pc) {
+
+    struct perf_event_attr attr;
+
+    for (int i = 0; i < PERF_EVENTS; i++) {
+
+        memset(&attr, 0, sizeof(struct perf_event_attr));
+
+        attr.size = sizeof(struct perf_event_attr);
+        attr.type = perf_events[i].type;
+        attr.config = perf_events[i].config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        // user space only, so that perf_event_paranoid <= 2 is enough
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        pc->fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        pc->values[i] = 0;
+    }
+}
+
+void perf_counters_erase(struct perf_counters * pc) {
+
+    for (int i = 0; i < PERF_EVENTS; i++) {
+
+        if (pc->fds[i] >= 0)
+            close(pc->fds[i]);
+
+        pc->fds[i] = -1;
+    }
+}
+
+void perf_counters_start(struct perf_counters * pc) {
+
+    for (int i = 0; i < PERF_EVENTS; i++) {
+
+        if (pc->fds[i] < 0)
+            continue;
+
+        ioctl(pc->fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+/*
+ * \brief   stops the counters and reads them into pc->values. counts of
+ *          inherited threads are only included once these have exited.
+ */
+void perf_counters_stop(struct perf_counters * pc) {
+
+    for (int i = 0; i < PERF_EVENTS; i++) {
+
+        if (pc->fds[i] < 0)
+            continue;
+
+        ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(pc->fds[i], &(pc->values[i]), sizeof(uint64_t)) != sizeof(uint64_t))
+            pc->values[i] = 0;
+    }
+}
+
+int perf_counters_available(struct perf_counters * pc, int event) {
+
+    return (pc->fds[event] >= 0);
+}
+
+/*
+ * \brief   prints the counters (total and per lookup) and appends them to
+ *          <output_dir>/perf-counters.tsv, tagged w/ label
+ */
+void perf_counters_print(
+        struct perf_counters * pc,
+        const char * label,
+        uint64_t num_lookups,
+        std::string output_dir) {
+
+    std::string report_file = output_dir + std::string("/") + std::string(DEFAULT_PERF_COUNTERS_FILE);
+    FILE * report = fopen(report_file.c_str(), "ab");
+
+    if (!report)
+        fprintf(stderr, "perf_counters_print() : [ERROR] couldn't open %s\n", report_file.c_str());
+
+    printf("\n%-10s\t| %-14s\t| %-14s\t| %-14s\n", "LABEL", "EVENT", "TOTAL", "PER LOOKUP");
+
+    for (int i = 0; i < PERF_EVENTS; i++) {
+
+        if (perf_counters_available(pc, i)) {
+
+            printf("%-10s\t| %-14s\t| %-14lu\t| %-14.3f\n",
+                label, perf_events[i].name, pc->values[i],
+                (double) pc->values[i] / (double) (num_lookups ? num_lookups : 1));
+
+            if (report)
+                fprintf(report, "%s\t%s\t%lu\t%lu\n", label, perf_events[i].name, pc->values[i], num_lookups);
+
+        } else {
+
+            printf("%-10s\t| %-14s\t| %-14s\t| %-14s\n", label, perf_events[i].name, "n/a", "n/a");
+
+            if (report)
+                fprintf(report, "%s\t%s\tn/a\t%lu\n", label, perf_events[i].name, num_lookups);
+        }
+    }
+
+    if (report)
+        fclose(report);
+}
@@ -0,0 +1,725 @@
+/*
+ * prefix_dict.c
+ *
+ * component dictionary for prefix strings of FIB entries.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "prefix_dict.h"
+
+const char * PREFIX_CLASSIFY_STRS[] = {"NONE", "SCAN", "MASKS"};
+
+// how TP checks and |F\R| counts are done (PREFIX_CLASSIFY_*)
+int prefix_classify = PREFIX_CLASSIFY_SCAN;
+
+static struct prefix_dict * default_dict = NULL;
+static pthread_once_t default_dict_once = PTHREAD_ONCE_INIT;
+
+static uint32_t prefix_dict_hash(const char * str, size_t len) {
+
+    uint64_t hash = fnv1a(FNV_OFFSET_BASIS, str, len);
+
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+static struct prefix_dict_table * prefix_dict_table_init(uint32_t num_slots) {
+
+    struct prefix_dict_table * table = (struct prefix_dict_table *) malloc(
+        sizeof(struct prefix_dict_table) + (num_slots * sizeof(uint32_t)));
+
+    table->num_slots = num_slots;
+    memset(table->slots, 0xFF, num_slots * sizeof(uint32_t));
+
+    return table;
+}
+
+struct prefix_dict * prefix_dict_init() {
+
+    struct prefix_dict * dict = (struct prefix_dict *) calloc(1, sizeof(struct prefix_dict));
+
+    dict->table = prefix_dict_table_init(PREFIX_DICT_MIN_SLOTS);
+    pthread_mutex_init(&(dict->lock), NULL);
+
+    return dict;
+}
+
+void prefix_dict_erase(struct prefix_dict * dict) {
+
+    uint32_t i = 0;
+
+    if (!dict)
+        return;
+
+    for (i = 0; i < dict->num_chunks; i++)
+        free(dict->chunks[i]);
+
+    for (i = 0; i < dict->num_old_tables; i++)
+        free(dict->old_tables[i]);
+
+    free(dict->old_tables);
+    free(dict->table);
+
+    pthread_mutex_destroy(&(dict->lock));
+    free(dict);
+}
+
+static void prefix_dict_default_init() {
+
+    default_dict = prefix_dict_init();
+}
+
+struct prefix_dict * prefix_dict_default() {
+
+    pthread_once(&default_dict_once, prefix_dict_default_init);
+
+    return default_dict;
+}
+
+/*
+ * \brief   erases the default dictionary. no prefix_info may be left.
+ */
+void prefix_dict_default_erase() {
+
+    prefix_dict_erase(default_dict);
+    default_dict = NULL;
+
+    default_dict_once = PTHREAD_ONCE_INIT;
+}
+
+static uint32_t prefix_dict_probe(
+        struct prefix_dict * dict,
+        struct prefix_dict_table * table,
+        const char * str,
+        size_t len,
+        uint32_t * slot) {
+
+    uint32_t mask = table->num_slots - 1;
+    uint32_t i = prefix_dict_hash(str, len) & mask;
+
+    while (1) {
+
+        uint32_t id = __atomic_load_n(&(table->slots[i]), __ATOMIC_ACQUIRE);
+
+        if (id == PREFIX_DICT_NONE)
+            break;
+
+        uint16_t id_len = 0;
+        const char * id_str = prefix_dict_get(dict, id, &id_len);
+
+        if (id_len == len && memcmp(id_str, str, len) == 0) {
+
+            *slot = i;
+            return id;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    *slot = i;
+    return PREFIX_DICT_NONE;
+}
+
+/*
+ * \brief   looks up a component, w/o locks
+ *
+ * \return  the component's ID, PREFIX_DICT_NONE if it isn't there
+ */
+uint32_t prefix_dict_find(struct prefix_dict * dict, const char * str, size_t len) {
+
+    uint32_t slot = 0;
+    struct prefix_dict_table * table = __atomic_load_n(&(dict->table), __ATOMIC_ACQUIRE);
+
+    return prefix_dict_probe(dict, table, str, len, &slot);
+}
+
+static void prefix_dict_grow(struct prefix_dict * dict) {
+
+    struct prefix_dict_table * old_table = dict->table;
+    struct prefix_dict_table * table = prefix_dict_table_init(old_table->num_slots * 2);
+    uint32_t i = 0, slot = 0;
+
+    for (i = 0; i < old_table->num_slots; i++) {
+
+        if (old_table->slots[i] == PREFIX_DICT_NONE)
+            continue;
+
+        uint16_t len = 0;
+        const char * str = prefix_dict_get(dict, old_table->slots[i], &len);
+
+        prefix_dict_probe(dict, table, str, len, &slot);
+        table->slots[slot] = old_table->slots[i];
+    }
+
+    __atomic_store_n(&(dict->table), table, __ATOMIC_RELEASE);
+
+    dict->old_tables = (struct prefix_dict_table **) realloc(
+        dict->old_tables, (dict->num_old_tables + 1) * sizeof(struct prefix_dict_table *));
+    dict->old_tables[dict->num_old_tables++] = old_table;
+}
+
+/*
+ * \brief   adds a component to the dictionary (unless it's already there)
+ *
+ * \return  the component's ID, PREFIX_DICT_NONE if the dictionary is full
+ */
+uint32_t prefix_dict_insert(struct prefix_dict * dict, const char * str, size_t len) {
+
+    uint32_t id = prefix_dict_find(dict, str, len);
+
+    if (id != PREFIX_DICT_NONE)
+        return id;
+
+    pthread_mutex_lock(&(dict->lock));
+
+    uint32_t slot = 0;
+    id = prefix_dict_probe(dict, dict->table, str, len, &slot);
+
+    if (id != PREFIX_DICT_NONE) {
+
+        pthread_mutex_unlock(&(dict->lock));
+        return id;
+    }
+
+    size_t size = sizeof(uint16_t) + len;
+
+    if (dict->num_chunks == 0 || dict->chunk_used + size > PREFIX_DICT_CHUNK_SIZE) {
+
+        if (dict->num_chunks == PREFIX_DICT_MAX_CHUNKS) {
+
+            fprintf(stderr, "prefix_dict_insert() : [ERROR] dictionary is full\n");
+
+            pthread_mutex_unlock(&(dict->lock));
+            return PREFIX_DICT_NONE;
+        }
+
+        dict->chunks[dict->num_chunks++] = (char *) malloc(PREFIX_DICT_CHUNK_SIZE);
+        dict->chunk_used = 0;
+    }
+
+    uint16_t _len = (uint16_t) len;
+    char * p = dict->chunks[dict->num_chunks - 1] + dict->chunk_used;
+
+    memcpy(p, &_len, sizeof(uint16_t));
+    memcpy(p + sizeof(uint16_t), str, len);
+
+    id = ((dict->num_chunks - 1) * PREFIX_DICT_CHUNK_SIZE) + dict->chunk_used;
+    dict->chunk_used += size;
+
+    // the component must be in place before its ID shows up in the table
+    __atomic_store_n(&(dict->table->slots[slot]), id, __ATOMIC_RELEASE);
+
+    dict->num_strings++;
+    dict->strings_size += size;
+
+    // keep the load factor <= 1/2
+    if (dict->num_strings * 2 > dict->table->num_slots)
+        prefix_dict_grow(dict);
+
+    pthread_mutex_unlock(&(dict->lock));
+
+    return id;
+}
+
+/*
+ * \brief   memory held by a dictionary (used string storage and the
+ *          current table), in byte
+ */
+size_t prefix_dict_memory(struct prefix_dict * dict) {
+
+    if (!dict)
+        return 0;
+
+    return sizeof(struct prefix_dict)
+        + dict->strings_size
+        + sizeof(struct prefix_dict_table) + (dict->table->num_slots * sizeof(uint32_t));
+}
+
+/*
+ * \brief   splits a request in components and looks them up in the default
+ *          dictionary. requests w/ more than PREFIX_REQ_MASK_COMPS 
+ *          components are only kept as a string.
+ */
+void prefix_req_init(struct prefix_req * req, const char * request) {
+
+    struct prefix_dict * dict = prefix_dict_default();
+    const char * start = request;
+
+    req->dict = dict;
+    req->request = request;
+    req->num_comps = 0;
+    req->memo_ready = 0;
+
+    while (req->num_comps < PREFIX_REQ_MASK_COMPS) {
+
+        const char * end = strchr(start, PREFIX_DELIM_CHAR);
+        size_t len = (end != NULL ? (size_t) (end - start) : strlen(start));
+
+        req->strs[req->num_comps] = start;
+        req->lens[req->num_comps] = (uint16_t) len;
+        req->ids[req->num_comps] = prefix_dict_find(dict, start, len);
+        req->num_comps++;
+
+        if (end == NULL)
+            return;
+
+        start = end + 1;
+    }
+
+    req->num_comps = PREFIX_REQ_MASK_COMPS + 1;
+}
+
+/*
+ * \brief   copies the components of a request w/o its memo, e.g. for a
+ *          lookup thread (the memo is written during lookups).
+ */
+void prefix_req_copy(struct prefix_req * dst, struct prefix_req * src) {
+
+    uint32_t n = (src->num_comps < PREFIX_REQ_MASK_COMPS ? src->num_comps : PREFIX_REQ_MASK_COMPS);
+
+    dst->dict = src->dict;
+    dst->request = src->request;
+    dst->num_comps = src->num_comps;
+    dst->memo_ready = 0;
+
+    memcpy(dst->ids, src->ids, n * sizeof(uint32_t));
+    memcpy(dst->strs, src->strs, n * sizeof(const char *));
+    memcpy(dst->lens, src->lens, n * sizeof(uint16_t));
+}
+
+/*
+ * \brief   puts the prefix string of an entry back together
+ *
+ * \return  the string's length, -1 if it doesn't fit in max_size
+ */
+int prefix_info_str(struct prefix_info * prefix_info, char * str, size_t max_size) {
+
+    struct prefix_dict * dict = prefix_dict_default();
+    size_t size = 0;
+    uint16_t c = 0;
+
+    for (c = 0; c < prefix_info->num_comps; c++) {
+
+        uint16_t len = 0;
+        const char * comp = prefix_dict_get(dict, prefix_info->comps[c], &len);
+
+        if (size + len + 1 > max_size)
+            return -1;
+
+        if (c > 0)
+            str[size - 1] = PREFIX_DELIM_CHAR;
+
+        memcpy(str + size, comp, len);
+        size += len + 1;
+        str[size - 1] = '\0';
+    }
+
+    if (prefix_info->num_comps == 0) {
+
+        if (max_size == 0)
+            return -1;
+
+        str[0] = '\0';
+        return 0;
+    }
+
+    return (int) (size - 1);
+}
+
+/*
+ * \brief   memory held by a prefix_info, in byte (w/o malloc() overhead)
+ */
+size_t prefix_info_size(struct prefix_info * prefix_info) {
+
+    return sizeof(struct prefix_info) + (prefix_info->num_comps * sizeof(uint32_t));
+}
+
+/*
+ * \brief   length of the prefix string of an entry, '\0' included
+ */
+size_t prefix_info_str_size(struct prefix_info * prefix_info) {
+
+    struct prefix_dict * dict = prefix_dict_default();
+    size_t size = 0;
+    uint16_t c = 0, len = 0;
+
+    for (c = 0; c < prefix_info->num_comps; c++) {
+
+        prefix_dict_get(dict, prefix_info->comps[c], &len);
+        size += len + 1;
+    }
+
+    return (size > 0 ? size : 1);
+}
+
+// 1 if component id (str, len) ends w/ request component i
+static __inline int prefix_req_suffix(
+        struct prefix_dict * dict,
+        struct prefix_req * req,
+        uint32_t i,
+        uint32_t id) {
+
+    if (req->ids[i] == id)
+        return 1;
+
+    uint16_t len = 0;
+    const char * str = prefix_dict_get(dict, id, &len);
+
+    return (len <= req->lens[i]
+        && memcmp(req->strs[i] + (req->lens[i] - len), str, len) == 0);
+}
+
+static __inline int prefix_req_prefix(
+        struct prefix_dict * dict,
+        struct prefix_req * req,
+        uint32_t i,
+        uint32_t id) {
+
+    if (req->ids[i] == id)
+        return 1;
+
+    uint16_t len = 0;
+    const char * str = prefix_dict_get(dict, id, &len);
+
+    return (len <= req->lens[i] && memcmp(req->strs[i], str, len) == 0);
+}
+
+/*
+ * \brief   TP check, 1 request component at a time.
+ *
+ * the prefix's components must line up w/ the request's: the 1st must end
+ * a request component, inner ones must be equal and the last must start a
+ * request component. a single component may be anywhere in one.
+ */
+static int prefix_info_match_scan(
+        struct prefix_info * prefix_info,
+        struct prefix_req * req) {
+
+    struct prefix_dict * dict = req->dict;
+    uint32_t k = prefix_info->num_comps, i = 0, j = 0;
+
+    if (k == 0)
+        return 1;
+
+    if (k == 1) {
+
+        uint16_t len = 0;
+        const char * str = prefix_dict_get(dict, prefix_info->comps[0], &len);
+
+        for (i = 0; i < req->num_comps; i++) {
+
+            if (req->ids[i] == prefix_info->comps[0])
+                return 1;
+
+            if (len == 0 || (len <= req->lens[i] && memmem(req->strs[i], req->lens[i], str, len) != NULL))
+                return 1;
+        }
+
+        return 0;
+    }
+
+    for (i = 0; i + k <= req->num_comps; i++) {
+
+        if (!prefix_req_suffix(dict, req, i, prefix_info->comps[0]))
+            continue;
+
+        for (j = 1; j < k - 1; j++)
+            if (req->ids[i + j] != prefix_info->comps[j])
+                break;
+
+        if (j == k - 1 && prefix_req_prefix(dict, req, i + k - 1, prefix_info->comps[k - 1]))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * \brief   |F\R| count, 1 request component at a time.
+ *
+ * the j-th step of req_entry_diff() looks for the prefix up to (and
+ * including) its j-th PREFIX_DELIM_CHAR in the request. the starting
+ * request components which still match after step j are kept in
+ * candidates, step j + 1 only has to check 1 more component of each.
+ */
+static unsigned int prefix_info_diff_scan(
+        struct prefix_info * prefix_info,
+        struct prefix_req * req,
+        unsigned int entry_size) {
+
+    struct prefix_dict * dict = req->dict;
+    uint32_t candidates[PREFIX_REQ_MASK_COMPS];
+    uint32_t num_candidates = 0, i = 0, c = 0;
+
+    unsigned int req_entry_diff = entry_size;
+    unsigned int prefix_count = 0;
+
+    // nr. of PREFIX_DELIM_CHARs in the prefix
+    uint32_t num_delims = (prefix_info->num_comps > 0 ? prefix_info->num_comps - 1 : 0);
+    uint32_t j = 0;
+
+    for (j = 1; j <= num_delims && (prefix_count <= entry_size); j++) {
+
+        if (j == 1) {
+
+            // 1st component, followed by a PREFIX_DELIM_CHAR
+            for (i = 0; i + 1 < req->num_comps; i++)
+                if (prefix_req_suffix(dict, req, i, prefix_info->comps[0]))
+                    candidates[num_candidates++] = i;
+
+        } else {
+
+            uint32_t kept = 0;
+
+            for (c = 0; c < num_candidates; c++) {
+
+                i = candidates[c];
+
+                if (i + j < req->num_comps && req->ids[i + j - 1] == prefix_info->comps[j - 1])
+                    candidates[kept++] = i;
+            }
+
+            num_candidates = kept;
+        }
+
+        if (num_candidates == 0)
+            return req_entry_diff;
+
+        req_entry_diff--;
+        prefix_count++;
+    }
+
+    return req_entry_diff;
+}
+
+// bit mask w/ the n lowest bits set
+static __inline uint64_t prefix_req_low(int n) {
+
+    if (n <= 0)
+        return 0;
+
+    return (n >= 64 ? ~((uint64_t) 0) : (((uint64_t) 1 << n) - 1));
+}
+
+/*
+ * \brief   bit masks of a prefix component vs. the request components,
+ *          worked out on the 1st call for each component and request.
+ */
+static __inline void prefix_req_masks_get(
+        struct prefix_dict * dict,
+        struct prefix_req * req,
+        uint32_t id,
+        struct prefix_req_masks * masks) {
+
+    uint32_t slot = (id * 2654435761U) & (PREFIX_REQ_MEMO_SLOTS - 1);
+    uint32_t i = 0, probes = 0;
+
+    if (!(req->memo_ready)) {
+
+        memset(req->memo_ids, 0xFF, sizeof(req->memo_ids));
+        req->memo_ready = 1;
+    }
+
+    // a few probes at most, the masks are cheap to work out anyway
+    for (probes = 0; probes < 8; probes++) {
+
+        if (req->memo_ids[slot] == id) {
+
+            *masks = req->memo[slot];
+            return;
+        }
+
+        if (req->memo_ids[slot] == PREFIX_DICT_NONE)
+            break;
+
+        slot = (slot + 1) & (PREFIX_REQ_MEMO_SLOTS - 1);
+    }
+
+    masks->suffix = 0;
+    masks->prefix = 0;
+    masks->equal = 0;
+
+    uint16_t len = 0;
+    const char * str = prefix_dict_get(dict, id, &len);
+
+    for (i = 0; i < req->num_comps; i++) {
+
+        uint64_t bit = ((uint64_t) 1 << i);
+
+        if (req->ids[i] == id) {
+
+            masks->suffix |= bit;
+            masks->prefix |= bit;
+            masks->equal |= bit;
+
+        } else if (len <= req->lens[i]) {
+
+            if (memcmp(req->strs[i] + (req->lens[i] - len), str, len) == 0)
+                masks->suffix |= bit;
+
+            if (memcmp(req->strs[i], str, len) == 0)
+                masks->prefix |= bit;
+        }
+    }
+
+    if (req->memo_ids[slot] == PREFIX_DICT_NONE) {
+
+        req->memo_ids[slot] = id;
+        req->memo[slot] = *masks;
+    }
+}
+
+/*
+ * \brief   TP check w/ bit masks: bit i of the running mask is set if the
+ *          prefix may still start at request component i.
+ */
+static int prefix_info_match_masks(
+        struct prefix_info * prefix_info,
+        struct prefix_req * req) {
+
+    struct prefix_dict * dict = req->dict;
+    struct prefix_req_masks masks;
+    int k = prefix_info->num_comps, t = 0;
+
+    if (k > (int) req->num_comps)
+        return 0;
+
+    prefix_req_masks_get(dict, req, prefix_info->comps[0], &masks);
+    uint64_t candidates = masks.suffix & prefix_req_low(req->num_comps - k + 1);
+
+    for (t = 1; t < k - 1 && candidates; t++) {
+
+        prefix_req_masks_get(dict, req, prefix_info->comps[t], &masks);
+        candidates &= (masks.equal >> t);
+    }
+
+    if (!candidates)
+        return 0;
+
+    prefix_req_masks_get(dict, req, prefix_info->comps[k - 1], &masks);
+
+    return ((candidates & (masks.prefix >> (k - 1))) != 0);
+}
+
+/*
+ * \brief   |F\R| count w/ bit masks: step j keeps the starting positions
+ *          w/ a PREFIX_DELIM_CHAR after component j - 1 of the prefix.
+ */
+static unsigned int prefix_info_diff_masks(
+        struct prefix_info * prefix_info,
+        uint64_t fp,
+        struct prefix_req * req,
+        unsigned int entry_size) {
+
+    struct prefix_dict * dict = req->dict;
+    struct prefix_req_masks masks;
+    uint64_t candidates = 0;
+
+    unsigned int req_entry_diff = entry_size;
+    unsigned int prefix_count = 0;
+
+    uint32_t j = 0, id = 0;
+
+    for (j = 1; (prefix_count <= entry_size); j++) {
+
+        // steps 1 and 2 out of the fingerprint
+        if (j <= 2) {
+
+            id = (uint32_t) (j == 1 ? fp : (fp >> 32));
+
+            if (id == PREFIX_DICT_NONE)
+                break;
+
+        } else {
+
+            if (j >= prefix_info->num_comps)
+                break;
+
+            id = prefix_info->comps[j - 1];
+        }
+
+        prefix_req_masks_get(dict, req, id, &masks);
+
+        if (j == 1)
+            candidates = masks.suffix;
+        else
+            candidates &= (masks.equal >> (j - 1));
+
+        candidates &= prefix_req_low((int) req->num_comps - (int) j);
+
+        if (!candidates)
+            return req_entry_diff;
+
+        req_entry_diff--;
+        prefix_count++;
+    }
+
+    return req_entry_diff;
+}
+
+/*
+ * \brief   same as (strstr(request, prefix) != NULL), w/ the prefix of an
+ *          entry and a request split in components.
+ *
+ * \return  1 if the request holds the prefix, 0 otherwise
+ */
+int prefix_info_match(
+        struct prefix_info * prefix_info,
+        struct prefix_req * req) {
+
+    if (req->num_comps > PREFIX_REQ_MASK_COMPS) {
+
+        char prefix[PREFIX_MAX_LENGTH];
+
+        return (prefix_info_str(prefix_info, prefix, PREFIX_MAX_LENGTH) >= 0
+            && strstr(req->request, prefix) != NULL);
+    }
+
+    if (prefix_classify == PREFIX_CLASSIFY_MASKS && prefix_info->num_comps > 1)
+        return prefix_info_match_masks(prefix_info, req);
+
+    return prefix_info_match_scan(prefix_info, req);
+}
+
+/*
+ * \brief   same as req_entry_diff(request, prefix, entry_size), w/ the
+ *          prefix of an entry and a request split in components.
+ *
+ * \param   fp  the entry's fingerprint (see prefix_info_fp())
+ *
+ * \return  |F\R|
+ */
+unsigned int prefix_info_diff(
+        struct prefix_info * prefix_info,
+        uint64_t fp,
+        struct prefix_req * req,
+        unsigned int entry_size) {
+
+    if (req->num_comps > PREFIX_REQ_MASK_COMPS) {
+
+        char prefix[PREFIX_MAX_LENGTH];
+
+        if (prefix_info_str(prefix_info, prefix, PREFIX_MAX_LENGTH) < 0)
+            return entry_size;
+
+        return req_entry_diff(req->request, prefix, entry_size);
+    }
+
+    if (prefix_classify == PREFIX_CLASSIFY_MASKS)
+        return prefix_info_diff_masks(prefix_info, fp, req, entry_size);
+
+    return prefix_info_diff_scan(prefix_info, req, entry_size);
+}
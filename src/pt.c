@@ -25,10 +25,49 @@
  */
 
 #include "pt.h"
+#include "scan.h"
+#include "bitslice.h"
+#include "pt_dir.h"
+#include "mbt.h"
+#include "bit_order.h"
+#include "pt_flat.h"
+#include "louds.h"
+#include "prefix_dict.h"
+#include "rcu.h"
+#include "hp_arena.h"
+#include "rid_cache.h"
 
-int condition_var = 0;
-pthread_mutex_t lock;
-threadpool_t * pool;
+#include <algorithm>
+#include <malloc.h>
+
+const char * PT_ENGINE_STRS[] = {"PT", "SCAN", "BITSLICE", "DIR", "MBT", "FLAT", "LOUDS"};
+
+// if set, FIB updates assume concurrent lookups: nodes are published w/
+// release semantics and unlinked nodes are retired instead of freed
+struct rcu_domain * pt_rcu = NULL;
+
+// if set, trie nodes and RIDs are allocated from huge pages
+struct hp_arena * pt_arena = NULL;
+
+struct rid_cache * pt_cache = NULL;
+
+/*
+ * \brief   allocates trie nodes and RIDs, from pt_arena if set (and not full)
+ */
+void * pt_fwd_malloc(size_t size) {
+
+    void * ptr = (pt_arena != NULL ? hp_arena_alloc(pt_arena, size) : NULL);
+
+    return (ptr != NULL ? ptr : malloc(size));
+}
+
+void pt_fwd_mfree(void * ptr, size_t size) {
+
+    if (hp_arena_owns(pt_arena, ptr))
+        hp_arena_free(pt_arena, ptr, size);
+    else
+        free(ptr);
+}
 
 /*
  * \brief   returns whether or not bit i (starting
@@ -84,6 +123,150 @@ int pt_fwd_count(struct pt_fwd * t) {
     return pt_fwd_count_rec(t, -1);
 }
 
+/*
+ * \brief   heap bytes held by a block, incl. malloc() overhead. blocks out
+ *          of pt_arena count their requested size.
+ */
+static size_t pt_fwd_block_size(void * ptr, size_t size) {
+
+    if (ptr == NULL)
+        return 0;
+
+    if (hp_arena_owns(pt_arena, ptr))
+        return size;
+
+    return malloc_usable_size(ptr) + sizeof(size_t);
+}
+
+// size of the malloc() chunk which holds size byte
+static __inline size_t pt_fwd_chunk_size(size_t size) {
+
+    size = (size + sizeof(size_t) + 15) & ~((size_t) 15);
+
+    return (size < 32 ? 32 : size);
+}
+
+static void pt_fwd_prefix_memory_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        size_t * prefixes,
+        size_t * plain) {
+
+    if (t->key_bit <= key_bit) return;
+
+    *prefixes += pt_fwd_block_size(t->prefix_i, prefix_info_size(t->prefix_i));
+
+    // a prefix_info w/ a copy of the prefix string (the root had a
+    // PREFIX_MAX_LENGTH one)
+    *plain += pt_fwd_chunk_size(sizeof(char *) + sizeof(uint8_t))
+        + pt_fwd_chunk_size(t->key_bit == 0 ? PREFIX_MAX_LENGTH : prefix_info_str_size(t->prefix_i));
+
+    pt_fwd_prefix_memory_rec(t->p_left, t->key_bit, prefixes, plain);
+    pt_fwd_prefix_memory_rec(t->p_right, t->key_bit, prefixes, plain);
+}
+
+static size_t pt_fwd_memory_rec(struct pt_fwd * t, int key_bit) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    size_t memory = pt_fwd_block_size(t, sizeof(struct pt_fwd))
+        + pt_fwd_block_size(t->prefix_rid, sizeof(struct click_xia_xid))
+        + pt_fwd_block_size(t->prefix_i, prefix_info_size(t->prefix_i));
+
+    memory += pt_fwd_memory_rec(t->p_left,  t->key_bit);
+    memory += pt_fwd_memory_rec(t->p_right, t->key_bit);
+
+    return memory;
+}
+
+/*
+ * \brief   memory held by the trie of a FIB partition (nodes, RIDs and
+ *          prefix info, incl. prefix strings), in byte. other engines'
+ *          tables aren't counted.
+ */
+size_t pt_ht_partition_memory(struct pt_ht * s) {
+
+    return pt_fwd_memory_rec(s->trie, -1);
+}
+
+/*
+ * \brief   memory held by the tries of all partitions of a FIB, in byte.
+ *          the prefix dictionary shared by all FIBs isn't included (see
+ *          prefix_dict_memory()).
+ */
+size_t pt_ht_memory(struct pt_ht * fib) {
+
+    size_t memory = 0;
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        memory += pt_ht_partition_memory(itr);
+
+    return memory;
+}
+
+/*
+ * \brief   prints the memory held by a FIB, w/ prefix strings stored as
+ *          component IDs (see prefix_dict.h), vs. what plain heap copies of
+ *          the prefix strings would take instead.
+ */
+void pt_ht_print_memory(struct pt_ht * fib) {
+
+    size_t prefixes = 0, plain = 0;
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        pt_fwd_prefix_memory_rec(itr->trie, -1, &prefixes, &plain);
+
+    struct prefix_dict * dict = prefix_dict_default();
+
+    size_t total = pt_ht_memory(fib);
+    size_t dict_memory = prefix_dict_memory(dict);
+
+    printf("[fwd table build]: FIB memory: "\
+        "\n\t[TRIES]: %lu byte"\
+        "\n\t[PREFIX_IDS]: %lu byte"\
+        "\n\t[PREFIX_DICT]: %lu byte (%u components)"\
+        "\n\t[TOTAL]: %lu byte"\
+        "\n\t[TOTAL (PLAIN PREFIXES)]: %lu byte\n",
+        (unsigned long) (total - prefixes),
+        (unsigned long) prefixes,
+        (unsigned long) dict_memory, dict->num_strings,
+        (unsigned long) (total + dict_memory),
+        (unsigned long) (total - prefixes + plain));
+}
+
+static int pt_fwd_depth_hist_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        int depth,
+        uint32_t * hist,
+        int hist_size) {
+
+    if (t->key_bit <= key_bit) return -1;
+
+    hist[std::min(depth, hist_size - 1)]++;
+
+    return std::max(depth, std::max(
+        pt_fwd_depth_hist_rec(t->p_left, t->key_bit, depth + 1, hist, hist_size),
+        pt_fwd_depth_hist_rec(t->p_right, t->key_bit, depth + 1, hist, hist_size)));
+}
+
+/*
+ * \brief counts the nodes of a FIB subtree per depth (root at depth 0)
+ *
+ * \param   t           FIB subtree
+ * \param   hist        depth histogram, nodes deeper than hist_size - 1 are
+ *                      counted in hist[hist_size - 1]
+ * \param   hist_size   size of the hist array
+ *
+ * \return  max. depth of the subtree
+ */
+int pt_fwd_depth_hist(struct pt_fwd * t, uint32_t * hist, int hist_size) {
+
+    return pt_fwd_depth_hist_rec(t, -1, 0, hist, hist_size);
+}
+
 static int pt_ht_erase_rec(
     struct pt_fwd * t, 
     int key_bit) {
@@ -100,51 +283,70 @@ static int pt_ht_erase_rec(
 
     // 1) the prefix_info struct 1st
     prefix_info_erase(&(t->prefix_i));
-    free(t->prefix_i);
 
     // 2) prefix_rid
-    free(t->prefix_rid);
+    pt_fwd_mfree(t->prefix_rid, sizeof(struct click_xia_xid));
 
     count += pt_ht_erase_rec(t->p_left,  t->key_bit);
     count += pt_ht_erase_rec(t->p_right, t->key_bit);
 
     // finally, the pt_fwd * itself
     //printf("pt_ht_erase_rec() : free(t)\n");
-    free(t);
+    pt_fwd_mfree(t, sizeof(struct pt_fwd));
 
     return count;
 }
 
 /*
- * \brief   erases and frees the memory held by a complete RID FIB
+ * \brief   erases and frees the memory held by a single FIB partition (which
+ *          must not be in a FIB anymore)
  *
- * \param   fib the FIB to be freed
+ * \return  nr. of trie nodes freed
  */
-void pt_ht_erase(struct pt_ht * fib) {
+int pt_ht_erase_partition(struct pt_ht * s) {
 
-    struct pt_ht * itr;
-    int count;
+    int count = pt_ht_erase_rec(s->trie, -1);
 
-    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+    // printf("pt_ht_erase() : table for |F| = %d : \n", s->prefix_size);
+    // pt_fwd_print(s->trie, PRE_ORDER);
 
-        // printf("pt_ht_erase() : erasing for |F| = %d\n", 
-        //     itr->prefix_size);
-        count += pt_ht_erase_rec(itr->trie, -1);
+    // other engines built out of the trie
+    scan_fwd_erase(s->scan);
+    bs_fwd_erase(s->bs);
+    pt_dir_erase(s->dir);
+    mbt_fwd_erase(s->mbt);
+    pt_flat_erase(s->flat);
+    louds_fwd_erase(s->louds);
+    delete s->profile;
+
+    // erase the general stats struct from pt_ht
+    lookup_stats_erase(&(s->general_stats));
+    free(s->general_stats);
 
-        // printf("pt_ht_erase() : erasing for |F| = %d (%d)\n", 
-        //     itr->prefix_size,
-        //     pt_fwd_dummy(itr->trie, -1));
+    // finally free the pt_ht struct (a FIB subtree)
+    free(s);
 
-        // printf("pt_ht_erase() : table for |F| = %d : \n", itr->prefix_size);
-        // pt_fwd_print(itr->trie, PRE_ORDER);
+    return count;
+}
+
+/*
+ * \brief   erases and frees the memory held by a complete RID FIB
+ *
+ * \param   fib the FIB to be freed
+ */
+void pt_ht_erase(struct pt_ht * fib) {
+
+    struct pt_ht * itr, * tmp;
+    int count = 0;
+
+    HASH_ITER(hh, fib, itr, tmp) {
 
-        // erase the general stats struct from pt_ht
-        lookup_stats_erase(&(itr->general_stats));
-        free(itr->general_stats);
         // special deletion operation related to uthash
         HASH_DEL(fib, itr);
-        // finally free the pt_ht struct (a FIB subtree)
-        free(itr);
+
+        // printf("pt_ht_erase() : erasing for |F| = %d\n", 
+        //     itr->prefix_size);
+        count += pt_ht_erase_partition(itr);
     }
 
     printf("pt_ht_erase() : gone through %d prefixes\n", count);
@@ -191,16 +393,16 @@ void pt_ht_print_stats(struct pt_ht * fib, std::string output_dir) {
     std::string filename = output_dir + std::string("/") + std::string(DEFAULT_ENTRY_FILE);
     FILE * output_file = fopen(filename.c_str(), "wb");
     // write the first line
-    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tFEA\n");
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tFEA\tENGINE\n");
 
     // collect the stats (and print the fwd table stats while doing it)
     struct pt_ht * itr;
 
     printf(
             "\n-------------------------------------------------------------------------------\n"\
-            "%-12s\t| %-12s\t| %-12s\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\n"\
             "-------------------------------------------------------------------------------\n",
-            "|F|", "# ENTRIES", "AVG. FEA");
+            "|F|", "# ENTRIES", "AVG. FEA", "ENGINE");
 
     for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
 
@@ -236,17 +438,19 @@ void pt_ht_print_stats(struct pt_ht * fib, std::string output_dir) {
         total_sizes++;
 
         printf(
-            "%-12d\t| %-12d\t| %-.6f\n",
+            "%-12d\t| %-12d\t| %-.6f\t| %-12s\n",
             // ((itr->trie->p_left != NULL) ? itr->trie->p_left->prefix_size : itr->trie->p_right->prefix_size),
             itr->prefix_size,
             itr->num_entries,
-            itr->fea);
+            itr->fea,
+            PT_ENGINE_STRS[itr->engine]);
 
         fprintf(output_file, 
-            "%d\t%d\t%-.6f\n", 
+            "%d\t%d\t%-.6f\t%s\n", 
             itr->prefix_size, 
             itr->num_entries,
-            itr->fea);
+            itr->fea,
+            PT_ENGINE_STRS[itr->engine]);
     }
 
     printf(
@@ -447,16 +651,65 @@ struct pt_fwd * pt_fwd_insert(struct pt_fwd * n, struct pt_fwd * head) {
 }
 
 
+static void pt_fwd_free(void * node) {
+
+    struct pt_fwd * t = (struct pt_fwd *) node;
+
+    prefix_info_erase(&(t->prefix_i));
+    pt_fwd_mfree(t->prefix_rid, sizeof(struct click_xia_xid));
+    pt_fwd_mfree(t, sizeof(struct pt_fwd));
+}
+
+static void pt_fwd_free_shell(void * node) {
+
+    pt_fwd_mfree(node, sizeof(struct pt_fwd));
+}
+
+/*
+ * \brief frees a node unlinked from a trie, or retires it if there may be
+ * concurrent readers (see pt_rcu). if shell is 1, only the node itself goes
+ * away, its RID and prefix info live on in another node.
+ */
+static void pt_fwd_retire(struct pt_fwd * t, int shell) {
+
+    if (pt_rcu != NULL)
+        rcu_retire(pt_rcu, t, (shell ? pt_fwd_free_shell : pt_fwd_free));
+    else if (shell)
+        pt_fwd_free_shell(t);
+    else
+        pt_fwd_free(t);
+}
+
 /*
- * remove an entry given a key in a Patricia trie.
+ * \brief removes an entry given a key in a Patricia trie.
+ *
+ * the node which holds the key (t) isn't necessarily the one which goes
+ * away: the node which leads to t through an upward link (p) is the one
+ * taken out of the trie, and its entry (RID and prefix info) takes the place
+ * of t's. so that readers never see a node change under them (see pt_rcu),
+ * t isn't changed in place: a copy of t w/ p's entry (t') replaces it. the
+ * links are updated so that a concurrent lookup always sees every entry
+ * other than the removed one (p's entry may be seen twice, in t' and p):
+ *
+ *  -# the upward link to p (from pp) is re-directed to t'
+ *  -# the downward link to t (from its parent) is re-directed to t'
+ *  -# the link to p (from its parent, g) is re-directed to p's other child
+ *
+ * \arg rid     key of the entry to remove
+ * \arg prefix  prefix of the entry to remove. if not NULL, the entry is
+ *              only removed if it holds the same prefix (i.e. not a
+ *              different prefix w/ the same RID).
+ * \arg head    head of the patricia (sub-)trie
+ *
+ * \return      1 if the entry was removed, 0 if it wasn't found
  */
-int pt_fwd_remove(struct pt_fwd * n, struct pt_fwd * head) {
+int pt_fwd_remove(struct click_xia_xid * rid, char * prefix, struct pt_fwd * head) {
 
     // parent, grandparent, ...
-    struct pt_fwd *p, *g, *pt, *pp, *t = NULL;
+    struct pt_fwd *p, *g, *pt, *pp, *t, *tp;
     int i;
 
-    if (!n || !t)
+    if (!rid || !head)
         return 0;
 
     /*
@@ -470,14 +723,20 @@ int pt_fwd_remove(struct pt_fwd * n, struct pt_fwd * head) {
         i = t->key_bit;
         g = p;
         p = t;
-        t = bit(t->key_bit, n->prefix_rid) ? t->p_right : t->p_left;
+        t = bit(t->key_bit, rid) ? t->p_right : t->p_left;
 
     } while (i < t->key_bit);
 
     /*
      * For removal, we need an exact match.
      */
-    if (!(rid_compare(t->prefix_rid, n->prefix_rid)))
+    if (!(rid_compare(t->prefix_rid, rid)))
+        return 0;
+
+    char t_prefix[PREFIX_MAX_LENGTH];
+
+    if (prefix != NULL
+        && (prefix_info_str(t->prefix_i, t_prefix, PREFIX_MAX_LENGTH) < 0 || strcmp(t_prefix, prefix) != 0))
         return 0;
 
     /*
@@ -486,6 +745,22 @@ int pt_fwd_remove(struct pt_fwd * n, struct pt_fwd * head) {
     if (t->key_bit == 0)
         return 0;
 
+    // p's other child, which takes p's place under g
+    struct pt_fwd * s = bit(p->key_bit, rid) ? p->p_left : p->p_right;
+
+    if (t == p) {
+
+        // t has an upward link to itself: just take it out
+        if (bit(g->key_bit, rid))
+            rcu_assign_pointer(g->p_right, s);
+        else
+            rcu_assign_pointer(g->p_left, s);
+
+        pt_fwd_retire(t, 0);
+
+        return 1;
+    }
+
     /*
      * Search for the node that points to the parent, so
      * we can make sure it doesn't get lost.
@@ -500,30 +775,66 @@ int pt_fwd_remove(struct pt_fwd * n, struct pt_fwd * head) {
 
     } while (i < pt->key_bit);
 
-    if (bit(pp->key_bit, p->prefix_rid))
-        pp->p_right = t;
-    else
-        pp->p_left = t;
-
     /*
-     * Point the grandparent to the proper node.
+     * The parent of t, on the way down.
      */
-    if (bit(g->key_bit, n->prefix_rid))
-        g->p_right = bit(p->key_bit, n->prefix_rid) ?
-            p->p_left : p->p_right;
+    tp = pt = head;
+
+    while (pt != t) {
+
+        tp = pt;
+        pt = bit(pt->key_bit, rid) ? pt->p_right : pt->p_left;
+    }
+
+    struct pt_fwd * tc = (struct pt_fwd *) pt_fwd_malloc(sizeof(struct pt_fwd));
+
+    tc->fib_root = t->fib_root;
+    tc->key_bit = t->key_bit;
+    tc->prefix_rid = p->prefix_rid;
+    tc->prefix_i = p->prefix_i;
+    tc->prefix_fp = p->prefix_fp;
+    tc->port = p->port;
+    tc->prefix_size = p->prefix_size;
+    tc->p_left = t->p_left;
+    tc->p_right = t->p_right;
+
+    // if p has an upward link to itself, p's other child is that link
+    if (s == p)
+        s = tc;
+
+    // if t is p's parent, t' takes p out of the trie already
+    if (g == t) {
+
+        if (bit(t->key_bit, rid))
+            tc->p_right = s;
+        else
+            tc->p_left = s;
+    }
+
+    if (pp != p) {
+
+        if (bit(pp->key_bit, p->prefix_rid))
+            rcu_assign_pointer(pp->p_right, tc);
+        else
+            rcu_assign_pointer(pp->p_left, tc);
+    }
+
+    if (bit(tp->key_bit, rid))
+        rcu_assign_pointer(tp->p_right, tc);
     else
-        g->p_left = bit(p->key_bit, n->prefix_rid) ?
-            p->p_left : p->p_right;
+        rcu_assign_pointer(tp->p_left, tc);
 
-    /*
-     * Delete the target's data and copy in its parent's
-     * data, but not the bit value.
-     */
-    if (t != p) {
-        t->prefix_rid = p->prefix_rid;
+    if (g != t) {
+
+        if (bit(g->key_bit, rid))
+            rcu_assign_pointer(g->p_right, s);
+        else
+            rcu_assign_pointer(g->p_left, s);
     }
 
-    free(p);
+    // p's entry lives on in t'
+    pt_fwd_retire(t, 0);
+    pt_fwd_retire(p, 1);
 
     return 1;
 }
@@ -553,13 +864,9 @@ struct pt_fwd * pt_fwd_init(struct pt_ht * ht) {
 
     // initialize the struct lookup_stats * attribute w/ an empty
     // prefix string
-    struct prefix_info * pi = (struct prefix_info *) malloc(sizeof(struct prefix_info));
-    char * prefix = (char *) calloc(PREFIX_MAX_LENGTH, sizeof(char));
-
-    pi->prefix = prefix;
-    pi->prefix_size = 0;
-
-    root->prefix_i = pi;
+    prefix_info_init(&(root->prefix_i), (char *) "", 0);
+    root->prefix_fp = prefix_info_fp(root->prefix_i);
+    root->port = PT_PORT_NONE;
 
     // initialize the rest of the root's attributes and set it's pointers to
     // point to the root itself
@@ -612,295 +919,1837 @@ struct pt_fwd * pt_fwd_search(struct click_xia_xid * rid, struct pt_fwd * head)
     return (rid_compare(rid, t->prefix_rid) ? t : NULL);
 }
 
-int pt_ht_add(
-        struct pt_ht ** ht,
-        struct click_xia_xid * rid,
-        char * prefix,
-        int prefix_size) {
-
-    struct pt_ht * s;
-    struct pt_fwd * f = (struct pt_fwd *) malloc(sizeof(struct pt_fwd));
-
-    // FIXME: why do you always need to complicate things?
-    f->prefix_rid = (struct click_xia_xid *) malloc(sizeof(struct click_xia_xid));
-    memcpy(f->prefix_rid, rid, sizeof(struct click_xia_xid));
-    // f->prefix_rid = rid;
+/*
+ * \brief   re-builds the trie of a frozen FIB partition out of its flat trie.
+ */
+static void pt_ht_thaw_partition(struct pt_ht * s) {
 
-    f->prefix_size = prefix_size;
-    f->p_right = NULL;
-    f->p_left = NULL;
+    if (!(s->frozen))
+        return;
 
-    // for control purposes, we also create and fill a prefix_info struct
-    // and set f->prefix_i to point to it
-    f->prefix_i = (struct prefix_info *) malloc(sizeof(struct prefix_info));
-    prefix_info_init(&(f->prefix_i), prefix, prefix_size);
+    pt_flat_thaw(s->flat, s);
+    s->frozen = 0;
+}
 
-    HASH_FIND_INT(*ht, &prefix_size, s);
+/*
+ * \brief   training run for profile-guided flat trie layouts: looks up
+ *          requests in the partition tries (thawed if needed), counting
+ *          the visits to each node (see pt_ht.profile). flat tries made before are
+ *          re-made w/ the profile (PT_FLAT_LAYOUT_PROFILE), and so are the
+ *          ones made afterwards if pt_flat_layout is set to it. lookup stats
+ *          are reset afterwards.
+ */
+void pt_ht_profile(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num) {
 
-    if (s == NULL) {
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
 
-        s = (struct pt_ht *) malloc(sizeof(struct pt_ht));
+    struct pt_ht * itr;
 
-        s->prefix_size = prefix_size;
-        s->num_entries = 0;
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
 
-        // initialize the trie with a `all-zero' root
-        s->trie = pt_fwd_init(s);
+        pt_ht_thaw_partition(itr);
 
-        // FIXME: temporary hack to keep track of one more stat
-        s->fea = 0.0;
-        s->fea_n = 0;
+        delete itr->profile;
+        itr->profile = new PtProfile();
+        itr->profiling = 1;
 
-        s->general_stats = (struct lookup_stats *) malloc(sizeof(struct lookup_stats));
-        lookup_stats_init(&(s->general_stats), prefix, prefix_size);
+        for (int i = 0; i < requests_num; i++) {
 
-        if (!(s->trie)){
+            if (requests[i].size < itr->prefix_size)
+                continue;
 
-            //fprintf(stderr, "[fwd table build]: pt_fwd_init() failed\n");
+            pt_fwd_lookup(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+        }
 
-        } else {
+        itr->profiling = 0;
 
-            HASH_ADD_INT(*ht, prefix_size, s);
+        lookup_stats_reset(itr->general_stats);
 
-            // when inserting new elements in the HT, sort by prefix size
-            HASH_SORT(*ht, pt_ht_sort);
+        if (itr->flat != NULL) {
 
-            //printf("[fwd table build]: pt_fwd_init() successful\n");
+            pt_flat_erase(itr->flat);
+            itr->flat = pt_flat_init_layout(itr, PT_FLAT_LAYOUT_PROFILE);
         }
     }
+}
 
-    // set the pointer to root node of RID subtree
-    f->fib_root = s;
-
-    struct pt_fwd * srch = NULL;
-
-    if ((srch = pt_fwd_search(f->prefix_rid, s->trie)) != NULL) {
-
-        //printf("[fwd table build]: node with %s (vs. %s) exists!\n", f->stats->prefix, srch->stats->prefix);
-        prefix_info_erase(&(f->prefix_i));
-        free(f->prefix_i);
-        free(f->prefix_rid);
-        free(f);
+/*
+ * \brief   drops the visit counts of all FIB partitions
+ */
+void pt_ht_profile_clear(struct pt_ht * fib) {
 
-    } else {
+    struct pt_ht * itr;
 
-        if (!(pt_fwd_insert(f, s->trie))) {
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
 
-            printf("pt_fwd_insert() : ERROR pt_fwd_insert() failed\n");
-            
-            prefix_info_erase(&(f->prefix_i));
-            free(f->prefix_i);
-            free(f->prefix_rid);
-            free(f);
+        delete itr->profile;
+        itr->profile = NULL;
+    }
+}
 
-            return -1;
-        }
+/*
+ * \brief   re-builds the tries of all frozen FIB partitions (e.g. loaded from
+ *          a snapshot), so that these can be used as usual.
+ */
+void pt_ht_thaw(struct pt_ht * fib) {
 
-        s->num_entries++;
-    }
+    struct pt_ht * itr;
 
-    return 0;
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        pt_ht_thaw_partition(itr);
 }
 
 /*
- * \brief     longest prefix matching on a patricia trie, accounting for
- *             false positives
+ * \brief   builds the table of a lookup engine for a FIB partition, out of
+ *          the partition's trie (if not built already).
  *
- * the advantage of this scheme is a potential reduction in lookup time: while
- * in the LSHT scheme we have O(|R| * avg(|HT|)) expected time (we have to
- * lookup all HTs for which |F| \le |R|), which includes all cases - TPs, FPs
- * and TNs - with a PT of RIDs we avoid looking up entire sub-tries made up of
- * TNs.
- *
- * XXX: it would be interesting to quantify how much do we gain, but i don't
- * know how to estimate the number of TNs in this way...
- *
- * organizing the FIB in multiple PTs indexed by Hamming weight (HW) as in
- * Papalini et al. 2014 does not translate into longer prefix matches for
- * larger HWs: since bits in BFs can be overwritten during the encoding
- * operation, we can have situations in which HW(R1) > HW(R2) and |R1| < |R2|
- * (theoretical results in (...)). Therefore, an indication of the number of
- * prefixes (similar to that of a `mask') must always be present in the trie
- * nodes.
- *
- * \return
+ * \return  1 if the engine is ready to use, 0 otherwise
  */
-int pt_fwd_lookup(
-        struct pt_fwd * node,
-        char * request,
-        int request_size,
-        struct click_xia_xid * request_rid,
-        int prev_key_bit,
-        uint32_t * fp_sizes,
-        uint32_t * tp_sizes) {
+static int pt_ht_build_engine(struct pt_ht * s, int engine) {
 
-    if (node->key_bit <= prev_key_bit) {
-
-       // printf("pt_fwd_lookup(): going upwards for (R) %s (%d vs. %d)\n",
-       //         request,
-       //         node->key_bit,
-       //         prev_key_bit);
+    // all engines but the flat trie itself are built out of the trie
+    if (s->frozen && engine != PT_ENGINE_FLAT)
+        pt_ht_thaw_partition(s);
 
-        return 0;
-    }
+    if (engine == PT_ENGINE_SCAN) {
 
-    uint32_t _req_entry_diff = req_entry_diff(request, node->prefix_i->prefix, node->prefix_size);
+        if (!(s->scan))
+            s->scan = scan_fwd_init(s);
 
-    int tps = 0, fps = 0, tns = 0;
-    int matches = 0;
+        return (s->scan != NULL);
 
-    // XXX: when looking up a PT with FPs, we always follow the left branch,
-    // and selectively follow the right branch.
+    } else if (engine == PT_ENGINE_BITSLICE) {
 
-    // "why?", you ask...
+        if (!(s->bs))
+            s->bs = bs_fwd_init(s);
 
-    // going left means there's
-    // a '0' bit at position key_bit: it doesn't matter if it maps to a '0' or '1'
-    // in request, the matching test ((R & F) == F) won't be false because of
-    // this fact. going right means there's a '1' at position key_bit: if it maps
-    // to a '0' in request, then ((R & F) == F) will fail, and so we avoid
-    // traversing the right sub-trie.
+        return (s->bs != NULL);
 
-    // XXX: apply a mask to the key_bit leftmost bits of node and request, check if
-    // ((mask(request) & mask(prefix)) == mask(prefix)): if yes, follow the
-    // p_right branch, if not, avoid it.
-    if (rid_match_mask(request_rid, node->prefix_rid, node->key_bit)) {
+    } else if (engine == PT_ENGINE_DIR) {
 
-        // XXX: check for a match, now without masks on
-        // FIXME: note we're avoiding matches with the default route (or root
-        // node) by checking if node->prefix_size > 0
-        if (rid_match(request_rid, node->prefix_rid) && (node->prefix_size > 0)) {
+        if (!(s->dir))
+            s->dir = pt_dir_init(s, pt_dir_bits);
 
-            // TP or FP check: this requires the consultation of the backup
-            // char * on f->stats for substrings of request
-            //printf("%s vs. %s\n", node->prefix_i->prefix, request);
+        return (s->dir != NULL);
 
-            if (strstr(request, node->prefix_i->prefix) != NULL) {
+    } else if (engine == PT_ENGINE_MBT) {
 
-                // printf("pt_fwd_lookup(): TP %s\n", node->prefix_i->prefix);
+        if (!(s->mbt))
+            s->mbt = mbt_fwd_init(s);
 
-                tps = 1;
-                matches += tps;
+        return (s->mbt != NULL);
 
-            } else {
+    } else if (engine == PT_ENGINE_FLAT) {
 
-                fps = 1;
-                matches += fps;
+        if (!(s->flat))
+            s->flat = pt_flat_init(s);
 
-                // if (_req_entry_diff == 3 && (strlen(node->prefix_i->prefix) > 0))
-                //     printf("pt_fwd_lookup(): |F\\R| = %d for %s (R) vs. %s (F)\n", 
-                //         _req_entry_diff, request, node->prefix_i->prefix);
-            }
+        return (s->flat != NULL);
 
-        } else {
+    } else if (engine == PT_ENGINE_LOUDS) {
 
-            // TN check: directly maps to a simple pass or fail of a normal
-            // RID matching operation
-            tns = 1;
-            matches += tns;
-        }
+        if (!(s->louds))
+            s->louds = louds_fwd_init(s);
 
-        // if (fps > 0) {
+        return (s->louds != NULL);
+    }
 
-        //        char * p = (char *) calloc(CLICK_XIA_XID_ID_STR_LEN, sizeof(char));
-        //        char * r = (char *) calloc(CLICK_XIA_XID_ID_STR_LEN, sizeof(char));
+    // the trie is always there
+    return 1;
+}
 
-        //        printf("pt_fwd_lookup(): (R) %s vs. (P) %s\n", request, node->prefix_i->prefix);
-        //        printf("pt_fwd_lookup(): (R) %s vs. (P) %s\n",
-        //                extract_prefix_bytes(&r, request_rid, node->key_bit),
-        //                extract_prefix_bytes(&p, node->prefix_rid, node->key_bit));
+/*
+ * \brief   throws away the tables of all lookup engines of a FIB partition,
+ *          except those of engine keep.
+ */
+static void pt_ht_drop_engines(struct pt_ht * s, int keep) {
 
-        //        // free string memory
-        //        free(r);
-        //        free(p);
+    if (keep != PT_ENGINE_SCAN) {
+        scan_fwd_erase(s->scan);
+        s->scan = NULL;
+    }
 
-        //        printf("pt_fwd_lookup(): FP %s\n", node->prefix_i->prefix);
-        // }
+    if (keep != PT_ENGINE_BITSLICE) {
+        bs_fwd_erase(s->bs);
+        s->bs = NULL;
+    }
 
-        // FIXME: update the general statistics in the FIB root node. note that 
-        // this way the entry-specific stats are sort of useless.
-        lookup_stats_update(
-            &(node->fib_root->general_stats), 
-            _req_entry_diff, 
-            tps, fps, tns, 1);
-
-        if (node->prefix_size > 0) {
-            fp_sizes[node->prefix_size - 1] += fps;
-            tp_sizes[node->prefix_size - 1] += tps;
-        }
+    if (keep != PT_ENGINE_DIR) {
+        pt_dir_erase(s->dir);
+        s->dir = NULL;
+    }
 
-        if (tps > 1) {
+    if (keep != PT_ENGINE_MBT) {
+        mbt_fwd_erase(s->mbt);
+        s->mbt = NULL;
+    }
 
-            return matches;
-        }
+    if (keep != PT_ENGINE_LOUDS) {
+        louds_fwd_erase(s->louds);
+        s->louds = NULL;
+    }
 
-        matches += pt_fwd_lookup(node->p_right, request, request_size, request_rid, node->key_bit, fp_sizes, tp_sizes);
+    // a frozen partition's entries only live in the flat trie
+    if (keep != PT_ENGINE_FLAT && !(s->frozen)) {
+        pt_flat_erase(s->flat);
+        s->flat = NULL;
+    }
+}
+
+/*
+ * \brief   looks up an RID in a patricia trie and links a new node for it if
+ *          it isn't there yet, in a single pass.
+ *
+ * the search for the closest matching leaf node records the path taken:
+ * if the RID is new, insertR() would walk down the same path again (the
+ * branching decisions are the same) and stop at the 1st node w/ a key bit
+ * >= the 1st differing bit, or at an upward link. so we just pick the node
+ * out of the recorded path. the node, its RID and prefix info are only
+ * allocated if the RID is actually inserted.
+ *
+ * \param   s           FIB partition
+ * \param   rid         RID to look for
+ * \param   prefix      prefix encoded in rid (for TP stats tracking)
+ * \param   prefix_size nr. of prefixes encoded in rid
+ * \param   port        next hop of the new node
+ * \param   inserted    set to 1 if a new node was linked, 0 otherwise
+ *
+ * \return  the existing node or the newly linked one
+ */
+static struct pt_fwd * pt_fwd_insert_or_find(
+        struct pt_ht * s,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port,
+        int * inserted) {
+
+    // key bits strictly increase along the path, so it can't be longer
+    // than the nr. of RID bits (+ 1 for the head)
+    struct pt_fwd * path[PT_MAX_DEPTH + 1];
+    int path_len = 0, i = 0, j = 0;
+
+    struct pt_fwd * head = s->trie;
+    struct pt_fwd * t = head;
+
+    *inserted = 0;
+
+    /*
+     * find closest matching leaf node, recording the path.
+     */
+    do {
+
+        path[path_len++] = t;
+
+        i = t->key_bit;
+        t = bit(t->key_bit, rid) ? t->p_right : t->p_left;
+
+    } while (i < t->key_bit);
+
+    if (rid_compare(rid, t->prefix_rid))
+        return t;
+
+    /*
+     * find the first bit that differs.
+     */
+    for (i = 1; i < ((8 * CLICK_XIA_XID_ID_LEN) - 1) && (bit(i, rid) == bit(i, t->prefix_rid)); i++);
+
+    // insertion point: the 1st node after the head w/ key bit >= i. if
+    // there's none, it's the upward link at the end of the path.
+    for (j = 1; j < path_len && path[j]->key_bit < i; j++);
+
+    struct pt_fwd * p = path[j - 1];
+    struct pt_fwd * h = (bit(p->key_bit, rid) ? p->p_right : p->p_left);
+
+    // a real insert: only now allocate the node
+    struct pt_fwd * f = (struct pt_fwd *) pt_fwd_malloc(sizeof(struct pt_fwd));
+
+    // FIXME: why do you always need to complicate things?
+    f->prefix_rid = (struct click_xia_xid *) pt_fwd_malloc(sizeof(struct click_xia_xid));
+    memcpy(f->prefix_rid, rid, sizeof(struct click_xia_xid));
+
+    f->prefix_size = prefix_size;
+    f->fib_root = s;
+
+    // for control purposes, we also create and fill a prefix_info struct
+    // and set f->prefix_i to point to it
+    prefix_info_init(&(f->prefix_i), prefix, prefix_size);
+    f->prefix_fp = prefix_info_fp(f->prefix_i);
+    f->port = port;
+
+    // same linking as in insertR()
+    f->key_bit = i;
+    f->p_left = bit(i, rid) ? h : f;
+    f->p_right = bit(i, rid) ? f : h;
+
+    // f is only reachable (by concurrent readers) from here on
+    if (bit(p->key_bit, rid))
+        rcu_assign_pointer(p->p_right, f);
+    else
+        rcu_assign_pointer(p->p_left, f);
+
+    *inserted = 1;
+
+    return f;
+}
+
+/*
+ * \brief   allocates a FIB partition w/ an empty trie, not added to any FIB.
+ */
+struct pt_ht * pt_ht_partition_init(char * prefix, int prefix_size) {
+
+    struct pt_ht * s = (struct pt_ht *) malloc(sizeof(struct pt_ht));
+
+    s->prefix_size = prefix_size;
+    s->num_entries = 0;
+    s->num_dups = 0;
+
+    // initialize the trie with a `all-zero' root
+    s->trie = pt_fwd_init(s);
+
+    // PT lookups by default
+    s->engine = PT_ENGINE_PT;
+    s->scan = NULL;
+    s->bs = NULL;
+    s->dir = NULL;
+    s->mbt = NULL;
+    s->flat = NULL;
+    s->louds = NULL;
+    s->frozen = 0;
+    s->profile = NULL;
+    s->profiling = 0;
+
+    // FIXME: temporary hack to keep track of one more stat
+    s->fea = 0.0;
+    s->fea_n = 0;
+
+    s->general_stats = (struct lookup_stats *) malloc(sizeof(struct lookup_stats));
+    lookup_stats_init(&(s->general_stats), prefix, prefix_size);
+
+    return s;
+}
+
+/*
+ * \brief   deep copies a FIB partition (its trie and entry counts), e.g. to
+ *          update a copy of it while lookups go on in the original. the copy
+ *          isn't added to any FIB and starts w/ empty lookup stats.
+ */
+struct pt_ht * pt_ht_clone_partition(struct pt_ht * s) {
+
+    struct pt_ht * c = pt_ht_partition_init((char *) "", s->prefix_size);
+
+    // the flat trie has the same structure as the trie, so it's a handy
+    // intermediate form
+    struct pt_flat * flat = (s->flat ? s->flat : pt_flat_init(s));
+    pt_flat_thaw(flat, c);
+
+    if (flat != s->flat)
+        pt_flat_erase(flat);
+
+    c->num_entries = s->num_entries;
+    c->num_dups = s->num_dups;
+
+    return c;
+}
+
+/*
+ * \brief   finds the FIB partition for a prefix size, creating it (w/ an
+ *          empty trie) if it doesn't exist yet.
+ *
+ * \param   ht          the FIB
+ * \param   prefix      a prefix of size prefix_size (for the partition stats)
+ * \param   prefix_size prefix size of the partition
+ *
+ * \return  the partition, NULL if its trie couldn't be initialized
+ */
+struct pt_ht * pt_ht_get_partition(
+        struct pt_ht ** ht,
+        char * prefix,
+        int prefix_size) {
+
+    struct pt_ht * s;
+
+    HASH_FIND_INT(*ht, &prefix_size, s);
+
+    if (s == NULL) {
+
+        s = pt_ht_partition_init(prefix, prefix_size);
+
+        if (!(s->trie)){
+
+            //fprintf(stderr, "[fwd table build]: pt_fwd_init() failed\n");
+            return NULL;
+
+        } else {
+
+            HASH_ADD_INT(*ht, prefix_size, s);
+
+            // when inserting new elements in the HT, sort by prefix size
+            HASH_SORT(*ht, pt_ht_sort);
+
+            //printf("[fwd table build]: pt_fwd_init() successful\n");
+        }
+    }
+
+    return s;
+}
+
+/*
+ * \brief   adds an RID to a FIB partition (of the same prefix size).
+ *
+ * \param   port    next hop of the entry, PT_PORT_NONE if none
+ *
+ * \return  0 if the RID was added, 1 if it was already there
+ */
+int pt_ht_partition_add(
+        struct pt_ht * s,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port) {
+
+    // new entries go into the trie
+    pt_ht_thaw_partition(s);
+
+    int inserted = 0;
+
+    pt_fwd_insert_or_find(s, rid, prefix, prefix_size, port, &inserted);
+
+    if (!inserted) {
+
+        //printf("[fwd table build]: node with %s exists!\n", prefix);
+        s->num_dups++;
+
+        return 1;
+    }
+
+    s->num_entries++;
+
+    // other engines are now out-of-date: fall back to the trie
+    pt_ht_drop_engines(s, PT_ENGINE_PT);
+    s->engine = PT_ENGINE_PT;
+
+    if (pt_cache != NULL)
+        rid_cache_invalidate(pt_cache);
+
+    return 0;
+}
+
+/*
+ * \brief   removes an RID from a FIB partition.
+ *
+ * \param   prefix  if not NULL, the entry is only removed if it holds the
+ *                  same prefix (see pt_fwd_remove())
+ *
+ * \return  0 if the RID was removed, 1 if it wasn't in the partition
+ */
+int pt_ht_partition_remove(
+        struct pt_ht * s,
+        struct click_xia_xid * rid,
+        char * prefix) {
+
+    pt_ht_thaw_partition(s);
+
+    if (!pt_fwd_remove(rid, prefix, s->trie))
+        return 1;
+
+    s->num_entries--;
+
+    // other engines are now out-of-date: fall back to the trie
+    pt_ht_drop_engines(s, PT_ENGINE_PT);
+    s->engine = PT_ENGINE_PT;
+
+    if (pt_cache != NULL)
+        rid_cache_invalidate(pt_cache);
+
+    // free the nodes no reader can reach anymore
+    if (pt_rcu != NULL)
+        rcu_reclaim(pt_rcu);
+
+    return 0;
+}
+
+/*
+ * \brief   adds an RID (and the prefix it encodes) to the FIB partition of
+ *          its prefix size. duplicate RIDs are counted and ignored.
+ *
+ * \param   port    next hop of the entry, PT_PORT_NONE if none
+ *
+ * \return  0 if the RID was added, 1 if it was a duplicate, -1 on error
+ */
+int pt_ht_add(
+        struct pt_ht ** ht,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port) {
+
+    struct pt_ht * s = pt_ht_get_partition(ht, prefix, prefix_size);
+
+    if (!s) {
+
+        printf("pt_ht_add() : ERROR no trie for prefix size %d\n", prefix_size);
+        return -1;
+    }
+
+    return pt_ht_partition_add(s, rid, prefix, prefix_size, port);
+}
+
+/*
+ * \brief   removes an RID from the FIB partition of its prefix size.
+ *
+ * \param   prefix  if not NULL, the entry is only removed if it holds the
+ *                  same prefix (see pt_fwd_remove())
+ *
+ * \return  0 if the RID was removed, 1 if it wasn't in the FIB
+ */
+int pt_ht_remove(
+        struct pt_ht * ht,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size) {
+
+    struct pt_ht * s = pt_ht_search(ht, prefix_size);
+
+    if (!s)
+        return 1;
+
+    return pt_ht_partition_remove(s, rid, prefix);
+}
+
+/*
+ * \brief   turns a URL into an RID, w/ the same normalization as when
+ *          building the FIB from a URL file (trailing '/' removed).
+ *
+ * \return  the prefix size, -1 if the URL can't be added to a FIB
+ */
+int pt_ht_url_to_rid(
+        char * url,
+        char * prefix,
+        struct click_xia_xid * rid,
+        struct rid_perm * perm) {
+
+    int len = strlen(url);
+
+    if (len == 0 || url[0] == '/' || len >= (PREFIX_MAX_LENGTH * 0.75))
+        return -1;
+
+    memcpy(prefix, url, len + 1);
+
+    if (prefix[len - 1] == '/')
+        prefix[--len] = '\0';
+
+    if (std::count(prefix, prefix + len, '/') + 1 > MAX_PREFIX_SIZE)
+        return -1;
+
+    memset(rid, 0, sizeof(struct click_xia_xid));
+    int prefix_size = name_to_rid(&rid, prefix);
+
+    if (prefix_size < 1)
+        return -1;
+
+    if (perm != NULL)
+        rid_perm_apply(perm, rid);
+
+    return prefix_size;
+}
+
+/*
+ * \brief   adds a URL to the FIB (online update).
+ *
+ * \param   perm    the bit permutation applied to the FIB's RIDs (see
+ *                  bit_order.h), NULL if none
+ *
+ * \return  0 if the URL was added, 1 if its RID was in the FIB already, -1
+ *          if the URL is invalid
+ */
+int pt_ht_add_url(struct pt_ht ** ht, char * url, struct rid_perm * perm) {
+
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+
+    int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, perm);
+
+    if (prefix_size < 0)
+        return -1;
+
+    return pt_ht_add(ht, &rid, prefix, prefix_size, PT_PORT_NONE);
+}
+
+/*
+ * \brief   removes a URL from the FIB (online update). the entry w/ the URL's
+ *          RID is only removed if it was added for the same URL.
+ *
+ * \return  0 if the URL was removed, 1 if it wasn't in the FIB, -1 if the
+ *          URL is invalid
+ */
+int pt_ht_remove_url(struct pt_ht * ht, char * url, struct rid_perm * perm) {
+
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+
+    int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, perm);
+
+    if (prefix_size < 0)
+        return -1;
+
+    return pt_ht_remove(ht, &rid, prefix, prefix_size);
+}
+
+/*
+ * \brief     longest prefix matching on a patricia trie, accounting for
+ *             false positives
+ *
+ * the advantage of this scheme is a potential reduction in lookup time: while
+ * in the LSHT scheme we have O(|R| * avg(|HT|)) expected time (we have to
+ * lookup all HTs for which |F| \le |R|), which includes all cases - TPs, FPs
+ * and TNs - with a PT of RIDs we avoid looking up entire sub-tries made up of
+ * TNs.
+ *
+ * XXX: it would be interesting to quantify how much do we gain, but i don't
+ * know how to estimate the number of TNs in this way...
+ *
+ * organizing the FIB in multiple PTs indexed by Hamming weight (HW) as in
+ * Papalini et al. 2014 does not translate into longer prefix matches for
+ * larger HWs: since bits in BFs can be overwritten during the encoding
+ * operation, we can have situations in which HW(R1) > HW(R2) and |R1| < |R2|
+ * (theoretical results in (...)). Therefore, an indication of the number of
+ * prefixes (similar to that of a `mask') must always be present in the trie
+ * nodes.
+ *
+ * what's done w/ visited nodes and matches is up to the Stats policy (see
+ * pt_fwd_full_stats and pt_fwd_no_stats below), so that forwarding can be
+ * timed w/o the measurement overhead.
+ *
+ * \return  nr. of visited nodes (so far)
+ */
+template <class Stats>
+static int pt_fwd_lookup_rec(
+        struct pt_fwd * node,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        Stats & stats) {
+
+    if (node->key_bit <= prev_key_bit || stats.stop()) {
+
+       // printf("pt_fwd_lookup(): going upwards (%d vs. %d)\n",
+       //         node->key_bit,
+       //         prev_key_bit);
+
+        return stats.visits;
+    }
+
+    stats.visit(node);
+
+    // XXX: when looking up a PT with FPs, we always follow the left branch,
+    // and selectively follow the right branch.
+
+    // "why?", you ask...
+
+    // going left means there's
+    // a '0' bit at position key_bit: it doesn't matter if it maps to a '0' or '1'
+    // in request, the matching test ((R & F) == F) won't be false because of
+    // this fact. going right means there's a '1' at position key_bit: if it maps
+    // to a '0' in request, then ((R & F) == F) will fail, and so we avoid
+    // traversing the right sub-trie.
+
+    // XXX: apply a mask to the key_bit leftmost bits of node and request, check if
+    // ((mask(request) & mask(prefix)) == mask(prefix)): if yes, follow the
+    // p_right branch, if not, avoid it.
+    if (rid_match_mask(request_rid, node->prefix_rid, node->key_bit)) {
+
+        // XXX: check for a match, now without masks on
+        // FIXME: note we're avoiding matches with the default route (or root
+        // node) by checking if node->prefix_size > 0
+        if (rid_match(request_rid, node->prefix_rid) && (node->prefix_size > 0))
+            stats.match(node);
+        else
+            stats.no_match(node);
+
+        pt_fwd_lookup_rec(rcu_dereference(node->p_right), request_rid, node->key_bit, stats);
+
+    } else {
+
+        stats.no_match(node);
+    }
+
+    pt_fwd_lookup_rec(rcu_dereference(node->p_left), request_rid, node->key_bit, stats);
+
+    return stats.visits;
+}
+
+/*
+ * \brief   stats policy of pt_fwd_lookup_rec() for pt_fwd_lookup(): TP / FP
+ *          classification, |F\R| counts, partition stats and profile
+ *          counts, i.e. the simulation's output.
+ */
+struct pt_fwd_full_stats {
+
+    struct prefix_req * req;
+    uint32_t * fp_sizes;
+    uint32_t * tp_sizes;
+
+    // next hops of the matches (TPs and FPs alike), if not NULL
+    struct pt_port_set * ports;
+
+    uint32_t req_entry_diff;
+    int visits;
+
+    __inline void visit(struct pt_fwd * node) {
+
+        // training run for a profile-guided layout (see pt_ht_profile())
+        if (node->fib_root->profiling)
+            (*(node->fib_root->profile))[node]++;
+
+        req_entry_diff = (prefix_classify != PREFIX_CLASSIFY_NONE ?
+            prefix_info_diff(node->prefix_i, node->prefix_fp, req, node->prefix_size) : 0);
+
+        visits++;
+    }
+
+    __inline void match(struct pt_fwd * node) {
+
+        // TP or FP check: this requires the consultation of the prefix
+        // (see prefix_dict.h) for substrings of request
+        int tp = (prefix_classify == PREFIX_CLASSIFY_NONE || prefix_info_match(node->prefix_i, req));
+
+        // FIXME: update the general statistics in the FIB root node. note that 
+        // this way the entry-specific stats are sort of useless.
+        lookup_stats_update(&(node->fib_root->general_stats), req_entry_diff, tp, !tp, 0, 1);
+
+        tp_sizes[node->prefix_size - 1] += tp;
+        fp_sizes[node->prefix_size - 1] += !tp;
+
+        if (ports != NULL)
+            pt_port_set_add(ports, node->port);
+    }
+
+    __inline void no_match(struct pt_fwd * node) {
+
+        // TN check: directly maps to a simple pass or fail of a normal
+        // RID matching operation
+        lookup_stats_update(&(node->fib_root->general_stats), req_entry_diff, 0, 0, 1, 1);
+    }
+
+    __inline int stop() { return 0; }
+};
+
+/*
+ * \brief   stats policy of pt_fwd_lookup_rec() for pt_fwd_lookup_fast():
+ *          only the match set, i.e. what forwarding needs.
+ */
+struct pt_fwd_no_stats {
+
+    struct pt_match_set * matches;
+    int visits;
+
+    __inline void visit(struct pt_fwd * node) {
+
+        visits++;
+    }
+
+    __inline void match(struct pt_fwd * node) {
+
+        matches->sizes[node->prefix_size - 1]++;
+
+        if (matches->num_entries < PT_MATCH_SET_MAX)
+            matches->entries[matches->num_entries] = node;
+
+        matches->num_entries++;
+        pt_port_set_add(&(matches->ports), node->port);
+    }
+
+    __inline void no_match(struct pt_fwd * node) { }
+
+    __inline int stop() { return 0; }
+};
+
+/*
+ * \brief   stats policy of pt_fwd_lookup_rec() for pt_fwd_lookup_first():
+ *          the traversal stops at the 1st confirmed match, i.e. a TP if req
+ *          is set, any RID match otherwise.
+ */
+struct pt_fwd_first_match {
+
+    struct prefix_req * req;
+    struct pt_fwd * first;
+    int visits;
+
+    __inline void visit(struct pt_fwd * node) {
+
+        visits++;
+    }
+
+    __inline void match(struct pt_fwd * node) {
+
+        if (req == NULL || prefix_info_match(node->prefix_i, req))
+            first = node;
+    }
+
+    __inline void no_match(struct pt_fwd * node) { }
+
+    __inline int stop() { return (first != NULL); }
+};
+
+/*
+ * \brief   looks up a request in a (sub-)trie, see pt_fwd_lookup_rec(). the
+ *          request is split in components for the TP and |F\R| checks once,
+ *          here (see prefix_dict.h).
+ *
+ * \return  nr. of visited nodes
+ */
+int pt_fwd_lookup(
+        struct pt_fwd * node,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes) {
+
+    return pt_fwd_lookup_ports(node, request, request_size, request_rid, prev_key_bit, fp_sizes, tp_sizes, NULL);
+}
+
+/*
+ * \brief   same as pt_fwd_lookup(), but the next hops of all matches are
+ *          also added to a port set.
+ *
+ * \param   ports   port set (see pt_port_set_clear()), NULL if not needed
+ *
+ * \return  nr. of visited nodes
+ */
+int pt_fwd_lookup_ports(
+        struct pt_fwd * node,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports) {
+
+    if (node->key_bit <= prev_key_bit)
+        return 0;
+
+    struct prefix_req req;
+
+    if (prefix_classify != PREFIX_CLASSIFY_NONE)
+        prefix_req_init(&req, request);
+
+    return pt_fwd_lookup_req(node, &req, request_rid, prev_key_bit, fp_sizes, tp_sizes, ports);
+}
+
+/*
+ * \brief   same as pt_fwd_lookup_ports(), w/ a request already split in 
+ *          components, e.g. once for all partitions of a FIB.
+ *
+ * \param   req     the request's components (see prefix_req_init()), 
+ *                  unused (and possibly not initialized) w/ 
+ *                  PREFIX_CLASSIFY_NONE
+ *
+ * \return  nr. of visited nodes
+ */
+int pt_fwd_lookup_req(
+        struct pt_fwd * node,
+        struct prefix_req * req,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports) {
+
+    if (node->key_bit <= prev_key_bit)
+        return 0;
+
+    struct pt_fwd_full_stats stats = { req, fp_sizes, tp_sizes, ports, 0, 0 };
+
+    return pt_fwd_lookup_rec(node, request_rid, prev_key_bit, stats);
+}
+
+/*
+ * \brief   stats-free lookup of a request in a (sub-)trie: same traversal as
+ *          pt_fwd_lookup(), but neither TPs / FPs nor partition stats are
+ *          worked out. matches are added to a match set (see
+ *          pt_match_set_init()).
+ *
+ * \return  nr. of visited nodes
+ */
+int pt_fwd_lookup_fast(
+        struct pt_fwd * node,
+        struct click_xia_xid * request_rid,
+        int prev_key_bit,
+        struct pt_match_set * matches) {
+
+    struct pt_fwd_no_stats stats = { matches, 0 };
+
+    return pt_fwd_lookup_rec(node, request_rid, prev_key_bit, stats);
+}
+
+/*
+ * \brief   looks up a request in a (sub-)trie until the 1st confirmed match
+ *          (no stats are updated).
+ *
+ * \param   req     the request's components (see prefix_req_init()), for
+ *                  TP checks. if NULL, RID matches are trusted as they are.
+ * \param   visits  set to the nr. of visited nodes, if not NULL
+ *
+ * \return  the 1st confirmed match, NULL if none
+ */
+struct pt_fwd * pt_fwd_lookup_first(
+        struct pt_fwd * node,
+        struct click_xia_xid * request_rid,
+        struct prefix_req * req,
+        int prev_key_bit,
+        int * visits) {
+
+    struct pt_fwd_first_match stats = { req, NULL, 0 };
+
+    pt_fwd_lookup_rec(node, request_rid, prev_key_bit, stats);
+
+    if (visits != NULL)
+        *visits = stats.visits;
+
+    return stats.first;
+}
+
+/*
+ * \brief   longest prefix match (LPM) forwarding: the partitions are
+ *          searched from the largest prefix size |F| <= |R| downwards, and
+ *          the search stops at the 1st confirmed match. no stats are
+ *          updated. flat trie partitions (e.g. frozen ones, loaded from a
+ *          snapshot) are searched as they are (see pt_flat_lookup_first()),
+ *          all others in their tries.
+ *
+ * \param   verify      if 1, RID matches are confirmed against the request
+ *                      name (i.e. only TPs count), otherwise any RID match
+ *                      is trusted
+ * \param   next_hop    set to the port of the match (PT_PORT_NONE if none),
+ *                      if not NULL
+ * \param   partitions  set to the nr. of partitions searched, if not NULL
+ *
+ * \return  the prefix size of the longest (confirmed) match, 0 if none
+ */
+int pt_ht_lookup_lpm(
+        struct pt_ht * fib,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int verify,
+        uint16_t * next_hop,
+        int * partitions) {
+
+    struct pt_ht * s = NULL, * itr = NULL;
+    struct prefix_req req;
+    int prefix_size = request_size, searched = 0, match_size = 0, req_ready = 0;
+    uint16_t port = PT_PORT_NONE;
+
+    while ((s == NULL) && prefix_size > 0)
+        s = pt_ht_search(fib, prefix_size--);
+
+    // partitions are sorted by prefix size (see pt_ht_sort())
+    for (itr = s; itr != NULL && match_size == 0; itr = (struct pt_ht *) itr->hh.prev) {
+
+        searched++;
+
+        if (itr->engine == PT_ENGINE_FLAT) {
+
+            struct pt_flat_node * match = pt_flat_lookup_first(itr->flat, (verify ? request : NULL), request_rid, NULL);
+
+            if (match != NULL) {
+                match_size = itr->prefix_size;
+                port = match->port;
+            }
+
+            continue;
+        }
+
+        // the request is split in components only if a trie needs it
+        if (verify && !req_ready) {
+            prefix_req_init(&req, request);
+            req_ready = 1;
+        }
+
+        struct pt_fwd * match = pt_fwd_lookup_first(rcu_dereference(itr->trie), request_rid, (verify ? &req : NULL), -1, NULL);
+
+        if (match != NULL) {
+            match_size = match->prefix_size;
+            port = match->port;
+        }
+    }
+
+    if (next_hop != NULL)
+        *next_hop = port;
+
+    if (partitions != NULL)
+        *partitions = searched;
+
+    return match_size;
+}
+
+/*
+ * \brief   next hop of a request, i.e. the port of its longest (confirmed)
+ *          match (see pt_ht_lookup_lpm()). if pt_cache is set, next hops w/
+ *          name checks (verify = 1) go through it (see rid_cache.h).
+ *
+ * \param   reader  the caller's EBR reader, as in pt_ht_lookup()
+ *
+ * \return  the next hop, PT_PORT_NONE if there's no match or the match has
+ *          no next hop
+ */
+uint16_t pt_ht_next_hop(
+        struct pt_ht * fib,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        int verify,
+        int reader) {
+
+    // only confirmed matches are cached
+    struct rid_cache * cache = (verify ? pt_cache : NULL);
+    struct rid_cache_result result;
+    uint64_t generation = 0;
+
+    if (cache != NULL) {
+
+        if (rid_cache_lookup(cache, request, request_rid, request_size, RID_CACHE_LPM, &result))
+            return result.next_hop;
+
+        generation = rid_cache_generation(cache);
+    }
+
+    uint16_t next_hop = PT_PORT_NONE;
+
+    if (pt_rcu != NULL && reader != PT_READER_NONE)
+        rcu_read_lock(pt_rcu, reader);
+
+    int lpm_size = pt_ht_lookup_lpm(fib, request, request_size, request_rid, verify, &next_hop, NULL);
+
+    if (pt_rcu != NULL && reader != PT_READER_NONE)
+        rcu_read_unlock(pt_rcu, reader);
+
+    if (cache != NULL) {
+
+        memset(&result, 0, sizeof(struct rid_cache_result));
+        result.parts = RID_CACHE_LPM;
+        result.lpm_size = lpm_size;
+        result.next_hop = next_hop;
+
+        rid_cache_insert(cache, request, request_rid, request_size, &result, generation);
+    }
+
+    return next_hop;
+}
+
+/*
+ * \brief   looks up a request in a single FIB partition, w/ the partition's
+ *          engine.
+ *
+ * \param   ports   if not NULL, the next hops of the matches are added to it
+ *                  (w/ any engine).
+ * \param   req     the request, split in components (see prefix_req_init()),
+ *                  for the PT and DIR engines. if NULL, it's split here.
+ */
+void pt_ht_lookup_partition(
+        struct pt_ht * partition,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct prefix_req * req) {
+
+    if (partition->engine == PT_ENGINE_SCAN) {
+
+        scan_fwd_lookup(
+            partition->scan,
+            request,
+            request_rid,
+            fp_sizes,
+            tp_sizes,
+            ports,
+            partition->general_stats);
+
+    } else if (partition->engine == PT_ENGINE_BITSLICE) {
+
+        bs_fwd_lookup(
+            partition->bs,
+            request,
+            request_rid,
+            fp_sizes,
+            tp_sizes,
+            ports,
+            partition->general_stats);
+
+    } else if (partition->engine == PT_ENGINE_DIR) {
+
+        pt_dir_lookup(
+            partition->dir,
+            request,
+            request_size,
+            request_rid,
+            fp_sizes,
+            tp_sizes,
+            ports,
+            req);
+
+    } else if (partition->engine == PT_ENGINE_MBT) {
+
+        mbt_fwd_lookup(
+            partition->mbt,
+            request,
+            request_rid,
+            fp_sizes,
+            tp_sizes,
+            ports,
+            partition->general_stats);
+
+    } else if (partition->engine == PT_ENGINE_FLAT) {
+
+        pt_flat_lookup(
+            partition->flat,
+            request,
+            request_size,
+            request_rid,
+            fp_sizes,
+            tp_sizes,
+            ports);
+
+    } else if (partition->engine == PT_ENGINE_LOUDS) {
+
+        louds_fwd_lookup(
+            partition->louds,
+            request,
+            request_size,
+            request_rid,
+            fp_sizes,
+            tp_sizes,
+            ports);
+
+    } else if (req != NULL) {
+
+        pt_fwd_lookup_req(
+            rcu_dereference(partition->trie), 
+            req, 
+            request_rid, 
+            -1, 
+            fp_sizes, 
+            tp_sizes,
+            ports);
+
+    } else {
+
+        pt_fwd_lookup_ports(
+            rcu_dereference(partition->trie), 
+            request, 
+            request_size, 
+            request_rid, 
+            -1, 
+            fp_sizes, 
+            tp_sizes,
+            ports);
+    }
+}
+
+/*
+ * \brief thread function, wrapper for the recursive pt_fwd_lookup() function
+ *
+ * updates the request's counter of pending partition lookups (pending), 
+ * which determines when the lookup for a given prefix size is over.
+ * 
+ * \return
+ */
+void pt_fwd_lookup_thread(void * t_args) {
+
+    struct pt_fwd_lookup_tdata * t_data = (pt_fwd_lookup_tdata *) t_args;
+    struct prefix_req req;
+
+    // the request's memo is written during lookups, so each thread gets its
+    // own copy of the request's components
+    if (t_data->req != NULL)
+        prefix_req_copy(&req, t_data->req);
+
+    pt_ht_lookup_partition(
+        t_data->node->fib_root,
+        t_data->request,
+        t_data->request_size,
+        t_data->request_rid,
+        t_data->fp_sizes,
+        t_data->tp_sizes,
+        (t_data->collect_ports ? &(t_data->ports) : NULL),
+        (t_data->req != NULL ? &req : NULL));
+
+    __atomic_sub_fetch(t_data->pending, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * \brief   sets the lookup engine of all FIB partitions, building the 
+ *          respective engine tables out of the partition tries
+ *
+ * \param   fib     the FIB
+ * \param   engine  one of PT_ENGINE_PT, PT_ENGINE_SCAN, PT_ENGINE_BITSLICE,
+ *                  PT_ENGINE_DIR (w/ pt_dir_bits directory bits),
+ *                  PT_ENGINE_MBT, PT_ENGINE_FLAT or PT_ENGINE_LOUDS
+ */
+void pt_ht_set_engine(struct pt_ht * fib, int engine) {
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        itr->engine = (pt_ht_build_engine(itr, engine) ? engine : PT_ENGINE_PT);
+        pt_ht_drop_engines(itr, itr->engine);
+    }
+}
+
+static int pt_fwd_collect_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct pt_fwd ** nodes,
+        int n) {
+
+    if (t->key_bit <= key_bit) return n;
+
+    // the root node (default route) is kept as is
+    if (t->prefix_size > 0)
+        nodes[n++] = t;
+
+    n = pt_fwd_collect_rec(t->p_left, t->key_bit, nodes, n);
+    n = pt_fwd_collect_rec(t->p_right, t->key_bit, nodes, n);
+
+    return n;
+}
+
+/*
+ * \brief   applies a bit permutation to all RIDs stored in a FIB, re-building
+ *          the partition tries in the new bit order. the nodes are re-linked,
+ *          not re-allocated. the tables of other engines are re-built as well.
+ *
+ * XXX: requests looked up in this FIB must be permuted w/ rid_perm_apply()
+ * from now on.
+ *
+ * \param   fib     the FIB
+ * \param   perm    the bit permutation (see bit_order.h)
+ */
+void pt_ht_permute(struct pt_ht * fib, struct rid_perm * perm) {
+
+    struct pt_ht * itr;
+    int i = 0, n = 0;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        pt_ht_thaw_partition(itr);
+
+        struct pt_fwd ** nodes = (struct pt_fwd **) calloc(itr->num_entries + 1, sizeof(struct pt_fwd *));
+        n = pt_fwd_collect_rec(itr->trie, -1, nodes, 0);
+
+        // the root is all-zero: reset it to an empty trie
+        itr->trie->key_bit = 0;
+        itr->trie->p_left = itr->trie->p_right = itr->trie;
+
+        for (i = 0; i < n; i++) {
+
+            rid_perm_apply(perm, nodes[i]->prefix_rid);
+            nodes[i]->p_left = nodes[i]->p_right = NULL;
+
+            pt_fwd_insert(nodes[i], itr->trie);
+        }
+
+        free(nodes);
+
+        // other engines are now out-of-date
+        pt_ht_drop_engines(itr, PT_ENGINE_PT);
+
+        if (!pt_ht_build_engine(itr, itr->engine))
+            itr->engine = PT_ENGINE_PT;
+    }
+
+    // cached results are keyed by the unpermuted RIDs
+    if (pt_cache != NULL)
+        rid_cache_invalidate(pt_cache);
+}
+
+/*
+ * \brief   collects the prefixes of all entries in a FIB (frozen partitions
+ *          are thawed first).
+ */
+void pt_ht_get_prefixes(struct pt_ht * fib, std::vector<std::string> & prefixes) {
+
+    struct pt_ht * itr;
+    int i = 0, n = 0;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        pt_ht_thaw_partition(itr);
+
+        struct pt_fwd ** nodes = (struct pt_fwd **) calloc(itr->num_entries + 1, sizeof(struct pt_fwd *));
+        n = pt_fwd_collect_rec(itr->trie, -1, nodes, 0);
+
+        char prefix[PREFIX_MAX_LENGTH];
+
+        for (i = 0; i < n; i++)
+            if (prefix_info_str(nodes[i]->prefix_i, prefix, PREFIX_MAX_LENGTH) >= 0)
+                prefixes.push_back(std::string(prefix));
+
+        free(nodes);
+    }
+}
 
-    } else {
+/*
+ * \brief   checks if the entry counts of the FIB partitions match the nr. of
+ *          entries in their tries (e.g. after a stream of updates).
+ *
+ * \return  1 if all counts match, 0 otherwise
+ */
+int pt_ht_check(struct pt_ht * fib) {
+
+    struct pt_ht * itr;
+    int ok = 1;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        // the entries of a frozen partition are counted in its flat trie
+        uint32_t count = (itr->frozen ? itr->flat->num_nodes : pt_fwd_count(itr->trie)) - 1;
+
+        if (count != itr->num_entries) {
+
+            fprintf(stderr, "pt_ht_check() : [ERROR] |F| = %d : %d entries in trie, %d in count\n",
+                itr->prefix_size, count, itr->num_entries);
+
+            ok = 0;
+        }
+    }
+
+    return ok;
+}
+
+/*
+ * \brief   share of PT lookup time which goes into classification (TP
+ *          checks and |F\R| counts), per classification mode (see
+ *          prefix_dict.h). requests are split in components once and 
+ *          looked up on the partition tries directly, w/o threads. results
+ *          go to
+ *          <output_dir>/classify-bench.tsv.
+ *
+ * XXX: the partition stats are reset by this function, so call it AFTER
+ * pt_ht_print_stats().
+ */
+void pt_ht_classify_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    struct prefix_req req;
+
+    double times[PREFIX_CLASSIFY_MODES] = {0.0};
+    uint64_t tps[PREFIX_CLASSIFY_MODES] = {0}, fps[PREFIX_CLASSIFY_MODES] = {0};
+    int classify = prefix_classify;
+    int mode = 0, i = 0, k = 0, round = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_CLASSIFY_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "pt_ht_classify_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    struct pt_ht * itr;
+
+    // 1st round warms up the caches and isn't counted. the modes take turns
+    // over the other rounds, and the fastest round of each mode is kept.
+    for (round = 0; round < PT_CLASSIFY_BENCH_ROUNDS; round++) {
+
+        for (mode = 0; mode < PREFIX_CLASSIFY_MODES; mode++) {
+
+            prefix_classify = mode;
+            double begin = get_time_now();
+
+            for (i = 0; i < requests_num; i++) {
+
+                // once per request, as in pt_ht_lookup()
+                if (mode != PREFIX_CLASSIFY_NONE)
+                    prefix_req_init(&req, requests[i].name);
+
+                for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+                    if (requests[i].size < itr->prefix_size)
+                        continue;
+
+                    pt_fwd_lookup_req(itr->trie, &req, requests[i].rid, -1, fp_sizes, tp_sizes, NULL);
+                }
+            }
+
+            double time = get_time_now() - begin;
+
+            if (round > 0 && (round == 1 || time < times[mode]))
+                times[mode] = time;
+
+            for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+
+                if (round == 1) {
+                    tps[mode] += tp_sizes[k];
+                    fps[mode] += fp_sizes[k];
+                }
+
+                fp_sizes[k] = 0; tp_sizes[k] = 0;
+            }
+        }
+    }
+
+    prefix_classify = classify;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        lookup_stats_reset(itr->general_stats);
+
+    fprintf(output_file, "MODE\tAVG_TIME\tCLASSIFY_TIME\tCLASSIFY_SHARE\tTPS\tFPS\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "MODE", "AVG (us)", "CLASSIFY (us)", "SHARE");
+
+    for (mode = 0; mode < PREFIX_CLASSIFY_MODES; mode++) {
+
+        double avg = (requests_num > 0 ? (times[mode] / requests_num) * 1000000.0 : 0.0);
+        double none = (requests_num > 0 ? (times[PREFIX_CLASSIFY_NONE] / requests_num) * 1000000.0 : 0.0);
+        double share = (avg > 0.0 ? (avg - none) / avg : 0.0);
+
+        printf("%-12s\t| %-12.3f\t| %-12.3f\t| %-12.3f\n",
+            PREFIX_CLASSIFY_STRS[mode], avg, avg - none, share);
+
+        fprintf(output_file, "%s\t%-.6f\t%-.6f\t%-.6f\t%lu\t%lu\n",
+            PREFIX_CLASSIFY_STRS[mode], avg, avg - none, share,
+            (unsigned long) tps[mode], (unsigned long) fps[mode]);
+    }
+
+    printf("\n");
+
+    // both classification modes must agree
+    if (tps[PREFIX_CLASSIFY_SCAN] != tps[PREFIX_CLASSIFY_MASKS]
+        || fps[PREFIX_CLASSIFY_SCAN] != fps[PREFIX_CLASSIFY_MASKS])
+        fprintf(stderr, "pt_ht_classify_bench() : [ERROR] TPs / FPs differ (%lu / %lu vs. %lu / %lu)\n",
+            (unsigned long) tps[PREFIX_CLASSIFY_SCAN], (unsigned long) fps[PREFIX_CLASSIFY_SCAN],
+            (unsigned long) tps[PREFIX_CLASSIFY_MASKS], (unsigned long) fps[PREFIX_CLASSIFY_MASKS]);
+
+    fclose(output_file);
+}
+
+/*
+ * \brief   lookup time w/ and w/o measurement, per prefix size: the PT of
+ *          each partition is looked up w/ pt_fwd_lookup() (TP / FP
+ *          classification, |F\R| counts and stats, as in the simulation)
+ *          and pt_fwd_lookup_fast() (match set only). results go to
+ *          <output_dir>/stats-bench.tsv.
+ *
+ * XXX: the partition stats are reset by this function, so call it AFTER
+ * pt_ht_print_stats().
+ */
+void pt_ht_stats_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+    struct pt_match_set matches;
+
+    double full_total = 0.0, fast_total = 0.0, begin = 0.0;
+    uint64_t full_matches = 0, fast_matches = 0;
+    int i = 0, k = 0, round = 0, lookups = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_STATS_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "pt_ht_stats_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tFULL_AVG_TIME\tNO_STATS_AVG_TIME\tMATCHES\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-4s\t| %-10s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "FULL (us)", "NO STATS (us)", "# MATCHES");
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        double full_time = 0.0, fast_time = 0.0;
+        uint32_t partition_matches = 0;
+
+        // 1st round warms up the caches and isn't counted
+        for (round = 0; round < 2; round++) {
+
+            lookups = 0;
+            begin = get_time_now();
+
+            for (i = 0; i < requests_num; i++) {
+
+                if (requests[i].size < itr->prefix_size)
+                    continue;
+
+                pt_fwd_lookup(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+                lookups++;
+            }
+
+            full_time = get_time_now() - begin;
+
+            for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+
+                if (round > 0)
+                    full_matches += fp_sizes[k] + tp_sizes[k];
 
-        tns = 1;
-        matches += tns;
+                fp_sizes[k] = 0; tp_sizes[k] = 0;
+            }
+
+            partition_matches = 0;
+            begin = get_time_now();
+
+            for (i = 0; i < requests_num; i++) {
+
+                if (requests[i].size < itr->prefix_size)
+                    continue;
+
+                pt_match_set_init(&matches);
+                pt_fwd_lookup_fast(itr->trie, requests[i].rid, -1, &matches);
+                partition_matches += matches.num_entries;
+            }
+
+            fast_time = get_time_now() - begin;
+        }
 
-        lookup_stats_update(
-            &(node->fib_root->general_stats), 
-            _req_entry_diff, 
-            tps, fps, tns, 1);
+        fast_matches += partition_matches;
 
-        if (node->prefix_size > 0) {
-            fp_sizes[node->prefix_size - 1] += fps;
-            tp_sizes[node->prefix_size - 1] += tps;
+        if (lookups > 0) {
+            full_time = (full_time / (double) lookups) * 1000000.0;
+            fast_time = (fast_time / (double) lookups) * 1000000.0;
         }
+
+        full_total += full_time;
+        fast_total += fast_time;
+
+        printf("%-4d\t| %-10d\t| %-12.3f\t| %-12.3f\t| %-12d\n",
+            itr->prefix_size, itr->num_entries, full_time, fast_time, partition_matches);
+
+        fprintf(output_file, "%d\t%d\t%-.6f\t%-.6f\t%d\n",
+            itr->prefix_size, itr->num_entries, full_time, fast_time, partition_matches);
     }
 
-    matches += pt_fwd_lookup(node->p_left, request, request_size, request_rid, node->key_bit, fp_sizes, tp_sizes);
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        lookup_stats_reset(itr->general_stats);
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n"\
+            "%-12.3f\t| %-12.3f\t| %-12.3f\n",
+            "FULL (us)", "NO STATS (us)", "STATS SHARE",
+            full_total, fast_total,
+            (full_total > 0.0 ? (full_total - fast_total) / full_total : 0.0));
+
+    printf("\n");
+
+    // both variants must agree on the match set
+    if (full_matches != fast_matches)
+        fprintf(stderr, "pt_ht_stats_bench() : [ERROR] %lu (full) vs. %lu (no stats) matches\n",
+            (unsigned long) full_matches, (unsigned long) fast_matches);
 
-    return matches;
+    fclose(output_file);
 }
 
+static double pt_ht_percentile(std::vector<double> & latencies, double p) {
+
+    return latencies[std::min(latencies.size() - 1, (size_t) (p * latencies.size()))];
+}
 
 /*
- * \brief thread function, wrapper for the recursive pt_fwd_lookup() function
+ * \brief   lookup latency distribution of LPM forwarding (see
+ *          pt_ht_lookup_lpm()), w/ and w/o verification of RID matches, vs.
+ *          an exhaustive lookup of all partitions |F| <= |R| (w/o stats,
+ *          see pt_fwd_lookup_fast()), which picks its largest RID match.
+ *          answers are checked against the verified LPM. results go to
+ *          <output_dir>/lpm-bench.tsv.
+ */
+void pt_ht_lpm_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    const char * modes[] = {"EXHAUSTIVE", "LPM", "LPM_RID"};
+    const int num_modes = 3;
+
+    std::vector<double> latencies[num_modes];
+    uint64_t partitions[num_modes] = {0};
+    uint32_t matched[num_modes] = {0}, wrong[num_modes] = {0};
+
+    // size of the verified LPM of each request, the reference answer
+    std::vector<int> lpm_sizes(requests_num, 0);
+
+    struct pt_match_set matches;
+    double begin = 0.0, latency = 0.0;
+    int mode = 0, i = 0, k = 0, round = 0, searched = 0, answer = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_LPM_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "pt_ht_lpm_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    struct pt_ht * itr;
+
+    // 1st round warms up the caches and isn't counted
+    for (round = 0; round < 2; round++) {
+
+        // the verified LPM goes 1st, it's the reference for the others
+        for (mode = num_modes - 1; mode >= 0; mode--) {
+
+            int m = (mode + 1) % num_modes;
+
+            for (i = 0; i < requests_num; i++) {
+
+                begin = get_time_now();
+
+                if (m == 0) {
+
+                    pt_match_set_init(&matches);
+                    searched = 0;
+
+                    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+                        if (requests[i].size < itr->prefix_size)
+                            continue;
+
+                        pt_fwd_lookup_fast(itr->trie, requests[i].rid, -1, &matches);
+                        searched++;
+                    }
+
+                    for (k = BF_MAX_ELEMENTS - 1, answer = 0; k >= 0 && answer == 0; k--)
+                        if (matches.sizes[k] > 0) answer = k + 1;
+
+                } else {
+
+                    answer = pt_ht_lookup_lpm(fib, requests[i].name, requests[i].size, requests[i].rid, (m == 1), NULL, &searched);
+                }
+
+                latency = get_time_now() - begin;
+
+                if (m == 1)
+                    lpm_sizes[i] = answer;
+
+                if (round == 0)
+                    continue;
+
+                latencies[m].push_back(latency);
+                partitions[m] += searched;
+                matched[m] += (answer > 0);
+                wrong[m] += (answer != lpm_sizes[i]);
+            }
+        }
+    }
+
+    fprintf(output_file, "MODE\tLOOKUPS\tAVG\tP50\tP90\tP99\tP999\tMAX\tAVG_PARTITIONS\tMATCHED\tWRONG\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-10s\t| %-8s\t| %-8s\t| %-8s\t| %-8s\t| %-8s\t| %-8s\t| %-8s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "MODE", "AVG (us)", "P50 (us)", "P99 (us)", "MAX (us)", "# PARTS", "MATCHED", "WRONG");
+
+    for (mode = 0; mode < num_modes; mode++) {
+
+        if (latencies[mode].empty())
+            continue;
+
+        double avg = 0.0;
+
+        for (i = 0; i < (int) latencies[mode].size(); i++)
+            avg += latencies[mode][i];
+
+        avg /= (double) latencies[mode].size();
+
+        std::sort(latencies[mode].begin(), latencies[mode].end());
+
+        double avg_partitions = (double) partitions[mode] / (double) latencies[mode].size();
+
+        printf("%-10s\t| %-8.3f\t| %-8.3f\t| %-8.3f\t| %-8.3f\t| %-8.2f\t| %-8d\t| %-8d\n",
+            modes[mode],
+            avg * 1000000.0,
+            pt_ht_percentile(latencies[mode], 0.50) * 1000000.0,
+            pt_ht_percentile(latencies[mode], 0.99) * 1000000.0,
+            latencies[mode].back() * 1000000.0,
+            avg_partitions, matched[mode], wrong[mode]);
+
+        fprintf(output_file, "%s\t%d\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%-.8f\t%-.2f\t%d\t%d\n",
+            modes[mode], (int) latencies[mode].size(), avg,
+            pt_ht_percentile(latencies[mode], 0.50),
+            pt_ht_percentile(latencies[mode], 0.90),
+            pt_ht_percentile(latencies[mode], 0.99),
+            pt_ht_percentile(latencies[mode], 0.999),
+            latencies[mode].back(),
+            avg_partitions, matched[mode], wrong[mode]);
+    }
+
+    printf("\n");
+
+    fclose(output_file);
+}
+
+/*
+ * \brief   picks the lookup engine of each FIB partition, based on a 
+ *          calibration run w/ a sample of the requests.
  *
- * updates a global condition variable (condition_var), which determines when 
- * the lookup for a given prefix size is over.
- * 
- * \return
+ * each partition is timed in isolation, single threaded, w/ the PT, SCAN and
+ * BITSLICE engines and (at most) PT_CALIBRATION_REQUESTS requests of size 
+ * |R| >= |F|. all engines are timed through pt_ht_lookup_partition(), i.e. 
+ * w/ the same TP / FP classification and stats gathering as the simulation 
+ * itself (stats are reset afterwards). SCAN and BITSLICE cost grows w/ the 
+ * nr. of entries, so partitions w/ more than PT_CALIBRATION_MAX_ENTRIES 
+ * entries keep the PT, whatever the sample says. otherwise, each partition
+ * gets the engine which was fastest on its own sample. engine tables which
+ * aren't picked are thrown away. the picked engines show up in entry.tsv 
+ * (see pt_ht_print_stats()).
+ *
+ * \param   fib             the FIB
+ * \param   requests        array of requests to sample from
+ * \param   requests_num    size of the requests array
  */
-void pt_fwd_lookup_thread(void * t_args) {
+void pt_ht_calibrate(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num) {
 
-    struct pt_fwd_lookup_tdata * t_data = (pt_fwd_lookup_tdata *) t_args;
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+    struct prefix_req req;
+
+    // times per engine, indexed by PT_ENGINE_PT, _SCAN and _BITSLICE
+    double times[PT_ENGINE_BITSLICE + 1][MAX_PREFIX_SIZE + 1] = {{0.0}};
+    int engines[MAX_PREFIX_SIZE + 1] = {0};
+
+    double begin = 0.0;
+    int i = 0, e = 0, lookups = 0;
+
+    // spread the sample over the whole request array (requests are 
+    // generated in prefix size order)
+    int step = std::max(1, requests_num / PT_CALIBRATION_REQUESTS);
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        engines[itr->prefix_size] = PT_ENGINE_PT;
+
+        if (itr->num_entries > PT_CALIBRATION_MAX_ENTRIES)
+            continue;
+
+        if (!pt_ht_build_engine(itr, PT_ENGINE_SCAN) || !pt_ht_build_engine(itr, PT_ENGINE_BITSLICE))
+            continue;
+
+        lookups = 0;
 
-    pt_fwd_lookup(
-        t_data->node, 
-        t_data->request, 
-        t_data->request_size, 
-        t_data->request_rid, 
-        -1, 
-        t_data->fp_sizes, 
-        t_data->tp_sizes);
+        for (i = 0; i < requests_num; i += step) {
 
-    pthread_mutex_lock(&lock);
-    condition_var--;
-    pthread_mutex_unlock(&lock);
+            if (requests[i].size < itr->prefix_size)
+                continue;
 
-    // printf("pt_fwd_lookup_thread(): finished lookup for prefix size %d. condition_var = %d\n",
-    //     t_data->node->fib_root->prefix_size,
-    //     condition_var);
+            // as in pt_ht_lookup(), the request is split in components 
+            // before the partition lookups
+            if (prefix_classify != PREFIX_CLASSIFY_NONE)
+                prefix_req_init(&req, requests[i].name);
+
+            for (e = PT_ENGINE_PT; e <= PT_ENGINE_BITSLICE; e++) {
+
+                itr->engine = e;
+
+                begin = get_time_now();
+                pt_ht_lookup_partition(
+                    itr, requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes, NULL,
+                    (prefix_classify != PREFIX_CLASSIFY_NONE ? &req : NULL));
+                times[e][itr->prefix_size] += get_time_now() - begin;
+            }
+
+            lookups++;
+        }
+
+        itr->engine = PT_ENGINE_PT;
+
+        if (lookups > 0) {
+
+            for (e = PT_ENGINE_PT; e <= PT_ENGINE_BITSLICE; e++) {
+
+                times[e][itr->prefix_size] = (times[e][itr->prefix_size] / (double) lookups) * 1000000.0;
+
+                if (times[e][itr->prefix_size] < times[engines[itr->prefix_size]][itr->prefix_size])
+                    engines[itr->prefix_size] = e;
+            }
+        }
+
+        lookup_stats_reset(itr->general_stats);
+    }
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "PT (us)", "SCAN (us)", "BITSLICE (us)", "ENGINE");
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        itr->engine = engines[itr->prefix_size];
+        pt_ht_drop_engines(itr, itr->engine);
+
+        printf(
+            "%-12d\t| %-12d\t| %-12.3f\t| %-12.3f\t| %-12.3f\t| %-12s\n",
+            itr->prefix_size,
+            itr->num_entries,
+            times[PT_ENGINE_PT][itr->prefix_size], 
+            times[PT_ENGINE_SCAN][itr->prefix_size], 
+            times[PT_ENGINE_BITSLICE][itr->prefix_size],
+            PT_ENGINE_STRS[itr->engine]);
+    }
+
+    printf("\n");
 }
 
-void pt_ht_lookup(
+static void pt_ht_lookup_pool(
         struct pt_ht * pt_fib,
         char * request,
         int request_size,
         struct click_xia_xid * request_rid,
         uint32_t * fp_sizes,
-        uint32_t * tp_sizes) {
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        int reader) {
 
     struct pt_ht * s = NULL;
     struct pt_ht * itr = NULL;
     int prefix_size = request_size;
     uint32_t total_matches = 0; 
 
+    // the tries (and their nodes) stay around until the lookup is over
+    if (pt_rcu != NULL && reader != PT_READER_NONE)
+        rcu_read_lock(pt_rcu, reader);
+
     // find the largest prefix size which is less than or equal than the 
     // request size
     // FIXME: we don't support partial RID queries... yet!
@@ -919,7 +2768,10 @@ void pt_ht_lookup(
     // hazards are possible. 
 
     // note that the parallelization only happens 
-    // per PT subtree, i.e. we don't lookup requests in parallel.
+    // per PT subtree, i.e. we don't lookup requests in parallel. the pool
+    // and the counter of pending jobs belong to the request, so that
+    // concurrent readers can call pt_ht_lookup().
+    threadpool_t * pool = NULL;
     assert((pool = threadpool_create(NUM_THREADS, MAX_PREFIX_SIZE * 2, 0)) != NULL);
     // printf("pt_ht_lookup(): thread pool started with %d threads and %d jobs\n", 
     //         NUM_THREADS, MAX_PREFIX_SIZE + 1);
@@ -929,11 +2781,19 @@ void pt_ht_lookup(
     // problem would emerge when pt_ht_lookup() returned. still don't know why...
     struct pt_fwd_lookup_tdata * t_args = 
         (struct pt_fwd_lookup_tdata *) calloc(MAX_PREFIX_SIZE + 1, sizeof(struct pt_fwd_lookup_tdata));
-    // update the global thread termination condition variable. the condition 
-    // variable is set to the number of prefix size subtrees encoded in the FIB, 
-    // given by HASH_COUNT().
-    // FIXME: using global variables is sad, and you should feel bad...
-    condition_var = HASH_COUNT(pt_fib);
+    // the thread termination counter is set to the number of prefix size 
+    // subtrees looked up, i.e. w/ |F| <= |R| (not all subtrees in the FIB, 
+    // or requests shorter than the largest prefix would wait forever).
+    int pending = 0;
+
+    for (itr = s; itr != NULL; itr = (struct pt_ht *) itr->hh.prev)
+        pending += (itr->trie != NULL);
+
+    // the request is split in components once, for all partitions
+    struct prefix_req req;
+
+    if (prefix_classify != PREFIX_CLASSIFY_NONE)
+        prefix_req_init(&req, request);
 
     // iterate the FIB prefix size subtrees back from prefix_size to 1 to get 
     // all possible matching prefixes. we are guaranteed (?) to follow a 
@@ -957,26 +2817,96 @@ void pt_ht_lookup(
         t_args[itr->prefix_size].request = request;
         t_args[itr->prefix_size].request_size = request_size;
         t_args[itr->prefix_size].request_rid = request_rid;
+        t_args[itr->prefix_size].req = (prefix_classify != PREFIX_CLASSIFY_NONE ? &req : NULL);
         t_args[itr->prefix_size].prev_key_bit = -1;
         t_args[itr->prefix_size].fp_sizes = fp_sizes;
         t_args[itr->prefix_size].tp_sizes = tp_sizes;
+        t_args[itr->prefix_size].pending = &pending;
+        // each thread fills its own port set, merged below (no locks needed)
+        t_args[itr->prefix_size].collect_ports = (ports != NULL);
 
         // pt_fwd_lookup_thread() starts the whole recursive lookup on the FIB 
         // subtree for prefix size itr->prefix_size
         assert(threadpool_add(pool, &pt_fwd_lookup_thread, &t_args[itr->prefix_size], 0) == 0);
     }
 
-    // wait on condition_var for the end of all subtree lookups
-    while (condition_var > 0) {
+    // wait on pending for the end of all subtree lookups
+    while (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) > 0) {
         usleep(1000);
     }
 
     // destroy them threads in them pool...
     assert(threadpool_destroy(pool, 0) == 0);
 
+    if (pt_rcu != NULL && reader != PT_READER_NONE)
+        rcu_read_unlock(pt_rcu, reader);
+
+    // union of the next hops of all matches, 1 word-wide OR per partition
+    if (ports != NULL) {
+
+        pt_port_set_clear(ports);
+
+        for (itr = s; itr != NULL; itr = (struct pt_ht *) itr->hh.prev)
+            pt_port_set_union(ports, &(t_args[itr->prefix_size].ports));
+    }
+
     free(t_args);
 }
 
+/*
+ * \brief   looks up a request in all partitions |F| <= |R|, w/ the
+ *          partitions' engines (1 thread per partition). FPs and TPs are
+ *          added to fp_sizes and tp_sizes, per prefix size. if pt_cache is
+ *          set, lookups go through it (see rid_cache.h): hits don't update
+ *          the partition stats.
+ *
+ * \param   ports   if not NULL, set to the union of the next hops of all
+ *                  matches (see pt_ht_lookup_partition())
+ * \param   reader  the caller's EBR reader (see rcu_register()), if pt_rcu
+ *                  is set. PT_READER_NONE if the caller doesn't run
+ *                  concurrently w/ FIB updates.
+ */
+void pt_ht_lookup(
+        struct pt_ht * pt_fib,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        int reader) {
+
+    struct rid_cache * cache = pt_cache;
+    struct rid_cache_result result;
+
+    if (cache == NULL) {
+
+        pt_ht_lookup_pool(pt_fib, request, request_size, request_rid, fp_sizes, tp_sizes, ports, reader);
+        return;
+    }
+
+    // misses are looked up w/ ports, so that all lookups can hit
+    if (!rid_cache_lookup(cache, request, request_rid, request_size, RID_CACHE_MATCHES, &result)) {
+
+        uint64_t generation = rid_cache_generation(cache);
+
+        memset(&result, 0, sizeof(struct rid_cache_result));
+        result.parts = RID_CACHE_MATCHES;
+
+        pt_ht_lookup_pool(pt_fib, request, request_size, request_rid, result.fp_sizes, result.tp_sizes, &(result.ports), reader);
+        rid_cache_insert(cache, request, request_rid, request_size, &result, generation);
+    }
+
+    for (int k = 0; k < BF_MAX_ELEMENTS; k++) {
+
+        fp_sizes[k] += result.fp_sizes[k];
+        tp_sizes[k] += result.tp_sizes[k];
+    }
+
+    if (ports != NULL)
+        memcpy(ports, &(result.ports), sizeof(struct pt_port_set));
+}
+
 void pt_fwd_print(
         struct pt_fwd * node,
         uint8_t mode) {
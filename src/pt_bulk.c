@@ -0,0 +1,378 @@
+/*
+ * pt_bulk.c
+ *
+ * bulk (bottom-up) construction of the FIB partition tries.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <assert.h>
+
+#include "pt_bulk.h"
+#include "prefix_dict.h"
+#include "rid_cache.h"
+
+#define PT_BULK_INIT_SIZE   1024
+
+// same bit order as bit() in pt.c
+static __inline int pt_bulk_bit(int i, struct click_xia_xid * rid) {
+
+    return (rid->id[CLICK_XIA_XID_ID_LEN - (i / 8) - 1] >> (8 - (i % 8) - 1)) & 0x01;
+}
+
+/*
+ * \brief   1st bit (>= 1) in which 2 RIDs differ, as in pt_fwd_insert(): bit
+ *          0 is only ever tested by the root.
+ *
+ * \return  the bit, -1 if the RIDs only (possibly) differ in bit 0
+ */
+static int pt_bulk_diff_bit(struct click_xia_xid * a, struct click_xia_xid * b) {
+
+    int j = 0;
+
+    for (j = CLICK_XIA_XID_ID_LEN - 1; j >= 0; j--) {
+
+        uint32_t x = a->id[j] ^ b->id[j];
+
+        if (j == CLICK_XIA_XID_ID_LEN - 1)
+            x &= 0x7F;
+
+        if (x)
+            return (8 * (CLICK_XIA_XID_ID_LEN - j - 1)) + (__builtin_clz(x) - 24);
+    }
+
+    return -1;
+}
+
+struct pt_bulk * pt_bulk_init() {
+
+    return (struct pt_bulk *) calloc(1, sizeof(struct pt_bulk));
+}
+
+void pt_bulk_erase(struct pt_bulk * bulk) {
+
+    uint32_t i = 0;
+    int p = 0;
+
+    for (p = 0; p <= MAX_PREFIX_SIZE; p++) {
+
+        // prefixes were encoded into the tries (see pt_bulk_node())
+        for (i = 0; i < bulk->parts[p].num; i++)
+            free(bulk->parts[p].prefixes[i]);
+
+        free(bulk->parts[p].rids);
+        free(bulk->parts[p].prefixes);
+        free(bulk->parts[p].ports);
+    }
+
+    free(bulk);
+}
+
+/*
+ * \brief   collects an (RID, prefix) pair and its next hop, to be added to
+ *          the FIB partition of size prefix_size by pt_bulk_build().
+ */
+void pt_bulk_add(
+        struct pt_bulk * bulk,
+        struct click_xia_xid * rid,
+        char * prefix,
+        int prefix_size,
+        uint16_t port) {
+
+    struct pt_bulk_part * part = &(bulk->parts[prefix_size]);
+
+    if (part->num == part->max) {
+
+        part->max = (part->max > 0 ? 2 * part->max : PT_BULK_INIT_SIZE);
+        part->rids = (struct click_xia_xid *) realloc(part->rids, part->max * sizeof(struct click_xia_xid));
+        part->prefixes = (char **) realloc(part->prefixes, part->max * sizeof(char *));
+        part->ports = (uint16_t *) realloc(part->ports, part->max * sizeof(uint16_t));
+    }
+
+    memcpy(&(part->rids[part->num]), rid, sizeof(struct click_xia_xid));
+    part->prefixes[part->num] = strdup(prefix);
+    part->ports[part->num] = port;
+    part->num++;
+
+    bulk->num++;
+}
+
+/*
+ * \brief   LSD radix sort of an index array, by RID. the most significant byte
+ *          is the last one (bit() order), and the sort is stable.
+ */
+static void pt_bulk_sort(struct click_xia_xid * rids, uint32_t * idx, uint32_t n) {
+
+    uint32_t * tmp = (uint32_t *) malloc(n * sizeof(uint32_t));
+    uint32_t counts[256];
+    uint32_t i = 0;
+    int j = 0, c = 0;
+
+    for (j = 0; j < CLICK_XIA_XID_ID_LEN; j++) {
+
+        memset(counts, 0, sizeof(counts));
+
+        for (i = 0; i < n; i++)
+            counts[rids[idx[i]].id[j]]++;
+
+        // all keys share this byte: nothing to do
+        if (n == 0 || counts[rids[idx[0]].id[j]] == n)
+            continue;
+
+        for (c = 0, i = 0; c < 256; c++) {
+
+            uint32_t count = counts[c];
+            counts[c] = i;
+            i += count;
+        }
+
+        for (i = 0; i < n; i++)
+            tmp[counts[rids[idx[i]].id[j]]++] = idx[i];
+
+        memcpy(idx, tmp, n * sizeof(uint32_t));
+    }
+
+    free(tmp);
+}
+
+static struct pt_fwd * pt_bulk_node(struct pt_bulk_part * part, uint32_t k) {
+
+    struct pt_fwd * f = (struct pt_fwd *) pt_fwd_malloc(sizeof(struct pt_fwd));
+
+    f->prefix_rid = (struct click_xia_xid *) pt_fwd_malloc(sizeof(struct click_xia_xid));
+    memcpy(f->prefix_rid, &(part->rids[k]), sizeof(struct click_xia_xid));
+
+    f->fib_root = part->partition;
+    f->prefix_size = part->partition->prefix_size;
+    f->port = part->ports[k];
+    f->p_left = f->p_right = NULL;
+
+    prefix_info_init(&(f->prefix_i), part->prefixes[k], f->prefix_size);
+    f->prefix_fp = prefix_info_fp(f->prefix_i);
+
+    return f;
+}
+
+/*
+ * \brief   builds one side (left or right) of the root of a partition trie,
+ *          out of sorted keys w/ the same bit 0.
+ *
+ * the root (all-zero RID) is the 1st key of both sides, as it is w/
+ * pt_fwd_insert(). internal node i sits between sorted keys i - 1 and i,
+ * branches on their 1st differing bit and holds key i (the leftmost key of
+ * its right subtree). an empty left (right) subtree is an upward link to
+ * the holder of key i - 1 (i).
+ *
+ * \return  the top node of the side, the root if the side is empty
+ */
+static struct pt_fwd * pt_bulk_build_side(
+        struct pt_bulk_part * part,
+        uint32_t * keys,
+        uint32_t m,
+        struct pt_fwd *** fallback,
+        uint32_t * fallback_num) {
+
+    struct pt_fwd * root = part->partition->trie;
+
+    struct pt_fwd ** nodes = (struct pt_fwd **) malloc((m + 1) * sizeof(struct pt_fwd *));
+    int * b = (int *) malloc((m + 1) * sizeof(int));
+    uint32_t * left = (uint32_t *) calloc(m + 1, sizeof(uint32_t));
+    uint32_t * right = (uint32_t *) calloc(m + 1, sizeof(uint32_t));
+    uint32_t * stack = (uint32_t *) malloc((m + 1) * sizeof(uint32_t));
+
+    uint32_t i = 0, n = 1, top = 0;
+
+    nodes[0] = root;
+
+    for (i = 0; i < m; i++) {
+
+        struct pt_fwd * f = pt_bulk_node(part, keys[i]);
+        int d = pt_bulk_diff_bit(nodes[n - 1]->prefix_rid, f->prefix_rid);
+
+        // only differs from the previous key in bit 0 (i.e. from the root, on
+        // the right side): leave it to pt_fwd_insert()
+        if (d < 0) {
+            (*fallback)[(*fallback_num)++] = f;
+            continue;
+        }
+
+        b[n] = d;
+        nodes[n++] = f;
+    }
+
+    // Cartesian tree of the branching bits, smallest at the top
+    for (i = 1; i < n; i++) {
+
+        uint32_t last = 0;
+
+        while (top > 0 && b[stack[top - 1]] > b[i])
+            last = stack[--top];
+
+        left[i] = last;
+
+        if (top > 0)
+            right[stack[top - 1]] = i;
+
+        stack[top++] = i;
+    }
+
+    for (i = 1; i < n; i++) {
+
+        nodes[i]->key_bit = b[i];
+        nodes[i]->p_left = (left[i] > 0 ? nodes[left[i]] : nodes[i - 1]);
+        nodes[i]->p_right = (right[i] > 0 ? nodes[right[i]] : nodes[i]);
+    }
+
+    struct pt_fwd * side = (n > 1 ? nodes[stack[0]] : root);
+
+    free(nodes);
+    free(b);
+    free(left);
+    free(right);
+    free(stack);
+
+    return side;
+}
+
+static void pt_bulk_build_part(void * arg) {
+
+    struct pt_bulk_part * part = (struct pt_bulk_part *) arg;
+    struct pt_fwd * root = part->partition->trie;
+
+    double begin = get_time_now();
+
+    uint32_t * idx = (uint32_t *) malloc((part->num + 1) * sizeof(uint32_t));
+    uint32_t i = 0, n = 0, left_num = 0;
+
+    for (i = 0; i < part->num; i++)
+        idx[i] = i;
+
+    pt_bulk_sort(part->rids, idx, part->num);
+
+    // drop duplicates (the sort is stable, so the 1st occurrence stays, as
+    // w/ pt_ht_add()) and RIDs equal to the root's
+    for (i = 0; i < part->num; i++) {
+
+        struct click_xia_xid * prev = (n > 0 ? &(part->rids[idx[n - 1]]) : root->prefix_rid);
+
+        if (rid_compare(&(part->rids[idx[i]]), prev)
+            || rid_compare(&(part->rids[idx[i]]), root->prefix_rid)) {
+
+            part->dups++;
+            continue;
+        }
+
+        idx[n++] = idx[i];
+    }
+
+    // keys w/ bit 0 = 0 come 1st
+    for (left_num = 0; left_num < n && !pt_bulk_bit(0, &(part->rids[idx[left_num]])); left_num++);
+
+    struct pt_fwd ** fallback = (struct pt_fwd **) malloc((n + 1) * sizeof(struct pt_fwd *));
+    uint32_t fallback_num = 0;
+
+    root->key_bit = 0;
+    root->p_left = pt_bulk_build_side(part, idx, left_num, &fallback, &fallback_num);
+    root->p_right = pt_bulk_build_side(part, idx + left_num, n - left_num, &fallback, &fallback_num);
+
+    for (i = 0; i < fallback_num; i++)
+        pt_fwd_insert(fallback[i], root);
+
+    part->partition->num_entries = n;
+    part->partition->num_dups += part->dups;
+
+    free(fallback);
+    free(idx);
+
+    part->build_time = get_time_now() - begin;
+}
+
+/*
+ * \brief   builds the FIB partitions out of the collected (RID, prefix)
+ *          pairs, in parallel.
+ *
+ * partitions which already hold entries are filled w/ pt_ht_add() instead.
+ *
+ * \param   bulk    the collected pairs
+ * \param   fib     the FIB
+ *
+ * \return  nr. of duplicate RIDs
+ */
+int pt_bulk_build(struct pt_bulk * bulk, struct pt_ht ** fib) {
+
+    uint32_t i = 0, dups = 0;
+    int p = 0;
+
+    threadpool_t * bulk_pool = threadpool_create(NUM_THREADS, MAX_PREFIX_SIZE * 2, 0);
+    assert(bulk_pool != NULL);
+
+    for (p = 1; p <= MAX_PREFIX_SIZE; p++) {
+
+        struct pt_bulk_part * part = &(bulk->parts[p]);
+
+        if (part->num == 0)
+            continue;
+
+        // partitions must be created here, uthash isn't thread safe
+        part->partition = pt_ht_get_partition(fib, part->prefixes[0], p);
+
+        if (!(part->partition))
+            continue;
+
+        if (part->partition->num_entries > 0) {
+
+            for (i = 0; i < part->num; i++) {
+
+                if (pt_ht_add(fib, &(part->rids[i]), part->prefixes[i], p, part->ports[i]) > 0)
+                    part->dups++;
+            }
+
+            continue;
+        }
+
+        assert(threadpool_add(bulk_pool, &pt_bulk_build_part, part, 0) == 0);
+    }
+
+    // waits for all partitions to be built
+    assert(threadpool_destroy(bulk_pool, threadpool_graceful) == 0);
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "# DUPLICATES", "BUILD TIME (s)");
+
+    for (p = 1; p <= MAX_PREFIX_SIZE; p++) {
+
+        struct pt_bulk_part * part = &(bulk->parts[p]);
+
+        if (!(part->partition))
+            continue;
+
+        printf("%-12d\t| %-12d\t| %-12d\t| %-.6f\n",
+            p, part->partition->num_entries, part->dups, part->build_time);
+
+        dups += part->dups;
+    }
+
+    printf("\n");
+
+    // the new entries aren't in the results cached so far
+    if (pt_cache != NULL)
+        rid_cache_invalidate(pt_cache);
+
+    return dups;
+}
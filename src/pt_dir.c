@@ -0,0 +1,328 @@
+/*
+ * pt_dir.c
+ *
+ * jump table (directory) over the top k bits of RIDs, w/ one patricia
+ * sub-trie per slot.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "pt_dir.h"
+
+int pt_dir_bits = PT_DIR_DEFAULT_BITS;
+
+/*
+ * \brief   returns the top k bits of an RID, i.e. bits 0 to (k - 1) in the
+ *          order used by bit() in pt.c (bit 0 is the msb of the last byte).
+ */
+static __inline uint32_t pt_dir_slot(struct click_xia_xid * rid, int bits) {
+
+    if (bits == 0)
+        return 0;
+
+    uint32_t top = ((uint32_t) rid->id[CLICK_XIA_XID_ID_LEN - 1] << 16)
+        | ((uint32_t) rid->id[CLICK_XIA_XID_ID_LEN - 2] << 8)
+        | ((uint32_t) rid->id[CLICK_XIA_XID_ID_LEN - 3]);
+
+    return (top >> (24 - bits));
+}
+
+static int pt_dir_collect_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct pt_dir * dir) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    // the root node (default route) isn't an actual entry
+    if (t->prefix_size > 0) {
+
+        uint32_t slot = pt_dir_slot(t->prefix_rid, dir->bits);
+
+        if (!(dir->slots[slot])) {
+            dir->slots[slot] = pt_fwd_init(dir->fib_root);
+            dir->num_slots++;
+        }
+
+        // the sub-trie node shares the RID and prefix info w/ t
+        struct pt_fwd * f = (struct pt_fwd *) pt_fwd_malloc(sizeof(struct pt_fwd));
+
+        f->fib_root = dir->fib_root;
+        f->prefix_rid = t->prefix_rid;
+        f->prefix_size = t->prefix_size;
+        f->port = t->port;
+        f->prefix_i = t->prefix_i;
+        f->prefix_fp = t->prefix_fp;
+        f->p_left = NULL;
+        f->p_right = NULL;
+
+        if (!(pt_fwd_insert(f, dir->slots[slot]))) {
+
+            fprintf(stderr, "pt_dir_init() : ERROR pt_fwd_insert() failed\n");
+            pt_fwd_mfree(f, sizeof(struct pt_fwd));
+
+        } else {
+
+            dir->num_entries++;
+        }
+    }
+
+    pt_dir_collect_rec(t->p_left, t->key_bit, dir);
+    pt_dir_collect_rec(t->p_right, t->key_bit, dir);
+
+    return dir->num_entries;
+}
+
+/*
+ * \brief   builds a directory of sub-tries out of the entries of a FIB
+ *          partition (i.e. a PT subtree for some prefix size)
+ *
+ * \param   partition   the FIB partition to collect the entries from
+ * \param   bits        nr. of RID bits used to index the directory (k)
+ *
+ * \return  the directory, NULL if bits is out of range
+ */
+struct pt_dir * pt_dir_init(struct pt_ht * partition, int bits) {
+
+    if (bits < 0 || bits > PT_DIR_MAX_BITS) {
+
+        fprintf(stderr, "pt_dir_init() : ERROR k = %d not in [0, %d]\n", bits, PT_DIR_MAX_BITS);
+        return NULL;
+    }
+
+    struct pt_dir * dir = (struct pt_dir *) calloc(1, sizeof(struct pt_dir));
+
+    dir->fib_root = partition;
+    dir->prefix_size = partition->prefix_size;
+    dir->bits = bits;
+    dir->slots = (struct pt_fwd **) calloc(((size_t) 1 << bits), sizeof(struct pt_fwd *));
+
+    pt_dir_collect_rec(partition->trie, -1, dir);
+
+    return dir;
+}
+
+static void pt_dir_erase_rec(struct pt_fwd * t, int key_bit) {
+
+    if (t->key_bit <= key_bit) return;
+
+    pt_dir_erase_rec(t->p_left, t->key_bit);
+    pt_dir_erase_rec(t->p_right, t->key_bit);
+
+    // only the sub-trie roots own their RID and prefix info
+    if (t->prefix_size == 0) {
+
+        prefix_info_erase(&(t->prefix_i));
+        pt_fwd_mfree(t->prefix_rid, sizeof(struct click_xia_xid));
+    }
+
+    pt_fwd_mfree(t, sizeof(struct pt_fwd));
+}
+
+void pt_dir_erase(struct pt_dir * dir) {
+
+    if (!dir)
+        return;
+
+    uint32_t slot = 0;
+
+    for (slot = 0; slot < ((uint32_t) 1 << dir->bits); slot++) {
+
+        if (dir->slots[slot])
+            pt_dir_erase_rec(dir->slots[slot], -1);
+    }
+
+    free(dir->slots);
+    free(dir);
+}
+
+/*
+ * \brief   memory held by a directory, in byte. the RIDs and prefix info 
+ *          shared w/ the partition trie aren't accounted for.
+ */
+size_t pt_dir_memory(struct pt_dir * dir) {
+
+    if (!dir)
+        return 0;
+
+    // slots + sub-trie nodes + sub-trie roots' own RIDs and (empty) prefixes
+    return (sizeof(struct pt_dir)
+        + (((size_t) 1 << dir->bits) * sizeof(struct pt_fwd *))
+        + ((dir->num_entries + dir->num_slots) * sizeof(struct pt_fwd))
+        + (dir->num_slots * (sizeof(struct click_xia_xid) + sizeof(struct prefix_info))));
+}
+
+/*
+ * \brief   looks up a request RID in a directory of sub-tries, visiting only
+ *          the slots whose index is a submask of the request's top k bits.
+ *
+ * TPs and FPs are added to the tp_sizes and fp_sizes arrays, the next hops
+ * of the matches to ports (if not NULL), and the partition stats are
+ * updated, by pt_fwd_lookup_req() on each sub-trie. the
+ * sub-trie roots aren't entries of the partition, so the lookup starts at 
+ * their children: roots count neither as visited nodes nor as TNs.
+ *
+ * \param   req     the request, split in components (see prefix_req_init()).
+ *                  if NULL, it's split here, once for all sub-tries.
+ *
+ * \return  nr. of visited nodes
+ */
+int pt_dir_lookup(
+        struct pt_dir * dir,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct prefix_req * req) {
+
+    uint32_t r = pt_dir_slot(request_rid, dir->bits), s = r;
+    int visited = 0;
+
+    struct prefix_req request_req;
+
+    if (req == NULL && prefix_classify != PREFIX_CLASSIFY_NONE) {
+        prefix_req_init(&request_req, request);
+        req = &request_req;
+    }
+
+    // all submasks of r, from r down to 0
+    while (1) {
+
+        struct pt_fwd * root = dir->slots[s];
+
+        if (root) {
+
+            // the root's RID is all 0s, so both branches are followed (right 
+            // 1st, as in pt_fwd_lookup())
+            visited += pt_fwd_lookup_req(root->p_right, req, request_rid, root->key_bit, fp_sizes, tp_sizes, ports);
+            visited += pt_fwd_lookup_req(root->p_left, req, request_rid, root->key_bit, fp_sizes, tp_sizes, ports);
+            dir->slot_visits++;
+        }
+
+        if (s == 0)
+            break;
+
+        s = (s - 1) & r;
+    }
+
+    return visited;
+}
+
+/*
+ * \brief   memory vs. lookup time trade-off of directories, for a range of
+ *          values of k.
+ *
+ * for each k, a directory is built for every partition of the FIB, and all
+ * requests are run through the partitions w/ |F| <= |R|, single threaded. 
+ * k = 0 is equivalent to the plain PT (a single slot).
+ *
+ * XXX: the partition stats are updated by this function, so call it AFTER
+ * pt_ht_print_stats().
+ *
+ * \param   fib             the (PT) FIB to test
+ * \param   requests        array of requests to run through the partitions
+ * \param   requests_num    size of the requests array
+ * \param   output_dir      dir on which to dump the .tsv file
+ */
+void pt_dir_print_tradeoff(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    int bits = 0, i = 0, lookups = 0;
+    double begin = 0.0, lookup_time = 0.0;
+    size_t memory = 0;
+    unsigned long slot_visits = 0, slots = 0, visited = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_DIR_TRADEOFF_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+    fprintf(output_file, "DIR_BITS\tNUM_SLOTS\tMEMORY\tAVG_SLOT_VISITS\tAVG_NODE_VISITS\tAVG_TIME\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-8s\t| %-12s\t| %-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "k", "# SLOTS", "MEMORY (KB)", "SLOTS/REQ", "NODES/REQ", "TIME (us)");
+
+    for (bits = 0; bits <= PT_DIR_MAX_BITS; bits += 2) {
+
+        struct pt_dir * dirs[MAX_PREFIX_SIZE + 1] = {NULL};
+        struct pt_ht * itr;
+
+        memory = 0; slots = 0; slot_visits = 0; visited = 0; lookups = 0;
+
+        for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+            dirs[itr->prefix_size] = pt_dir_init(itr, bits);
+            memory += pt_dir_memory(dirs[itr->prefix_size]);
+            slots += dirs[itr->prefix_size]->num_slots;
+        }
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+                if (requests[i].size < itr->prefix_size)
+                    continue;
+
+                visited += pt_dir_lookup(
+                    dirs[itr->prefix_size], 
+                    requests[i].name, requests[i].size, requests[i].rid, 
+                    fp_sizes, tp_sizes, NULL, NULL);
+            }
+
+            lookups++;
+        }
+
+        lookup_time = get_time_now() - begin;
+
+        for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+            slot_visits += dirs[itr->prefix_size]->slot_visits;
+            pt_dir_erase(dirs[itr->prefix_size]);
+        }
+
+        if (lookups > 0)
+            lookup_time = (lookup_time / (double) lookups) * 1000000.0;
+
+        printf(
+            "%-8d\t| %-12lu\t| %-12.1f\t| %-12.1f\t| %-12.1f\t| %-12.3f\n",
+            bits, slots,
+            (double) memory / 1024.0,
+            (lookups > 0 ? (double) slot_visits / (double) lookups : 0.0),
+            (lookups > 0 ? (double) visited / (double) lookups : 0.0),
+            lookup_time);
+
+        fprintf(output_file,
+            "%d\t%lu\t%lu\t%-.6f\t%-.6f\t%-.6f\n",
+            bits, slots, (unsigned long) memory,
+            (lookups > 0 ? (double) slot_visits / (double) lookups : 0.0),
+            (lookups > 0 ? (double) visited / (double) lookups : 0.0),
+            lookup_time);
+    }
+
+    printf("\n");
+
+    fclose(output_file);
+}
@@ -0,0 +1,1001 @@
+/*
+ * pt_flat.c
+ *
+ * flat (frozen) patricia trie.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include "pt_flat.h"
+#include "perf_counters.h"
+#include "prefix_dict.h"
+
+typedef std::unordered_map<struct pt_fwd *, uint32_t> PtFlatIndex;
+
+const char * PT_FLAT_LAYOUT_STRS[] = {"PREORDER", "BFS", "VEB", "PROFILE"};
+
+int pt_flat_layout = PT_FLAT_LAYOUT_PREORDER;
+
+/*
+ * \brief   numbers the nodes of a trie in pre-order, copying them to the
+ *          flat trie. in a patricia trie, upward links always point to an
+ *          ancestor (or the node itself), so these are numbered already by
+ *          the time they're followed.
+ */
+static uint32_t pt_flat_freeze_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct pt_flat * flat,
+        PtFlatIndex & index) {
+
+    if (t->key_bit <= key_bit)
+        return index[t];
+
+    uint32_t n = flat->num_nodes++;
+    index[t] = n;
+
+    memcpy(&(flat->nodes[n].rid), t->prefix_rid, sizeof(struct click_xia_xid));
+    flat->nodes[n].key_bit = t->key_bit;
+    flat->nodes[n].port = t->port;
+
+    flat->nodes[n].prefix = (uint32_t) flat->strings_size;
+    flat->strings_size += prefix_info_str(t->prefix_i, flat->strings + flat->strings_size, PREFIX_MAX_LENGTH) + 1;
+
+    // note: flat->nodes isn't realloc()'d, so it's fine to index it after
+    // the recursive calls
+    uint32_t left = pt_flat_freeze_rec(t->p_left, t->key_bit, flat, index);
+    uint32_t right = pt_flat_freeze_rec(t->p_right, t->key_bit, flat, index);
+
+    flat->nodes[n].p_left = left;
+    flat->nodes[n].p_right = right;
+
+    return n;
+}
+
+static void pt_flat_relayout_profile(struct pt_flat * flat, std::vector<uint32_t> & counts);
+
+static size_t pt_flat_strings_size(struct pt_fwd * t, int key_bit) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    return prefix_info_str_size(t->prefix_i)
+        + pt_flat_strings_size(t->p_left, t->key_bit)
+        + pt_flat_strings_size(t->p_right, t->key_bit);
+}
+
+/*
+ * \brief   freezes the trie of a FIB partition into a flat trie, w/ the
+ *          default layout (pt_flat_layout)
+ */
+struct pt_flat * pt_flat_init(struct pt_ht * partition) {
+
+    return pt_flat_init_layout(partition, pt_flat_layout);
+}
+
+/*
+ * \brief   freezes the trie of a FIB partition into a flat trie
+ *
+ * \param   partition   the FIB partition
+ * \param   layout      node order, PT_FLAT_LAYOUT_*
+ *
+ * \return  the flat trie
+ */
+struct pt_flat * pt_flat_init_layout(struct pt_ht * partition, int layout) {
+
+    struct pt_flat * flat = (struct pt_flat *) calloc(1, sizeof(struct pt_flat));
+
+    flat->fib_root = partition;
+    flat->prefix_size = partition->prefix_size;
+
+    // + 1 for the root
+    flat->nodes = (struct pt_flat_node *) calloc(partition->num_entries + 1, sizeof(struct pt_flat_node));
+    flat->strings = (char *) malloc(pt_flat_strings_size(partition->trie, -1));
+
+    PtFlatIndex index;
+    pt_flat_freeze_rec(partition->trie, -1, flat, index);
+
+    if (layout == PT_FLAT_LAYOUT_PROFILE && partition->profile != NULL) {
+
+        std::vector<uint32_t> counts(flat->num_nodes, 0);
+        PtProfile::iterator itr;
+
+        // nodes which aren't in the trie anymore aren't in the index either
+        for (itr = partition->profile->begin(); itr != partition->profile->end(); itr++) {
+
+            PtFlatIndex::iterator n = index.find(itr->first);
+
+            if (n != index.end())
+                counts[n->second] = itr->second;
+        }
+
+        pt_flat_relayout_profile(flat, counts);
+
+    } else if (layout != PT_FLAT_LAYOUT_PREORDER) {
+
+        pt_flat_relayout(flat, layout);
+    }
+
+    return flat;
+}
+
+/*
+ * \brief   copy of a flat trie which owns its nodes and strings, e.g. of a
+ *          flat trie mapped from a snapshot, whose strings are the blob of
+ *          all partitions. only the strings referenced by the nodes are
+ *          copied, in node order, and prefix offsets are rebased.
+ */
+struct pt_flat * pt_flat_copy(struct pt_flat * flat) {
+
+    struct pt_flat * copy = (struct pt_flat *) calloc(1, sizeof(struct pt_flat));
+
+    memcpy(copy, flat, sizeof(struct pt_flat));
+    copy->mapped = 0;
+
+    copy->nodes = (struct pt_flat_node *) calloc(flat->num_nodes, sizeof(struct pt_flat_node));
+    memcpy(copy->nodes, flat->nodes, flat->num_nodes * sizeof(struct pt_flat_node));
+
+    copy->strings_size = 0;
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++)
+        copy->strings_size += strlen(flat->strings + flat->nodes[i].prefix) + 1;
+
+    copy->strings = (char *) malloc(copy->strings_size);
+    size_t strings_size = 0;
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++) {
+
+        size_t len = strlen(flat->strings + flat->nodes[i].prefix) + 1;
+
+        memcpy(copy->strings + strings_size, flat->strings + flat->nodes[i].prefix, len);
+        copy->nodes[i].prefix = (uint32_t) strings_size;
+        strings_size += len;
+    }
+
+    return copy;
+}
+
+/*
+ * \brief   appends the children of a node which are in its sub-trie (i.e.
+ *          not upward links) to a list
+ */
+static void pt_flat_children(
+        struct pt_flat * flat,
+        uint32_t node,
+        std::vector<uint32_t> & children) {
+
+    struct pt_flat_node * n = &(flat->nodes[node]);
+
+    if (flat->nodes[n->p_left].key_bit > n->key_bit)
+        children.push_back(n->p_left);
+
+    if (flat->nodes[n->p_right].key_bit > n->key_bit)
+        children.push_back(n->p_right);
+}
+
+/*
+ * \brief   page sized blocks, each filled breadth-first from a block root.
+ *          nodes which don't fit become block roots themselves.
+ */
+static void pt_flat_order_bfs(struct pt_flat * flat, std::vector<uint32_t> & order) {
+
+    uint32_t block = PT_FLAT_BLOCK_SIZE / sizeof(struct pt_flat_node);
+
+    std::deque<uint32_t> roots(1, 0);
+    std::deque<uint32_t> level;
+    std::vector<uint32_t> children;
+
+    while (!roots.empty()) {
+
+        level.assign(1, roots.front());
+        roots.pop_front();
+
+        for (uint32_t n = 0; n < block && !level.empty(); n++) {
+
+            uint32_t node = level.front();
+            level.pop_front();
+
+            order.push_back(node);
+
+            children.clear();
+            pt_flat_children(flat, node, children);
+            level.insert(level.end(), children.begin(), children.end());
+        }
+
+        roots.insert(roots.end(), level.begin(), level.end());
+    }
+}
+
+/*
+ * \brief   van Emde Boas order of the top `levels' levels of the sub-trie
+ *          rooted at node. the nodes right below those are appended to
+ *          bottom.
+ */
+static void pt_flat_order_veb(
+        struct pt_flat * flat,
+        uint32_t node,
+        int levels,
+        std::vector<uint32_t> & order,
+        std::vector<uint32_t> & bottom) {
+
+    if (levels == 1) {
+
+        order.push_back(node);
+        pt_flat_children(flat, node, bottom);
+
+        return;
+    }
+
+    int top = levels / 2;
+    std::vector<uint32_t> middle;
+
+    pt_flat_order_veb(flat, node, top, order, middle);
+
+    for (size_t i = 0; i < middle.size(); i++)
+        pt_flat_order_veb(flat, middle[i], levels - top, order, bottom);
+}
+
+static int pt_flat_height(struct pt_flat * flat) {
+
+    std::vector<uint32_t> level(1, 0), next;
+    int height = 0;
+
+    for ( ; !level.empty(); height++) {
+
+        next.clear();
+
+        for (size_t i = 0; i < level.size(); i++)
+            pt_flat_children(flat, level[i], next);
+
+        level.swap(next);
+    }
+
+    return height;
+}
+
+/*
+ * \brief   re-orders the nodes (and prefix strings) of a flat trie, w/o
+ *          changing its structure
+ *
+ * \param   order   old index of each node, in the new order
+ */
+static void pt_flat_apply_order(struct pt_flat * flat, std::vector<uint32_t> & order) {
+
+    if (order.size() != flat->num_nodes || order[0] != 0) {
+
+        fprintf(stderr, "pt_flat_apply_order() : [ERROR] %d of %d nodes placed\n",
+            (int) order.size(), flat->num_nodes);
+        return;
+    }
+
+    std::vector<uint32_t> index(flat->num_nodes);
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++)
+        index[order[i]] = i;
+
+    struct pt_flat_node * nodes = (struct pt_flat_node *) calloc(flat->num_nodes, sizeof(struct pt_flat_node));
+    char * strings = (char *) malloc(flat->strings_size);
+    size_t strings_size = 0;
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++) {
+
+        memcpy(&(nodes[i]), &(flat->nodes[order[i]]), sizeof(struct pt_flat_node));
+
+        nodes[i].p_left = index[nodes[i].p_left];
+        nodes[i].p_right = index[nodes[i].p_right];
+
+        // strings follow the nodes, so they're close to them as well
+        size_t len = strlen(flat->strings + nodes[i].prefix) + 1;
+
+        memcpy(strings + strings_size, flat->strings + nodes[i].prefix, len);
+        nodes[i].prefix = (uint32_t) strings_size;
+        strings_size += len;
+    }
+
+    free(flat->nodes);
+    free(flat->strings);
+
+    flat->nodes = nodes;
+    flat->strings = strings;
+    flat->strings_size = strings_size;
+}
+
+/*
+ * \brief   re-orders the nodes (and prefix strings) of a flat trie, w/o
+ *          changing its structure
+ *
+ * \param   layout  PT_FLAT_LAYOUT_BFS or PT_FLAT_LAYOUT_VEB. other layouts
+ *                  leave the trie as is.
+ */
+void pt_flat_relayout(struct pt_flat * flat, int layout) {
+
+    if (flat->mapped || flat->num_nodes < 2)
+        return;
+
+    std::vector<uint32_t> order, rest;
+    order.reserve(flat->num_nodes);
+
+    if (layout == PT_FLAT_LAYOUT_BFS) {
+
+        pt_flat_order_bfs(flat, order);
+
+    } else if (layout == PT_FLAT_LAYOUT_VEB) {
+
+        pt_flat_order_veb(flat, 0, pt_flat_height(flat), order, rest);
+
+    } else {
+
+        // pre-order, which is how pt_flat_init() numbers the nodes
+        return;
+    }
+
+    pt_flat_apply_order(flat, order);
+    flat->num_hot = 0;
+}
+
+/*
+ * \brief   hot / cold layout of a flat trie in pre-order (as made by
+ *          pt_flat_freeze_rec()), given the visit counts of its nodes
+ */
+static void pt_flat_relayout_profile(struct pt_flat * flat, std::vector<uint32_t> & counts) {
+
+    if (flat->mapped || flat->num_nodes < 2)
+        return;
+
+    std::vector<uint32_t> by_count(flat->num_nodes);
+    uint64_t total = 0, hot = 0;
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++) {
+
+        by_count[i] = i;
+        total += counts[i];
+    }
+
+    std::stable_sort(by_count.begin(), by_count.end(),
+        [&counts](uint32_t a, uint32_t b) { return counts[a] > counts[b]; });
+
+    // the hot set: the most visited nodes, up to PT_FLAT_HOT_SHARE of the
+    // visits. the root always starts it.
+    std::vector<char> is_hot(flat->num_nodes, 0);
+    uint32_t num_hot = 1;
+
+    is_hot[0] = 1;
+    hot = counts[0];
+
+    for (uint32_t i = 0; i < flat->num_nodes && hot < PT_FLAT_HOT_SHARE * total; i++) {
+
+        if (is_hot[by_count[i]] || counts[by_count[i]] == 0)
+            continue;
+
+        is_hot[by_count[i]] = 1;
+        hot += counts[by_count[i]];
+        num_hot++;
+    }
+
+    // hot and cold nodes, each in pre-order
+    std::vector<uint32_t> order;
+    order.reserve(flat->num_nodes);
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++)
+        if (is_hot[i]) order.push_back(i);
+
+    for (uint32_t i = 0; i < flat->num_nodes; i++)
+        if (!is_hot[i]) order.push_back(i);
+
+    pt_flat_apply_order(flat, order);
+    flat->num_hot = num_hot;
+}
+
+void pt_flat_erase(struct pt_flat * flat) {
+
+    if (!flat)
+        return;
+
+    if (!(flat->mapped)) {
+        free(flat->nodes);
+        free(flat->strings);
+    }
+
+    free(flat);
+}
+
+size_t pt_flat_memory(struct pt_flat * flat) {
+
+    if (!flat)
+        return 0;
+
+    return (sizeof(struct pt_flat)
+        + (flat->num_nodes * sizeof(struct pt_flat_node))
+        + flat->strings_size);
+}
+
+/*
+ * \brief   re-builds the (pointer based) trie of a FIB partition out of a
+ *          flat trie, w/ the same structure. the partition's trie must be
+ *          empty (i.e. just the root).
+ */
+void pt_flat_thaw(struct pt_flat * flat, struct pt_ht * partition) {
+
+    struct pt_fwd ** nodes = (struct pt_fwd **) calloc(flat->num_nodes + 1, sizeof(struct pt_fwd *));
+    uint32_t i = 0;
+
+    // the root is already there
+    nodes[0] = partition->trie;
+
+    for (i = 1; i < flat->num_nodes; i++) {
+
+        struct pt_fwd * f = (struct pt_fwd *) pt_fwd_malloc(sizeof(struct pt_fwd));
+
+        f->fib_root = partition;
+        f->prefix_size = partition->prefix_size;
+        f->port = flat->nodes[i].port;
+
+        f->prefix_rid = (struct click_xia_xid *) pt_fwd_malloc(sizeof(struct click_xia_xid));
+        memcpy(f->prefix_rid, &(flat->nodes[i].rid), sizeof(struct click_xia_xid));
+
+        prefix_info_init(&(f->prefix_i), flat->strings + flat->nodes[i].prefix, partition->prefix_size);
+        f->prefix_fp = prefix_info_fp(f->prefix_i);
+
+        nodes[i] = f;
+    }
+
+    for (i = 0; i < flat->num_nodes; i++) {
+
+        nodes[i]->key_bit = flat->nodes[i].key_bit;
+        nodes[i]->p_left = nodes[flat->nodes[i].p_left];
+        nodes[i]->p_right = nodes[flat->nodes[i].p_right];
+    }
+
+    free(nodes);
+}
+
+static int pt_flat_lookup_rec(
+        struct pt_flat * flat,
+        uint32_t node,
+        int prev_key_bit,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports) {
+
+    struct pt_flat_node * n = &(flat->nodes[node]);
+
+    if (n->key_bit <= prev_key_bit)
+        return 0;
+
+    // the root (default route) has prefix size 0
+    int prefix_size = (node > 0 ? flat->prefix_size : 0);
+    char * prefix = flat->strings + n->prefix;
+
+    uint32_t _req_entry_diff = req_entry_diff(request, prefix, prefix_size);
+
+    int tps = 0, fps = 0, tns = 0;
+    int matches = 0;
+
+    // same as pt_fwd_lookup(): always follow the left branch, follow the
+    // right branch only if the request matches the node up to the key bit
+    if (rid_match_mask(request_rid, &(n->rid), n->key_bit)) {
+
+        if (rid_match(request_rid, &(n->rid)) && (prefix_size > 0)) {
+
+            if (strstr(request, prefix) != NULL)
+                tps = 1;
+            else
+                fps = 1;
+
+        } else {
+
+            tns = 1;
+        }
+
+        matches += (tps + fps + tns);
+
+        lookup_stats_update(
+            &(flat->fib_root->general_stats),
+            _req_entry_diff,
+            tps, fps, tns, 1);
+
+        if (prefix_size > 0) {
+            fp_sizes[prefix_size - 1] += fps;
+            tp_sizes[prefix_size - 1] += tps;
+        }
+
+        if ((tps + fps) > 0 && ports != NULL)
+            pt_port_set_add(ports, n->port);
+
+        matches += pt_flat_lookup_rec(flat, n->p_right, n->key_bit, request, request_size, request_rid, fp_sizes, tp_sizes, ports);
+
+    } else {
+
+        tns = 1;
+        matches += tns;
+
+        lookup_stats_update(
+            &(flat->fib_root->general_stats),
+            _req_entry_diff,
+            tps, fps, tns, 1);
+    }
+
+    matches += pt_flat_lookup_rec(flat, n->p_left, n->key_bit, request, request_size, request_rid, fp_sizes, tp_sizes, ports);
+
+    return matches;
+}
+
+/*
+ * \brief   looks up a request RID in a flat trie, w/ the same behavior and
+ *          stats as pt_fwd_lookup_ports() on the trie it was frozen from.
+ *
+ * \param   ports   port set for the next hops of the matches, NULL if not
+ *                  needed
+ *
+ * \return  nr. of visited nodes
+ */
+int pt_flat_lookup(
+        struct pt_flat * flat,
+        char * request,
+        int request_size,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports) {
+
+    return pt_flat_lookup_rec(flat, 0, -1, request, request_size, request_rid, fp_sizes, tp_sizes, ports);
+}
+
+static struct pt_flat_node * pt_flat_lookup_first_rec(
+        struct pt_flat * flat,
+        uint32_t node,
+        int prev_key_bit,
+        char * request,
+        struct click_xia_xid * request_rid,
+        int * visits) {
+
+    struct pt_flat_node * n = &(flat->nodes[node]);
+    struct pt_flat_node * first = NULL;
+
+    if (n->key_bit <= prev_key_bit)
+        return NULL;
+
+    (*visits)++;
+
+    // same traversal as pt_flat_lookup(), the root (default route) is never
+    // a match
+    if (rid_match_mask(request_rid, &(n->rid), n->key_bit)) {
+
+        if (node > 0 && rid_match(request_rid, &(n->rid))
+            && (request == NULL || strstr(request, flat->strings + n->prefix) != NULL))
+            return n;
+
+        first = pt_flat_lookup_first_rec(flat, n->p_right, n->key_bit, request, request_rid, visits);
+
+        if (first != NULL)
+            return first;
+    }
+
+    return pt_flat_lookup_first_rec(flat, n->p_left, n->key_bit, request, request_rid, visits);
+}
+
+/*
+ * \brief   looks up a request in a flat trie until the 1st confirmed match
+ *          (no stats are updated), same as pt_fwd_lookup_first() on the trie
+ *          it was frozen from.
+ *
+ * \param   request the request name, for TP checks. if NULL, RID matches
+ *                  are trusted as they are.
+ * \param   visits  set to the nr. of visited nodes, if not NULL
+ *
+ * \return  the 1st confirmed match, NULL if none
+ */
+struct pt_flat_node * pt_flat_lookup_first(
+        struct pt_flat * flat,
+        char * request,
+        struct click_xia_xid * request_rid,
+        int * visits) {
+
+    int _visits = 0;
+    struct pt_flat_node * first = pt_flat_lookup_first_rec(flat, 0, -1, request, request_rid, &_visits);
+
+    if (visits != NULL)
+        *visits = _visits;
+
+    return first;
+}
+
+/*
+ * \brief   nodes visited by pt_flat_lookup() for a request
+ */
+static void pt_flat_trace_rec(
+        struct pt_flat * flat,
+        uint32_t node,
+        int prev_key_bit,
+        struct click_xia_xid * request_rid,
+        std::vector<uint32_t> & trace) {
+
+    struct pt_flat_node * n = &(flat->nodes[node]);
+
+    if (n->key_bit <= prev_key_bit)
+        return;
+
+    trace.push_back(node);
+
+    if (rid_match_mask(request_rid, &(n->rid), n->key_bit))
+        pt_flat_trace_rec(flat, n->p_right, n->key_bit, request_rid, trace);
+
+    pt_flat_trace_rec(flat, n->p_left, n->key_bit, request_rid, trace);
+}
+
+/*
+ * \brief   nr. of distinct blocks of block_size byte of the node array
+ *          touched by a trace
+ */
+static uint32_t pt_flat_trace_blocks(std::vector<uint32_t> & trace, size_t block_size) {
+
+    std::vector<uint64_t> blocks(trace.size());
+
+    for (size_t i = 0; i < trace.size(); i++)
+        blocks[i] = ((uint64_t) trace[i] * sizeof(struct pt_flat_node)) / block_size;
+
+    std::sort(blocks.begin(), blocks.end());
+
+    return (uint32_t) (std::unique(blocks.begin(), blocks.end()) - blocks.begin());
+}
+
+/*
+ * \brief   freezes the FIB w/ each layout and compares lookups: time, cache
+ *          lines and pages of the node arrays touched per lookup (counted
+ *          from the nodes a lookup visits, i.e. as if nothing was cached
+ *          between lookups) and, if available, hardware cache and dTLB
+ *          misses (see perf_counters.h). results go to
+ *          <output_dir>/layout-bench.tsv. the partitions must have a trie
+ *          (see pt_ht_thaw()).
+ */
+void pt_flat_layout_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_LAYOUT_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "pt_flat_layout_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    fprintf(output_file, "LAYOUT\tLOOKUPS\tAVG_TIME\tAVG_NODES\tAVG_LINES\tAVG_PAGES\tL1D_MISSES\tLLC_MISSES\tDTLB_MISSES\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "LAYOUT", "TIME (us)", "NODES", "LINES", "PAGES", "L1D MISSES");
+
+    int num_parts = HASH_COUNT(fib);
+    struct pt_flat ** flats = (struct pt_flat **) calloc(num_parts, sizeof(struct pt_flat *));
+    std::vector<uint32_t> trace;
+
+    for (int layout = 0; layout < PT_FLAT_LAYOUTS; layout++) {
+
+        struct pt_ht * itr;
+        int p = 0;
+
+        for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++)
+            flats[p] = pt_flat_init_layout(itr, layout);
+
+        // footprint: what a lookup walks through, per partition
+        uint64_t nodes = 0, lines = 0, pages = 0, lookups = 0;
+
+        for (int i = 0; i < requests_num; i++) {
+
+            for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++) {
+
+                if (itr->prefix_size > requests[i].size)
+                    continue;
+
+                trace.clear();
+                pt_flat_trace_rec(flats[p], 0, -1, requests[i].rid, trace);
+
+                nodes += trace.size();
+                lines += pt_flat_trace_blocks(trace, PT_FLAT_LINE_SIZE);
+                pages += pt_flat_trace_blocks(trace, PT_FLAT_BLOCK_SIZE);
+            }
+
+            lookups++;
+        }
+
+        struct perf_counters pc;
+        perf_counters_init(&pc);
+        perf_counters_start(&pc);
+
+        double begin = get_time_now();
+
+        for (int i = 0; i < requests_num; i++) {
+
+            for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++) {
+
+                if (itr->prefix_size > requests[i].size)
+                    continue;
+
+                pt_flat_lookup(flats[p], requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes, NULL);
+            }
+        }
+
+        double time = (get_time_now() - begin) / (double) (lookups ? lookups : 1);
+
+        perf_counters_stop(&pc);
+
+        char misses[3][32];
+        int events[3] = {PERF_EVENT_L1D_MISSES, PERF_EVENT_LLC_MISSES, PERF_EVENT_DTLB_MISSES};
+
+        for (int e = 0; e < 3; e++) {
+
+            if (perf_counters_available(&pc, events[e]))
+                snprintf(misses[e], 32, "%.3f", (double) pc.values[events[e]] / (double) (lookups ? lookups : 1));
+            else
+                snprintf(misses[e], 32, "n/a");
+        }
+
+        perf_counters_erase(&pc);
+
+        printf("%-10s\t| %-10.3f\t| %-10.1f\t| %-10.1f\t| %-10.1f\t| %-10s\n",
+            PT_FLAT_LAYOUT_STRS[layout], time * 1000000.0,
+            (double) nodes / lookups, (double) lines / lookups, (double) pages / lookups,
+            misses[0]);
+
+        fprintf(output_file, "%s\t%lu\t%-.8f\t%-.3f\t%-.3f\t%-.3f\t%s\t%s\t%s\n",
+            PT_FLAT_LAYOUT_STRS[layout], lookups, time,
+            (double) nodes / lookups, (double) lines / lookups, (double) pages / lookups,
+            misses[0], misses[1], misses[2]);
+
+        for (p = 0; p < num_parts; p++)
+            pt_flat_erase(flats[p]);
+    }
+
+    free(flats);
+    fclose(output_file);
+}
+
+/*
+ * \brief set associative LRU cache model, for cache and TLB misses w/o a PMU
+ */
+struct pt_flat_cache {
+
+    uint32_t sets;
+    uint32_t ways;
+    uint32_t block_bits;
+
+    std::vector<uint64_t> tags;
+    std::vector<uint64_t> stamps;
+
+    uint64_t clock;
+    uint64_t misses;
+};
+
+static void pt_flat_cache_init(struct pt_flat_cache * c, size_t size, uint32_t ways, size_t block_size) {
+
+    c->ways = ways;
+    c->sets = (uint32_t) (size / (block_size * ways));
+    c->block_bits = __builtin_ctzl(block_size);
+
+    c->tags.assign((size_t) c->sets * ways, UINT64_MAX);
+    c->stamps.assign((size_t) c->sets * ways, 0);
+
+    c->clock = 0;
+    c->misses = 0;
+}
+
+static void pt_flat_cache_access(struct pt_flat_cache * c, const void * addr) {
+
+    uint64_t block = ((uintptr_t) addr) >> c->block_bits;
+    uint64_t * tags = &(c->tags[(block % c->sets) * c->ways]);
+    uint64_t * stamps = &(c->stamps[(block % c->sets) * c->ways]);
+    uint32_t lru = 0;
+
+    c->clock++;
+
+    for (uint32_t w = 0; w < c->ways; w++) {
+
+        if (tags[w] == block) {
+            stamps[w] = c->clock;
+            return;
+        }
+
+        if (stamps[w] < stamps[lru])
+            lru = w;
+    }
+
+    tags[lru] = block;
+    stamps[lru] = c->clock;
+    c->misses++;
+}
+
+// L1D (32 KB, 8 way), L2 (1 MB, 16 way) and dTLB (64 x 4 KB pages, 4 way)
+#define PT_FLAT_CACHES  3
+
+static void pt_flat_replay_rec(
+        struct pt_flat * flat,
+        uint32_t node,
+        int prev_key_bit,
+        struct click_xia_xid * request_rid,
+        struct pt_flat_cache * caches) {
+
+    struct pt_flat_node * n = &(flat->nodes[node]);
+
+    for (int c = 0; c < PT_FLAT_CACHES; c++)
+        pt_flat_cache_access(&(caches[c]), n);
+
+    if (n->key_bit <= prev_key_bit)
+        return;
+
+    // the prefix string is read for every visited node
+    for (int c = 0; c < PT_FLAT_CACHES; c++)
+        pt_flat_cache_access(&(caches[c]), flat->strings + n->prefix);
+
+    if (rid_match_mask(request_rid, &(n->rid), n->key_bit))
+        pt_flat_replay_rec(flat, n->p_right, n->key_bit, request_rid, caches);
+
+    pt_flat_replay_rec(flat, n->p_left, n->key_bit, request_rid, caches);
+}
+
+/*
+ * \brief   replays requests on the FIB frozen w/ and w/o the profile of a
+ *          training run (see pt_ht_profile()), and reports the hot set size
+ *          and cache misses per lookup: modeled (L1D, L2 and dTLB, over the
+ *          node and string accesses of the lookups, w/ caches kept warm
+ *          across lookups) and, if available, hardware counts (see
+ *          perf_counters.h). results go to <output_dir>/profile-bench.tsv.
+ *          the partitions must have a trie and a profile.
+ */
+void pt_flat_profile_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_PROFILE_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "pt_flat_profile_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    fprintf(output_file, "LAYOUT\tLOOKUPS\tHOT_NODES\tHOT_BYTES\tAVG_TIME\tL1D_MISSES\tL2_MISSES\tDTLB_MISSES\tHW_L1D_MISSES\tHW_LLC_MISSES\tHW_DTLB_MISSES\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "LAYOUT", "HOT NODES", "HOT (KB)", "TIME (us)", "L1D MISSES", "L2 MISSES", "DTLB MISSES");
+
+    int num_parts = HASH_COUNT(fib);
+    struct pt_flat ** flats = (struct pt_flat **) calloc(num_parts, sizeof(struct pt_flat *));
+    int layouts[2] = {PT_FLAT_LAYOUT_PREORDER, PT_FLAT_LAYOUT_PROFILE};
+    uint64_t num_nodes = 0;
+
+    for (int l = 0; l < 2; l++) {
+
+        struct pt_ht * itr;
+        int p = 0;
+        uint64_t hot_nodes = 0, hot_bytes = 0, lookups = 0;
+
+        for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++) {
+
+            flats[p] = pt_flat_init_layout(itr, layouts[l]);
+
+            if (l == 0)
+                num_nodes += flats[p]->num_nodes;
+
+            // strings of the hot nodes are packed right after each other too
+            hot_nodes += flats[p]->num_hot;
+            hot_bytes += flats[p]->num_hot * sizeof(struct pt_flat_node);
+
+            if (flats[p]->num_hot > 0 && flats[p]->num_hot < flats[p]->num_nodes)
+                hot_bytes += flats[p]->nodes[flats[p]->num_hot].prefix;
+            else if (flats[p]->num_hot > 0)
+                hot_bytes += flats[p]->strings_size;
+        }
+
+        struct pt_flat_cache caches[PT_FLAT_CACHES];
+
+        pt_flat_cache_init(&(caches[0]), 32 * 1024, 8, PT_FLAT_LINE_SIZE);
+        pt_flat_cache_init(&(caches[1]), 1024 * 1024, 16, PT_FLAT_LINE_SIZE);
+        pt_flat_cache_init(&(caches[2]), 64 * 4096, 4, 4096);
+
+        for (int i = 0; i < requests_num; i++) {
+
+            for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++) {
+
+                if (itr->prefix_size > requests[i].size)
+                    continue;
+
+                pt_flat_replay_rec(flats[p], 0, -1, requests[i].rid, caches);
+            }
+
+            lookups++;
+        }
+
+        struct perf_counters pc;
+        perf_counters_init(&pc);
+        perf_counters_start(&pc);
+
+        double begin = get_time_now();
+
+        for (int i = 0; i < requests_num; i++) {
+
+            for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++) {
+
+                if (itr->prefix_size > requests[i].size)
+                    continue;
+
+                pt_flat_lookup(flats[p], requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes, NULL);
+            }
+        }
+
+        double time = (get_time_now() - begin) / (double) (lookups ? lookups : 1);
+
+        perf_counters_stop(&pc);
+
+        char misses[3][32];
+        int events[3] = {PERF_EVENT_L1D_MISSES, PERF_EVENT_LLC_MISSES, PERF_EVENT_DTLB_MISSES};
+
+        for (int e = 0; e < 3; e++) {
+
+            if (perf_counters_available(&pc, events[e]))
+                snprintf(misses[e], 32, "%.3f", (double) pc.values[events[e]] / (double) (lookups ? lookups : 1));
+            else
+                snprintf(misses[e], 32, "n/a");
+        }
+
+        perf_counters_erase(&pc);
+
+        lookups = (lookups ? lookups : 1);
+
+        printf("%-10s\t| %-10lu\t| %-10.1f\t| %-10.3f\t| %-10.1f\t| %-10.1f\t| %-10.1f\n",
+            PT_FLAT_LAYOUT_STRS[layouts[l]], hot_nodes, hot_bytes / 1024.0, time * 1000000.0,
+            (double) caches[0].misses / lookups, (double) caches[1].misses / lookups, (double) caches[2].misses / lookups);
+
+        fprintf(output_file, "%s\t%lu\t%lu\t%lu\t%-.8f\t%-.3f\t%-.3f\t%-.3f\t%s\t%s\t%s\n",
+            PT_FLAT_LAYOUT_STRS[layouts[l]], lookups, hot_nodes, hot_bytes, time,
+            (double) caches[0].misses / lookups, (double) caches[1].misses / lookups, (double) caches[2].misses / lookups,
+            misses[0], misses[1], misses[2]);
+
+        if (layouts[l] == PT_FLAT_LAYOUT_PROFILE)
+            printf("\n[HOT_SET]: %lu of %lu nodes (%.2f%%), %.1f KB\n",
+                hot_nodes, num_nodes, 100.0 * (double) hot_nodes / (double) num_nodes, hot_bytes / 1024.0);
+
+        for (p = 0; p < num_parts; p++)
+            pt_flat_erase(flats[p]);
+    }
+
+    free(flats);
+    fclose(output_file);
+}
@@ -0,0 +1,131 @@
+/*
+ * rcu.c
+ *
+ * epoch-based reclamation.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "rcu.h"
+
+struct rcu_domain * rcu_init() {
+
+    struct rcu_domain * rcu = NULL;
+
+    if (posix_memalign((void **) &rcu, RCU_CACHE_LINE, sizeof(struct rcu_domain)) != 0)
+        return NULL;
+
+    memset(rcu, 0, sizeof(struct rcu_domain));
+
+    // epoch 0 would be mistaken for an idle reader slot
+    rcu->epoch = 1;
+
+    return rcu;
+}
+
+static void rcu_free_list(struct rcu_domain * rcu, int list) {
+
+    struct rcu_retired * r = rcu->retired[list], * next = NULL;
+
+    for ( ; r != NULL; r = next) {
+
+        next = r->next;
+
+        r->free_fn(r->ptr);
+        free(r);
+
+        rcu->num_reclaimed++;
+    }
+
+    rcu->retired[list] = NULL;
+}
+
+/*
+ * \brief   frees all retired nodes and the domain itself. there must be no
+ *          active readers left.
+ */
+void rcu_erase(struct rcu_domain * rcu) {
+
+    if (!rcu)
+        return;
+
+    for (int i = 0; i < RCU_EPOCHS; i++)
+        rcu_free_list(rcu, i);
+
+    free(rcu);
+}
+
+/*
+ * \brief   registers a reader. must be called before readers are started.
+ *
+ * \return  the reader's id (for rcu_read_lock() and rcu_read_unlock()), -1
+ *          if there are RCU_MAX_READERS already
+ */
+int rcu_register(struct rcu_domain * rcu) {
+
+    if (rcu->num_readers == RCU_MAX_READERS)
+        return -1;
+
+    return rcu->num_readers++;
+}
+
+/*
+ * \brief   hands an unlinked node over to the domain, which frees it w/
+ *          free_fn once no reader can hold a reference to it anymore.
+ *          writers only.
+ */
+void rcu_retire(struct rcu_domain * rcu, void * ptr, void (*free_fn)(void *)) {
+
+    struct rcu_retired * r = (struct rcu_retired *) malloc(sizeof(struct rcu_retired));
+
+    r->ptr = ptr;
+    r->free_fn = free_fn;
+
+    int list = rcu->epoch % RCU_EPOCHS;
+
+    r->next = rcu->retired[list];
+    rcu->retired[list] = r;
+
+    rcu->num_retired++;
+}
+
+/*
+ * \brief   tries to advance the global epoch and frees the nodes which are
+ *          then safe to free. never blocks. writers only.
+ *
+ * \return  1 if the epoch was advanced, 0 if some reader is still in an
+ *          older epoch
+ */
+int rcu_reclaim(struct rcu_domain * rcu) {
+
+    uint64_t epoch = rcu->epoch;
+
+    for (uint32_t i = 0; i < rcu->num_readers; i++) {
+
+        uint64_t state = __atomic_load_n(&(rcu->readers[i].state), __ATOMIC_SEQ_CST);
+
+        if ((state & 1) && (state >> 1) != epoch)
+            return 0;
+    }
+
+    __atomic_store_n(&(rcu->epoch), epoch + 1, __ATOMIC_SEQ_CST);
+
+    // all active readers are in epoch, i.e. started after all nodes retired
+    // in epoch - 1 were unlinked, so these are unreachable
+    rcu_free_list(rcu, (epoch + RCU_EPOCHS - 1) % RCU_EPOCHS);
+
+    return 1;
+}
@@ -0,0 +1,504 @@
+/*
+ * rid_cache.c
+ *
+ * lookup result cache in front of a RID FIB (see rid_cache.h).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <malloc.h>
+#include <math.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "rid_cache.h"
+
+// heap bytes held by a block, incl. malloc() overhead
+static __inline size_t rid_cache_block_size(void * ptr) {
+
+    return (ptr != NULL ? malloc_usable_size(ptr) + sizeof(size_t) : 0);
+}
+
+static __inline void rid_cache_key_init(
+        struct rid_cache_key * key,
+        const char * request,
+        struct click_xia_xid * rid,
+        int request_size) {
+
+    memcpy(key->rid, rid->id, CLICK_XIA_XID_ID_LEN);
+    key->request_size = (uint32_t) request_size;
+    key->name_hash = fnv1a(FNV_OFFSET_BASIS, request, strlen(request));
+}
+
+/*
+ * \brief   shard of a key: FNV-1a over the key bytes. RIDs are Bloom
+ *          filters, so their bits alone are far from uniform.
+ */
+static __inline struct rid_cache_shard * rid_cache_shard(
+        struct rid_cache * cache,
+        struct rid_cache_key * key) {
+
+    uint64_t hash = fnv1a(FNV_OFFSET_BASIS, key, sizeof(struct rid_cache_key));
+
+    hash ^= (hash >> 32);
+
+    return &(cache->shards[hash & (RID_CACHE_SHARDS - 1)]);
+}
+
+/*
+ * \brief   allocates a cache of (at most) capacity entries, split evenly
+ *          over the shards.
+ */
+struct rid_cache * rid_cache_init(uint32_t capacity) {
+
+    struct rid_cache * cache = NULL;
+
+    if (posix_memalign((void **) &cache, RID_CACHE_LINE, sizeof(struct rid_cache)) != 0)
+        return NULL;
+
+    memset(cache, 0, sizeof(struct rid_cache));
+
+    for (int i = 0; i < RID_CACHE_SHARDS; i++) {
+
+        pthread_mutex_init(&(cache->shards[i].lock), NULL);
+        cache->shards[i].capacity = std::max(1U, (capacity + RID_CACHE_SHARDS - 1) / RID_CACHE_SHARDS);
+    }
+
+    return cache;
+}
+
+void rid_cache_erase(struct rid_cache * cache) {
+
+    struct rid_cache_entry * itr, * tmp;
+
+    if (!cache)
+        return;
+
+    for (int i = 0; i < RID_CACHE_SHARDS; i++) {
+
+        HASH_ITER(hh, cache->shards[i].entries, itr, tmp) {
+
+            HASH_DELETE(hh, cache->shards[i].entries, itr);
+            free(itr);
+        }
+
+        pthread_mutex_destroy(&(cache->shards[i].lock));
+    }
+
+    free(cache);
+}
+
+/*
+ * \brief   looks up the result for a request. a hit moves the entry to the
+ *          tail of its shard's LRU list.
+ *
+ * \param   request the request name (hashed into the key)
+ * \param   parts   parts of the result which are needed (RID_CACHE_LPM and /
+ *                  or RID_CACHE_MATCHES). entries w/o all of them are misses.
+ *
+ * \return  1 on a hit (result is filled), 0 otherwise
+ */
+int rid_cache_lookup(
+        struct rid_cache * cache,
+        const char * request,
+        struct click_xia_xid * rid,
+        int request_size,
+        uint8_t parts,
+        struct rid_cache_result * result) {
+
+    struct rid_cache_key key;
+    rid_cache_key_init(&key, request, rid, request_size);
+
+    struct rid_cache_shard * shard = rid_cache_shard(cache, &key);
+    struct rid_cache_entry * e = NULL;
+    int hit = 0;
+
+    uint64_t generation = rid_cache_generation(cache);
+
+    pthread_mutex_lock(&(shard->lock));
+
+    HASH_FIND(hh, shard->entries, &key, sizeof(struct rid_cache_key), e);
+
+    // entries from before the last FIB update are misses
+    if (e != NULL && e->generation == generation && (e->result.parts & parts) == parts) {
+
+        HASH_DELETE(hh, shard->entries, e);
+        HASH_ADD(hh, shard->entries, key, sizeof(struct rid_cache_key), e);
+
+        memcpy(result, &(e->result), sizeof(struct rid_cache_result));
+
+        shard->hits++;
+        hit = 1;
+
+    } else {
+
+        shard->misses++;
+    }
+
+    pthread_mutex_unlock(&(shard->lock));
+
+    return hit;
+}
+
+/*
+ * \brief   caches the result for a request. the parts of result are added
+ *          to the request's entry, if it's up-to-date. if the shard is full,
+ *          its least recently used entry is evicted.
+ *
+ * \param   generation  generation before the result was computed (see
+ *                      rid_cache_generation()). if the FIB was updated
+ *                      since, the result may be outdated and isn't cached.
+ */
+void rid_cache_insert(
+        struct rid_cache * cache,
+        const char * request,
+        struct click_xia_xid * rid,
+        int request_size,
+        struct rid_cache_result * result,
+        uint64_t generation) {
+
+    struct rid_cache_key key;
+    rid_cache_key_init(&key, request, rid, request_size);
+
+    struct rid_cache_shard * shard = rid_cache_shard(cache, &key);
+    struct rid_cache_entry * e = NULL;
+    int merge = 0;
+
+    pthread_mutex_lock(&(shard->lock));
+
+    if (generation != rid_cache_generation(cache)) {
+
+        pthread_mutex_unlock(&(shard->lock));
+        return;
+    }
+
+    HASH_FIND(hh, shard->entries, &key, sizeof(struct rid_cache_key), e);
+
+    // outdated entries (or entries cached meanwhile by another thread) and
+    // evicted ones are re-used. up-to-date entries keep their other parts.
+    if (e != NULL) {
+
+        HASH_DELETE(hh, shard->entries, e);
+        merge = (e->generation == generation);
+
+    } else if (HASH_COUNT(shard->entries) >= shard->capacity) {
+
+        e = shard->entries;
+        HASH_DELETE(hh, shard->entries, e);
+
+    } else {
+
+        e = (struct rid_cache_entry *) malloc(sizeof(struct rid_cache_entry));
+    }
+
+    if (!merge) {
+
+        memcpy(&(e->key), &key, sizeof(struct rid_cache_key));
+        e->generation = generation;
+        memset(&(e->result), 0, sizeof(struct rid_cache_result));
+    }
+
+    if (result->parts & RID_CACHE_LPM) {
+
+        e->result.lpm_size = result->lpm_size;
+        e->result.next_hop = result->next_hop;
+    }
+
+    if (result->parts & RID_CACHE_MATCHES) {
+
+        memcpy(e->result.fp_sizes, result->fp_sizes, sizeof(result->fp_sizes));
+        memcpy(e->result.tp_sizes, result->tp_sizes, sizeof(result->tp_sizes));
+        memcpy(&(e->result.ports), &(result->ports), sizeof(struct pt_port_set));
+    }
+
+    e->result.parts |= result->parts;
+
+    HASH_ADD(hh, shard->entries, key, sizeof(struct rid_cache_key), e);
+
+    pthread_mutex_unlock(&(shard->lock));
+}
+
+uint64_t rid_cache_generation(struct rid_cache * cache) {
+
+    return __atomic_load_n(&(cache->generation), __ATOMIC_ACQUIRE);
+}
+
+/*
+ * \brief   invalidates all entries, e.g. after a FIB update. entries are
+ *          only dropped (or re-used) when looked up or inserted again.
+ */
+void rid_cache_invalidate(struct rid_cache * cache) {
+
+    __atomic_add_fetch(&(cache->generation), 1, __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&(cache->invalidations), 1, __ATOMIC_RELAXED);
+}
+
+double rid_cache_hit_rate(struct rid_cache * cache) {
+
+    uint64_t hits = 0, misses = 0;
+
+    for (int i = 0; i < RID_CACHE_SHARDS; i++) {
+
+        pthread_mutex_lock(&(cache->shards[i].lock));
+        hits += cache->shards[i].hits;
+        misses += cache->shards[i].misses;
+        pthread_mutex_unlock(&(cache->shards[i].lock));
+    }
+
+    return ((hits + misses) > 0 ? (double) hits / (double) (hits + misses) : 0.0);
+}
+
+/*
+ * \brief   memory held by a cache (shards, entries and hash table buckets),
+ *          in byte.
+ */
+size_t rid_cache_memory(struct rid_cache * cache) {
+
+    struct rid_cache_entry * itr;
+    size_t memory = rid_cache_block_size(cache);
+
+    for (int i = 0; i < RID_CACHE_SHARDS; i++) {
+
+        pthread_mutex_lock(&(cache->shards[i].lock));
+
+        if (cache->shards[i].entries != NULL) {
+
+            UT_hash_table * tbl = cache->shards[i].entries->hh.tbl;
+            memory += rid_cache_block_size(tbl) + rid_cache_block_size(tbl->buckets);
+
+            for (itr = cache->shards[i].entries; itr != NULL; itr = (struct rid_cache_entry *) itr->hh.next)
+                memory += rid_cache_block_size(itr);
+        }
+
+        pthread_mutex_unlock(&(cache->shards[i].lock));
+    }
+
+    return memory;
+}
+
+/*
+ * \brief   a stream of request indexes, w/ Zipf distributed popularity (of
+ *          exponent s) over a random ranking of the requests.
+ */
+static void rid_cache_zipf_stream(
+        int requests_num,
+        double s,
+        std::vector<int> & stream) {
+
+    std::vector<int> ranks(requests_num);
+    std::vector<double> cdf(requests_num);
+    double total = 0.0;
+    int i = 0;
+
+    for (i = 0; i < requests_num; i++) {
+
+        ranks[i] = i;
+        total += 1.0 / pow((double) (i + 1), s);
+        cdf[i] = total;
+    }
+
+    for (i = requests_num - 1; i > 0; i--)
+        std::swap(ranks[i], ranks[rand() % (i + 1)]);
+
+    for (i = 0; i < (int) stream.size(); i++) {
+
+        double u = ((double) rand() / ((double) RAND_MAX + 1.0)) * total;
+        int r = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+
+        stream[i] = ranks[std::min(r, requests_num - 1)];
+    }
+}
+
+static double rid_cache_percentile(std::vector<double> & latencies, double p) {
+
+    return latencies[std::min(latencies.size() - 1, (size_t) (p * latencies.size()))];
+}
+
+/*
+ * \brief   latency of LPM forwarding (see pt_ht_next_hop(), w/ name checks)
+ *          w/ and w/o the cache, under Zipf workloads (see
+ *          RID_CACHE_BENCH_ZIPF) drawn from the requests. for each exponent,
+ *          a stream of RID_CACHE_BENCH_LOOKUPS lookups is run:
+ *
+ *  -# w/o cache, i.e. w/ pt_cache unset
+ *  -# through an (initially empty) cache of capacity entries, set as
+ *     pt_cache, w/ hit rate and memory. answers are checked against the
+ *     uncached ones.
+ *  -# through an empty cache again, w/ FIB updates (an entry added every
+ *     RID_CACHE_BENCH_UPDATES lookups, and removed later on), to check
+ *     that no outdated result is ever returned.
+ *
+ * results go to <output_dir>/cache-bench.tsv. pt_cache is restored
+ * afterwards.
+ */
+void rid_cache_bench(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        uint32_t capacity,
+        std::string output_dir) {
+
+    double zipf[] = RID_CACHE_BENCH_ZIPF;
+    int zipf_num = sizeof(zipf) / sizeof(double);
+
+    std::vector<int> stream(RID_CACHE_BENCH_LOOKUPS);
+    std::vector<uint16_t> answers(RID_CACHE_BENCH_LOOKUPS);
+    std::vector<double> plain_latencies(RID_CACHE_BENCH_LOOKUPS), cache_latencies(RID_CACHE_BENCH_LOOKUPS);
+
+    uint32_t mismatches = 0, stale = 0, zipf_stale = 0;
+    uint16_t next_hop = PT_PORT_NONE, expected = PT_PORT_NONE;
+    double begin = 0.0;
+    int i = 0, z = 0;
+
+    if (requests_num < 1)
+        return;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_CACHE_BENCH_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+
+    if (!output_file) {
+
+        fprintf(stderr, "rid_cache_bench() : [ERROR] couldn't open %s\n", filename.c_str());
+        return;
+    }
+
+    struct rid_cache * prev_cache = pt_cache;
+    struct rid_cache * cache = NULL;
+
+    fprintf(output_file, "ZIPF_S\tCAPACITY\tLOOKUPS\tHIT_RATE\tMEMORY\tAVG_TIME\tCACHE_AVG_TIME\tP99_TIME\tCACHE_P99_TIME\tINVALIDATIONS\tSTALE\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-6s\t| %-8s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-10s\t| %-8s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "ZIPF S", "HIT RATE", "MEM. (KB)", "AVG (us)", "CACHE (us)", "P99 (us)", "CACHE P99", "SPEEDUP");
+
+    for (z = 0; z < zipf_num; z++) {
+
+        rid_cache_zipf_stream(requests_num, zipf[z], stream);
+
+        // 1) w/o cache
+        pt_cache = NULL;
+
+        for (i = 0; i < RID_CACHE_BENCH_LOOKUPS; i++) {
+
+            struct rid_request * r = &(requests[stream[i]]);
+
+            begin = get_time_now();
+            answers[i] = pt_ht_next_hop(fib, r->name, r->size, r->rid, 1, PT_READER_NONE);
+            plain_latencies[i] = (get_time_now() - begin) * 1000000.0;
+        }
+
+        // 2) w/ cache
+        pt_cache = cache = rid_cache_init(capacity);
+
+        for (i = 0; i < RID_CACHE_BENCH_LOOKUPS; i++) {
+
+            struct rid_request * r = &(requests[stream[i]]);
+
+            begin = get_time_now();
+            next_hop = pt_ht_next_hop(fib, r->name, r->size, r->rid, 1, PT_READER_NONE);
+            cache_latencies[i] = (get_time_now() - begin) * 1000000.0;
+
+            mismatches += (next_hop != answers[i]);
+        }
+
+        double hit_rate = rid_cache_hit_rate(cache);
+        size_t memory = rid_cache_memory(cache);
+        rid_cache_erase(cache);
+
+        // 3) w/ cache and FIB updates, which invalidate pt_cache. the new
+        // entries are request names, so they change some next hops.
+        pt_cache = cache = rid_cache_init(capacity);
+
+        char prefix[PREFIX_MAX_LENGTH];
+        struct click_xia_xid rid;
+        struct pt_ht * s = NULL;
+        int prefix_size = 0, added = 0;
+
+        zipf_stale = 0;
+
+        for (i = 0; i < RID_CACHE_BENCH_LOOKUPS; i++) {
+
+            if (i % RID_CACHE_BENCH_UPDATES == 0) {
+
+                // a new entry, out of a random request name
+                prefix_size = pt_ht_url_to_rid(requests[rand() % requests_num].name, prefix, &rid, NULL);
+                s = (prefix_size > 0 ? pt_ht_search(fib, prefix_size) : NULL);
+                added = (s != NULL && pt_ht_partition_add(s, &rid, prefix, prefix_size, rand() % PT_MAX_PORTS) == 0);
+
+            } else if (i % RID_CACHE_BENCH_UPDATES == RID_CACHE_BENCH_UPDATES / 2 && added) {
+
+                pt_ht_partition_remove(s, &rid, prefix);
+                added = 0;
+            }
+
+            struct rid_request * r = &(requests[stream[i]]);
+
+            next_hop = pt_ht_next_hop(fib, r->name, r->size, r->rid, 1, PT_READER_NONE);
+
+            pt_cache = NULL;
+            expected = pt_ht_next_hop(fib, r->name, r->size, r->rid, 1, PT_READER_NONE);
+            pt_cache = cache;
+
+            zipf_stale += (next_hop != expected);
+        }
+
+        stale += zipf_stale;
+
+        // leave the FIB as it was
+        if (added)
+            pt_ht_partition_remove(s, &rid, prefix);
+
+        uint64_t invalidations = cache->invalidations;
+        pt_cache = NULL;
+        rid_cache_erase(cache);
+
+        double plain_avg = 0.0, cache_avg = 0.0;
+
+        for (i = 0; i < RID_CACHE_BENCH_LOOKUPS; i++) {
+            plain_avg += plain_latencies[i] / (double) RID_CACHE_BENCH_LOOKUPS;
+            cache_avg += cache_latencies[i] / (double) RID_CACHE_BENCH_LOOKUPS;
+        }
+
+        std::sort(plain_latencies.begin(), plain_latencies.end());
+        std::sort(cache_latencies.begin(), cache_latencies.end());
+
+        double plain_p99 = rid_cache_percentile(plain_latencies, 0.99);
+        double cache_p99 = rid_cache_percentile(cache_latencies, 0.99);
+
+        printf("%-6.2f\t| %-8.4f\t| %-10.1f\t| %-10.3f\t| %-10.3f\t| %-10.3f\t| %-10.3f\t| %-8.2f\n",
+            zipf[z], hit_rate, (double) memory / 1024.0,
+            plain_avg, cache_avg, plain_p99, cache_p99,
+            (cache_avg > 0.0 ? plain_avg / cache_avg : 0.0));
+
+        fprintf(output_file, "%-.2f\t%d\t%d\t%-.6f\t%lu\t%-.6f\t%-.6f\t%-.6f\t%-.6f\t%lu\t%d\n",
+            zipf[z], capacity, RID_CACHE_BENCH_LOOKUPS, hit_rate, (unsigned long) memory,
+            plain_avg, cache_avg, plain_p99, cache_p99,
+            (unsigned long) invalidations, zipf_stale);
+    }
+
+    printf("\n");
+
+    pt_cache = prev_cache;
+
+    if (mismatches > 0 || stale > 0)
+        fprintf(stderr, "rid_cache_bench() : [ERROR] %d cached results differ from the FIB's, %d outdated\n",
+            mismatches, stale);
+
+    fclose(output_file);
+}
@@ -55,6 +55,22 @@
 #include "threadpool.h"
 
 #include "pt.h"
+#include "scan.h"
+#include "pt_dir.h"
+#include "mbt.h"
+#include "louds.h"
+#include "name_lpm.h"
+#include "fib_compress.h"
+#include "rid_cache.h"
+#include "prefix_dict.h"
+#include "bit_order.h"
+#include "pt_bulk.h"
+#include "snapshot.h"
+#include "delta.h"
+#include "churn.h"
+#include "fib_version.h"
+#include "hp_arena.h"
+#include "perf_counters.h"
 #include "lookup_stats.h"
 #include "rid_utils.h"
 
@@ -73,6 +89,36 @@
 #define OPTION_MIN_PREFIX_SIZE      (char *) "min-prefix-size"
 #define OPTION_TABLE_SIZE           (char *) "table-size"
 #define OPTION_RANDOM               (char *) "random"
+#define OPTION_SCAN_BENCH           (char *) "scan-bench"
+#define OPTION_ENGINE               (char *) "engine"
+#define OPTION_DIR_BITS             (char *) "dir-bits"
+#define OPTION_DIR_BENCH            (char *) "dir-bench"
+#define OPTION_MBT_BENCH            (char *) "mbt-bench"
+#define OPTION_BIT_ORDER            (char *) "bit-order"
+#define OPTION_BULK_LOAD            (char *) "bulk-load"
+#define OPTION_SNAPSHOT_SAVE        (char *) "snapshot-save"
+#define OPTION_SNAPSHOT_LOAD        (char *) "snapshot-load"
+#define OPTION_SNAPSHOT_VERIFY      (char *) "snapshot-verify"
+#define OPTION_DELTA_FILE           (char *) "delta-file"
+#define OPTION_DELTA_CREATE         (char *) "delta-create"
+#define OPTION_DELTA_MERGE          (char *) "delta-merge"
+#define OPTION_DELTA_BENCH          (char *) "delta-bench"
+#define OPTION_CHURN_BENCH          (char *) "churn-bench"
+#define OPTION_RCU_BENCH            (char *) "rcu-bench"
+#define OPTION_COW_BENCH            (char *) "cow-bench"
+#define OPTION_HUGE_PAGES           (char *) "huge-pages"
+#define OPTION_PERF_COUNTERS        (char *) "perf-counters"
+#define OPTION_FLAT_LAYOUT          (char *) "flat-layout"
+#define OPTION_LAYOUT_BENCH         (char *) "layout-bench"
+#define OPTION_PROFILE_LAYOUT       (char *) "profile-layout"
+#define OPTION_LOUDS_BENCH          (char *) "louds-bench"
+#define OPTION_CLASSIFY_BENCH       (char *) "classify-bench"
+#define OPTION_NAME_LPM_BENCH       (char *) "name-lpm-bench"
+#define OPTION_STATS_BENCH          (char *) "stats-bench"
+#define OPTION_LPM_BENCH            (char *) "lpm-bench"
+#define OPTION_FIB_COMPRESS         (char *) "fib-compress"
+#define OPTION_CACHE_BENCH          (char *) "cache-bench"
+#define OPTION_CACHE                (char *) "cache"
 
 using namespace std;
 using namespace CommandLineProcessing;
@@ -132,6 +178,226 @@ ArgvParser * create_argv_parser() {
                 "a probability of 50\%. by default, it's false.",
             ArgvParser::NoOptionAttribute);
 
+    cmds->defineOption(
+            OPTION_ENGINE,
+            "lookup engine for the FIB partitions: 'pt', 'scan', 'bitslice', "\
+                "'dir', 'mbt', 'flat', 'louds' or 'auto'. "\
+                "'auto' picks an engine per prefix size |F|, based on a "\
+                "calibration run. default is 'pt'. NOTE: "\
+                "engines count TNs (and LOOKUPs) and |F\\R| "\
+                "(req-entry-diff.tsv) differently: the PT, 'dir', 'flat' and "\
+                "'louds' count visited nodes and |F\\R| of each, 'scan' and "\
+                "'bitslice' count all non-matching entries as TNs and |F\\R| "\
+                "of matches only, 'mbt' does the same for the entries of "\
+                "visited buckets. w/ 'auto', entry.tsv mixes these definitions "\
+                "across partitions.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_DIR_BITS,
+            "nr. of top RID bits (k) indexing the sub-trie directory of the "\
+                "'dir' engine. default is 8.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_DIR_BENCH,
+            "after the simulation, report the memory vs. lookup time "\
+                "trade-off of the 'dir' engine for k = 0, 2, ..., 20.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_SNAPSHOT_SAVE,
+            "write the FIB to a binary snapshot file, once built.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_SNAPSHOT_LOAD,
+            "mmap() the FIB from a binary snapshot file instead of building "\
+                "it. the URL file is still read to generate requests.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_SNAPSHOT_VERIFY,
+            "verify the checksum of the whole snapshot on load (reads the "\
+                "whole file). the header is always checked.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_DELTA_FILE,
+            "binary FIB delta file. the delta is applied to the FIB once "\
+                "built (or loaded from a snapshot), before the simulation.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_DELTA_CREATE,
+            "create the delta file given w/ --delta-file out of a .txt file "\
+                "w/ 1 URL per line, prefixed by '+' (add) or '-' (remove), "\
+                "and exit. added URLs may be followed by a next hop (port), "\
+                "as in the URL file.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_DELTA_MERGE,
+            "merge the delta given w/ --delta-file into the snapshot given "\
+                "w/ --snapshot-load, write the result to a new snapshot file "\
+                "and exit.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_DELTA_BENCH,
+            "after the simulation, report the cost of applying deltas of "\
+                "1k, 10k and 100k updates to the FIB.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_CHURN_BENCH,
+            "after the simulation, apply a stream of N online updates (adds "\
+                "and removes of URLs, equally likely) to the FIB and report "\
+                "updates per second.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_RCU_BENCH,
+            "after the simulation, look up the requests while online "\
+                "updates run concurrently, at the given rate (updates per "\
+                "second), and report the lookup latency distribution (p99).",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_COW_BENCH,
+            "after the simulation, build a new FIB version w/ N updates in "\
+                "the background while looking up the requests, swap it in "\
+                "and report the lookup latency before, during and after.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_HUGE_PAGES,
+            "allocate the FIB trie nodes and RIDs from 2 MB huge pages: "\
+                "'thp' (transparent) or 'explicit' (hugetlbfs, reserved in "\
+                "/proc/sys/vm/nr_hugepages). default is 'none' (malloc()).",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_PERF_COUNTERS,
+            "count page faults, dTLB and cache misses during the lookup "\
+                "phase (w/ perf_event_open()) and append them to "\
+                "perf-counters.tsv.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_FLAT_LAYOUT,
+            "node order of flat (frozen) tries and snapshots: 'preorder', "\
+                "'bfs' (page sized blocks, filled breadth-first) or 'veb' "\
+                "(van Emde Boas). default is 'preorder'.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_LAYOUT_BENCH,
+            "after the simulation, freeze the FIB w/ each flat trie layout "\
+                "and report lookup time, cache lines and pages touched and "\
+                "cache misses per lookup.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_PROFILE_LAYOUT,
+            "record node visit counts w/ a training run over half the "\
+                "requests, and freeze flat tries (and snapshots) w/ the hot "\
+                "nodes first. after the simulation, replay the other half "\
+                "and report the hot set size and cache misses per lookup "\
+                "vs. 'preorder'.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_BULK_LOAD,
+            "build the FIB tries in bulk: collect all prefixes first, then "\
+                "build each trie bottom-up out of its radix sorted RIDs, w/ "\
+                "1 thread per prefix size |F|.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_BIT_ORDER,
+            "order of the RID bits in the FIB tries: 'identity' or 'entropy'. "\
+                "'entropy' re-orders the bits of all entries and requests by "\
+                "decreasing entropy of their set frequency over the FIB, and "\
+                "reports trie depth and nodes visited per lookup vs. "\
+                "'identity'. default is 'identity'.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_MBT_BENCH,
+            "after the simulation, compare the binary PT w/ the multi-bit "\
+                "trie engine (depth, nodes visited per lookup, memory and "\
+                "lookup time), per prefix size |F|.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_CLASSIFY_BENCH,
+            "after the simulation, report the share of PT lookup time which "\
+                "goes into TP / FP classification and |F\\R| counts, per "\
+                "classification mode ('scan' or 'masks').",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_LPM_BENCH,
+            "after the simulation, report the lookup latency distribution "\
+                "of LPM forwarding (partitions searched from the largest |F| "\
+                "down, until the 1st match, w/ and w/o checking RID matches "\
+                "against the request name) vs. an exhaustive lookup.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_FIB_COMPRESS,
+            "before the simulation, remove the FIB entries w/ the same next "\
+                "hop as their longest covering entry (next hops are given in "\
+                "an optional 2nd column of the URL file), and report the "\
+                "removed entries, memory saved and lookup speedup per prefix "\
+                "size |F|.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_CACHE,
+            "look up the requests of the simulation through a result cache "\
+                "of N entries (keyed by request RID and size), and report its "\
+                "hit rate. hits don't update the partition stats, so "\
+                "gen-stats.tsv only counts misses.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_CACHE_BENCH,
+            "after the simulation, put a lookup result cache of N entries "\
+                "(keyed by request RID) in front of the FIB, and report hit "\
+                "rate, memory and lookup latency w/ vs. w/o the cache under "\
+                "Zipf workloads.",
+            ArgvParser::OptionRequiresValue);
+
+    cmds->defineOption(
+            OPTION_STATS_BENCH,
+            "after the simulation, time PT lookups w/ full stats (as in the "\
+                "simulation) vs. w/o stats (match set only), per prefix size "\
+                "|F|, i.e. the true forwarding cost.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_NAME_LPM_BENCH,
+            "build an exact name-based FIB (LPM on URL components, 1 hash "\
+                "table per prefix size) out of the same URLs and, after the "\
+                "simulation, compare it w/ the RID FIB (memory and lookup "\
+                "time) and use its LPM answers as ground truth for the FPs.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_LOUDS_BENCH,
+            "after the simulation, compare the binary PT w/ the succinct "\
+                "(LOUDS) trie engine (bytes per entry and lookup time), per "\
+                "prefix size |F|.",
+            ArgvParser::NoOptionAttribute);
+
+    cmds->defineOption(
+            OPTION_SCAN_BENCH,
+            "after the simulation, compare the lookup times of the PT, "\
+                "linear scan and bit-sliced engines, per prefix size |F|.",
+            ArgvParser::NoOptionAttribute);
+
     return cmds;
 }
 
@@ -341,6 +607,34 @@ int main(int argc, char **argv) {
     int table_size = TABLE_SIZE_LIMIT;
     
     bool random = false;
+    bool scan_bench = false;
+    bool dir_bench = false;
+    bool mbt_bench = false;
+    bool bit_order = false;
+    bool bulk_load = false;
+    bool snapshot_verify = false;
+    char snapshot_save_file[128] = {0};
+    char snapshot_load_file[128] = {0};
+    bool delta_bench_run = false;
+    int churn_updates = 0;
+    double rcu_update_rate = 0.0;
+    int cow_updates = 0;
+    int cache_capacity = 0;
+    int cache_entries = 0;
+    int huge_pages = HP_MODE_NONE;
+    bool perf_counters = false;
+    bool layout_bench = false;
+    bool profile_layout = false;
+    bool louds_bench = false;
+    bool classify_bench = false;
+    bool name_lpm_bench_run = false;
+    bool stats_bench = false;
+    bool lpm_bench = false;
+    bool fib_compress_run = false;
+    char delta_file[128] = {0};
+    char delta_create_file[128] = {0};
+    char delta_merge_file[128] = {0};
+    int engine = PT_ENGINE_PT;
 
     // parse() takes the arguments to main() and parses them according to 
     // ArgvParser rules
@@ -406,6 +700,206 @@ int main(int argc, char **argv) {
         if (cmds->foundOption(OPTION_RANDOM)) {
             random = true;
         }
+
+        if (cmds->foundOption(OPTION_SCAN_BENCH)) {
+            scan_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_DIR_BITS)) {
+
+            pt_dir_bits = std::stoi(cmds->optionValue(OPTION_DIR_BITS));
+
+            if (pt_dir_bits < 0 || pt_dir_bits > PT_DIR_MAX_BITS) {
+
+                fprintf(stderr, "dir bits must be in [0, %d]. use "\
+                    "option -h for help.\n", PT_DIR_MAX_BITS);
+
+                delete cmds;
+                return -1;
+            }
+        }
+
+        if (cmds->foundOption(OPTION_DIR_BENCH)) {
+            dir_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_MBT_BENCH)) {
+            mbt_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_BULK_LOAD)) {
+            bulk_load = true;
+        }
+
+        if (cmds->foundOption(OPTION_SNAPSHOT_SAVE)) {
+            strncpy(snapshot_save_file, (char *) cmds->optionValue(OPTION_SNAPSHOT_SAVE).c_str(), 127);
+        }
+
+        if (cmds->foundOption(OPTION_SNAPSHOT_LOAD)) {
+            strncpy(snapshot_load_file, (char *) cmds->optionValue(OPTION_SNAPSHOT_LOAD).c_str(), 127);
+        }
+
+        if (cmds->foundOption(OPTION_SNAPSHOT_VERIFY)) {
+            snapshot_verify = true;
+        }
+
+        if (cmds->foundOption(OPTION_DELTA_FILE)) {
+            strncpy(delta_file, (char *) cmds->optionValue(OPTION_DELTA_FILE).c_str(), 127);
+        }
+
+        if (cmds->foundOption(OPTION_DELTA_CREATE)) {
+            strncpy(delta_create_file, (char *) cmds->optionValue(OPTION_DELTA_CREATE).c_str(), 127);
+        }
+
+        if (cmds->foundOption(OPTION_DELTA_MERGE)) {
+            strncpy(delta_merge_file, (char *) cmds->optionValue(OPTION_DELTA_MERGE).c_str(), 127);
+        }
+
+        if (cmds->foundOption(OPTION_DELTA_BENCH)) {
+            delta_bench_run = true;
+        }
+
+        if (cmds->foundOption(OPTION_CHURN_BENCH)) {
+            churn_updates = std::stoi(cmds->optionValue(OPTION_CHURN_BENCH));
+        }
+
+        if (cmds->foundOption(OPTION_RCU_BENCH)) {
+            rcu_update_rate = std::stod(cmds->optionValue(OPTION_RCU_BENCH));
+        }
+
+        if (cmds->foundOption(OPTION_COW_BENCH)) {
+            cow_updates = std::stoi(cmds->optionValue(OPTION_COW_BENCH));
+        }
+
+        if (cmds->foundOption(OPTION_CACHE_BENCH)) {
+            cache_capacity = std::stoi(cmds->optionValue(OPTION_CACHE_BENCH));
+        }
+
+        if (cmds->foundOption(OPTION_CACHE)) {
+            cache_entries = std::stoi(cmds->optionValue(OPTION_CACHE));
+        }
+
+        if (cmds->foundOption(OPTION_PERF_COUNTERS)) {
+            perf_counters = true;
+        }
+
+        if (cmds->foundOption(OPTION_LAYOUT_BENCH)) {
+            layout_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_CLASSIFY_BENCH)) {
+            classify_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_LPM_BENCH)) {
+            lpm_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_FIB_COMPRESS)) {
+            fib_compress_run = true;
+        }
+
+        if (cmds->foundOption(OPTION_STATS_BENCH)) {
+            stats_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_NAME_LPM_BENCH)) {
+            name_lpm_bench_run = true;
+        }
+
+        if (cmds->foundOption(OPTION_LOUDS_BENCH)) {
+            louds_bench = true;
+        }
+
+        if (cmds->foundOption(OPTION_PROFILE_LAYOUT)) {
+            profile_layout = true;
+        }
+
+        if (cmds->foundOption(OPTION_FLAT_LAYOUT)) {
+
+            std::string layout_str = cmds->optionValue(OPTION_FLAT_LAYOUT);
+
+            if (layout_str == "bfs") {
+                pt_flat_layout = PT_FLAT_LAYOUT_BFS;
+            } else if (layout_str == "veb") {
+                pt_flat_layout = PT_FLAT_LAYOUT_VEB;
+            } else if (layout_str != "preorder") {
+
+                fprintf(stderr, "unknown flat trie layout '%s'. use "\
+                    "option -h for help.\n", layout_str.c_str());
+
+                delete cmds;
+                return -1;
+            }
+        }
+
+        if (cmds->foundOption(OPTION_HUGE_PAGES)) {
+
+            std::string huge_pages_str = cmds->optionValue(OPTION_HUGE_PAGES);
+
+            if ((huge_pages = hp_mode(huge_pages_str.c_str())) < 0) {
+
+                fprintf(stderr, "unknown huge page mode '%s'. use "\
+                    "option -h for help.\n", huge_pages_str.c_str());
+
+                delete cmds;
+                return -1;
+            }
+        }
+
+        if (cmds->foundOption(OPTION_BIT_ORDER)) {
+
+            std::string bit_order_str = cmds->optionValue(OPTION_BIT_ORDER);
+
+            if (bit_order_str == "entropy") {
+                bit_order = true;
+            } else if (bit_order_str != "identity") {
+
+                fprintf(stderr, "unknown bit order '%s'. use "\
+                    "option -h for help.\n", bit_order_str.c_str());
+
+                delete cmds;
+                return -1;
+            }
+        }
+
+        if (cmds->foundOption(OPTION_ENGINE)) {
+
+            std::string engine_str = cmds->optionValue(OPTION_ENGINE);
+
+            if (engine_str == "scan") {
+                engine = PT_ENGINE_SCAN;
+            } else if (engine_str == "bitslice") {
+                engine = PT_ENGINE_BITSLICE;
+            } else if (engine_str == "dir") {
+                engine = PT_ENGINE_DIR;
+            } else if (engine_str == "mbt") {
+                engine = PT_ENGINE_MBT;
+            } else if (engine_str == "flat") {
+                engine = PT_ENGINE_FLAT;
+            } else if (engine_str == "louds") {
+                engine = PT_ENGINE_LOUDS;
+            } else if (engine_str == "auto") {
+                engine = PT_ENGINE_AUTO;
+            } else if (engine_str != "pt") {
+
+                fprintf(stderr, "unknown engine '%s'. use "\
+                    "option -h for help.\n", engine_str.c_str());
+
+                delete cmds;
+                return -1;
+            }
+        }
+    }
+
+    // the bit order of a snapshot is fixed
+    if (bit_order && snapshot_load_file[0] != '\0') {
+
+        fprintf(stderr, "can't re-order the RID bits of a FIB loaded from "\
+            "a snapshot. use option -h for help.\n");
+
+        delete cmds;
+        return -1;
     }
 
     if (result == ArgvParser::ParserHelpRequested) {
@@ -413,6 +907,41 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    // delta creation and merging are offline operations: no FIB is built
+    if (delta_create_file[0] != '\0' || delta_merge_file[0] != '\0') {
+
+        int ret = -1;
+        struct fib_delta * delta = NULL;
+
+        if (delta_file[0] == '\0') {
+
+            fprintf(stderr, "no delta file specified. use "\
+                "option -h for help.\n");
+
+        } else if (delta_create_file[0] != '\0') {
+
+            if ((delta = delta_from_urls(delta_create_file)) != NULL
+                && (ret = delta_save(delta, delta_file)) == 0)
+                printf("[delta]: saved %d updates to %s\n", delta->num_records, delta_file);
+
+        } else if (snapshot_load_file[0] == '\0') {
+
+            fprintf(stderr, "no base snapshot specified. use "\
+                "option -h for help.\n");
+
+        } else if ((delta = delta_load(delta_file)) != NULL) {
+
+            double merge_begin = get_time_now();
+            if ((ret = delta_merge_snapshot(snapshot_load_file, delta, delta_merge_file)) == 0)
+                printf("[delta]: merged %d updates (time elapsed : %-.8f)\n", 
+                    delta->num_records, get_time_now() - merge_begin);
+        }
+
+        delta_erase(delta);
+        delete cmds;
+        return ret;
+    }
+
     // if (argc > 3 && !(strncmp(argv[3], "-m", 2))) {
 
     //     if (strcmp(argv[4], ht_mode_strs[1]) == 0) {
@@ -432,6 +961,33 @@ int main(int argc, char **argv) {
     //     strncpy(url_file_name, DEFAULT_URL_FILE, strlen(DEFAULT_URL_FILE));
     // }
 
+    // trie nodes and RIDs go in huge pages, if asked to
+    if (huge_pages != HP_MODE_NONE)
+        pt_arena = hp_arena_init(HP_DEFAULT_SIZE, huge_pages);
+
+    // RID bit permutation applied to the FIB (see bit_order.h)
+    struct rid_perm perm;
+    int has_perm = 0;
+
+    // mmap() the FIB from a snapshot, if given
+    struct snapshot * snap = NULL;
+
+    if (snapshot_load_file[0] != '\0') {
+
+        double load_begin = get_time_now();
+
+        if (!(snap = snapshot_load(snapshot_load_file, &pt_fib, &perm, &has_perm, (int) snapshot_verify))) {
+
+            delete cmds;
+            return -1;
+        }
+
+        printf("[fwd table build]: loaded FIB snapshot %s: "\
+            "\n\t[PARTITIONS]: %d"\
+            "\n\t[SNAPSHOT_LOAD_TIME]: %-.8f\n",
+            snapshot_load_file, HASH_COUNT(pt_fib), get_time_now() - load_begin);
+    }
+
     FILE * fr = fopen(url_file_name, "rt");
 
     // start reading the URLs and add forwarding entries to each FIB
@@ -452,7 +1008,19 @@ int main(int argc, char **argv) {
     struct click_xia_xid * rid = (struct click_xia_xid *) malloc(sizeof(struct click_xia_xid));
     // keep track of the number of encoded prefixes
     uint32_t prefix_count = 0;
+    // duplicate URLs (same RID) rejected by the FIB
+    uint32_t dup_count = 0;
+    // URLs w/ a next hop (optional 2nd column of the URL file)
+    uint32_t port_count = 0;
+    uint16_t port = PT_PORT_NONE;
+    char * port_pos = NULL;
     int prefix_size = 0;
+    // time spent adding prefixes to the FIB (wall clock)
+    double fib_time = 0.0, fib_begin = 0.0;
+    // prefixes collected for a bulk build
+    struct pt_bulk * bulk = (bulk_load && snap == NULL ? pt_bulk_init() : NULL);
+    // exact name-based FIB, built out of the same URLs
+    struct name_lpm * name_fib = (name_lpm_bench_run ? name_lpm_init() : NULL);
 
     // collect the prefixes which will be used to build requests afterwards, 
     // up to a max of REQUEST_LIMIT. the prefixes should be evenly 
@@ -478,6 +1046,25 @@ int main(int argc, char **argv) {
             p_length = strlen(prefix);
         }
 
+        // an optional next hop (port) may follow the URL, separated by a 
+        // space or tab. invalid or out-of-range ports are ignored.
+        port = PT_PORT_NONE;
+
+        if ((port_pos = strpbrk(prefix, " \t")) != NULL) {
+
+            *(port_pos++) = '\0';
+            p_length = strlen(prefix);
+
+            char * port_end = NULL;
+            long port_val = strtol(port_pos, &port_end, 10);
+
+            if (port_end != port_pos && port_val >= 0 && port_val < PT_MAX_PORTS)
+                port = (uint16_t) port_val;
+
+            if (p_length < 1)
+                continue;
+        }
+
         if (prefix[0] == '/') {
             // prefix = prefix + 1;
             // p_length--;
@@ -551,9 +1138,27 @@ int main(int argc, char **argv) {
 
         // add rid (and prefix for TP stats tracking) to RID FIB
         begin = clock();
-        pt_ht_add(&pt_fib, rid, prefix, prefix_size);
+        fib_begin = get_time_now();
+
+        // a FIB loaded from a snapshot is built already: the URLs are only 
+        // used to generate requests
+        if (snap == NULL) {
+
+            if (bulk_load)
+                pt_bulk_add(bulk, rid, prefix, prefix_size, port);
+            else if (pt_ht_add(&pt_fib, rid, prefix, prefix_size, port) > 0)
+                dup_count++;
+        }
+
+        if (port != PT_PORT_NONE)
+            port_count++;
+
+        fib_time += get_time_now() - fib_begin;
         end = clock();
 
+        if (name_fib != NULL)
+            name_lpm_add(name_fib, prefix, prefix_size);
+
         if (++prefix_count % 100000 == 0)
             printf("[fwd table build]: added %d prefixes (time elapsed : %-.8f)\n", prefix_count, tot_time);
 
@@ -567,17 +1172,56 @@ int main(int argc, char **argv) {
             max_time = cur_time;
     }
 
+    // bulk build: the actual tries are built now
+    if (bulk != NULL) {
+
+        printf("[fwd table build]: bulk building FIB out of %d prefixes:\n", bulk->num);
+
+        fib_begin = get_time_now();
+        dup_count = pt_bulk_build(bulk, &pt_fib);
+        fib_time += get_time_now() - fib_begin;
+
+        pt_bulk_erase(bulk);
+    }
+
     printf("[fwd table build]: done. added %d prefixes to FIB: "\
+        "\n\t[DUPLICATES]: %d"\
+        "\n\t[FIB_BUILD_TIME]: %-.8f"\
         "\n\t[TOT_TIME]: %-.8f"\
         "\n\t[MAX_TIME]: %-.8f"\
         "\n\t[MIN_TIME]: %-.8f"\
         "\n\t[AVG_TIME]: %-.8f\n", 
         //HASH_COUNT(pt_stats_ht),
         prefix_count,
+        dup_count,
+        fib_time,
         tot_time, max_time, min_time,
         //(tot_time / (double) HASH_COUNT(pt_stats_ht)));
         (tot_time / (double) prefix_count));
 
+    pt_ht_print_memory(pt_fib);
+
+    // apply a delta to the FIB, if given
+    if (delta_file[0] != '\0') {
+
+        struct fib_delta * delta = delta_load(delta_file);
+
+        if (delta != NULL) {
+
+            uint32_t skipped = 0;
+            double delta_begin = get_time_now();
+            int applied = delta_apply(delta, &pt_fib, (has_perm ? &perm : NULL), &skipped);
+
+            printf("[fwd table build]: applied delta %s: "\
+                "\n\t[APPLIED]: %d"\
+                "\n\t[SKIPPED]: %d"\
+                "\n\t[DELTA_APPLY_TIME]: %-.8f\n",
+                delta_file, applied, skipped, get_time_now() - delta_begin);
+
+            delta_erase(delta);
+        }
+    }
+
     // printf("[fwd table build]: *** FWD TABLE *** :\n");
 
     // struct pt_ht * itr;
@@ -609,7 +1253,7 @@ int main(int argc, char **argv) {
     char request_prefix[PREFIX_MAX_LENGTH];
     char * request_name = (char *) calloc(PREFIX_MAX_LENGTH, sizeof(char));
     // the RID `holder'
-    struct click_xia_xid * request_rid = (struct click_xia_xid *) malloc(sizeof(struct click_xia_xid));
+    struct click_xia_xid * request_rid = NULL;
     // request size (guides the lookup procedures)
     int request_size = 0;
     // keep track of the number of requested names
@@ -626,6 +1270,12 @@ int main(int argc, char **argv) {
 
     printf("[rid fwd simulation]: generating random requests out of prefixes in request prefix histogram\n");
 
+    // generate all requests first, so that the same requests can be replayed
+    // against other FIB engines afterwards
+    struct rid_request * requests = 
+        (struct rid_request *) calloc(request_prefixes_num, sizeof(struct rid_request));
+    int requests_num = 0;
+
     for (itr = request_prefixes.begin(); itr != request_prefixes.end(); itr++) {
 
         for (int i = 0; i < (itr)->second.size(); i++) {
@@ -647,6 +1297,7 @@ int main(int argc, char **argv) {
             }
 
             // generate RIDs out of the request names
+            request_rid = (struct click_xia_xid *) calloc(1, sizeof(struct click_xia_xid));
             request_size = name_to_rid(&request_rid, request_name);
 
             // // FIXME: based on the mode argument, we may need to change the value
@@ -654,32 +1305,127 @@ int main(int argc, char **argv) {
             // if (mode == HAMMING_WEIGHT)
             //     request_size = rid_hamming_weight(request_rid);
 
-            if (++request_cnt % 100 == 0)
-                printf("[rid fwd simulation]: ran %d requests (time elapsed : %-.8f)\n", request_cnt, tot_time);
+            requests[requests_num].name = strdup(request_name);
+            requests[requests_num].size = request_size;
+            requests[requests_num].rid = request_rid;
+            requests_num++;
 
-            // printf("[rid fwd simulation]: lookup for %s started\n", request_name);
+            memset(request_name, 0, PREFIX_MAX_LENGTH);
+            memset(request_prefix, 0, PREFIX_MAX_LENGTH);
+        }
+    }
 
-            // pass the request RID through the FIBs, gather the
-            // lookup stats
-            begin = clock();
-            pt_ht_lookup(pt_fib, request_name, request_size, request_rid, fp_sizes, tp_sizes);
-            end = clock();
+    // re-order the RID bits of the FIB and requests, before building other
+    // engines out of the tries
+    if (bit_order) {
 
-            // update the TP stats
-            update_tp_cond(fp_sizes, tp_sizes, tp_cond);
+        printf("[rid fwd simulation]: identity vs. entropy bit order per |F|:\n");
+        bit_order_apply(pt_fib, &perm, requests, requests_num, output_dir);
+        has_perm = 1;
 
-            // time keeping
-            cur_time += (double) (end - begin) / CLOCKS_PER_SEC;
-            tot_time += cur_time;
+    } else if (has_perm) {
 
-            if (min_time > cur_time)
-                min_time = cur_time;
-            else if (max_time < cur_time)
-                max_time = cur_time;
+        // the snapshot's RIDs are permuted
+        for (int i = 0; i < requests_num; i++)
+            rid_perm_apply(&perm, requests[i].rid);
+    }
 
-            memset(request_name, 0, PREFIX_MAX_LENGTH);
-            memset(request_prefix, 0, PREFIX_MAX_LENGTH);
-        }
+    // training run (even requests) for the profile-guided layout. the odd
+    // requests are the replayed trace.
+    std::vector<struct rid_request> train_requests, replay_requests;
+
+    if (profile_layout) {
+
+        for (int i = 0; i < requests_num; i++)
+            (i % 2 == 0 ? train_requests : replay_requests).push_back(requests[i]);
+
+        double profile_begin = get_time_now();
+
+        pt_ht_profile(pt_fib, train_requests.data(), train_requests.size());
+        pt_flat_layout = PT_FLAT_LAYOUT_PROFILE;
+
+        printf("[rid fwd simulation]: profiled %d training requests (time elapsed : %-.8f)\n",
+            (int) train_requests.size(), get_time_now() - profile_begin);
+    }
+
+    if (snapshot_save_file[0] != '\0') {
+
+        double save_begin = get_time_now();
+
+        if (snapshot_save(pt_fib, (has_perm ? &perm : NULL), snapshot_save_file) == 0)
+            printf("[rid fwd simulation]: saved FIB snapshot %s (time elapsed : %-.8f)\n", 
+                snapshot_save_file, get_time_now() - save_begin);
+    }
+
+    // drop the entries which are redundant for forwarding, before building
+    // other engines out of the tries
+    if (fib_compress_run) {
+
+        printf("[rid fwd simulation]: FIB compression per |F|:\n");
+        fib_compress_bench(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // pick the lookup engine(s) for the FIB partitions
+    if (engine == PT_ENGINE_AUTO) {
+
+        printf("[rid fwd simulation]: calibrating lookup engines per |F|:\n");
+        pt_ht_calibrate(pt_fib, requests, requests_num);
+
+    } else if (engine != PT_ENGINE_PT) {
+
+        pt_ht_set_engine(pt_fib, engine);
+    }
+
+    if (engine != PT_ENGINE_PT) {
+
+        printf("[rid fwd simulation]: [WARNING] TN and LOOKUP counts and "\
+            "req-entry-diff.tsv follow the per-partition engine's own "\
+            "definitions (see option -h), not the PT's\n");
+    }
+
+    struct perf_counters pc;
+
+    if (perf_counters) {
+
+        perf_counters_init(&pc);
+        perf_counters_start(&pc);
+    }
+
+    if (cache_entries > 0)
+        pt_cache = rid_cache_init(cache_entries);
+
+    // union of the next hops of all matches of a request, only collected if
+    // the URL file has next hops
+    struct pt_port_set ports;
+    uint64_t port_set_sizes = 0;
+
+    for (int i = 0; i < requests_num; i++) {
+
+        if (++request_cnt % 100 == 0)
+            printf("[rid fwd simulation]: ran %d requests (time elapsed : %-.8f)\n", request_cnt, tot_time);
+
+        // printf("[rid fwd simulation]: lookup for %s started\n", requests[i].name);
+
+        // pass the request RID through the FIBs, gather the
+        // lookup stats
+        begin = clock();
+        pt_ht_lookup(pt_fib, requests[i].name, requests[i].size, requests[i].rid, fp_sizes, tp_sizes, (port_count > 0 ? &ports : NULL), PT_READER_NONE);
+        end = clock();
+
+        if (port_count > 0)
+            port_set_sizes += pt_port_set_count(&ports);
+
+        // update the TP stats
+        update_tp_cond(fp_sizes, tp_sizes, tp_cond);
+
+        // time keeping
+        cur_time += (double) (end - begin) / CLOCKS_PER_SEC;
+        tot_time += cur_time;
+
+        if (min_time > cur_time)
+            min_time = cur_time;
+        else if (max_time < cur_time)
+            max_time = cur_time;
     }
 
     printf("[rid fwd simulation]: done. looked up %ld requests: "\
@@ -691,13 +1437,164 @@ int main(int argc, char **argv) {
         tot_time, max_time, min_time,
         (tot_time / (double) request_cnt));
 
+    if (pt_cache != NULL) {
+
+        printf("[rid fwd simulation]: result cache hit rate : %-.4f (%-.1f KB)\n",
+            rid_cache_hit_rate(pt_cache), (double) rid_cache_memory(pt_cache) / 1024.0);
+
+        rid_cache_erase(pt_cache);
+        pt_cache = NULL;
+    }
+
+    if (perf_counters) {
+
+        perf_counters_stop(&pc);
+
+        printf("[rid fwd simulation]: lookup phase event counts:\n");
+        perf_counters_print(&pc, hp_mode_name(huge_pages), request_cnt, output_dir);
+        perf_counters_erase(&pc);
+    }
+
+    if (pt_arena != NULL)
+        hp_arena_print(pt_arena);
+
     // A.3.6) print some stats about the namespace
     printf("[rid fwd simulation]: URL size distribution:\n");
     print_namespace_stats(url_sizes, max_prefix_size);
 
     printf("[rid fwd simulation]: simulation stats:\n");
     pt_ht_print_stats(pt_fib, output_dir);
+
+    // the benchmarks below work on the partition tries
+    if (snap != NULL && (scan_bench || dir_bench || mbt_bench || louds_bench || classify_bench || stats_bench || lpm_bench || layout_bench || profile_layout))
+        pt_ht_thaw(pt_fib);
+
+    // next hops: LPM (1 port) vs. union of the ports of all matches
+    if (port_count > 0) {
+
+        uint32_t next_hops = 0;
+
+        for (int i = 0; i < requests_num; i++)
+            next_hops += (pt_ht_next_hop(pt_fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE) != PT_PORT_NONE);
+
+        printf("[rid fwd simulation]: next hops (%d URLs w/ a next hop):"\
+            "\n\t[LPM_NEXT_HOPS]: %d of %d requests"\
+            "\n\t[AVG_PORT_SET_SIZE]: %-.8f\n",
+            port_count,
+            next_hops, requests_num,
+            (requests_num > 0 ? (double) port_set_sizes / (double) requests_num : 0.0));
+    }
+
+    // PT vs. linear scan, partition by partition
+    if (scan_bench) {
+
+        printf("[rid fwd simulation]: PT vs. SCAN vs. BITSLICE lookup times per |F|:\n");
+        scan_ht_print_crossover(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // directory size (k) vs. lookup time
+    if (dir_bench) {
+
+        printf("[rid fwd simulation]: DIR memory vs. lookup time per k:\n");
+        pt_dir_print_tradeoff(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // binary vs. multi-bit trie
+    if (mbt_bench) {
+
+        printf("[rid fwd simulation]: PT vs. MBT per |F|:\n");
+        mbt_ht_print_stats(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // classification cost
+    if (classify_bench) {
+
+        printf("[rid fwd simulation]: TP / FP classification share of PT lookup time:\n");
+        pt_ht_classify_bench(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // forwarding vs. measurement cost
+    if (stats_bench) {
+
+        printf("[rid fwd simulation]: PT lookup time w/ vs. w/o stats per |F|:\n");
+        pt_ht_stats_bench(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // LPM forwarding vs. exhaustive lookups
+    if (lpm_bench) {
+
+        printf("[rid fwd simulation]: LPM vs. exhaustive lookup latency:\n");
+        pt_ht_lpm_bench(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // RID FIB vs. exact name-based LPM
+    if (name_fib != NULL) {
+
+        printf("[rid fwd simulation]: RID FIB vs. name-based LPM:\n");
+        name_lpm_bench(name_fib, pt_fib, requests, requests_num, output_dir);
+    }
+
+    // pointer vs. succinct trie
+    if (louds_bench) {
+
+        printf("[rid fwd simulation]: PT vs. LOUDS memory and lookup time per |F|:\n");
+        louds_ht_print_stats(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // flat trie node order vs. cache misses
+    if (layout_bench) {
+
+        printf("[rid fwd simulation]: flat trie layouts vs. cache footprint per lookup:\n");
+        pt_flat_layout_bench(pt_fib, requests, requests_num, output_dir);
+    }
+
+    // hot / cold layout vs. cache misses, on the replayed trace
+    if (profile_layout) {
+
+        printf("[rid fwd simulation]: profile-guided vs. pre-order layout on the replayed requests:\n");
+        pt_flat_profile_bench(pt_fib, replay_requests.data(), replay_requests.size(), output_dir);
+        pt_ht_profile_clear(pt_fib);
+    }
+
+    // skewed request streams through a result cache
+    if (cache_capacity > 0) {
+
+        printf("[rid fwd simulation]: lookup latency w/ vs. w/o a result cache of %d entries:\n", cache_capacity);
+        rid_cache_bench(pt_fib, requests, requests_num, cache_capacity, output_dir);
+    }
+
+    // incremental updates
+    if (delta_bench_run) {
+
+        printf("[rid fwd simulation]: delta apply times per delta size:\n");
+        delta_bench(&pt_fib, (has_perm ? &perm : NULL), output_dir);
+    }
+
+    if (churn_updates > 0) {
+
+        printf("[rid fwd simulation]: online update rate (churn):\n");
+        churn_bench(&pt_fib, (has_perm ? &perm : NULL), churn_updates, output_dir);
+    }
+
+    // lookups concurrent w/ updates
+    if (rcu_update_rate > 0.0) {
+
+        printf("[rid fwd simulation]: lookup latency w/ concurrent updates:\n");
+        churn_rcu_bench(&pt_fib, (has_perm ? &perm : NULL), requests, requests_num, rcu_update_rate, output_dir);
+    }
+
+    // background FIB version build + swap
+    if (cow_updates > 0) {
+
+        printf("[rid fwd simulation]: lookup latency w/ a FIB version swap:\n");
+        fib_handle_bench(&pt_fib, (has_perm ? &perm : NULL), requests, requests_num, cow_updates, output_dir);
+    }
+
     pt_ht_erase(pt_fib);
+    name_lpm_erase(name_fib);
+    prefix_dict_default_erase();
+    snapshot_unmap(snap);
+    hp_arena_erase(pt_arena);
     print_tp_cond(tp_cond, output_dir);
 
     // struct lookup_stats * itr;
@@ -711,8 +1608,14 @@ int main(int argc, char **argv) {
     free(prefix);
     free(request_name);
     // click_xia_xid structs
-    free(request_rid);
     free(rid);
 
+    for (int i = 0; i < requests_num; i++) {
+        free(requests[i].name);
+        free(requests[i].rid);
+    }
+
+    free(requests);
+
     return 0;
 }
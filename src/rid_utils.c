@@ -21,6 +21,8 @@
  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
  * limitations under the License.
  */
+#include <time.h>
+
 #include <algorithm>
 #include <string>
 
@@ -270,3 +272,34 @@ int count_prefixes(char * prefix) {
 
     return prefix_count;
 }
+
+/*
+ * \brief   monotonic wall clock time, in seconds. unlike clock(), this isn't 
+ *          inflated by the CPU time of the lookup threads.
+ */
+double get_time_now() {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1000000000.0);
+}
+
+/*
+ * \brief   64 bit FNV-1a hash of a byte array. hashes can be chained, by 
+ *          passing the result of a previous call as hash.
+ *
+ * \param   hash    FNV_OFFSET_BASIS for a new hash
+ */
+uint64_t fnv1a(uint64_t hash, const void * data, size_t size) {
+
+    const uint8_t * bytes = (const uint8_t *) data;
+    size_t i = 0;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
@@ -0,0 +1,447 @@
+/*
+ * scan.c
+ *
+ * brute-force linear scan RID FIB engine.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <immintrin.h>
+
+#include "scan.h"
+#include "bitslice.h"
+#include "prefix_dict.h"
+
+/*
+ * \brief   splits an RID into its 64 + 64 + 32 bit columns
+ */
+static __inline void scan_rid_pack(
+        struct click_xia_xid * rid,
+        uint64_t * hi,
+        uint64_t * mid,
+        uint32_t * lo) {
+
+    // XXX: byte order doesn't matter here, as long as requests and entries
+    // are packed the same way
+    memcpy(hi, &(rid->id[0]), sizeof(uint64_t));
+    memcpy(mid, &(rid->id[8]), sizeof(uint64_t));
+    memcpy(lo, &(rid->id[16]), sizeof(uint32_t));
+}
+
+static int scan_fwd_collect_rec(
+        struct pt_fwd * t,
+        int key_bit,
+        struct scan_fwd * s) {
+
+    if (t->key_bit <= key_bit) return 0;
+
+    // the root node (default route) isn't an actual entry
+    if (t->prefix_size > 0) {
+
+        scan_rid_pack(
+            t->prefix_rid,
+            &(s->rid_hi[s->num_entries]),
+            &(s->rid_mid[s->num_entries]),
+            &(s->rid_lo[s->num_entries]));
+
+        s->prefix_i[s->num_entries] = t->prefix_i;
+        s->ports[s->num_entries] = t->port;
+        s->num_entries++;
+    }
+
+    scan_fwd_collect_rec(t->p_left, t->key_bit, s);
+    scan_fwd_collect_rec(t->p_right, t->key_bit, s);
+
+    return s->num_entries;
+}
+
+/*
+ * \brief   builds a linear scan fwd table out of the entries of a FIB
+ *          partition (i.e. a PT subtree for some prefix size)
+ *
+ * \param   partition   the FIB partition to collect the entries from
+ *
+ * \return  the linear scan fwd table, NULL if memory couldn't be allocated
+ */
+struct scan_fwd * scan_fwd_init(struct pt_ht * partition) {
+
+    struct scan_fwd * s = (struct scan_fwd *) calloc(1, sizeof(struct scan_fwd));
+
+    s->fib_root = partition;
+    s->prefix_size = partition->prefix_size;
+
+    // align the columns to 32 byte, so that loads never split cache lines
+    // FIXME: the + 1 avoids 0 size allocations for empty partitions
+    size_t capacity = partition->num_entries + 1;
+
+    if (posix_memalign((void **) &(s->rid_hi), 32, capacity * sizeof(uint64_t))
+        || posix_memalign((void **) &(s->rid_mid), 32, capacity * sizeof(uint64_t))
+        || posix_memalign((void **) &(s->rid_lo), 32, capacity * sizeof(uint32_t))) {
+
+        fprintf(stderr, "scan_fwd_init() : ERROR posix_memalign() failed\n");
+        scan_fwd_erase(s);
+
+        return NULL;
+    }
+
+    s->prefix_i = (struct prefix_info **) calloc(capacity, sizeof(struct prefix_info *));
+    s->ports = (uint16_t *) calloc(capacity, sizeof(uint16_t));
+
+    s->num_entries = 0;
+    scan_fwd_collect_rec(partition->trie, -1, s);
+
+    return s;
+}
+
+void scan_fwd_erase(struct scan_fwd * s) {
+
+    if (!s)
+        return;
+
+    free(s->rid_hi);
+    free(s->rid_mid);
+    free(s->rid_lo);
+    free(s->prefix_i);
+    free(s->ports);
+    free(s);
+}
+
+/*
+ * \brief   TP or FP check for entry i of a scan fwd table, which is known to
+ *          match the request RID
+ */
+static __inline void scan_fwd_classify(
+        struct scan_fwd * s,
+        uint32_t i,
+        char * request,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats) {
+
+    int tps = 0, fps = 0;
+
+    // matches are rare, so the prefix is just put back together here
+    char prefix[PREFIX_MAX_LENGTH];
+    prefix_info_str(s->prefix_i[i], prefix, PREFIX_MAX_LENGTH);
+
+    if (strstr(request, prefix) != NULL)
+        tps = 1;
+    else
+        fps = 1;
+
+    tp_sizes[s->prefix_size - 1] += tps;
+    fp_sizes[s->prefix_size - 1] += fps;
+
+    if (ports != NULL)
+        pt_port_set_add(ports, s->ports[i]);
+
+    // |F\R| is only worked out for matches (unlike pt_fwd_lookup(), which 
+    // does it for every visited node)
+    if (stats != NULL) {
+
+        lookup_stats_update(
+            &stats,
+            req_entry_diff(request, prefix, s->prefix_size),
+            tps, fps, 0, 1);
+    }
+}
+
+static int scan_fwd_lookup_scalar(
+        struct scan_fwd * s,
+        uint32_t from,
+        uint64_t r_hi,
+        uint64_t r_mid,
+        uint32_t r_lo,
+        char * request,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats) {
+
+    int matches = 0;
+    uint32_t i = from;
+
+    for ( ; i < s->num_entries; i++) {
+
+        // (R & F) == F <=> (F & ~R) == 0, for all 3 columns at once
+        if (((s->rid_hi[i] & ~r_hi) | (s->rid_mid[i] & ~r_mid) | (s->rid_lo[i] & ~r_lo)) == 0) {
+
+            scan_fwd_classify(s, i, request, fp_sizes, tp_sizes, ports, stats);
+            matches++;
+        }
+    }
+
+    return matches;
+}
+
+__attribute__((target("avx2")))
+static int scan_fwd_lookup_avx2(
+        struct scan_fwd * s,
+        uint64_t r_hi,
+        uint64_t r_mid,
+        uint32_t r_lo,
+        char * request,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats) {
+
+    int matches = 0;
+    uint32_t i = 0, blocks = s->num_entries - (s->num_entries % SCAN_BLOCK_SIZE);
+
+    const __m256i req_hi = _mm256_set1_epi64x((long long) r_hi);
+    const __m256i req_mid = _mm256_set1_epi64x((long long) r_mid);
+    const __m256i req_lo = _mm256_set1_epi64x((long long) r_lo);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for ( ; i < blocks; i += SCAN_BLOCK_SIZE) {
+
+        __m256i hi = _mm256_load_si256((const __m256i *) &(s->rid_hi[i]));
+        __m256i mid = _mm256_load_si256((const __m256i *) &(s->rid_mid[i]));
+        // widen the 4 x 32 bit column to 4 x 64 bit, so that all columns
+        // share the same lanes
+        __m256i lo = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) &(s->rid_lo[i])));
+
+        // (F & ~R) for the 3 columns, OR'd together: a lane is 0 iff the
+        // respective entry matches the request
+        __m256i diff = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_andnot_si256(req_hi, hi),
+                _mm256_andnot_si256(req_mid, mid)),
+            _mm256_andnot_si256(req_lo, lo));
+
+        unsigned int mask = (unsigned int) _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpeq_epi64(diff, zero)));
+
+        // matches are rare, so this is (almost) never taken
+        while (mask) {
+
+            scan_fwd_classify(s, i + __builtin_ctz(mask), request, fp_sizes, tp_sizes, ports, stats);
+            matches++;
+
+            mask &= (mask - 1);
+        }
+    }
+
+    // leftover entries
+    matches += scan_fwd_lookup_scalar(s, blocks, r_hi, r_mid, r_lo, request, fp_sizes, tp_sizes, ports, stats);
+
+    return matches;
+}
+
+/*
+ * \brief   looks up a request RID in a scan fwd table, by testing
+ *          (R & F) == F against ALL entries.
+ *
+ * TPs and FPs are added to the tp_sizes and fp_sizes arrays, in the same way
+ * as pt_fwd_lookup() does it, and the next hops of the matches to ports (if
+ * not NULL). if stats isn't NULL, all non-matching entries are counted as TNs.
+ *
+ * \return  nr. of matching entries (TPs + FPs)
+ */
+int scan_fwd_lookup(
+        struct scan_fwd * s,
+        char * request,
+        struct click_xia_xid * request_rid,
+        uint32_t * fp_sizes,
+        uint32_t * tp_sizes,
+        struct pt_port_set * ports,
+        struct lookup_stats * stats) {
+
+    // checking for AVX2 support only once
+    static int has_avx2 = -1;
+
+    if (has_avx2 < 0)
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    uint64_t r_hi, r_mid;
+    uint32_t r_lo;
+
+    scan_rid_pack(request_rid, &r_hi, &r_mid, &r_lo);
+
+    int matches = 0;
+
+    if (has_avx2)
+        matches = scan_fwd_lookup_avx2(s, r_hi, r_mid, r_lo, request, fp_sizes, tp_sizes, ports, stats);
+    else
+        matches = scan_fwd_lookup_scalar(s, 0, r_hi, r_mid, r_lo, request, fp_sizes, tp_sizes, ports, stats);
+
+    if (stats != NULL)
+        lookup_stats_add_tns(stats, s->num_entries - matches);
+
+    return matches;
+}
+
+/*
+ * \brief   runs a set of requests through each FIB partition, with the PT,
+ *          linear scan and bit-sliced engines, and prints the avg. lookup 
+ *          time of each.
+ *
+ * partitions are tested in isolation, single threaded. the crossover point
+ * is the largest partition (in nr. of entries) for which the linear scan
+ * still beats the PT.
+ *
+ * XXX: the PT times include the stats gathering in pt_fwd_lookup() (i.e.
+ * req_entry_diff() on every visited node), so they're not 'pure' forwarding
+ * times. the PT partition stats are updated by this function, so call it
+ * AFTER pt_ht_print_stats().
+ *
+ * \param   fib             the (PT) FIB to test
+ * \param   requests        array of requests to run through the partitions
+ * \param   requests_num    size of the requests array
+ * \param   output_dir      dir on which to dump the .tsv file
+ */
+void scan_ht_print_crossover(
+        struct pt_ht * fib,
+        struct rid_request * requests,
+        int requests_num,
+        std::string output_dir) {
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS] = {0};
+    uint32_t tp_sizes[BF_MAX_ELEMENTS] = {0};
+
+    uint32_t pt_matches = 0, scan_matches = 0, bs_matches = 0, crossover = 0;
+    double begin = 0.0, pt_time = 0.0, scan_time = 0.0, bs_time = 0.0;
+    int i = 0, k = 0, lookups = 0;
+
+    std::string filename = output_dir + std::string("/") + std::string(DEFAULT_SCAN_CROSSOVER_FILE);
+    FILE * output_file = fopen(filename.c_str(), "wb");
+    fprintf(output_file, "PREFIX_SIZE\tNUM_ENTRIES\tPT_AVG_TIME\tSCAN_AVG_TIME\tBITSLICE_AVG_TIME\tSPEEDUP\n");
+
+    printf(
+            "\n-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n",
+            "|F|", "# ENTRIES", "PT (us)", "SCAN (us)", "BITSLICE (us)", "SPEEDUP");
+
+    struct pt_ht * itr;
+
+    for (itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        if (itr->prefix_size < 1)
+            continue;
+
+        struct scan_fwd * s = scan_fwd_init(itr);
+        struct bs_fwd * bs = bs_fwd_init(itr);
+
+        if (!s || !bs) {
+
+            scan_fwd_erase(s);
+            bs_fwd_erase(bs);
+
+            continue;
+        }
+
+        // only requests w/ |R| >= |F| ever get to this partition
+        pt_time = 0.0; scan_time = 0.0; bs_time = 0.0; lookups = 0;
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            pt_fwd_lookup(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes);
+            lookups++;
+        }
+
+        pt_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            pt_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            scan_fwd_lookup(s, requests[i].name, requests[i].rid, fp_sizes, tp_sizes, NULL, NULL);
+        }
+
+        scan_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            scan_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        begin = get_time_now();
+
+        for (i = 0; i < requests_num; i++) {
+
+            if (requests[i].size < itr->prefix_size)
+                continue;
+
+            bs_fwd_lookup(bs, requests[i].name, requests[i].rid, fp_sizes, tp_sizes, NULL, NULL);
+        }
+
+        bs_time = get_time_now() - begin;
+
+        for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+            bs_matches += fp_sizes[k] + tp_sizes[k];
+            fp_sizes[k] = 0; tp_sizes[k] = 0;
+        }
+
+        if (lookups > 0) {
+            pt_time = (pt_time / (double) lookups) * 1000000.0;
+            scan_time = (scan_time / (double) lookups) * 1000000.0;
+            bs_time = (bs_time / (double) lookups) * 1000000.0;
+        }
+
+        if (scan_time < pt_time && itr->num_entries > crossover)
+            crossover = itr->num_entries;
+
+        printf(
+            "%-12d\t| %-12d\t| %-12.3f\t| %-12.3f\t| %-12.3f\t| %-.3f\n",
+            itr->prefix_size,
+            itr->num_entries,
+            pt_time, scan_time, bs_time,
+            (scan_time > 0.0 ? pt_time / scan_time : 0.0));
+
+        fprintf(output_file,
+            "%d\t%d\t%-.6f\t%-.6f\t%-.6f\t%-.6f\n",
+            itr->prefix_size,
+            itr->num_entries,
+            pt_time, scan_time, bs_time,
+            (scan_time > 0.0 ? pt_time / scan_time : 0.0));
+
+        scan_fwd_erase(s);
+        bs_fwd_erase(bs);
+    }
+
+    printf(
+            "-------------------------------------------------------------------------------\n"\
+            "%-12s\t| %-12s\t| %-12s\t| %-12s\n"\
+            "-------------------------------------------------------------------------------\n"\
+            "%-12d\t| %-12d\t| %-12d\t| %-12d\n",
+            "CROSSOVER", "# PT MATCHES", "# SCAN MATCHES", "# BS MATCHES",
+            crossover, pt_matches, scan_matches, bs_matches);
+
+    printf("\n");
+
+    // all engines must agree on the match set
+    if (pt_matches != scan_matches || pt_matches != bs_matches)
+        fprintf(stderr, "scan_ht_print_crossover() : [ERROR] %d PT vs. %d SCAN vs. %d BITSLICE matches\n",
+            pt_matches, scan_matches, bs_matches);
+
+    fclose(output_file);
+}
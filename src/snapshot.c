@@ -0,0 +1,352 @@
+/*
+ * snapshot.c
+ *
+ * binary FIB snapshots.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+
+static uint64_t snapshot_header_checksum(struct snapshot_header * header, struct snapshot_part * parts) {
+
+    struct snapshot_header h;
+
+    memcpy(&h, header, sizeof(struct snapshot_header));
+    h.header_checksum = 0;
+
+    return fnv1a(
+        fnv1a(FNV_OFFSET_BASIS, &h, sizeof(struct snapshot_header)),
+        parts, header->num_parts * sizeof(struct snapshot_part));
+}
+
+static uint64_t snapshot_align(uint64_t off) {
+
+    return (off + SNAPSHOT_ALIGN - 1) & ~((uint64_t) SNAPSHOT_ALIGN - 1);
+}
+
+/*
+ * \brief   writes a snapshot of a FIB to a file. partitions are frozen into
+ *          flat tries first (unless they already are).
+ *
+ * \param   fib         the FIB
+ * \param   perm        the bit permutation applied to the FIB's RIDs, NULL
+ *                      if none
+ * \param   filename    path of the snapshot file
+ *
+ * \return  0 on success, -1 otherwise
+ */
+int snapshot_save(
+        struct pt_ht * fib,
+        struct rid_perm * perm,
+        const char * filename) {
+
+    struct snapshot_header header;
+    struct pt_ht * itr;
+    int num_parts = HASH_COUNT(fib), p = 0;
+    uint32_t i = 0;
+
+    struct snapshot_part * parts = (struct snapshot_part *) calloc(num_parts + 1, sizeof(struct snapshot_part));
+    struct pt_flat ** flats = (struct pt_flat **) calloc(num_parts + 1, sizeof(struct pt_flat *));
+
+    memset(&header, 0, sizeof(struct snapshot_header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(struct snapshot_header);
+    header.num_parts = num_parts;
+
+    if (perm != NULL) {
+        header.has_perm = 1;
+        memcpy(header.perm, perm->map, BIT_ORDER_BITS);
+    }
+
+    for (itr = fib, p = 0; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++) {
+
+        // flat tries are dropped on inserts, so an existing one is up-to-date.
+        // mapped ones (e.g. of a snapshot) share the string blob of all
+        // partitions, so only their own strings are copied.
+        if (itr->flat == NULL)
+            flats[p] = pt_flat_init(itr);
+        else
+            flats[p] = (itr->flat->mapped ? pt_flat_copy(itr->flat) : itr->flat);
+
+        parts[p].prefix_size = itr->prefix_size;
+        parts[p].num_entries = itr->num_entries;
+        parts[p].num_dups = itr->num_dups;
+        parts[p].num_nodes = flats[p]->num_nodes;
+        parts[p].first_node = header.num_nodes;
+
+        header.num_nodes += flats[p]->num_nodes;
+        header.strings_size += flats[p]->strings_size;
+    }
+
+    header.parts_off = sizeof(struct snapshot_header);
+    header.nodes_off = snapshot_align(header.parts_off + (num_parts * sizeof(struct snapshot_part)));
+    header.strings_off = header.nodes_off + (header.num_nodes * sizeof(struct pt_flat_node));
+    header.file_size = header.strings_off + header.strings_size;
+
+    FILE * f = fopen(filename, "wb");
+
+    if (!f) {
+
+        fprintf(stderr, "snapshot_save() : [ERROR] couldn't open %s\n", filename);
+
+        for (p = 0, itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++)
+            if (flats[p] != itr->flat) pt_flat_erase(flats[p]);
+
+        free(flats);
+        free(parts);
+
+        return -1;
+    }
+
+    // header goes in last, w/ the checksums
+    char pad[SNAPSHOT_ALIGN] = {0};
+    fwrite(&header, sizeof(struct snapshot_header), 1, f);
+    fwrite(parts, sizeof(struct snapshot_part), num_parts, f);
+    fwrite(pad, 1, header.nodes_off - (header.parts_off + (num_parts * sizeof(struct snapshot_part))), f);
+
+    uint64_t checksum = FNV_OFFSET_BASIS, strings_base = 0;
+
+    // nodes: prefix offsets are made relative to the global string blob
+    for (p = 0; p < num_parts; p++) {
+
+        struct pt_flat_node node;
+
+        for (i = 0; i < flats[p]->num_nodes; i++) {
+
+            memcpy(&node, &(flats[p]->nodes[i]), sizeof(struct pt_flat_node));
+            node.prefix += strings_base;
+
+            fwrite(&node, sizeof(struct pt_flat_node), 1, f);
+            checksum = fnv1a(checksum, &node, sizeof(struct pt_flat_node));
+        }
+
+        strings_base += flats[p]->strings_size;
+    }
+
+    for (p = 0; p < num_parts; p++) {
+
+        fwrite(flats[p]->strings, 1, flats[p]->strings_size, f);
+        checksum = fnv1a(checksum, flats[p]->strings, flats[p]->strings_size);
+    }
+
+    header.payload_checksum = checksum;
+    header.header_checksum = snapshot_header_checksum(&header, parts);
+
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(struct snapshot_header), 1, f);
+
+    int ret = (ferror(f) ? -1 : 0);
+    fclose(f);
+
+    for (p = 0, itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next, p++)
+        if (flats[p] != itr->flat) pt_flat_erase(flats[p]);
+
+    free(flats);
+    free(parts);
+
+    return ret;
+}
+
+/*
+ * \brief   checks the links, key bits and prefix offsets of a partition's
+ *          nodes, so that lookups and thaws on a corrupt file can't follow
+ *          them out of the mapping.
+ *
+ * \return  1 if all nodes are valid, 0 otherwise
+ */
+static int snapshot_check_nodes(
+        struct pt_flat_node * nodes,
+        uint32_t num_nodes,
+        uint64_t strings_size) {
+
+    uint32_t i = 0;
+
+    for (i = 0; i < num_nodes; i++) {
+
+        if (nodes[i].p_left >= num_nodes || nodes[i].p_right >= num_nodes
+            || nodes[i].key_bit < 0 || nodes[i].key_bit >= PT_MAX_DEPTH
+            || nodes[i].prefix >= strings_size)
+            return 0;
+    }
+
+    return 1;
+}
+
+static struct snapshot * snapshot_fail(struct snapshot * snap, const char * filename, const char * reason) {
+
+    fprintf(stderr, "snapshot_load() : [ERROR] %s : %s\n", filename, reason);
+
+    snapshot_unmap(snap);
+
+    return NULL;
+}
+
+/*
+ * \brief   maps a snapshot read-only and adds its partitions to a FIB, as
+ *          frozen partitions w/ the flat trie engine. pages are only read
+ *          from disk as lookups touch them.
+ *
+ * \param   filename    path of the snapshot file
+ * \param   fib         the FIB. it must not hold entries of the same prefix
+ *                      sizes as the snapshot.
+ * \param   perm        set to the snapshot's bit permutation, if any
+ * \param   has_perm    set to 1 if the snapshot has a bit permutation
+ * \param   verify      if 1, the payload checksum is verified as well
+ *
+ * \return  the mapped snapshot, NULL on error
+ */
+struct snapshot * snapshot_load(
+        const char * filename,
+        struct pt_ht ** fib,
+        struct rid_perm * perm,
+        int * has_perm,
+        int verify) {
+
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+
+        if (fd >= 0) close(fd);
+        return snapshot_fail(NULL, filename, "couldn't open file");
+    }
+
+    if ((size_t) st.st_size < sizeof(struct snapshot_header)) {
+
+        close(fd);
+        return snapshot_fail(NULL, filename, "file too small");
+    }
+
+    struct snapshot * snap = (struct snapshot *) calloc(1, sizeof(struct snapshot));
+
+    snap->size = st.st_size;
+    snap->addr = mmap(NULL, snap->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping stays valid after the file is closed
+    close(fd);
+
+    if (snap->addr == MAP_FAILED) {
+
+        snap->addr = NULL;
+        return snapshot_fail(snap, filename, "mmap() failed");
+    }
+
+    char * base = (char *) snap->addr;
+    struct snapshot_header * header = (struct snapshot_header *) base;
+
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0)
+        return snapshot_fail(snap, filename, "not a FIB snapshot");
+
+    if (header->version != SNAPSHOT_VERSION || header->header_size != sizeof(struct snapshot_header))
+        return snapshot_fail(snap, filename, "unsupported version");
+
+    if (header->file_size != snap->size
+        || header->parts_off + (header->num_parts * sizeof(struct snapshot_part)) > snap->size
+        || header->nodes_off + (header->num_nodes * sizeof(struct pt_flat_node)) > snap->size
+        || header->strings_off + header->strings_size > snap->size
+        || (header->nodes_off % SNAPSHOT_ALIGN) != 0)
+        return snapshot_fail(snap, filename, "truncated or corrupt file");
+
+    struct snapshot_part * parts = (struct snapshot_part *) (base + header->parts_off);
+
+    if (snapshot_header_checksum(header, parts) != header->header_checksum)
+        return snapshot_fail(snap, filename, "header checksum mismatch");
+
+    if (verify) {
+
+        uint64_t checksum = fnv1a(FNV_OFFSET_BASIS, base + header->nodes_off, header->num_nodes * sizeof(struct pt_flat_node));
+        checksum = fnv1a(checksum, base + header->strings_off, header->strings_size);
+
+        if (checksum != header->payload_checksum)
+            return snapshot_fail(snap, filename, "payload checksum mismatch");
+    }
+
+    // the prefix strings are '\0' terminated, so any offset w/in the blob 
+    // is a valid string if the last one is
+    char * strings = base + header->strings_off;
+
+    if (header->strings_size > 0 && strings[header->strings_size - 1] != '\0')
+        return snapshot_fail(snap, filename, "corrupt string blob");
+
+    int seen[MAX_PREFIX_SIZE + 1] = {0};
+    uint32_t p = 0;
+
+    for (p = 0; p < header->num_parts; p++) {
+
+        if (parts[p].prefix_size < 0 || parts[p].prefix_size > MAX_PREFIX_SIZE
+            || parts[p].num_nodes != parts[p].num_entries + 1
+            || parts[p].first_node + parts[p].num_nodes > header->num_nodes)
+            return snapshot_fail(snap, filename, "corrupt partition table");
+
+        if (seen[parts[p].prefix_size]++)
+            return snapshot_fail(snap, filename, "duplicate prefix size in partition table");
+
+        if (!snapshot_check_nodes(
+                (struct pt_flat_node *) (base + header->nodes_off) + parts[p].first_node,
+                parts[p].num_nodes, header->strings_size))
+            return snapshot_fail(snap, filename, "corrupt node array");
+
+        if (pt_ht_search(*fib, parts[p].prefix_size) != NULL)
+            return snapshot_fail(snap, filename, "FIB already holds a partition of the same prefix size");
+    }
+
+    for (p = 0; p < header->num_parts; p++) {
+
+        struct pt_ht * s = pt_ht_get_partition(fib, (char *) "", parts[p].prefix_size);
+
+        struct pt_flat * flat = (struct pt_flat *) calloc(1, sizeof(struct pt_flat));
+
+        flat->fib_root = s;
+        flat->prefix_size = s->prefix_size;
+        flat->nodes = (struct pt_flat_node *) (base + header->nodes_off) + parts[p].first_node;
+        flat->num_nodes = parts[p].num_nodes;
+        flat->strings = strings;
+        flat->strings_size = header->strings_size;
+        flat->mapped = 1;
+
+        s->flat = flat;
+        s->frozen = 1;
+        s->engine = PT_ENGINE_FLAT;
+        s->num_entries = parts[p].num_entries;
+        s->num_dups = parts[p].num_dups;
+    }
+
+    *has_perm = header->has_perm;
+
+    if (header->has_perm)
+        memcpy(perm->map, header->perm, BIT_ORDER_BITS);
+
+    return snap;
+}
+
+void snapshot_unmap(struct snapshot * snap) {
+
+    if (!snap)
+        return;
+
+    if (snap->addr)
+        munmap(snap->addr, snap->size);
+
+    free(snap);
+}
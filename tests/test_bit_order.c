@@ -0,0 +1,115 @@
+/*
+ * test_bit_order.c
+ *
+ * a RID bit permutation (see bit_order.h) applied to the FIB and to the
+ * requests must not change any lookup result: the FPs and TPs per prefix
+ * size, the ports of the matches and the next hop of each request are the
+ * same before and after pt_ht_permute(). requests which aren't permuted
+ * don't get the same results (i.e. the permutation isn't a no-op).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "test_fib.h"
+#include "bit_order.h"
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    // lookup results in identity bit order
+    int n = (int) requests.size(), i = 0;
+    std::vector<uint32_t> sizes(n * 2 * BF_MAX_ELEMENTS);
+    std::vector<struct pt_port_set> ports(n);
+    std::vector<uint16_t> next_hops(n);
+    uint32_t tps = 0, fps = 0;
+
+    for (i = 0; i < n; i++) {
+
+        test_fib_lookup(fib, &requests[i], &sizes[i * 2 * BF_MAX_ELEMENTS], &ports[i]);
+        next_hops[i] = pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE);
+    }
+
+    // the permutation is a bijection, and not the identity
+    struct rid_perm perm;
+    rid_perm_init(&perm, fib);
+
+    std::vector<int> seen(BIT_ORDER_BITS, 0);
+    int moved = 0;
+
+    for (i = 0; i < BIT_ORDER_BITS; i++) {
+
+        assert(perm.map[i] < BIT_ORDER_BITS && !seen[perm.map[i]]);
+        seen[perm.map[i]] = 1;
+        moved += (perm.map[i] != i);
+    }
+
+    assert(moved > 0);
+
+    pt_ht_permute(fib, &perm);
+    assert(pt_ht_check(fib));
+
+    uint32_t permuted_sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set permuted_ports;
+    struct click_xia_xid rid;
+    struct rid_request permuted;
+    int unpermuted_diffs = 0;
+
+    for (i = 0; i < n; i++) {
+
+        memcpy(&rid, requests[i].rid, sizeof(struct click_xia_xid));
+        rid_perm_apply(&perm, &rid);
+
+        permuted = requests[i];
+        permuted.rid = &rid;
+
+        test_fib_lookup(fib, &permuted, permuted_sizes, &permuted_ports);
+        uint16_t next_hop = pt_ht_next_hop(fib, permuted.name, permuted.size, permuted.rid, 1, PT_READER_NONE);
+
+        if (memcmp(permuted_sizes, &sizes[i * 2 * BF_MAX_ELEMENTS], sizeof(permuted_sizes)) != 0
+            || memcmp(&permuted_ports, &ports[i], sizeof(struct pt_port_set)) != 0
+            || next_hop != next_hops[i]) {
+
+            fprintf(stderr, "test_bit_order : [ERROR] lookup of %s changed after the permutation\n", requests[i].name);
+            assert(0);
+        }
+
+        for (int k = 0; k < BF_MAX_ELEMENTS; k++) {
+            fps += permuted_sizes[k];
+            tps += permuted_sizes[BF_MAX_ELEMENTS + k];
+        }
+
+        // the same request, in identity bit order
+        test_fib_lookup(fib, &requests[i], permuted_sizes, NULL);
+        unpermuted_diffs += (memcmp(permuted_sizes, &sizes[i * 2 * BF_MAX_ELEMENTS], sizeof(permuted_sizes)) != 0);
+    }
+
+    assert(tps > 0 && fps > 0 && unpermuted_diffs > 0);
+
+    printf("test_bit_order : same lookups for %d requests after moving %d of %d bits (%u TPs, %u FPs, %d differ w/o permuting requests)\n",
+        n, moved, BIT_ORDER_BITS, tps, fps, unpermuted_diffs);
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
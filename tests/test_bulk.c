@@ -0,0 +1,109 @@
+/*
+ * test_bulk.c
+ *
+ * a FIB bulk loaded w/ pt_bulk_build() must hold the same entries as one
+ * built incrementally w/ pt_ht_add(), and return the same matches and next
+ * hops for every request.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "test_fib.h"
+#include "pt_bulk.h"
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL, * bulk_fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+
+    int entries = test_fib_build(&fib, urls);
+    assert(entries > 0);
+
+    // same URLs and next hops, through the bulk loader
+    char url[PREFIX_MAX_LENGTH];
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+    struct pt_bulk * bulk = pt_bulk_init();
+    int collected = 0;
+
+    for (int i = 0; i < (int) urls.size(); i++) {
+
+        strncpy(url, urls[i].c_str(), PREFIX_MAX_LENGTH - 1);
+        url[PREFIX_MAX_LENGTH - 1] = '\0';
+
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+
+        if (prefix_size < 0)
+            continue;
+
+        pt_bulk_add(bulk, &rid, prefix, prefix_size, test_fib_port(prefix, i));
+        collected++;
+    }
+
+    int dups = pt_bulk_build(bulk, &bulk_fib);
+    pt_bulk_erase(bulk);
+
+    assert(pt_ht_check(fib) && pt_ht_check(bulk_fib));
+    assert(collected - dups == entries);
+    assert(HASH_COUNT(fib) == HASH_COUNT(bulk_fib));
+
+    for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        struct pt_ht * s = pt_ht_search(bulk_fib, itr->prefix_size);
+
+        assert(s != NULL && s->num_entries == itr->num_entries);
+    }
+
+    // same prefixes
+    std::vector<std::string> prefixes, bulk_prefixes;
+    pt_ht_get_prefixes(fib, prefixes);
+    pt_ht_get_prefixes(bulk_fib, bulk_prefixes);
+    std::sort(prefixes.begin(), prefixes.end());
+    std::sort(bulk_prefixes.begin(), bulk_prefixes.end());
+    assert(prefixes == bulk_prefixes);
+
+    // same matches and next hops
+    test_requests_build(urls, requests);
+
+    uint32_t sizes[2 * BF_MAX_ELEMENTS], bulk_sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set ports, bulk_ports;
+
+    for (int i = 0; i < (int) requests.size(); i++) {
+
+        test_fib_lookup(fib, &requests[i], sizes, &ports);
+        test_fib_lookup(bulk_fib, &requests[i], bulk_sizes, &bulk_ports);
+
+        assert(memcmp(sizes, bulk_sizes, sizeof(sizes)) == 0);
+        assert(memcmp(&ports, &bulk_ports, sizeof(ports)) == 0);
+
+        assert(pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE)
+            == pt_ht_next_hop(bulk_fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE));
+    }
+
+    printf("test_bulk : bulk == incremental (%d entries, %d requests)\n",
+        entries, (int) requests.size());
+
+    pt_ht_erase(fib);
+    pt_ht_erase(bulk_fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
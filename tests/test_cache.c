@@ -0,0 +1,255 @@
+/*
+ * test_cache.c
+ *
+ * lookups through pt_cache (see rid_cache.h) must give the same results as
+ * lookups w/o it: the same FPs, TPs and ports from pt_ht_lookup(), and the
+ * same next hops from pt_ht_next_hop(), also w/ concurrent readers while a
+ * writer updates the FIB (and so invalidates the cache). entries added or
+ * removed must show up in the very next lookup. requests w/ the same RID
+ * and size but different names don't share results.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <algorithm>
+
+#include "test_fib.h"
+#include "rid_cache.h"
+#include "rcu.h"
+
+#define TEST_READERS        3
+#define TEST_UPDATES        4000
+// requests looked up by the readers, and w/ pt_ht_lookup() (1 thread pool
+// per lookup, so fewer)
+#define TEST_HOT            2048
+#define TEST_LOOKUPS        256
+// the cache holds 1/2 of the readers' requests, so that some are evicted
+#define TEST_CAPACITY       (TEST_HOT / 2)
+
+struct reader_args {
+
+    struct pt_ht * fib;
+    std::vector<struct rid_request> * requests;
+    std::vector<uint16_t> * expected;
+
+    int reader;
+    int * stop;
+
+    unsigned long lookups;
+    unsigned long stale;
+};
+
+static void * reader_run(void * arg) {
+
+    struct reader_args * r = (struct reader_args *) arg;
+    std::vector<struct rid_request> & requests = *(r->requests);
+    int n = std::min((int) requests.size(), TEST_HOT);
+
+    // skewed: the 1st requests are looked up the most
+    for (int i = r->reader; !__atomic_load_n(r->stop, __ATOMIC_ACQUIRE); i++) {
+
+        int k = (i % n) % (1 + (i % 8) * (n / 8));
+
+        uint16_t next_hop = pt_ht_next_hop(r->fib, requests[k].name, requests[k].size, requests[k].rid, 1, r->reader);
+
+        r->stale += (next_hop != (*(r->expected))[k]);
+        __atomic_add_fetch(&(r->lookups), 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls, churn_urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    // results w/o cache
+    int n = (int) requests.size(), lookups = std::min(n, TEST_LOOKUPS), i = 0, k = 0;
+    std::vector<uint16_t> expected(n);
+    std::vector<uint32_t> expected_sizes(lookups * 2 * BF_MAX_ELEMENTS, 0);
+    std::vector<struct pt_port_set> expected_ports(lookups);
+
+    for (i = 0; i < n; i++)
+        expected[i] = pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE);
+
+    for (i = 0; i < lookups; i++) {
+
+        uint32_t * sizes = &expected_sizes[i * 2 * BF_MAX_ELEMENTS];
+        pt_ht_lookup(fib, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS, &expected_ports[i], PT_READER_NONE);
+    }
+
+    pt_cache = rid_cache_init(TEST_CAPACITY);
+
+    // 1) pt_ht_lookup(): the 2nd pass hits
+    uint32_t sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set ports;
+
+    for (k = 0; k < 2; k++) {
+
+        for (i = 0; i < lookups; i++) {
+
+            memset(sizes, 0, sizeof(sizes));
+            pt_ht_lookup(fib, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS, &ports, PT_READER_NONE);
+
+            assert(memcmp(sizes, &expected_sizes[i * 2 * BF_MAX_ELEMENTS], sizeof(sizes)) == 0);
+            assert(memcmp(&ports, &expected_ports[i], sizeof(struct pt_port_set)) == 0);
+        }
+    }
+
+    assert(rid_cache_hit_rate(pt_cache) > 0.0);
+
+    // 2) pt_ht_next_hop() w/ concurrent readers, while a writer adds and
+    // removes entries which aren't TPs of any request (see test_rcu.c), so
+    // that next hops stay the same
+    for (i = 0; i < (int) urls.size(); i += 7) {
+
+        int size = std::count(urls[i].begin(), urls[i].end(), PREFIX_DELIM_CHAR) + 1;
+
+        if (urls[i][urls[i].size() - 1] == PREFIX_DELIM_CHAR)
+            size--;
+
+        if (size < MAX_PREFIX_SIZE && pt_ht_search(fib, size + 1) != NULL && urls[i].size() < 128)
+            churn_urls.push_back(urls[i] + (urls[i][urls[i].size() - 1] == PREFIX_DELIM_CHAR ? "" : "/") + "_cache" + std::to_string(i));
+    }
+
+    assert(!churn_urls.empty());
+
+    pt_rcu = rcu_init();
+
+    pthread_t readers[TEST_READERS];
+    struct reader_args args[TEST_READERS];
+    int stop = 0, r = 0;
+
+    for (r = 0; r < TEST_READERS; r++) {
+
+        args[r].fib = fib;
+        args[r].requests = &requests;
+        args[r].expected = &expected;
+        args[r].reader = rcu_register(pt_rcu);
+        args[r].stop = &stop;
+        args[r].lookups = 0;
+        args[r].stale = 0;
+    }
+
+    for (r = 0; r < TEST_READERS; r++)
+        pthread_create(&readers[r], NULL, reader_run, &args[r]);
+
+    // the readers fill the cache before the 1st update
+    for (r = 0; r < TEST_READERS; r++) {
+
+        while (__atomic_load_n(&(args[r].lookups), __ATOMIC_ACQUIRE) < (unsigned long) (2 * TEST_HOT))
+            usleep(1000);
+    }
+
+    char url[PREFIX_MAX_LENGTH];
+    int updates = 0;
+
+    while (updates < TEST_UPDATES) {
+
+        for (i = 0; i < (int) churn_urls.size() && updates < TEST_UPDATES; i++, updates += 2) {
+
+            snprintf(url, PREFIX_MAX_LENGTH, "%s", churn_urls[i].c_str());
+            assert(pt_ht_add_url(&fib, url, NULL) == 0);
+
+            snprintf(url, PREFIX_MAX_LENGTH, "%s", churn_urls[i].c_str());
+            assert(pt_ht_remove_url(fib, url, NULL) == 0);
+        }
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+
+    unsigned long reads = 0, stale = 0;
+
+    for (r = 0; r < TEST_READERS; r++) {
+
+        pthread_join(readers[r], NULL);
+
+        reads += args[r].lookups;
+        stale += args[r].stale;
+    }
+
+    assert(stale == 0 && pt_cache->invalidations == (uint64_t) updates);
+
+    for (r = 0; r < RCU_EPOCHS; r++)
+        rcu_reclaim(pt_rcu);
+
+    rcu_erase(pt_rcu);
+    pt_rcu = NULL;
+
+    // 3) a request's own name, added w/ a new next hop, is its longest
+    // confirmed match: cached results must not hide it, nor its removal
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+    struct rid_cache_result result;
+    int invalidated = 0;
+
+    for (i = 0; i < lookups; i++) {
+
+        snprintf(url, PREFIX_MAX_LENGTH, "%s", requests[i].name);
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+
+        if (prefix_size != requests[i].size)
+            continue;
+
+        assert(pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE) == expected[i]);
+        assert(rid_cache_lookup(pt_cache, requests[i].name, requests[i].rid, requests[i].size, RID_CACHE_LPM, &result));
+        assert(result.next_hop == expected[i]);
+
+        if (pt_ht_add(&fib, &rid, prefix, prefix_size, TEST_PORTS) != 0)
+            continue;
+
+        assert(pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE) == TEST_PORTS);
+
+        memset(sizes, 0, sizeof(sizes));
+        pt_ht_lookup(fib, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS, &ports, PT_READER_NONE);
+        assert(sizes[BF_MAX_ELEMENTS + prefix_size - 1] == expected_sizes[(i * 2 * BF_MAX_ELEMENTS) + BF_MAX_ELEMENTS + prefix_size - 1] + 1);
+
+        assert(pt_ht_remove(fib, &rid, prefix, prefix_size) == 0);
+        assert(pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE) == expected[i]);
+
+        invalidated++;
+    }
+
+    assert(invalidated > 0);
+
+    // 4) a name w/ the same RID and size is another request (its TPs may
+    // differ)
+    char other[PREFIX_MAX_LENGTH];
+    snprintf(other, PREFIX_MAX_LENGTH, "%s_", requests[0].name);
+
+    pt_ht_next_hop(fib, requests[0].name, requests[0].size, requests[0].rid, 1, PT_READER_NONE);
+
+    assert(rid_cache_lookup(pt_cache, requests[0].name, requests[0].rid, requests[0].size, RID_CACHE_LPM, &result));
+    assert(!rid_cache_lookup(pt_cache, other, requests[0].rid, requests[0].size, RID_CACHE_LPM, &result));
+
+    printf("test_cache : cached == uncached over %d lookups, %lu concurrent reads (%d updates, hit rate %.4f), %d entries added and removed\n",
+        2 * lookups, reads, updates, rid_cache_hit_rate(pt_cache), invalidated);
+
+    rid_cache_erase(pt_cache);
+    pt_cache = NULL;
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * test_classify.c
+ *
+ * TP checks and |F\R| counts on component IDs (see prefix_dict.h) must give
+ * the same results as on the plain strings, in all classification modes:
+ * prefix_info_match() == (strstr(request, prefix) != NULL) and
+ * prefix_info_diff() == req_entry_diff(), for every (request, entry) pair,
+ * including requests too long for bit masks.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "test_fib.h"
+#include "prefix_dict.h"
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls, prefixes;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    // the entries' prefixes, as kept in the FIB
+    pt_ht_get_prefixes(fib, prefixes);
+
+    int n = (int) requests.size(), m = (int) prefixes.size(), i = 0, j = 0;
+    std::vector<struct prefix_info *> entries(m);
+    std::vector<uint64_t> fps(m);
+
+    for (j = 0; j < m; j++) {
+
+        char prefix[PREFIX_MAX_LENGTH];
+        snprintf(prefix, PREFIX_MAX_LENGTH, "%s", prefixes[j].c_str());
+
+        prefix_info_init(&entries[j], prefix, (uint8_t) (count_prefixes(prefix)));
+        fps[j] = prefix_info_fp(entries[j]);
+    }
+
+    // a request w/ more than PREFIX_REQ_MASK_COMPS components, which holds
+    // an entry
+    std::string long_name = prefixes[0];
+
+    for (i = 0; i <= PREFIX_REQ_MASK_COMPS; i++)
+        long_name += "/c";
+
+    std::vector<const char *> names(n + 1);
+
+    for (i = 0; i < n; i++)
+        names[i] = requests[i].name;
+
+    names[n] = long_name.c_str();
+
+    int classify = prefix_classify, mode = 0;
+    unsigned long tps = 0, diffs = 0;
+    struct prefix_req req;
+
+    // the strings are compared once per pair, the IDs in both modes
+    for (i = 0; i <= n; i++) {
+
+        prefix_req_init(&req, names[i]);
+        assert(i < n || req.num_comps > PREFIX_REQ_MASK_COMPS);
+
+        for (j = 0; j < m; j++) {
+
+            int tp = (strstr(names[i], prefixes[j].c_str()) != NULL);
+            unsigned int diff = req_entry_diff(names[i], prefixes[j].c_str(), entries[j]->prefix_size);
+
+            for (mode = PREFIX_CLASSIFY_SCAN; mode <= PREFIX_CLASSIFY_MASKS; mode++) {
+
+                prefix_classify = mode;
+
+                if (prefix_info_match(entries[j], &req) != tp
+                    || prefix_info_diff(entries[j], fps[j], &req, entries[j]->prefix_size) != diff) {
+
+                    fprintf(stderr, "test_classify : [ERROR] %s vs. %s (%s) : TP %d, |F\\R| %u expected\n",
+                        names[i], prefixes[j].c_str(), PREFIX_CLASSIFY_STRS[mode], tp, diff);
+                    assert(0);
+                }
+            }
+
+            tps += tp;
+            diffs += (diff < entries[j]->prefix_size);
+        }
+    }
+
+    assert(tps > 0 && diffs > tps);
+
+    prefix_classify = classify;
+
+    printf("test_classify : SCAN == MASKS == strings over %d x %d (request, entry) pairs (%lu TPs, %lu w/ |F\\R| < |F|)\n",
+        n + 1, m, tps, diffs);
+
+    for (j = 0; j < m; j++)
+        prefix_info_erase(&entries[j]);
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
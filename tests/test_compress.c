@@ -0,0 +1,90 @@
+/*
+ * test_compress.c
+ *
+ * FIB compression (see fib_compress.h) must not change any forwarding
+ * decision: the next hop of the longest confirmed match and the ports of
+ * the matches are the same before and after, for every request. a 2nd pass
+ * over a compressed FIB finds nothing left to remove.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "test_fib.h"
+#include "fib_compress.h"
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+
+    int entries = test_fib_build(&fib, urls);
+    assert(entries > 0);
+    test_requests_build(urls, requests);
+
+    // forwarding decisions before compression
+    int n = (int) requests.size(), i = 0;
+    std::vector<uint16_t> next_hops(n);
+    std::vector<struct pt_port_set> ports(n);
+    uint32_t sizes[2 * BF_MAX_ELEMENTS];
+    int forwarded = 0;
+
+    for (i = 0; i < n; i++) {
+
+        next_hops[i] = pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE);
+        test_fib_lookup(fib, &requests[i], sizes, &ports[i]);
+
+        forwarded += (next_hops[i] != PT_PORT_NONE);
+    }
+
+    // URLs of a domain mostly share a next hop, so there's a lot to remove
+    int removed = fib_compress(fib);
+    uint32_t left = 0;
+
+    for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        left += itr->num_entries;
+
+    assert(forwarded > 0 && removed > 0);
+    assert(pt_ht_check(fib) && (int) left == entries - removed);
+
+    struct pt_port_set compressed_ports;
+
+    for (i = 0; i < n; i++) {
+
+        uint16_t next_hop = pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE);
+        test_fib_lookup(fib, &requests[i], sizes, &compressed_ports);
+
+        if (next_hop != next_hops[i]
+            || memcmp(&compressed_ports, &ports[i], sizeof(struct pt_port_set)) != 0) {
+
+            fprintf(stderr, "test_compress : [ERROR] forwarding of %s changed (next hop %d vs. %d)\n",
+                requests[i].name, (int) next_hop, (int) next_hops[i]);
+            assert(0);
+        }
+    }
+
+    assert(fib_compress(fib) == 0);
+
+    printf("test_compress : %d of %d entries removed, same forwarding for %d requests\n",
+        removed, entries, n);
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * test_delta.c
+ *
+ * applying a delta of adds to a FIB must give the same FIB as building it
+ * w/ all entries in the 1st place, and applying the reverse delta (the same
+ * URLs, removed) must give back the original FIB, next hops included.
+ * delta URLs go through the same normalization as FIB URLs.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <algorithm>
+
+#include "test_fib.h"
+#include "delta.h"
+
+/*
+ * \brief   both FIBs hold the same prefixes, and return the same matches
+ *          and next hops for all requests.
+ */
+static int same_fib(
+        struct pt_ht * a,
+        struct pt_ht * b,
+        std::vector<struct rid_request> & requests) {
+
+    std::vector<std::string> a_prefixes, b_prefixes;
+
+    pt_ht_get_prefixes(a, a_prefixes);
+    pt_ht_get_prefixes(b, b_prefixes);
+    std::sort(a_prefixes.begin(), a_prefixes.end());
+    std::sort(b_prefixes.begin(), b_prefixes.end());
+
+    if (!pt_ht_check(a) || !pt_ht_check(b) || a_prefixes != b_prefixes)
+        return 0;
+
+    uint32_t a_sizes[2 * BF_MAX_ELEMENTS], b_sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set a_ports, b_ports;
+
+    for (int i = 0; i < (int) requests.size(); i++) {
+
+        test_fib_lookup(a, &requests[i], a_sizes, &a_ports);
+        test_fib_lookup(b, &requests[i], b_sizes, &b_ports);
+
+        if (memcmp(a_sizes, b_sizes, sizeof(a_sizes)) != 0)
+            return 0;
+
+        if (memcmp(&a_ports, &b_ports, sizeof(a_ports)) != 0)
+            return 0;
+    }
+
+    return 1;
+}
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls, base_urls, extra_urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL, * base_fib = NULL, * full_fib = NULL, * all_fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+
+    // the last 1/3 of the URLs goes in the delta. URLs which can't be added
+    // to the full FIB (e.g. duplicate RIDs) are left out, so that every 
+    // record of the delta (and of its reverse) is applied.
+    char url[PREFIX_MAX_LENGTH];
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+
+    for (int i = 0; i < (int) urls.size(); i++) {
+
+        strncpy(url, urls[i].c_str(), PREFIX_MAX_LENGTH - 1);
+        url[PREFIX_MAX_LENGTH - 1] = '\0';
+
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+
+        if (prefix_size < 0 || pt_ht_add(&all_fib, &rid, prefix, prefix_size, PT_PORT_NONE) != 0)
+            continue;
+
+        (i < (int) (2 * urls.size() / 3) ? base_urls : extra_urls).push_back(urls[i]);
+    }
+
+    pt_ht_erase(all_fib);
+
+    assert(test_fib_build(&fib, base_urls) == (int) base_urls.size());
+    assert(test_fib_build(&base_fib, base_urls) == (int) base_urls.size());
+    assert(test_fib_build(&full_fib, base_urls) == (int) base_urls.size());
+    test_requests_build(urls, requests);
+
+    // the delta's URLs are added w/ next hops (see below)
+    for (int i = 0; i < (int) extra_urls.size(); i++) {
+
+        snprintf(url, PREFIX_MAX_LENGTH, "%s", extra_urls[i].c_str());
+
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+        assert(pt_ht_add(&full_fib, &rid, prefix, prefix_size, (uint16_t) (i % TEST_PORTS)) == 0);
+    }
+
+    // text deltas: every other URL w/ a trailing '/', added URLs w/ their
+    // next hops (but the 1st, w/ an invalid one), plus a URL which is too 
+    // long to be a FIB entry
+    char filename[PREFIX_MAX_LENGTH];
+    snprintf(filename, PREFIX_MAX_LENGTH, "/tmp/test_delta.%d", (int) getpid());
+
+    for (int k = 0; k < 2; k++) {
+
+        FILE * f = fopen(filename, "w");
+        assert(f != NULL);
+
+        fprintf(f, "# %s\n\n", (k == 0 ? "adds" : "removes"));
+
+        for (int i = 0; i < (int) extra_urls.size(); i++) {
+
+            std::string & u = extra_urls[(k == 0 ? i : (int) extra_urls.size() - 1 - i)];
+            int slash = (i % 2) && (u[u.size() - 1] != PREFIX_DELIM_CHAR);
+
+            if (k == 0)
+                fprintf(f, "+%s%s %d\n", u.c_str(), (slash ? PREFIX_DELIM : ""), (i > 0 ? i % TEST_PORTS : PT_MAX_PORTS));
+            else
+                fprintf(f, "-%s%s\n", u.c_str(), (slash ? PREFIX_DELIM : ""));
+        }
+
+        fprintf(f, "%c%s\n", (k == 0 ? '+' : '-'), std::string(PREFIX_MAX_LENGTH - 8, 'x').c_str());
+        fclose(f);
+
+        struct fib_delta * delta = delta_from_urls(filename);
+
+        assert(delta != NULL && delta->num_records == extra_urls.size());
+
+        // the invalid next hop is ignored
+        if (k == 0) {
+
+            assert(delta->records[0].port == PT_PORT_NONE && delta->records[1].port == 1);
+            delta->records[0].port = 0;
+        }
+
+        // save / load round trip
+        assert(delta_save(delta, filename) == 0);
+        struct fib_delta * loaded = delta_load(filename);
+
+        assert(loaded != NULL && loaded->num_records == delta->num_records);
+        assert(memcmp(loaded->records, delta->records, delta->num_records * sizeof(struct delta_record)) == 0);
+        assert(loaded->strings_size == delta->strings_size);
+        assert(memcmp(loaded->strings, delta->strings, delta->strings_size) == 0);
+
+        uint32_t skipped = 0;
+
+        assert(delta_apply(loaded, &fib, NULL, &skipped) == (int) extra_urls.size());
+        assert(skipped == 0);
+
+        assert(same_fib(fib, (k == 0 ? full_fib : base_fib), requests));
+
+        // a delta which was applied already is all no-ops
+        assert(delta_apply(loaded, &fib, NULL, &skipped) == 0);
+        assert(skipped == extra_urls.size());
+
+        delta_erase(delta);
+        delta_erase(loaded);
+    }
+
+    printf("test_delta : apply and revert ok (%d base entries, %d records)\n",
+        (int) base_urls.size(), (int) extra_urls.size());
+
+    unlink(filename);
+    pt_ht_erase(fib);
+    pt_ht_erase(base_fib);
+    pt_ht_erase(full_fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
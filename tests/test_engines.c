@@ -0,0 +1,92 @@
+/*
+ * test_engines.c
+ *
+ * all lookup engines (scan, bitslice, dir, mbt, flat and louds) must find
+ * the same matches as the PT, i.e. the same nr. of TPs and FPs per prefix
+ * size and the same next hops, for every request.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "test_fib.h"
+
+int main(int argc, char **argv) {
+
+    int engines[] = {
+        PT_ENGINE_SCAN, PT_ENGINE_BITSLICE, PT_ENGINE_DIR,
+        PT_ENGINE_MBT, PT_ENGINE_FLAT, PT_ENGINE_LOUDS};
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    int n = (int) requests.size();
+    std::vector<uint32_t> expected(n * 2 * BF_MAX_ELEMENTS, 0);
+    std::vector<struct pt_port_set> expected_ports(n);
+    uint32_t sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set ports;
+    uint32_t tps = 0, fps = 0;
+    int routed = 0;
+
+    // the PT is the reference
+    for (int i = 0; i < n; i++) {
+
+        test_fib_lookup(fib, &requests[i], &expected[i * 2 * BF_MAX_ELEMENTS], &expected_ports[i]);
+        routed += (pt_port_set_count(&expected_ports[i]) > 0);
+
+        for (int k = 0; k < BF_MAX_ELEMENTS; k++) {
+            fps += expected[(i * 2 * BF_MAX_ELEMENTS) + k];
+            tps += expected[(i * 2 * BF_MAX_ELEMENTS) + BF_MAX_ELEMENTS + k];
+        }
+    }
+
+    // a fixture w/o FPs or TPs wouldn't test much
+    assert(tps > 0 && fps > 0 && routed > 0);
+
+    for (int e = 0; e < (int) (sizeof(engines) / sizeof(int)); e++) {
+
+        pt_ht_set_engine(fib, engines[e]);
+
+        for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+            assert(itr->engine == engines[e]);
+
+        for (int i = 0; i < n; i++) {
+
+            test_fib_lookup(fib, &requests[i], sizes, &ports);
+
+            if (memcmp(sizes, &expected[i * 2 * BF_MAX_ELEMENTS], sizeof(sizes)) != 0
+                || memcmp(&ports, &expected_ports[i], sizeof(struct pt_port_set)) != 0) {
+
+                fprintf(stderr, "test_engines : [ERROR] %s and PT differ for %s\n",
+                    PT_ENGINE_STRS[engines[e]], requests[i].name);
+                assert(0);
+            }
+        }
+
+        printf("test_engines : %s == PT over %d requests (%u TPs, %u FPs, %d w/ next hops)\n",
+            PT_ENGINE_STRS[engines[e]], n, tps, fps, routed);
+    }
+
+    pt_ht_set_engine(fib, PT_ENGINE_PT);
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
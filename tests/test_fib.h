@@ -0,0 +1,200 @@
+/*
+ * test_fib.h
+ *
+ * fixtures shared by the behaviour tests: a FIB w/ the URLs of a URL file
+ * (e.g. misc/url.txt) and deterministic next hops, and a deterministic set
+ * of requests out of the same URLs. each test is a main() which asserts
+ * on the behaviour of the FIB, run by 'make test'.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#ifndef _TEST_FIB_H_
+#define _TEST_FIB_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include <string>
+#include <vector>
+
+#include "rid_utils.h"
+#include "pt.h"
+
+#define TEST_URL_FILE       (char *) "misc/url.txt"
+
+// next hops are picked out of [0, TEST_PORTS[
+#define TEST_PORTS          16
+
+/*
+ * \brief   next hop of the i-th URL of the file: the same for all URLs of a
+ *          domain (1st prefix element), except for every 10th URL.
+ */
+static __inline uint16_t test_fib_port(const char * url, int i) {
+
+    uint64_t h = fnv1a(FNV_OFFSET_BASIS, url, strcspn(url, PREFIX_DELIM));
+
+    return (uint16_t) (((i % 10) == 9 ? h + i : h) % TEST_PORTS);
+}
+
+/*
+ * \brief   reads the URLs of a URL file.
+ *
+ * \return  nr. of URLs read, -1 if the file can't be opened
+ */
+static __inline int test_fib_read(const char * url_file, std::vector<std::string> & urls) {
+
+    char line[PREFIX_MAX_LENGTH];
+    FILE * fr = fopen(url_file, "r");
+
+    if (fr == NULL) {
+
+        fprintf(stderr, "test_fib_read() : [ERROR] couldn't open %s\n", url_file);
+        return -1;
+    }
+
+    while (fgets(line, PREFIX_MAX_LENGTH, fr) != NULL) {
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] != '\0')
+            urls.push_back(std::string(line));
+    }
+
+    fclose(fr);
+
+    return (int) urls.size();
+}
+
+/*
+ * \brief   builds a FIB out of a set of URLs, w/ next hops given by
+ *          test_fib_port(). URLs which can't be added (invalid or
+ *          duplicate RIDs) are skipped.
+ *
+ * \return  nr. of entries in the FIB
+ */
+static __inline int test_fib_build(struct pt_ht ** fib, std::vector<std::string> & urls) {
+
+    char url[PREFIX_MAX_LENGTH];
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+    int entries = 0;
+
+    for (int i = 0; i < (int) urls.size(); i++) {
+
+        strncpy(url, urls[i].c_str(), PREFIX_MAX_LENGTH - 1);
+        url[PREFIX_MAX_LENGTH - 1] = '\0';
+
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+
+        if (prefix_size < 0)
+            continue;
+
+        if (pt_ht_add(fib, &rid, prefix, prefix_size, test_fib_port(prefix, i)) == 0)
+            entries++;
+    }
+
+    return entries;
+}
+
+/*
+ * \brief   builds 2 requests per URL: the URL w/ (i % 3) extra elements
+ *          appended (matches its own entry), and the domain of the URL w/
+ *          the URL of some other line appended (mostly FPs and partial
+ *          matches).
+ */
+static __inline void test_requests_build(std::vector<std::string> & urls, std::vector<struct rid_request> & requests) {
+
+    char name[PREFIX_MAX_LENGTH];
+    int n = (int) urls.size();
+
+    for (int i = 0; i < n; i++) {
+
+        for (int k = 0; k < 2; k++) {
+
+            std::string s;
+
+            if (k == 0) {
+
+                s = urls[i];
+
+                for (int j = 0; j < (i % 3); j++)
+                    s += (s[s.size() - 1] == PREFIX_DELIM_CHAR ? "t" : "/t") + std::to_string(j);
+
+            } else {
+
+                s = urls[i].substr(0, urls[i].find(PREFIX_DELIM_CHAR))
+                    + PREFIX_DELIM + urls[(i * 7919) % n];
+            }
+
+            if (s.size() >= (PREFIX_MAX_LENGTH * 0.75))
+                continue;
+
+            memcpy(name, s.c_str(), s.size() + 1);
+
+            struct rid_request request;
+            request.rid = (struct click_xia_xid *) calloc(1, sizeof(struct click_xia_xid));
+            request.size = name_to_rid(&(request.rid), name);
+            request.name = strdup(name);
+
+            requests.push_back(request);
+        }
+    }
+}
+
+/*
+ * \brief   looks up a request in all partitions of size |F| <= |R|, w/ the
+ *          partitions' engines, into sizes (FPs per |F| 1st, then TPs per
+ *          |F|, i.e. 2 x BF_MAX_ELEMENTS counters).
+ *
+ * \param   ports   next hops of the matches, NULL if not needed
+ */
+static __inline void test_fib_lookup(
+        struct pt_ht * fib,
+        struct rid_request * request,
+        uint32_t * sizes,
+        struct pt_port_set * ports) {
+
+    memset(sizes, 0, 2 * BF_MAX_ELEMENTS * sizeof(uint32_t));
+
+    if (ports != NULL)
+        pt_port_set_clear(ports);
+
+    for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        if (itr->prefix_size > request->size)
+            continue;
+
+        pt_ht_lookup_partition(
+            itr, request->name, request->size, request->rid,
+            sizes, sizes + BF_MAX_ELEMENTS, ports, NULL);
+    }
+}
+
+static __inline void test_requests_erase(std::vector<struct rid_request> & requests) {
+
+    for (int i = 0; i < (int) requests.size(); i++) {
+        free(requests[i].name);
+        free(requests[i].rid);
+    }
+
+    requests.clear();
+}
+
+#endif /* _TEST_FIB_H_ */
@@ -0,0 +1,183 @@
+/*
+ * test_fib_version.c
+ *
+ * copy-on-write FIB versions (see fib_version.h): updates to the next
+ * version aren't seen by lookups until fib_handle_commit(), and all lookups
+ * after it see them, i.e. the same results as a FIB updated in place.
+ * partitions w/o updates are shared by both versions (same pointers), only
+ * the updated ones are copied.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "test_fib.h"
+#include "fib_version.h"
+
+/*
+ * \brief   nr. of requests w/ different FPs or TPs in the handle's current
+ *          version and in a reference FIB.
+ */
+static int diff_lookups(
+        struct fib_handle * handle,
+        int reader,
+        struct pt_ht * ref,
+        std::vector<struct rid_request> & requests) {
+
+    uint32_t sizes[2 * BF_MAX_ELEMENTS], ref_sizes[2 * BF_MAX_ELEMENTS];
+    int diffs = 0;
+
+    for (int i = 0; i < (int) requests.size(); i++) {
+
+        memset(sizes, 0, sizeof(sizes));
+        fib_handle_lookup(handle, reader, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS);
+        test_fib_lookup(ref, &requests[i], ref_sizes, NULL);
+
+        diffs += (memcmp(sizes, ref_sizes, sizeof(sizes)) != 0);
+    }
+
+    return diffs;
+}
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls, new_urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL, * ref = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    assert(test_fib_build(&ref, urls) > 0);
+
+    // new entries, 1 element longer than some of the URLs, only in some
+    // partitions
+    int touched[MAX_PREFIX_SIZE + 1] = {0};
+    int i = 0, k = 0;
+
+    for (i = 0; i < (int) urls.size(); i += 5) {
+
+        int size = std::count(urls[i].begin(), urls[i].end(), PREFIX_DELIM_CHAR) + 1;
+
+        if (urls[i][urls[i].size() - 1] == PREFIX_DELIM_CHAR)
+            size--;
+
+        if (size + 1 > 3 || pt_ht_search(fib, size + 1) == NULL || urls[i].size() >= 128)
+            continue;
+
+        new_urls.push_back(urls[i] + (urls[i][urls[i].size() - 1] == PREFIX_DELIM_CHAR ? "" : "/") + "_v" + std::to_string(i));
+    }
+
+    assert(!new_urls.empty());
+
+    // requests out of 1/4 of the URLs, and of all new entries (see 
+    // test_requests_build())
+    std::vector<std::string> request_urls;
+
+    for (i = 0; i < (int) urls.size(); i += 4)
+        request_urls.push_back(urls[i]);
+
+    request_urls.insert(request_urls.end(), new_urls.begin(), new_urls.end());
+    test_requests_build(request_urls, requests);
+
+    struct fib_handle * handle = fib_handle_init(&fib);
+    int reader = rcu_register(handle->rcu);
+
+    assert(fib == NULL);
+    assert(diff_lookups(handle, reader, ref, requests) == 0);
+
+    char url[PREFIX_MAX_LENGTH];
+    char prefix[PREFIX_MAX_LENGTH];
+    struct click_xia_xid rid;
+
+    struct pt_ht * prev_parts[MAX_PREFIX_SIZE + 1];
+    memcpy(prev_parts, handle->current->parts, sizeof(prev_parts));
+
+    // 1) adds
+    for (i = 0; i < (int) new_urls.size(); i++) {
+
+        snprintf(url, PREFIX_MAX_LENGTH, "%s", new_urls[i].c_str());
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+
+        assert(prefix_size > 0);
+        assert(fib_handle_add(handle, &rid, prefix, prefix_size) == 0);
+        assert(pt_ht_add(&ref, &rid, prefix, prefix_size, PT_PORT_NONE) == 0);
+
+        touched[prefix_size] = 1;
+    }
+
+    // not published yet
+    int diffs = diff_lookups(handle, reader, ref, requests);
+    assert(diffs > 0);
+
+    fib_handle_commit(handle);
+
+    int shared = 0, copied = 0;
+
+    for (k = 1; k <= MAX_PREFIX_SIZE; k++) {
+
+        if (prev_parts[k] == NULL)
+            continue;
+
+        if (touched[k]) {
+
+            assert(handle->current->parts[k] != prev_parts[k]);
+            copied++;
+
+        } else {
+
+            assert(handle->current->parts[k] == prev_parts[k]);
+            shared++;
+        }
+    }
+
+    assert(shared > 0 && copied > 0);
+    assert(diff_lookups(handle, reader, ref, requests) == 0);
+
+    // 2) removes, back to the original FIB
+    memcpy(prev_parts, handle->current->parts, sizeof(prev_parts));
+
+    for (i = 0; i < (int) new_urls.size(); i++) {
+
+        snprintf(url, PREFIX_MAX_LENGTH, "%s", new_urls[i].c_str());
+        int prefix_size = pt_ht_url_to_rid(url, prefix, &rid, NULL);
+
+        assert(fib_handle_remove(handle, &rid, prefix, prefix_size) == 0);
+        assert(pt_ht_remove(ref, &rid, prefix, prefix_size) == 0);
+    }
+
+    assert(diff_lookups(handle, reader, ref, requests) == diffs);
+
+    fib_handle_commit(handle);
+
+    for (k = 1; k <= MAX_PREFIX_SIZE; k++)
+        if (prev_parts[k] != NULL)
+            assert((handle->current->parts[k] == prev_parts[k]) == !touched[k]);
+
+    assert(diff_lookups(handle, reader, ref, requests) == 0);
+
+    fib = fib_handle_detach(handle);
+    assert(pt_ht_check(fib));
+
+    printf("test_fib_version : %d adds and removes seen after commit only (%d of %d requests), %d partitions shared, %d copied\n",
+        (int) new_urls.size(), diffs, (int) requests.size(), shared, copied);
+
+    pt_ht_erase(fib);
+    pt_ht_erase(ref);
+    test_requests_erase(requests);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * test_match_set.c
+ *
+ * the stats-free lookup (pt_fwd_lookup_fast()) must find the same matches
+ * as pt_fwd_lookup(), partition by partition: the same nr. of matches per
+ * prefix size (i.e. TPs + FPs), the same ports and the same nr. of visited
+ * nodes. the entries in the match set are RID matches of the request, and
+ * split into the same TPs and FPs.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <set>
+
+#include "test_fib.h"
+#include "prefix_dict.h"
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    uint32_t fp_sizes[BF_MAX_ELEMENTS], tp_sizes[BF_MAX_ELEMENTS];
+    struct pt_port_set ports;
+    struct pt_match_set matches;
+    char prefix[PREFIX_MAX_LENGTH];
+
+    unsigned long total = 0, listed = 0;
+    int n = (int) requests.size(), i = 0, k = 0;
+
+    for (i = 0; i < n; i++) {
+
+        for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+            if (itr->prefix_size > requests[i].size)
+                continue;
+
+            memset(fp_sizes, 0, sizeof(fp_sizes));
+            memset(tp_sizes, 0, sizeof(tp_sizes));
+            pt_port_set_clear(&ports);
+            pt_match_set_init(&matches);
+
+            int visits = pt_fwd_lookup_ports(itr->trie, requests[i].name, requests[i].size, requests[i].rid, -1, fp_sizes, tp_sizes, &ports);
+            int fast_visits = pt_fwd_lookup_fast(itr->trie, requests[i].rid, -1, &matches);
+
+            uint32_t num_matches = 0, tps = 0;
+
+            for (k = 0; k < BF_MAX_ELEMENTS; k++) {
+
+                assert(matches.sizes[k] == fp_sizes[k] + tp_sizes[k]);
+                num_matches += matches.sizes[k];
+                tps += tp_sizes[k];
+            }
+
+            assert(visits == fast_visits);
+            assert(matches.num_entries == num_matches);
+            assert(memcmp(&(matches.ports), &ports, sizeof(struct pt_port_set)) == 0);
+
+            total += num_matches;
+
+            if (matches.num_entries > PT_MATCH_SET_MAX)
+                continue;
+
+            // the listed entries are distinct RID matches, w/ the same TPs
+            std::set<struct pt_fwd *> entries(matches.entries, matches.entries + matches.num_entries);
+            uint32_t entry_tps = 0;
+
+            assert(entries.size() == matches.num_entries);
+
+            for (k = 0; k < (int) matches.num_entries; k++) {
+
+                struct pt_fwd * e = matches.entries[k];
+
+                assert(e->prefix_size == itr->prefix_size && rid_match(requests[i].rid, e->prefix_rid));
+                assert(prefix_info_str(e->prefix_i, prefix, PREFIX_MAX_LENGTH) >= 0);
+
+                entry_tps += (strstr(requests[i].name, prefix) != NULL);
+            }
+
+            assert(entry_tps == tps);
+            listed += matches.num_entries;
+        }
+    }
+
+    assert(total > 0 && listed > 0);
+
+    printf("test_match_set : pt_fwd_lookup_fast() == pt_fwd_lookup() over %d requests (%lu matches, %lu listed)\n",
+        n, total, listed);
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * test_port_set.c
+ *
+ * the ports of a request (see struct pt_port_set) are the union of the next
+ * hops of all its matches: pt_ht_lookup() must return the OR of the port
+ * sets of each partition (pt_ht_lookup_partition()), and the port set of a
+ * partition holds the ports of all the entries it matches (and no others).
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include "test_fib.h"
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    uint32_t sizes[2 * BF_MAX_ELEMENTS], part_sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set ports, part_ports, union_ports, entry_ports;
+    struct pt_match_set matches;
+
+    // pt_ht_lookup() starts a thread pool per request, so only every 4th
+    // request goes through it
+    int n = (int) requests.size(), i = 0, k = 0;
+    int checked = 0, multi_part = 0;
+
+    for (i = 0; i < n; i += 4) {
+
+        memset(part_sizes, 0, sizeof(part_sizes));
+        pt_port_set_clear(&union_ports);
+
+        // partitions which add ports not seen in smaller partitions
+        int adding_parts = 0;
+
+        for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+            if (itr->prefix_size > requests[i].size)
+                continue;
+
+            pt_port_set_clear(&part_ports);
+            pt_ht_lookup_partition(
+                itr, requests[i].name, requests[i].size, requests[i].rid,
+                part_sizes, part_sizes + BF_MAX_ELEMENTS, &part_ports, NULL);
+
+            // the ports of the partition's matches, one by one
+            pt_match_set_init(&matches);
+            pt_fwd_lookup_fast(itr->trie, requests[i].rid, -1, &matches);
+
+            if (matches.num_entries <= PT_MATCH_SET_MAX) {
+
+                pt_port_set_clear(&entry_ports);
+
+                for (k = 0; k < (int) matches.num_entries; k++)
+                    pt_port_set_add(&entry_ports, matches.entries[k]->port);
+
+                assert(memcmp(&entry_ports, &part_ports, sizeof(struct pt_port_set)) == 0);
+            }
+
+            int prev_count = pt_port_set_count(&union_ports);
+            pt_port_set_union(&union_ports, &part_ports);
+            adding_parts += (pt_port_set_count(&union_ports) > prev_count);
+        }
+
+        memset(sizes, 0, sizeof(sizes));
+        pt_ht_lookup(fib, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS, &ports, PT_READER_NONE);
+
+        if (memcmp(&ports, &union_ports, sizeof(struct pt_port_set)) != 0
+            || memcmp(sizes, part_sizes, sizeof(sizes)) != 0) {
+
+            fprintf(stderr, "test_port_set : [ERROR] ports of %s aren't the union of its partitions' ports\n", requests[i].name);
+            assert(0);
+        }
+
+        checked++;
+        multi_part += (adding_parts > 1);
+    }
+
+    // unions of > 1 partition, i.e. not just a copy of a single port set
+    assert(checked > 0 && multi_part > 0);
+
+    printf("test_port_set : pt_ht_lookup() ports == union of partition ports for %d requests (%d w/ ports from > 1 partition)\n",
+        checked, multi_part);
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * test_rcu.c
+ *
+ * lock-free readers must never miss an entry of the FIB while a writer
+ * adds and removes other entries w/ pt_rcu set (see rcu.h): every lookup
+ * finds at least the matches it finds w/o updates, and the same next hops
+ * (the writer's entries have none). at the end, the FIB must be back to
+ * where it was and all retired nodes reclaimed. readers calling
+ * pt_ht_lookup() concurrently get the same results as a single caller, and
+ * none of their partition stats updates get lost.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <algorithm>
+
+#include "test_fib.h"
+#include "rcu.h"
+
+#define TEST_READERS    3
+#define TEST_UPDATES    20000
+// requests looked up w/ pt_ht_lookup() (1 thread pool per lookup, so fewer)
+#define TEST_LOOKUPS    128
+
+struct reader_args {
+
+    struct pt_ht * fib;
+    std::vector<struct rid_request> * requests;
+    std::vector<struct pt_match_set> * expected;
+
+    int reader;
+    int * stop;
+
+    unsigned long lookups;
+    unsigned long misses;
+};
+
+static void * reader_run(void * arg) {
+
+    struct reader_args * r = (struct reader_args *) arg;
+    std::vector<struct rid_request> & requests = *(r->requests);
+
+    struct pt_match_set matches;
+
+    for (int i = r->reader; !__atomic_load_n(r->stop, __ATOMIC_ACQUIRE); i = (i + 1) % requests.size()) {
+
+        pt_match_set_init(&matches);
+
+        rcu_read_lock(pt_rcu, r->reader);
+
+        struct pt_ht * s = NULL;
+        int prefix_size = requests[i].size;
+
+        while ((s == NULL) && prefix_size > 0)
+            s = pt_ht_search(r->fib, prefix_size--);
+
+        for ( ; s != NULL; s = (struct pt_ht *) s->hh.prev)
+            pt_fwd_lookup_fast(rcu_dereference(s->trie), requests[i].rid, -1, &matches);
+
+        rcu_read_unlock(pt_rcu, r->reader);
+
+        // an entry moved by a remove may be seen twice, but none can be
+        // missed
+        struct pt_match_set & expected = (*(r->expected))[i];
+        int miss = (memcmp(&(matches.ports), &(expected.ports), sizeof(struct pt_port_set)) != 0);
+
+        for (int k = 0; k < BF_MAX_ELEMENTS; k++)
+            miss |= (matches.sizes[k] < expected.sizes[k]);
+
+        r->misses += miss;
+        r->lookups++;
+    }
+
+    return NULL;
+}
+
+struct lookup_args {
+
+    struct pt_ht * fib;
+    std::vector<struct rid_request> * requests;
+    std::vector<uint32_t> * expected_sizes;
+    std::vector<struct pt_port_set> * expected_ports;
+
+    int reader;
+    unsigned long mismatches;
+};
+
+static void * lookup_run(void * arg) {
+
+    struct lookup_args * l = (struct lookup_args *) arg;
+    std::vector<struct rid_request> & requests = *(l->requests);
+
+    uint32_t sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set ports;
+
+    for (int i = 0; i < TEST_LOOKUPS; i++) {
+
+        memset(sizes, 0, sizeof(sizes));
+        pt_ht_lookup(l->fib, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS, &ports, l->reader);
+
+        l->mismatches += (memcmp(sizes, &((*(l->expected_sizes))[i * 2 * BF_MAX_ELEMENTS]), sizeof(sizes)) != 0
+            || memcmp(&ports, &((*(l->expected_ports))[i]), sizeof(struct pt_port_set)) != 0);
+    }
+
+    // partition walks are short next to a thread pool, so these are the
+    // ones which race on the partition stats
+    for (int i = 0; i < (int) requests.size(); i++)
+        test_fib_lookup(l->fib, &requests[i], sizes, NULL);
+
+    return NULL;
+}
+
+/*
+ * \brief   sum of the (TPs, FPs, TNs, matches) counters of all partitions
+ */
+static uint64_t stats_total(struct pt_ht * fib) {
+
+    uint64_t total = 0;
+
+    for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        total += itr->general_stats->tps + itr->general_stats->fps + itr->general_stats->tns + itr->general_stats->total_matches;
+
+    return total;
+}
+
+static void stats_reset(struct pt_ht * fib) {
+
+    for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        lookup_stats_reset(itr->general_stats);
+}
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls, churn_urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL;
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    int entries = test_fib_build(&fib, urls);
+    assert(entries > 0);
+    test_requests_build(urls, requests);
+
+    std::vector<std::string> prefixes;
+    pt_ht_get_prefixes(fib, prefixes);
+    std::sort(prefixes.begin(), prefixes.end());
+
+    // matches w/o updates
+    int n = (int) requests.size();
+    std::vector<struct pt_match_set> expected(n);
+
+    for (int i = 0; i < n; i++) {
+
+        pt_match_set_init(&expected[i]);
+
+        for (struct pt_ht * itr = fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+            if (itr->prefix_size <= requests[i].size)
+                pt_fwd_lookup_fast(itr->trie, requests[i].rid, -1, &expected[i]);
+        }
+    }
+
+    // the writer's URLs: 1 element longer than URLs in the FIB, so that
+    // they go to partitions which exist already (partitions aren't added
+    // or removed, which readers can't cope w/)
+    for (int i = 0; i < (int) urls.size(); i += 7) {
+
+        int size = std::count(urls[i].begin(), urls[i].end(), PREFIX_DELIM_CHAR) + 1;
+
+        if (urls[i][urls[i].size() - 1] == PREFIX_DELIM_CHAR)
+            size--;
+
+        if (size < MAX_PREFIX_SIZE && pt_ht_search(fib, size + 1) != NULL && urls[i].size() < 128)
+            churn_urls.push_back(urls[i] + (urls[i][urls[i].size() - 1] == PREFIX_DELIM_CHAR ? "" : "/") + "_rcu" + std::to_string(i));
+    }
+
+    assert(!churn_urls.empty());
+
+    pt_rcu = rcu_init();
+
+    pthread_t readers[TEST_READERS];
+    struct reader_args args[TEST_READERS];
+    int stop = 0, r = 0;
+
+    for (r = 0; r < TEST_READERS; r++) {
+
+        args[r].fib = fib;
+        args[r].requests = &requests;
+        args[r].expected = &expected;
+        args[r].reader = rcu_register(pt_rcu);
+        args[r].stop = &stop;
+        args[r].lookups = 0;
+        args[r].misses = 0;
+    }
+
+    for (r = 0; r < TEST_READERS; r++)
+        pthread_create(&readers[r], NULL, reader_run, &args[r]);
+
+    // the writer: adds all churn URLs, then removes them, in rounds
+    char url[PREFIX_MAX_LENGTH];
+    int updates = 0, added = 0, removed = 0;
+
+    while (updates < TEST_UPDATES) {
+
+        for (int i = 0; i < (int) churn_urls.size(); i++, updates++) {
+
+            snprintf(url, PREFIX_MAX_LENGTH, "%s", churn_urls[i].c_str());
+            added += (pt_ht_add_url(&fib, url, NULL) == 0);
+        }
+
+        for (int i = (int) churn_urls.size() - 1; i >= 0; i--, updates++) {
+
+            snprintf(url, PREFIX_MAX_LENGTH, "%s", churn_urls[i].c_str());
+            removed += (pt_ht_remove_url(fib, url, NULL) == 0);
+        }
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+
+    unsigned long lookups = 0, misses = 0;
+
+    for (r = 0; r < TEST_READERS; r++) {
+
+        pthread_join(readers[r], NULL);
+
+        lookups += args[r].lookups;
+        misses += args[r].misses;
+    }
+
+    // w/ no readers left, the epoch can advance until all is reclaimed
+    for (r = 0; r < RCU_EPOCHS; r++)
+        rcu_reclaim(pt_rcu);
+
+    printf("test_rcu : %d adds, %d removes, %lu lookups, %lu misses, %lu / %lu nodes reclaimed\n",
+        added, removed, lookups, misses,
+        (unsigned long) pt_rcu->num_reclaimed, (unsigned long) pt_rcu->num_retired);
+
+    assert(added > 0 && added == removed);
+    assert(lookups > 0 && misses == 0);
+    assert(pt_rcu->num_retired > 0 && pt_rcu->num_reclaimed == pt_rcu->num_retired);
+
+    // back to the original FIB
+    std::vector<std::string> after;
+    pt_ht_get_prefixes(fib, after);
+    std::sort(after.begin(), after.end());
+    assert(pt_ht_check(fib) && after == prefixes);
+
+    // concurrent pt_ht_lookup() callers, each w/ its own reader id
+    assert(n >= TEST_LOOKUPS);
+
+    std::vector<uint32_t> expected_sizes(TEST_LOOKUPS * 2 * BF_MAX_ELEMENTS, 0);
+    std::vector<struct pt_port_set> expected_ports(TEST_LOOKUPS);
+
+    stats_reset(fib);
+
+    for (int i = 0; i < TEST_LOOKUPS; i++) {
+
+        uint32_t * sizes = &expected_sizes[i * 2 * BF_MAX_ELEMENTS];
+        pt_ht_lookup(fib, requests[i].name, requests[i].size, requests[i].rid, sizes, sizes + BF_MAX_ELEMENTS, &expected_ports[i], PT_READER_NONE);
+    }
+
+    for (int i = 0; i < n; i++) {
+
+        uint32_t sizes[2 * BF_MAX_ELEMENTS];
+        test_fib_lookup(fib, &requests[i], sizes, NULL);
+    }
+
+    uint64_t expected_stats = stats_total(fib);
+    stats_reset(fib);
+
+    pthread_t lookupers[TEST_READERS];
+    struct lookup_args largs[TEST_READERS];
+    unsigned long mismatches = 0;
+
+    for (r = 0; r < TEST_READERS; r++) {
+
+        largs[r].fib = fib;
+        largs[r].requests = &requests;
+        largs[r].expected_sizes = &expected_sizes;
+        largs[r].expected_ports = &expected_ports;
+        largs[r].reader = args[r].reader;
+        largs[r].mismatches = 0;
+
+        pthread_create(&lookupers[r], NULL, lookup_run, &largs[r]);
+    }
+
+    for (r = 0; r < TEST_READERS; r++) {
+
+        pthread_join(lookupers[r], NULL);
+        mismatches += largs[r].mismatches;
+    }
+
+    printf("test_rcu : %d x %d concurrent pt_ht_lookup() calls, %lu mismatches, %lu / %lu stats updates\n",
+        TEST_READERS, TEST_LOOKUPS, mismatches,
+        (unsigned long) stats_total(fib), (unsigned long) (TEST_READERS * expected_stats));
+
+    assert(expected_stats > 0 && mismatches == 0);
+    assert(stats_total(fib) == TEST_READERS * expected_stats);
+
+    rcu_erase(pt_rcu);
+    pt_rcu = NULL;
+
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * test_snapshot.c
+ *
+ * a FIB loaded from a snapshot must return the same matches and LPM next
+ * hops as the FIB it was saved from, before and after it is thawed, and be
+ * saved to the same file again. snapshots w/ out of range node links or
+ * prefix offsets, duplicate partitions or a truncated payload must be
+ * rejected on load.
+ *
+ * Antonio Rodrigues <antonior@andrew.cmu.edu>
+ *
+ * Copyright 2015 Carnegie Mellon University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <algorithm>
+
+#include "test_fib.h"
+#include "snapshot.h"
+
+static std::vector<char> read_file(const char * filename) {
+
+    std::vector<char> buf;
+    FILE * f = fopen(filename, "rb");
+
+    assert(f != NULL);
+    fseek(f, 0, SEEK_END);
+    buf.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    assert(fread(buf.data(), 1, buf.size(), f) == buf.size());
+    fclose(f);
+
+    return buf;
+}
+
+static void write_file(const char * filename, std::vector<char> & buf, size_t size) {
+
+    FILE * f = fopen(filename, "wb");
+
+    assert(f != NULL);
+    assert(fwrite(buf.data(), 1, size, f) == size);
+    fclose(f);
+}
+
+/*
+ * \brief   true if a (corrupt) snapshot image is rejected by snapshot_load()
+ *          and leaves the FIB alone.
+ */
+static int rejected(const char * filename, std::vector<char> & buf, size_t size) {
+
+    struct pt_ht * fib = NULL;
+    struct rid_perm perm;
+    int has_perm = 0;
+
+    write_file(filename, buf, size);
+
+    struct snapshot * snap = snapshot_load(filename, &fib, &perm, &has_perm, 0);
+
+    if (snap != NULL) {
+
+        pt_ht_erase(fib);
+        snapshot_unmap(snap);
+
+        return 0;
+    }
+
+    return (fib == NULL);
+}
+
+/*
+ * \brief   re-computes the header checksum of a snapshot image, so that
+ *          corruptions of the partition table get past it.
+ */
+static void reseal(std::vector<char> & buf) {
+
+    struct snapshot_header * header = (struct snapshot_header *) buf.data();
+
+    header->header_checksum = 0;
+    header->header_checksum = fnv1a(
+        fnv1a(FNV_OFFSET_BASIS, header, sizeof(struct snapshot_header)),
+        buf.data() + header->parts_off, header->num_parts * sizeof(struct snapshot_part));
+}
+
+int main(int argc, char **argv) {
+
+    std::vector<std::string> urls;
+    std::vector<struct rid_request> requests;
+    struct pt_ht * fib = NULL, * snap_fib = NULL;
+    struct rid_perm perm;
+    int has_perm = 0;
+
+    char filename[PREFIX_MAX_LENGTH];
+    snprintf(filename, PREFIX_MAX_LENGTH, "/tmp/test_snapshot.%d", (int) getpid());
+
+    assert(test_fib_read((argc > 1 ? argv[1] : TEST_URL_FILE), urls) > 0);
+    assert(test_fib_build(&fib, urls) > 0);
+    test_requests_build(urls, requests);
+
+    // round trip
+    assert(snapshot_save(fib, NULL, filename) == 0);
+
+    struct snapshot * snap = snapshot_load(filename, &snap_fib, &perm, &has_perm, 1);
+
+    assert(snap != NULL && has_perm == 0);
+    assert(HASH_COUNT(fib) == HASH_COUNT(snap_fib));
+    assert(pt_ht_check(snap_fib));
+
+    uint32_t sizes[2 * BF_MAX_ELEMENTS], snap_sizes[2 * BF_MAX_ELEMENTS];
+    struct pt_port_set ports, snap_ports;
+    int i = 0;
+
+    for (struct pt_ht * itr = snap_fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next) {
+
+        assert(itr->frozen && itr->engine == PT_ENGINE_FLAT);
+        assert(itr->num_entries == pt_ht_search(fib, itr->prefix_size)->num_entries);
+    }
+
+    // save -> load -> save: mapped partitions only write their own strings
+    char resave_filename[PREFIX_MAX_LENGTH];
+    snprintf(resave_filename, PREFIX_MAX_LENGTH, "%s.resave", filename);
+
+    assert(snapshot_save(snap_fib, NULL, resave_filename) == 0);
+    assert(read_file(resave_filename) == read_file(filename));
+
+    // frozen (flat trie engine): same matches and next hops
+    for (i = 0; i < (int) requests.size(); i++) {
+
+        test_fib_lookup(fib, &requests[i], sizes, &ports);
+        test_fib_lookup(snap_fib, &requests[i], snap_sizes, &snap_ports);
+
+        assert(memcmp(sizes, snap_sizes, sizeof(sizes)) == 0);
+        assert(memcmp(&ports, &snap_ports, sizeof(ports)) == 0);
+    }
+
+    // LPM forwarding on the frozen FIB: same next hops and match sizes, w/
+    // and w/o name checks. lookups don't thaw partitions.
+    uint16_t next_hop = 0, snap_next_hop = 0;
+
+    for (i = 0; i < (int) requests.size(); i++) {
+
+        for (int verify = 0; verify < 2; verify++) {
+
+            assert(pt_ht_lookup_lpm(fib, requests[i].name, requests[i].size, requests[i].rid, verify, &next_hop, NULL)
+                == pt_ht_lookup_lpm(snap_fib, requests[i].name, requests[i].size, requests[i].rid, verify, &snap_next_hop, NULL));
+            assert(next_hop == snap_next_hop);
+        }
+
+        assert(pt_ht_next_hop(fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE)
+            == pt_ht_next_hop(snap_fib, requests[i].name, requests[i].size, requests[i].rid, 1, PT_READER_NONE));
+    }
+
+    for (struct pt_ht * itr = snap_fib; itr != NULL; itr = (struct pt_ht *) itr->hh.next)
+        assert(itr->frozen && itr->engine == PT_ENGINE_FLAT);
+
+    // thawed (PT engine): same entries, matches and next hops
+    pt_ht_thaw(snap_fib);
+    pt_ht_set_engine(snap_fib, PT_ENGINE_PT);
+    assert(pt_ht_check(snap_fib));
+
+    std::vector<std::string> prefixes, snap_prefixes;
+    pt_ht_get_prefixes(fib, prefixes);
+    pt_ht_get_prefixes(snap_fib, snap_prefixes);
+    std::sort(prefixes.begin(), prefixes.end());
+    std::sort(snap_prefixes.begin(), snap_prefixes.end());
+    assert(prefixes == snap_prefixes);
+
+    for (i = 0; i < (int) requests.size(); i++) {
+
+        test_fib_lookup(fib, &requests[i], sizes, &ports);
+        test_fib_lookup(snap_fib, &requests[i], snap_sizes, &snap_ports);
+
+        assert(memcmp(sizes, snap_sizes, sizeof(sizes)) == 0);
+        assert(memcmp(&ports, &snap_ports, sizeof(ports)) == 0);
+    }
+
+    pt_ht_erase(snap_fib);
+    snapshot_unmap(snap);
+
+    // corrupt images
+    std::vector<char> image = read_file(filename), buf;
+    struct snapshot_header * header = (struct snapshot_header *) image.data();
+    struct pt_flat_node * nodes = NULL;
+    struct snapshot_part * parts = NULL;
+
+    // sanity check of the helpers: an untouched image loads
+    buf = image;
+    assert(!rejected(filename, buf, buf.size()));
+
+    buf = image;
+    nodes = (struct pt_flat_node *) (buf.data() + header->nodes_off);
+    nodes[header->num_nodes / 2].p_left = header->num_nodes;
+    assert(rejected(filename, buf, buf.size()));
+
+    buf = image;
+    nodes = (struct pt_flat_node *) (buf.data() + header->nodes_off);
+    nodes[header->num_nodes - 1].p_right = 0xFFFFFFFF;
+    assert(rejected(filename, buf, buf.size()));
+
+    buf = image;
+    nodes = (struct pt_flat_node *) (buf.data() + header->nodes_off);
+    nodes[1].prefix = header->strings_size;
+    assert(rejected(filename, buf, buf.size()));
+
+    buf = image;
+    nodes = (struct pt_flat_node *) (buf.data() + header->nodes_off);
+    nodes[1].key_bit = PT_MAX_DEPTH;
+    assert(rejected(filename, buf, buf.size()));
+
+    buf = image;
+    buf[header->strings_off + header->strings_size - 1] = 'x';
+    assert(rejected(filename, buf, buf.size()));
+
+    // partition table corruptions w/ a valid header checksum
+    assert(header->num_parts > 1);
+    buf = image;
+    parts = (struct snapshot_part *) (buf.data() + header->parts_off);
+    parts[1].prefix_size = parts[0].prefix_size;
+    reseal(buf);
+    assert(rejected(filename, buf, buf.size()));
+
+    buf = image;
+    parts = (struct snapshot_part *) (buf.data() + header->parts_off);
+    parts[0].first_node = header->num_nodes;
+    reseal(buf);
+    assert(rejected(filename, buf, buf.size()));
+
+    buf = image;
+    assert(rejected(filename, buf, buf.size() / 2));
+
+    printf("test_snapshot : round trip and corrupt images ok (%d partitions, %lu nodes)\n",
+        (int) header->num_parts, (unsigned long) header->num_nodes);
+
+    unlink(filename);
+    unlink(resave_filename);
+    pt_ht_erase(fib);
+    test_requests_erase(requests);
+
+    return 0;
+}